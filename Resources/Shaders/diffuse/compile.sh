@@ -1,3 +0,0 @@
-~/vulkan/VulkanSDK/1.0.26.0/x86_64/bin/glslangValidator -V diffuse.vert -o diffuse-vert.spv
-~/vulkan/VulkanSDK/1.0.26.0/x86_64/bin/glslangValidator -V diffuse.frag -o diffuse-frag.spv
-
@@ -1,15 +1,25 @@
 #version 450
 layout(location = 0) in vec4 position;
 layout(location = 1) in vec3 appNormal;
+//Per instance world matrix, locations 2 to 5.
+layout(location = 2) in mat4 instanceMatrix;
 layout(set = 0, binding = 0) uniform uniformBuffer{
 	mat4 modelViewMatrix;
 	mat4 projectionMatrix;
 };
+//Per draw parameters, pushed with every draw. diffusefallback.vert reads them from a
+//uniform buffer on devices with too little push constant space.
+layout(push_constant) uniform DrawParameters{
+	mat4 transform;
+	uint objectIndex;
+	uint materialIndex;
+} draw;
 layout(location = 0) out float vertexColor;
 
 void main()
 {
-	gl_Position = projectionMatrix * modelViewMatrix * position;
-	vec3 normal = mat3(modelViewMatrix) * appNormal;	
+	mat4 instanceModelViewMatrix = modelViewMatrix * instanceMatrix * draw.transform;
+	gl_Position = projectionMatrix * instanceModelViewMatrix * position;
+	vec3 normal = mat3(instanceModelViewMatrix) * appNormal;	
 	vertexColor = max(0.0, dot(normal, vec3(0.58, 0.58, 0.58)))+0.1;
 }
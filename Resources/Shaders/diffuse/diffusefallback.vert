@@ -0,0 +1,25 @@
+#version 450
+layout(location = 0) in vec4 position;
+layout(location = 1) in vec3 appNormal;
+//Per instance world matrix, locations 2 to 5.
+layout(location = 2) in mat4 instanceMatrix;
+layout(set = 0, binding = 0) uniform uniformBuffer{
+	mat4 modelViewMatrix;
+	mat4 projectionMatrix;
+};
+//Per draw parameters, at the draw's offset into the uniform ring. Used instead of
+//diffuse.vert on devices with too little push constant space.
+layout(set = 0, binding = 1) uniform DrawParameters{
+	mat4 transform;
+	uint objectIndex;
+	uint materialIndex;
+} draw;
+layout(location = 0) out float vertexColor;
+
+void main()
+{
+	mat4 instanceModelViewMatrix = modelViewMatrix * instanceMatrix * draw.transform;
+	gl_Position = projectionMatrix * instanceModelViewMatrix * position;
+	vec3 normal = mat3(instanceModelViewMatrix) * appNormal;	
+	vertexColor = max(0.0, dot(normal, vec3(0.58, 0.58, 0.58)))+0.1;
+}
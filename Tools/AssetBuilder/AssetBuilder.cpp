@@ -0,0 +1,477 @@
+#include "CookedAssets.h"
+#include "MeshLoader.h"
+#include "MeshletBuilder.h"
+#include "MeshSimplifier.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+//Cooks the source assets of a resource directory into files the engine loads as is:
+//  .obj                          -> .rmesh (indexed positions and normals normalized to a unit
+//                                   cube with simplified levels of detail, split into
+//                                   meshlets with culling bounds)
+//  .png .jpg .jpeg .tga .bmp     -> .rtex  (RGBA8 with a full mip chain)
+//  .vert .frag .comp .geom ...   -> <name>-<stage>.spv (compiled with glslangValidator and
+//                                   checked with spirv-val)
+//Outputs mirror the directory structure of the resources. Every output is recorded
+//in a database together with a hash of the contents of all of its inputs, so only
+//assets whose sources, dependencies or cooking rules changed are rebuilt.
+//
+//Usage: AssetBuilder <resource directory> <output directory>
+//                    [--jobs <count>] [--glslang <path>] [--spirv-val <path>] [--force]
+
+namespace fs = std::filesystem;
+
+//Bump when the cooking rules change so every asset is rebuilt.
+static const char *BUILDER_VERSION = "AssetBuilder 4";
+//Attributes of every cooked mesh, matching the vertex layout of the engine pipelines.
+static const uint32_t MESH_ATTRIBUTES = Raven::COOKED_MESH_ATTRIBUTE_NORMAL_BIT;
+//Levels of detail of every mesh part including the full part, each with half the triangles
+//of the previous one. Meshes are normalized so the error limit is relative to their size.
+static const uint32_t MESH_LOD_COUNT = 4;
+static const float MESH_LOD_REDUCTION = 0.5f;
+static const float MESH_LOD_MAX_ERROR = 0.05f;
+
+enum class JobType
+{
+    Mesh,
+    Texture,
+    Shader
+};
+
+struct BuildJob
+{
+    JobType type;
+    fs::path source;
+    fs::path output;
+    //Relative output path, used as the key in the database.
+    std::string name;
+    //The source and every file it includes.
+    std::vector<fs::path> dependencies;
+    uint64_t hash;
+    bool succeeded = false;
+};
+
+//Paths of the external shader tools.
+struct ShaderTools
+{
+    std::string glslang = "glslangValidator";
+    std::string spirvVal = "spirv-val";
+};
+
+static std::mutex outputMutex;
+
+static void printUsage()
+{
+    std::cout << "Usage: AssetBuilder <resource directory> <output directory> "
+                 "[--jobs <count>] [--glslang <path>] [--spirv-val <path>] [--force]" << std::endl;
+}
+
+static std::string toLower(std::string text)
+{
+    std::transform(text.begin(), text.end(), text.begin(), ::tolower);
+    return text;
+}
+
+//Continues a 64-bit FNV-1a hash with more bytes.
+static uint64_t hashBytes(uint64_t hash, const char *data, size_t size)
+{
+    for(size_t i = 0; i < size; ++i)
+    {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+static uint64_t hashString(uint64_t hash, const std::string &text)
+{
+    //The terminating zero keeps "ab"+"c" and "a"+"bc" apart.
+    return hashBytes(hash, text.c_str(), text.size() + 1);
+}
+
+//Returns the lines of a text file, or nothing if it can not be opened.
+static std::vector<std::string> readLines(const fs::path &filename)
+{
+    std::vector<std::string> lines;
+    std::ifstream file(filename);
+    std::string line;
+    while(std::getline(file, line))
+        lines.push_back(line);
+    return lines;
+}
+
+//Adds the material libraries an .obj-file refers to.
+static void findObjDependencies(const fs::path &source, std::vector<fs::path> &dependencies)
+{
+    for(const std::string &line : readLines(source))
+    {
+        std::istringstream stream(line);
+        std::string keyword;
+        stream >> keyword;
+        if(keyword != "mtllib")
+            continue;
+        std::string library;
+        while(stream >> library)
+            dependencies.push_back(source.parent_path() / library);
+    }
+}
+
+//Adds every file a shader includes with #include "file", recursively.
+static void findShaderDependencies(const fs::path &source, std::vector<fs::path> &dependencies)
+{
+    for(const std::string &line : readLines(source))
+    {
+        size_t position = line.find_first_not_of(" \t");
+        if(position == std::string::npos || line.compare(position, 8, "#include") != 0)
+            continue;
+        size_t begin = line.find('"', position);
+        size_t end = begin == std::string::npos ? begin : line.find('"', begin + 1);
+        if(end == std::string::npos)
+            continue;
+
+        fs::path include = source.parent_path() / line.substr(begin + 1, end - begin - 1);
+        if(std::find(dependencies.begin(), dependencies.end(), include) != dependencies.end())
+            continue;
+        dependencies.push_back(include);
+        findShaderDependencies(include, dependencies);
+    }
+}
+
+//Hashes the cooking rules and the contents of every dependency.
+static uint64_t hashJob(const BuildJob &job, const fs::path &resourceDirectory)
+{
+    uint64_t hash = 14695981039346656037ull;
+    hash = hashString(hash, BUILDER_VERSION);
+    hash = hashString(hash, std::to_string(static_cast<int>(job.type)));
+    hash = hashString(hash, job.name);
+    if(job.type == JobType::Mesh)
+    {
+        hash = hashString(hash, std::to_string(MESH_ATTRIBUTES));
+        hash = hashString(hash, std::to_string(MESH_LOD_COUNT) + " " + std::to_string(MESH_LOD_REDUCTION) +
+                                " " + std::to_string(MESH_LOD_MAX_ERROR));
+    }
+
+    std::vector<char> buffer(1 << 16);
+    for(const fs::path &dependency : job.dependencies)
+    {
+        hash = hashString(hash, fs::relative(dependency, resourceDirectory).generic_string());
+        std::ifstream file(dependency, std::ios::binary);
+        if(!file.is_open())
+        {
+            hash = hashString(hash, "<missing>");
+            continue;
+        }
+        while(file)
+        {
+            file.read(buffer.data(), buffer.size());
+            hash = hashBytes(hash, buffer.data(), static_cast<size_t>(file.gcount()));
+        }
+    }
+    return hash;
+}
+
+static std::string quote(const std::string &text)
+{
+    return "\"" + text + "\"";
+}
+
+static void report(const BuildJob &job, const std::string &message)
+{
+    std::lock_guard<std::mutex> lock(outputMutex);
+    std::cout << message << " " << job.name << std::endl;
+}
+
+static bool cookMesh(const BuildJob &job, const fs::path &temporaryOutput)
+{
+    Raven::Mesh mesh;
+    uint32_t vertexStride = 0;
+    if(!Raven::MeshLoader::loadObj(job.source.string(), true, false, false, true, mesh, &vertexStride))
+        return false;
+    Raven::MeshLoader::generateIndices(mesh, vertexStride);
+    if(!mesh.indices.empty() &&
+       (!Raven::MeshSimplifier::generateLods(mesh, vertexStride, MESH_LOD_COUNT, MESH_LOD_REDUCTION, MESH_LOD_MAX_ERROR) ||
+        !Raven::MeshletBuilder::buildMeshlets(mesh, vertexStride)))
+    {
+        return false;
+    }
+    return Raven::CookedAssets::writeMesh(temporaryOutput.string(), mesh, MESH_ATTRIBUTES);
+}
+
+static bool cookTexture(const BuildJob &job, const fs::path &temporaryOutput)
+{
+    int width = 0;
+    int height = 0;
+    int components = 0;
+    std::unique_ptr<unsigned char, void(*)(void*)> pixels(
+                stbi_load(job.source.string().c_str(), &width, &height, &components, 4), stbi_image_free);
+    if(!pixels || width <= 0 || height <= 0)
+    {
+        std::cerr << "Failed to load image file " << job.source.string() << "!" << std::endl;
+        return false;
+    }
+
+    std::vector<Raven::TextureMipLevel> mipLevels;
+    Raven::generateMipChain(pixels.get(), static_cast<uint32_t>(width), static_cast<uint32_t>(height), mipLevels);
+    return Raven::CookedAssets::writeTexture(temporaryOutput.string(), mipLevels);
+}
+
+static int runCommand(std::string command)
+{
+#ifdef _WIN32
+    //cmd.exe strips the outermost quotes of the whole command line.
+    command = quote(command);
+#endif
+    return std::system(command.c_str());
+}
+
+//Shaders are only ever produced by the compiler, and every binary is validated for the
+//vulkan version the engine targets before it replaces the previous one.
+static bool cookShader(const BuildJob &job, const fs::path &temporaryOutput, const ShaderTools &tools)
+{
+    if(runCommand(quote(tools.glslang) + " -V --target-env vulkan1.0 " + quote(job.source.string()) +
+                  " -o " + quote(temporaryOutput.string())) != 0)
+    {
+        std::cerr << "Failed to compile shader " << job.source.string() << "!" << std::endl;
+        return false;
+    }
+    if(runCommand(quote(tools.spirvVal) + " --target-env vulkan1.0 " + quote(temporaryOutput.string())) != 0)
+    {
+        std::cerr << "Failed to validate shader " << job.source.string() << "!" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+//Cooks a single asset. Outputs are written next to their final location and renamed
+//into place so an interrupted build never leaves a truncated file behind.
+static void runJob(BuildJob &job, const ShaderTools &tools)
+{
+    fs::path temporaryOutput = job.output;
+    temporaryOutput += ".tmp";
+
+    bool result = false;
+    switch(job.type)
+    {
+        case JobType::Mesh:
+            result = cookMesh(job, temporaryOutput);
+            break;
+        case JobType::Texture:
+            result = cookTexture(job, temporaryOutput);
+            break;
+        case JobType::Shader:
+            result = cookShader(job, temporaryOutput, tools);
+            break;
+    }
+
+    std::error_code error;
+    if(result)
+    {
+        fs::rename(temporaryOutput, job.output, error);
+        result = !error;
+    }
+    if(!result)
+    {
+        fs::remove(temporaryOutput, error);
+        report(job, "FAILED");
+        return;
+    }
+    job.succeeded = true;
+    report(job, "Cooked");
+}
+
+//Creates a job for a source file, returns false if the file is not a source asset.
+static bool createJob(const fs::path &source, const fs::path &resourceDirectory,
+                      const fs::path &outputDirectory, BuildJob &job)
+{
+    static const char *textureExtensions[] = {".png", ".jpg", ".jpeg", ".tga", ".bmp"};
+    static const char *shaderExtensions[] = {".vert", ".frag", ".comp", ".geom", ".tesc", ".tese"};
+
+    std::string extension = toLower(source.extension().string());
+    fs::path relativePath = fs::relative(source, resourceDirectory);
+    fs::path output = outputDirectory / relativePath;
+
+    if(extension == ".obj")
+    {
+        job.type = JobType::Mesh;
+        output.replace_extension(COOKED_MESH_EXTENSION);
+    }
+    else if(std::find(std::begin(textureExtensions), std::end(textureExtensions), extension) !=
+            std::end(textureExtensions))
+    {
+        job.type = JobType::Texture;
+        output.replace_extension(COOKED_TEXTURE_EXTENSION);
+    }
+    else if(std::find(std::begin(shaderExtensions), std::end(shaderExtensions), extension) !=
+            std::end(shaderExtensions))
+    {
+        //diffuse.vert becomes diffuse-vert.spv, which is what the engine loads.
+        job.type = JobType::Shader;
+        output.replace_filename(source.stem().string() + "-" + extension.substr(1) + ".spv");
+    }
+    else
+    {
+        return false;
+    }
+
+    job.source = source;
+    job.output = output;
+    job.name = fs::relative(output, outputDirectory).generic_string();
+    job.dependencies = {source};
+    if(job.type == JobType::Mesh)
+        findObjDependencies(source, job.dependencies);
+    else if(job.type == JobType::Shader)
+        findShaderDependencies(source, job.dependencies);
+    job.hash = hashJob(job, resourceDirectory);
+    return true;
+}
+
+//The database holds one "<hash> <output name>" line per cooked asset.
+static std::map<std::string, uint64_t> loadDatabase(const fs::path &filename)
+{
+    std::map<std::string, uint64_t> database;
+    for(const std::string &line : readLines(filename))
+    {
+        size_t separator = line.find(' ');
+        if(separator == std::string::npos)
+            continue;
+        database[line.substr(separator + 1)] = std::strtoull(line.substr(0, separator).c_str(), nullptr, 16);
+    }
+    return database;
+}
+
+static bool saveDatabase(const fs::path &filename, const std::map<std::string, uint64_t> &database)
+{
+    fs::path temporaryFilename = filename;
+    temporaryFilename += ".tmp";
+    {
+        std::ofstream file(temporaryFilename, std::ios::trunc);
+        for(const auto &entry : database)
+            file << std::hex << entry.second << " " << entry.first << "\n";
+        if(!file.good())
+        {
+            std::cerr << "Failed to write the asset database!" << std::endl;
+            return false;
+        }
+    }
+    std::error_code error;
+    fs::rename(temporaryFilename, filename, error);
+    return !error;
+}
+
+int main(int argc, char *argv[])
+{
+    if(argc < 3)
+    {
+        printUsage();
+        return 1;
+    }
+
+    fs::path resourceDirectory = fs::absolute(argv[1]);
+    fs::path outputDirectory = fs::absolute(argv[2]);
+    unsigned int jobCount = std::max(1u, std::thread::hardware_concurrency());
+    ShaderTools tools;
+    bool force = false;
+
+    for(int i = 3; i < argc; ++i)
+    {
+        if(std::strcmp(argv[i], "--jobs") == 0 && i + 1 < argc)
+            jobCount = std::max(1ul, std::stoul(argv[++i]));
+        else if(std::strcmp(argv[i], "--glslang") == 0 && i + 1 < argc)
+            tools.glslang = argv[++i];
+        else if(std::strcmp(argv[i], "--spirv-val") == 0 && i + 1 < argc)
+            tools.spirvVal = argv[++i];
+        else if(std::strcmp(argv[i], "--force") == 0)
+            force = true;
+        else
+        {
+            printUsage();
+            return 1;
+        }
+    }
+
+    std::error_code error;
+    if(!fs::is_directory(resourceDirectory, error))
+    {
+        std::cerr << resourceDirectory.string() << " is not a directory!" << std::endl;
+        return 1;
+    }
+    fs::create_directories(outputDirectory, error);
+
+    //Gather the jobs, skipping the output directory and library sources.
+    std::vector<BuildJob> jobs;
+    for(fs::recursive_directory_iterator iterator(resourceDirectory), end; iterator != end; ++iterator)
+    {
+        if(iterator->is_directory() &&
+           (fs::equivalent(iterator->path(), outputDirectory, error) ||
+            fs::relative(iterator->path(), resourceDirectory) == "Libraries"))
+        {
+            iterator.disable_recursion_pending();
+            continue;
+        }
+        BuildJob job;
+        if(iterator->is_regular_file() && createJob(iterator->path(), resourceDirectory, outputDirectory, job))
+            jobs.push_back(std::move(job));
+    }
+
+    //Only cook what is missing or whose inputs changed since the last build.
+    fs::path databaseFilename = outputDirectory / COOKED_ASSET_DATABASE_FILENAME;
+    std::map<std::string, uint64_t> database = loadDatabase(databaseFilename);
+    std::vector<BuildJob*> outdatedJobs;
+    for(BuildJob &job : jobs)
+    {
+        auto entry = database.find(job.name);
+        if(force || entry == database.end() || entry->second != job.hash || !fs::exists(job.output, error))
+        {
+            fs::create_directories(job.output.parent_path(), error);
+            outdatedJobs.push_back(&job);
+        }
+        else
+        {
+            job.succeeded = true;
+        }
+    }
+
+    //The jobs do not depend on each other so they are simply shared between the workers.
+    std::atomic<size_t> nextJob(0);
+    std::vector<std::thread> workers;
+    unsigned int workerCount = static_cast<unsigned int>(std::min<size_t>(jobCount, outdatedJobs.size()));
+    for(unsigned int i = 0; i < workerCount; ++i)
+    {
+        workers.emplace_back([&]()
+        {
+            for(size_t index = nextJob++; index < outdatedJobs.size(); index = nextJob++)
+                runJob(*outdatedJobs[index], tools);
+        });
+    }
+    for(std::thread &worker : workers)
+        worker.join();
+
+    //Failed jobs are left out of the database so they run again next time.
+    std::map<std::string, uint64_t> newDatabase;
+    size_t failedCount = 0;
+    for(const BuildJob &job : jobs)
+    {
+        if(job.succeeded)
+            newDatabase[job.name] = job.hash;
+        if(!job.succeeded)
+            ++failedCount;
+    }
+    saveDatabase(databaseFilename, newDatabase);
+
+    std::cout << "Cooked " << outdatedJobs.size() - failedCount << " of " << outdatedJobs.size()
+              << " outdated assets, " << jobs.size() - outdatedJobs.size() << " up to date." << std::endl;
+    return failedCount == 0 ? 0 : 1;
+}
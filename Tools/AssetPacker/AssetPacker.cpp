@@ -0,0 +1,105 @@
+#include "AssetArchive.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+//Packs every file under a resource directory into a Raven asset pack.
+//Entry names are the paths relative to the resource directory with forward
+//slashes, which is what FileIO::getArchiveAssetName produces at runtime.
+//
+//Usage: AssetPacker <resource directory> <output pack> [--lz4] [--align <bytes>]
+
+namespace fs = std::filesystem;
+
+//File types that are already compressed and would not shrink any further.
+static bool isCompressedFormat(const fs::path &path)
+{
+    std::string extension = path.extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+    return extension == ".png" || extension == ".jpg" || extension == ".jpeg" || extension == ".rpak";
+}
+
+static void printUsage()
+{
+    std::cout << "Usage: AssetPacker <resource directory> <output pack> [--lz4] [--align <bytes>]" << std::endl;
+}
+
+int main(int argc, char *argv[])
+{
+    if(argc < 3)
+    {
+        printUsage();
+        return 1;
+    }
+
+    fs::path resourceDirectory = argv[1];
+    fs::path outputFile = argv[2];
+    Raven::AssetCompression compression = Raven::AssetCompression::None;
+    uint32_t alignment = ASSET_ARCHIVE_DEFAULT_ALIGNMENT;
+
+    for(int i = 3; i < argc; ++i)
+    {
+        if(std::strcmp(argv[i], "--lz4") == 0)
+            compression = Raven::AssetCompression::LZ4;
+        else if(std::strcmp(argv[i], "--align") == 0 && i + 1 < argc)
+            alignment = static_cast<uint32_t>(std::stoul(argv[++i]));
+        else
+        {
+            printUsage();
+            return 1;
+        }
+    }
+
+    if(alignment == 0 || (alignment & (alignment - 1)) != 0)
+    {
+        std::cerr << "Alignment has to be a power of two!" << std::endl;
+        return 1;
+    }
+
+    std::error_code error;
+    if(!fs::is_directory(resourceDirectory, error))
+    {
+        std::cerr << resourceDirectory.string() << " is not a directory!" << std::endl;
+        return 1;
+    }
+
+    //Gather the files first so the pack contents do not depend on directory iteration order.
+    std::vector<fs::path> files;
+    fs::path absoluteOutput = fs::absolute(outputFile);
+    for(const fs::directory_entry &entry : fs::recursive_directory_iterator(resourceDirectory))
+    {
+        if(!entry.is_regular_file())
+            continue;
+        //Never pack the pack itself or any library sources.
+        if(fs::absolute(entry.path()) == absoluteOutput)
+            continue;
+        fs::path relativePath = fs::relative(entry.path(), resourceDirectory);
+        if(relativePath.begin()->string() == "Libraries")
+            continue;
+        files.push_back(entry.path());
+    }
+    std::sort(files.begin(), files.end());
+
+    Raven::AssetArchiveWriter writer(alignment);
+    uint64_t originalBytes = 0;
+    for(const fs::path &file : files)
+    {
+        std::string name = fs::relative(file, resourceDirectory).generic_string();
+        Raven::AssetCompression fileCompression =
+                isCompressedFormat(file) ? Raven::AssetCompression::None : compression;
+
+        if(!writer.addFile(name, file.string(), fileCompression))
+            return 1;
+        originalBytes += fs::file_size(file, error);
+    }
+
+    if(!writer.write(outputFile.string()))
+        return 1;
+
+    std::cout << "Packed " << writer.getEntryCount() << " files (" << originalBytes << " bytes) into "
+              << outputFile.string() << " (" << fs::file_size(outputFile, error) << " bytes)." << std::endl;
+    return 0;
+}
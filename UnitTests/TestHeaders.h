@@ -1,4 +1,7 @@
 #pragma once
+#include <filesystem>
+#include <fstream>
+#include <map>
 #include <iostream>
 #include <gtest/gtest.h>
 #include <string>
@@ -13,6 +16,10 @@
 #include "VulkanDestroyer.h"
 #include "VulkanDestroyer.cpp"
 #include "Headers.h"
+#include "Compression.h"
+#include "Compression.cpp"
+#include "AssetArchive.h"
+#include "AssetArchive.cpp"
 #include "FileIO.h"
 #include "FileIO.cpp"
 #include "CommandBufferManager.h"
@@ -37,5 +44,56 @@
 #include "VulkanPipeline.cpp"
 #include "RavenEngine.h"
 #include "RavenEngine.cpp"
+#include "Mesh.h"
+#include "MeshLoader.h"
+#include "MeshLoader.cpp"
+#include "MeshletBuilder.h"
+#include "MeshletBuilder.cpp"
+#include "MeshSimplifier.h"
+#include "MeshSimplifier.cpp"
+#include "CookedAssets.h"
+#include "CookedAssets.cpp"
+#include "TextureStreamer.h"
+#include "TextureStreamer.cpp"
 #include "GraphicsObject.h"
 #include "GraphicsObject.cpp"
+#include "ThreadPool.h"
+#include "ThreadPool.cpp"
+#include "Scene.h"
+#include "Scene.cpp"
+#include "FrustumCuller.h"
+#include "FrustumCuller.cpp"
+#include "GpuCuller.h"
+#include "GpuCuller.cpp"
+#include "InstanceBatcher.h"
+#include "InstanceBatcher.cpp"
+#include "RenderQueue.h"
+#include "RenderQueue.cpp"
+#include "Bvh.h"
+#include "Bvh.cpp"
+#include "DepthPyramid.h"
+#include "DepthPyramid.cpp"
+#include "QueryPoolManager.h"
+#include "QueryPoolManager.cpp"
+#include "EntityStore.h"
+#include "EntityStore.cpp"
+#include "ResourceRegistry.h"
+#include "ResourceRegistry.cpp"
+#include "RenderGraph.h"
+#include "RenderGraph.cpp"
+#include "BarrierBatch.h"
+#include "BarrierBatch.cpp"
+#include "SyncObjectPool.h"
+#include "SyncObjectPool.cpp"
+#include "QueueSubmitter.h"
+#include "QueueSubmitter.cpp"
+#include "GpuTimeline.h"
+#include "GpuTimeline.cpp"
+#include "QueueScheduler.h"
+#include "QueueScheduler.cpp"
+#include "PostProcessChain.h"
+#include "PostProcessChain.cpp"
+#include "UniformRing.h"
+#include "UniformRing.cpp"
+#include "DrawParameters.h"
+#include "DrawParameters.cpp"
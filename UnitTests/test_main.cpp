@@ -301,6 +301,98 @@ TEST_F(PhysicalDeviceTest, createCommandPoolTest)
 }
 
 /**PHYSICAL DEVICE TESTS END**/
+
+//A file in the temporary directory that is removed when the test ends.
+struct TemporaryFile
+{
+    std::string path;
+    TemporaryFile(const std::string &filename)
+        : path((std::filesystem::temp_directory_path() / filename).string()) {}
+    ~TemporaryFile()
+    {
+        std::error_code error;
+        std::filesystem::remove(path, error);
+    }
+};
+
+//A fake device. The device level functions are saved before every test and restored after it,
+//buffers are backed by host memory and tests replace the functions they want to watch.
+struct MockDeviceTest : testing::Test
+{
+#define DEVICE_LEVEL_VULKAN_FUNCTION( name ) PFN_##name saved_##name;
+#define DEVICE_LEVEL_VULKAN_FUNCTION_FROM_EXTENSION( name, extension ) PFN_##name saved_##name;
+#include "ListOfVulkanFunctions.inl"
+
+    static inline uint64_t nextHandle = 1;
+    static inline VkDeviceSize lastBufferSize = 0;
+    static inline std::map<uint64_t, std::vector<uint8_t>> allocations;
+    static inline uint8_t *lastMappedMemory = nullptr;
+    VkDevice device;
+    VkCommandBuffer cmdBuffer;
+
+    void SetUp() override
+    {
+#define DEVICE_LEVEL_VULKAN_FUNCTION( name ) saved_##name = name;
+#define DEVICE_LEVEL_VULKAN_FUNCTION_FROM_EXTENSION( name, extension ) saved_##name = name;
+#include "ListOfVulkanFunctions.inl"
+        nextHandle = 1;
+        lastBufferSize = 0;
+        allocations.clear();
+        lastMappedMemory = nullptr;
+        std::memset(&device, 0xff, sizeof(device));
+        std::memset(&cmdBuffer, 0xfe, sizeof(cmdBuffer));
+
+        vkCreateBuffer = [](VkDevice, const VkBufferCreateInfo *createInfo, const VkAllocationCallbacks*,
+                            VkBuffer *buffer)
+        {
+            lastBufferSize = createInfo->size;
+            return makeHandle(*buffer);
+        };
+        vkGetBufferMemoryRequirements = [](VkDevice, VkBuffer, VkMemoryRequirements *memReq)
+        {
+            *memReq = {lastBufferSize, 256, ~0u};
+        };
+        vkAllocateMemory = [](VkDevice, const VkMemoryAllocateInfo *allocateInfo, const VkAllocationCallbacks*,
+                              VkDeviceMemory *memory)
+        {
+            makeHandle(*memory);
+            allocations[handleValue(*memory)].assign(static_cast<size_t>(allocateInfo->allocationSize), 0);
+            return VK_SUCCESS;
+        };
+        vkBindBufferMemory = [](VkDevice, VkBuffer, VkDeviceMemory, VkDeviceSize) {return VK_SUCCESS;};
+        vkMapMemory = [](VkDevice, VkDeviceMemory memory, VkDeviceSize offset, VkDeviceSize, VkMemoryMapFlags,
+                         void **data)
+        {
+            lastMappedMemory = allocations[handleValue(memory)].data() + offset;
+            *data = lastMappedMemory;
+            return VK_SUCCESS;
+        };
+        vkFlushMappedMemoryRanges = [](VkDevice, uint32_t, const VkMappedMemoryRange*) {return VK_SUCCESS;};
+        vkUnmapMemory = [](VkDevice, VkDeviceMemory){};
+        vkFreeMemory = [](VkDevice, VkDeviceMemory memory, const VkAllocationCallbacks*)
+        {
+            allocations.erase(handleValue(memory));
+        };
+        vkDestroyBuffer = [](VkDevice, VkBuffer, const VkAllocationCallbacks*){};
+    }
+
+    void TearDown() override
+    {
+#define DEVICE_LEVEL_VULKAN_FUNCTION( name ) name = saved_##name;
+#define DEVICE_LEVEL_VULKAN_FUNCTION_FROM_EXTENSION( name, extension ) name = saved_##name;
+#include "ListOfVulkanFunctions.inl"
+    }
+
+    template<typename Handle>
+    static VkResult makeHandle(Handle &handle)
+    {
+        std::memset(&handle, 0, sizeof(handle));
+        std::memcpy(&handle, &nextHandle, sizeof(handle) < sizeof(nextHandle) ? sizeof(handle) : sizeof(nextHandle));
+        ++nextHandle;
+        return VK_SUCCESS;
+    }
+};
+
 TEST(FileIOTests, shaderTest)
 {
     std::vector<char> testShader =
@@ -309,6 +401,1720 @@ TEST(FileIOTests, shaderTest)
     EXPECT_FALSE(testShader.empty());
 }
 
+TEST(FileIOTests, assetArchiveRoundTripTest)
+{
+    std::string text = "Raven asset archive test, Raven asset archive test, Raven asset archive test.";
+    std::vector<char> binary(1000, 7);
+    TemporaryFile archiveFile("raven-test.rpak");
+
+    AssetArchiveWriter writer;
+    EXPECT_TRUE(writer.addData("Shaders/test.txt", text.data(), text.size(), AssetCompression::LZ4));
+    EXPECT_TRUE(writer.addData("Models/test.bin", binary.data(), binary.size()));
+    EXPECT_FALSE(writer.addData("Models/test.bin", binary.data(), binary.size()));
+    EXPECT_TRUE(writer.write(archiveFile.path));
+
+    AssetArchive archive;
+    ASSERT_TRUE(archive.open(archiveFile.path));
+    EXPECT_EQ(archive.getEntryCount(), 2u);
+    EXPECT_FALSE(archive.contains("Models/missing.bin"));
+
+    AssetSpan span;
+    ASSERT_TRUE(archive.getAsset("Shaders/test.txt", span));
+    EXPECT_EQ(std::string(span.data, span.size), text);
+    ASSERT_TRUE(archive.getAsset("Models/test.bin", span));
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(span.data) % ASSET_ARCHIVE_DEFAULT_ALIGNMENT, 0u);
+
+    //Mounted packs are read through FileIO with paths relative to Resources.
+    FileIO::mountArchive(&archive);
+    std::vector<char> contents = FileIO::readBinaryFile("../../Resources/Models/test.bin");
+    FileIO::mountArchive(nullptr);
+    EXPECT_EQ(contents, binary);
+}
+
+TEST(FileIOTests, cookedAssetRoundTripTest)
+{
+    Mesh mesh;
+    mesh.data = {0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f,
+                 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f,
+                 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f};
+    mesh.parts = {{0, 3}};
+    TemporaryFile cookedMeshFile("raven-test.rmesh");
+    TemporaryFile cookedTextureFile("raven-test.rtex");
+    ASSERT_TRUE(CookedAssets::writeMesh(cookedMeshFile.path, mesh, COOKED_MESH_ATTRIBUTE_NORMAL_BIT));
+
+    Mesh cookedMesh;
+    uint32_t attributes, vertexStride;
+    ASSERT_TRUE(CookedAssets::readMesh(FileIO::readBinaryFile(cookedMeshFile.path), cookedMesh,
+                                       &attributes, &vertexStride));
+    EXPECT_EQ(cookedMesh.data, mesh.data);
+    EXPECT_EQ(cookedMesh.parts.size(), 1u);
+    EXPECT_EQ(attributes, static_cast<uint32_t>(COOKED_MESH_ATTRIBUTE_NORMAL_BIT));
+    EXPECT_EQ(vertexStride, 6 * sizeof(float));
+
+    std::vector<unsigned char> pixels(16 * 8 * 4, 50);
+    std::vector<TextureMipLevel> mipLevels;
+    generateMipChain(pixels.data(), 16, 8, mipLevels);
+    ASSERT_TRUE(CookedAssets::writeTexture(cookedTextureFile.path, mipLevels));
+
+    std::vector<char> textureFile = FileIO::readBinaryFile(cookedTextureFile.path);
+    std::vector<TextureMipLevel> cookedMipLevels;
+    ASSERT_TRUE(CookedAssets::readTexture(textureFile, cookedMipLevels));
+    ASSERT_EQ(cookedMipLevels.size(), mipLevels.size());
+    EXPECT_EQ(cookedMipLevels.back().pixels, mipLevels.back().pixels);
+
+    //Truncated files are rejected instead of read past the end.
+    textureFile.pop_back();
+    EXPECT_FALSE(CookedAssets::readTexture(textureFile, cookedMipLevels));
+}
+
+TEST(MeshletTest, buildMeshletsTest)
+{
+    //A flat 20x20 grid of quads facing +z, three vertices per triangle.
+    Mesh mesh;
+    const float corners[6][2] = {{0, 0}, {1, 0}, {1, 1}, {0, 0}, {1, 1}, {0, 1}};
+    for(int y = 0; y < 20; ++y)
+        for(int x = 0; x < 20; ++x)
+            for(auto &corner : corners)
+                mesh.data.insert(mesh.data.end(), {x + corner[0], y + corner[1], 0.0f, 0.0f, 0.0f, 1.0f});
+    mesh.parts = {{0, 20 * 20 * 6}};
+
+    MeshLoader::generateIndices(mesh, 6 * sizeof(float));
+    EXPECT_EQ(mesh.data.size() / 6, 21u * 21u);
+    EXPECT_EQ(mesh.indices.size(), 20u * 20u * 6u);
+
+    ASSERT_TRUE(MeshletBuilder::buildMeshlets(mesh, 6 * sizeof(float)));
+    ASSERT_EQ(mesh.meshletBounds.size(), mesh.meshlets.size());
+    uint32_t triangleCount = 0;
+    for(const Meshlet &meshlet : mesh.meshlets)
+    {
+        EXPECT_LE(meshlet.vertexCount, static_cast<uint32_t>(MESHLET_MAX_VERTICES));
+        EXPECT_LE(meshlet.triangleCount, static_cast<uint32_t>(MESHLET_MAX_TRIANGLES));
+        triangleCount += meshlet.triangleCount;
+    }
+    EXPECT_EQ(triangleCount, 20u * 20u * 2u);
+
+    //The grid is only visible from the front.
+    const MeshletBounds &bounds = mesh.meshletBounds[0];
+    EXPECT_TRUE(MeshletBuilder::isMeshletCulled(bounds, glm::vec3(10.0f, 10.0f, -10.0f), nullptr, 0));
+    EXPECT_FALSE(MeshletBuilder::isMeshletCulled(bounds, glm::vec3(10.0f, 10.0f, 10.0f), nullptr, 0));
+
+    //Cooked meshlets whose triangles point past their own vertices are rejected.
+    TemporaryFile cookedMeshFile("raven-test-meshlets.rmesh");
+    Mesh cookedMesh;
+    ASSERT_TRUE(CookedAssets::writeMesh(cookedMeshFile.path, mesh, COOKED_MESH_ATTRIBUTE_NORMAL_BIT));
+    EXPECT_TRUE(CookedAssets::readMesh(FileIO::readBinaryFile(cookedMeshFile.path), cookedMesh, nullptr, nullptr));
+    mesh.meshletTriangles[mesh.meshlets[0].triangleOffset] = static_cast<uint8_t>(mesh.meshlets[0].vertexCount);
+    ASSERT_TRUE(CookedAssets::writeMesh(cookedMeshFile.path, mesh, COOKED_MESH_ATTRIBUTE_NORMAL_BIT));
+    EXPECT_FALSE(CookedAssets::readMesh(FileIO::readBinaryFile(cookedMeshFile.path), cookedMesh, nullptr, nullptr));
+}
+
+TEST(MeshSimplifierTest, generateLodsTest)
+{
+    //A bumpy 20x20 grid so that simplifying it costs some accuracy.
+    Mesh mesh;
+    const float corners[6][2] = {{0, 0}, {1, 0}, {1, 1}, {0, 0}, {1, 1}, {0, 1}};
+    for(int y = 0; y < 20; ++y)
+        for(int x = 0; x < 20; ++x)
+            for(auto &corner : corners)
+            {
+                float px = x + corner[0];
+                float py = y + corner[1];
+                mesh.data.insert(mesh.data.end(), {px, py, std::sin(px * 0.5f) * std::cos(py * 0.5f),
+                                                   0.0f, 0.0f, 1.0f});
+            }
+    mesh.parts = {{0, 20 * 20 * 6}};
+    MeshLoader::generateIndices(mesh, 6 * sizeof(float));
+
+    ASSERT_TRUE(MeshSimplifier::generateLods(mesh, 6 * sizeof(float), 4, 0.5f, 10.0f));
+    const Mesh::Part &part = mesh.parts[0];
+    ASSERT_GT(part.lodCount, 1u);
+    EXPECT_EQ(mesh.lods[part.lodOffset].indexCount, part.indexCount);
+    EXPECT_EQ(mesh.lods[part.lodOffset].error, 0.0f);
+    for(uint32_t i = 1; i < part.lodCount; ++i)
+    {
+        const MeshLod &lod = mesh.lods[part.lodOffset + i];
+        EXPECT_LT(lod.indexCount, mesh.lods[part.lodOffset + i - 1].indexCount);
+        EXPECT_GE(lod.error, mesh.lods[part.lodOffset + i - 1].error);
+        EXPECT_LE(uint64_t(lod.indexOffset) + lod.indexCount, mesh.indices.size());
+    }
+
+    //Close objects use the full part, distant ones the coarsest level.
+    EXPECT_EQ(MeshSimplifier::selectLod(mesh, part, 1.0e6f, 1.0f), 0u);
+    EXPECT_EQ(MeshSimplifier::selectLod(mesh, part, 0.0f, 1.0f), part.lodCount - 1);
+}
+
+TEST(MeshSimplifierTest, selectLodsTest)
+{
+    GraphicsObject drawable;
+    Mesh *mesh = drawable.getMesh();
+    Mesh::Part part = {0, 3};
+    part.lodCount = 4;
+    mesh->parts = {part};
+    mesh->lods = {{0, 3, 0.0f}, {0, 3, 0.001f}, {0, 3, 0.01f}, {0, 3, 0.1f}};
+
+    //A 90 degree field of view puts 40 pixels on a unit at a depth of 10 on an 800 pixel viewport,
+    //so errors up to 1/40 are allowed.
+    glm::mat4 projection(1.0f);
+    drawable.selectLods(glm::vec3(0.0f, 0.0f, -11.0f), 1.0f, 1.0f, glm::mat4(1.0f), projection, 800.0f, 1.0f);
+    EXPECT_EQ(drawable.getSelectedLod(0), 2u);
+
+    //Vulkan projections are often flipped on y, which must not change the selection.
+    projection[1][1] = -1.0f;
+    drawable.selectLods(glm::vec3(0.0f, 0.0f, -11.0f), 1.0f, 1.0f, glm::mat4(1.0f), projection, 800.0f, 1.0f);
+    EXPECT_EQ(drawable.getSelectedLod(0), 2u);
+
+    //Inside the bounding sphere the full part is drawn.
+    drawable.selectLods(glm::vec3(0.0f, 0.0f, -0.5f), 1.0f, 1.0f, glm::mat4(1.0f), projection, 800.0f, 1.0f);
+    EXPECT_EQ(drawable.getSelectedLod(0), 0u);
+}
+
+TEST(SceneTest, transformHierarchyTest)
+{
+    ThreadPool threadPool;
+    ASSERT_TRUE(threadPool.initialize(2));
+
+    Scene scene;
+    SceneNode root = scene.createNode();
+    SceneNode child = scene.createNode(root);
+    SceneNode grandChild = scene.createNode(child);
+    scene.setPosition(root, glm::vec3(1.0f, 0.0f, 0.0f));
+    scene.setPosition(child, glm::vec3(0.0f, 2.0f, 0.0f));
+    scene.setPosition(grandChild, glm::vec3(0.0f, 0.0f, 3.0f));
+    scene.update(&threadPool);
+    EXPECT_EQ(scene.getWorldMatrix(grandChild)[3], glm::vec4(1.0f, 2.0f, 3.0f, 1.0f));
+
+    //Moving a parent moves the whole subtree.
+    scene.setScale(root, glm::vec3(2.0f));
+    scene.update(&threadPool);
+    EXPECT_EQ(scene.getWorldMatrix(grandChild)[3], glm::vec4(1.0f, 4.0f, 6.0f, 1.0f));
+
+    //Reparenting keeps the local transform and cycles are rejected.
+    SceneNode newRoot = scene.createNode();
+    scene.setPosition(newRoot, glm::vec3(10.0f, 0.0f, 0.0f));
+    EXPECT_TRUE(scene.setParent(child, newRoot));
+    EXPECT_FALSE(scene.setParent(newRoot, grandChild));
+    scene.update(&threadPool);
+    EXPECT_EQ(scene.getWorldMatrix(grandChild)[3], glm::vec4(10.0f, 2.0f, 3.0f, 1.0f));
+
+    scene.destroyNode(newRoot);
+    EXPECT_TRUE(scene.isValid(root));
+    EXPECT_FALSE(scene.isValid(child));
+    EXPECT_FALSE(scene.isValid(grandChild));
+    EXPECT_EQ(scene.getNodeCount(), 1u);
+}
+
+TEST(FrustumCullerTest, cullSpheresTest)
+{
+    //With an identity view projection the frustum is the box [-1, 1] x [-1, 1] x [0, 1].
+    Frustum frustum = FrustumCuller::extractFrustum(glm::mat4(1.0f));
+
+    //Enough spheres for several chunks and a partial batch at the end.
+    FrustumCuller culler;
+    std::vector<uint32_t> expected;
+    for(uint32_t i = 0; i < 10001; ++i)
+    {
+        float x = -3.0f + 6.0f * i / 10000.0f;
+        culler.addSphere(glm::vec3(x, 0.0f, 0.5f), 0.25f);
+        if(std::fabs(x) <= 1.25f)
+            expected.push_back(i);
+    }
+    //Behind the near plane.
+    uint32_t behind = culler.addSphere(glm::vec3(0.0f, 0.0f, -1.0f), 0.5f);
+
+    std::vector<uint32_t> visible;
+    culler.cull(frustum, visible);
+    EXPECT_EQ(visible, expected);
+
+    ThreadPool threadPool;
+    ASSERT_TRUE(threadPool.initialize(2));
+    culler.cull(frustum, visible, &threadPool);
+    EXPECT_EQ(visible, expected);
+
+    culler.setSphere(behind, glm::vec3(0.0f, 0.0f, -0.25f), 0.5f);
+    culler.cull(frustum, visible, &threadPool);
+    ASSERT_FALSE(visible.empty());
+    EXPECT_EQ(visible.back(), behind);
+}
+
+TEST(InstanceBatcherTest, groupByMeshAndMaterialTest)
+{
+    Scene scene;
+    SceneNode first = scene.createNode();
+    SceneNode second = scene.createNode();
+    SceneNode third = scene.createNode();
+    SceneNode removed = scene.createNode();
+    scene.destroyNode(removed);
+
+    GraphicsObject rock, tree;
+    InstanceBatcher batcher;
+    batcher.addInstance(&rock, 0, first);
+    batcher.addInstance(&tree, 0, second);
+    batcher.addInstance(&rock, 0, third);
+    batcher.addInstance(&rock, 1, first);
+    batcher.addInstance(&rock, 0, removed);
+    ASSERT_TRUE(batcher.build(scene));
+
+    //Three groups whose instances follow each other without gaps.
+    const std::vector<InstanceGroup> &groups = batcher.getGroups();
+    ASSERT_EQ(groups.size(), 3u);
+    uint32_t nextInstance = 0;
+    for(const InstanceGroup &group : groups)
+    {
+        EXPECT_EQ(group.firstInstance, nextInstance);
+        nextInstance += group.instanceCount;
+        bool rockWithFirstMaterial = group.drawable == &rock && group.materialId == 0;
+        EXPECT_EQ(group.instanceCount, rockWithFirstMaterial ? 2u : 1u);
+    }
+    EXPECT_EQ(nextInstance, 4u);
+}
+
+//Records the descriptor set binds of a render queue.
+struct RenderQueueTest : MockDeviceTest {};
+
+TEST_F(RenderQueueTest, sortKeysTest)
+{
+    //Near draws come first unless the pass sorts back to front.
+    EXPECT_LT(RenderQueue::makeKey(0, 0, 0, 0, 1.0f, false), RenderQueue::makeKey(0, 0, 0, 0, 2.0f, false));
+    EXPECT_GT(RenderQueue::makeKey(0, 0, 0, 0, 1.0f, true), RenderQueue::makeKey(0, 0, 0, 0, 2.0f, true));
+    //State outweighs depth and the pass outweighs everything.
+    EXPECT_LT(RenderQueue::makeKey(0, 0, 0, 0, 1000.0f, false), RenderQueue::makeKey(0, 0, 0, 1, 0.0f, false));
+    EXPECT_LT(RenderQueue::makeKey(0, 4095, 4095, 4095, 1000.0f, false), RenderQueue::makeKey(1, 0, 0, 0, 0.0f, false));
+
+    //Alternating buffers end up grouped, and each group is sorted by depth.
+    RenderQueue renderQueue;
+    GraphicsObject drawable;
+    std::vector<VkBuffer> buffers = {reinterpret_cast<VkBuffer>(uintptr_t(0x1000)),
+                                     reinterpret_cast<VkBuffer>(uintptr_t(0x2000))};
+    for(uint32_t i = 0; i < 1000; ++i)
+    {
+        RenderItem item = {VK_NULL_HANDLE, VK_NULL_HANDLE, VK_NULL_HANDLE, buffers[i % 2], VK_NULL_HANDLE,
+                           &drawable, 1, i};
+        renderQueue.submit(i % 3 == 0 ? 1 : 0, item, float(1000 - i));
+    }
+    renderQueue.sort();
+
+    ASSERT_EQ(renderQueue.getItemCount(), 1000u);
+    uint32_t bufferChanges = 0;
+    for(size_t i = 1; i < renderQueue.getItemCount(); ++i)
+    {
+        EXPECT_LE(renderQueue.getSortedKey(i - 1), renderQueue.getSortedKey(i));
+        if(renderQueue.getSortedItem(i).vertexBuffer != renderQueue.getSortedItem(i - 1).vertexBuffer)
+            ++bufferChanges;
+    }
+    //Two buffers in each of the two passes.
+    EXPECT_EQ(bufferChanges, 3u);
+    EXPECT_EQ(renderQueue.getSortedItem(0).firstInstance, 998u);
+}
+
+TEST_F(RenderQueueTest, dynamicOffsetsTest)
+{
+    static std::vector<std::vector<uint32_t>> boundOffsets;
+    boundOffsets.clear();
+    vkCmdBindPipeline = [](VkCommandBuffer, VkPipelineBindPoint, VkPipeline){};
+    vkCmdBindVertexBuffers = [](VkCommandBuffer, uint32_t, uint32_t, const VkBuffer*, const VkDeviceSize*){};
+    vkCmdBindDescriptorSets = [](VkCommandBuffer, VkPipelineBindPoint, VkPipelineLayout, uint32_t, uint32_t,
+                                 const VkDescriptorSet*, uint32_t dynamicOffsetCount, const uint32_t *dynamicOffsets)
+    {
+        boundOffsets.emplace_back(dynamicOffsets, dynamicOffsets + dynamicOffsetCount);
+    };
+
+    RenderQueue renderQueue;
+    GraphicsObject drawable;
+    VkDescriptorSet descriptorSet = reinterpret_cast<VkDescriptorSet>(uintptr_t(0x3000));
+    VkBuffer vertexBuffer = reinterpret_cast<VkBuffer>(uintptr_t(0x1000));
+    //The same set with the per draw blocks of a uniform ring, front to back.
+    uint32_t offsets[] = {0, 0, 256, 512};
+    for(uint32_t i = 0; i < 4; ++i)
+    {
+        RenderItem item = {VK_NULL_HANDLE, VK_NULL_HANDLE, descriptorSet, vertexBuffer, VK_NULL_HANDLE,
+                           &drawable, 1, i, 1, {offsets[i]}};
+        renderQueue.submit(0, item, float(i));
+    }
+    RenderItem tooManyOffsets = {VK_NULL_HANDLE, VK_NULL_HANDLE, descriptorSet, vertexBuffer, VK_NULL_HANDLE,
+                                 &drawable, 1, 0, RENDER_QUEUE_MAX_DYNAMIC_OFFSETS + 1, {}};
+    renderQueue.submit(0, tooManyOffsets, 0.0f);
+    EXPECT_EQ(renderQueue.getItemCount(), 4u);
+
+    renderQueue.record(cmdBuffer, 0, 0);
+
+    //The set is only bound again when its offsets change.
+    std::vector<std::vector<uint32_t>> expectedOffsets = {{0}, {256}, {512}};
+    EXPECT_EQ(boundOffsets, expectedOffsets);
+    EXPECT_EQ(renderQueue.getStatistics().descriptorSetBinds, 3u);
+}
+
+TEST(BvhTest, queriesMatchBruteForceTest)
+{
+    //A grid of unit boxes, one of them far away from the rest.
+    std::vector<BvhBounds> bounds;
+    for(int x = 0; x < 10; ++x)
+        for(int y = 0; y < 10; ++y)
+            for(int z = 0; z < 10; ++z)
+                bounds.push_back({glm::vec3(x * 2.0f, y * 2.0f, z * 2.0f), glm::vec3(x * 2.0f + 1.0f, y * 2.0f + 1.0f, z * 2.0f + 1.0f)});
+    bounds.push_back({glm::vec3(100.0f), glm::vec3(101.0f)});
+
+    Bvh bvh;
+    bvh.build(bounds);
+    ASSERT_FALSE(bvh.getNodes().empty());
+    for(const BvhNode &node : bvh.getNodes())
+        EXPECT_TRUE(node.count <= BVH_MAX_LEAF_SIZE);
+
+    auto bruteForceOverlap = [&](const BvhBounds &box)
+    {
+        std::vector<uint32_t> result;
+        for(uint32_t i = 0; i < bounds.size(); ++i)
+            if(bounds[i].min.x <= box.max.x && bounds[i].max.x >= box.min.x &&
+               bounds[i].min.y <= box.max.y && bounds[i].max.y >= box.min.y &&
+               bounds[i].min.z <= box.max.z && bounds[i].max.z >= box.min.z)
+                result.push_back(i);
+        return result;
+    };
+    BvhBounds box = {glm::vec3(3.5f, 0.0f, 0.0f), glm::vec3(6.5f, 2.5f, 100.0f)};
+    std::vector<uint32_t> results;
+    bvh.queryOverlap(box, results);
+    std::sort(results.begin(), results.end());
+    EXPECT_EQ(results, bruteForceOverlap(box));
+
+    //With an identity view projection the frustum is the box [-1, 1] x [-1, 1] x [0, 1].
+    bvh.queryFrustum(FrustumCuller::extractFrustum(glm::mat4(1.0f)), results);
+    std::sort(results.begin(), results.end());
+    EXPECT_EQ(results, bruteForceOverlap({glm::vec3(-1.0f, -1.0f, 0.0f), glm::vec3(1.0f)}));
+
+    uint32_t hitPrimitive = 0;
+    float hitDistance = 0.0f;
+    ASSERT_TRUE(bvh.raycast(glm::vec3(4.5f, 4.5f, -10.0f), glm::vec3(0.0f, 0.0f, 1.0f), 1000.0f, hitPrimitive, hitDistance));
+    EXPECT_EQ(hitPrimitive, 2u * 100u + 2u * 10u);
+    EXPECT_FLOAT_EQ(hitDistance, 10.0f);
+    EXPECT_FALSE(bvh.raycast(glm::vec3(4.5f, 4.5f, -10.0f), glm::vec3(0.0f, 0.0f, 1.0f), 5.0f, hitPrimitive, hitDistance));
+
+    //Moving the far box into the grid is found after a refit.
+    bvh.setPrimitiveBounds(1000, {glm::vec3(-2.5f), glm::vec3(-1.5f)});
+    bvh.refit();
+    bvh.queryOverlap({glm::vec3(-2.25f), glm::vec3(-1.75f)}, results);
+    ASSERT_EQ(results.size(), 1u);
+    EXPECT_EQ(results[0], 1000u);
+
+    //Rotating a box by 90 degrees around z swaps its x and y extents.
+    MeshBounds meshBounds = {{0.0f, 0.0f, 0.0f}, {2.0f, 1.0f, 1.0f}, {1.0f, 0.5f, 0.5f}, 1.0f};
+    glm::mat4 rotation(1.0f);
+    rotation[0] = glm::vec4(0.0f, 1.0f, 0.0f, 0.0f);
+    rotation[1] = glm::vec4(-1.0f, 0.0f, 0.0f, 0.0f);
+    BvhBounds rotated = Bvh::transformBounds(rotation, meshBounds);
+    EXPECT_FLOAT_EQ(rotated.min.x, -1.0f);
+    EXPECT_FLOAT_EQ(rotated.max.x, 0.0f);
+    EXPECT_FLOAT_EQ(rotated.max.y, 2.0f);
+}
+
+TEST(DepthPyramidTest, levelCountTest)
+{
+    //Levels halve down to 1x1, odd sizes round down.
+    EXPECT_EQ(DepthPyramid::computeLevelCount(1, 1), 1u);
+    EXPECT_EQ(DepthPyramid::computeLevelCount(2, 1), 2u);
+    EXPECT_EQ(DepthPyramid::computeLevelCount(400, 400), 9u);
+    EXPECT_EQ(DepthPyramid::computeLevelCount(960, 540), 10u);
+    EXPECT_EQ(DepthPyramid::computeLevelCount(3, 1025), 11u);
+}
+
+TEST(QueryPoolManagerTest, visibilityHistoryTest)
+{
+    QueryPoolManager queries;
+    //Objects without a result count as visible so that they are drawn and queried.
+    EXPECT_TRUE(queries.wasVisible(7));
+    EXPECT_EQ(queries.getVisibilityHistory(7), ~0u);
+
+    queries.recordVisibility(7, false);
+    queries.recordVisibility(7, true);
+    queries.recordVisibility(7, false);
+    EXPECT_FALSE(queries.wasVisible(7));
+    EXPECT_EQ(queries.getVisibilityHistory(7), 2u);
+    EXPECT_TRUE(queries.wasVisible(3));
+
+    //Queries are only handed out during a frame.
+    EXPECT_EQ(queries.beginOcclusionQuery(VK_NULL_HANDLE, 7), QUERY_POOL_INVALID_QUERY);
+    EXPECT_EQ(queries.beginStatisticsQuery(VK_NULL_HANDLE), QUERY_POOL_INVALID_QUERY);
+}
+
+TEST(EntityStoreTest, archetypeChunksTest)
+{
+    const uint32_t renderable = ENTITY_COMPONENT_TRANSFORM_BIT | ENTITY_COMPONENT_MESH_BIT |
+                                ENTITY_COMPONENT_MATERIAL_BIT | ENTITY_COMPONENT_BOUNDS_BIT |
+                                ENTITY_COMPONENT_FLAGS_BIT;
+    uint32_t capacity = EntityStore::computeChunkCapacity(renderable);
+    ASSERT_GT(capacity, 0u);
+
+    //Two and a half chunks of renderables along the x axis.
+    EntityStore store;
+    std::vector<Entity> entities;
+    for(uint32_t i = 0; i < 5 * capacity / 2; ++i)
+    {
+        Entity entity = store.createEntity(renderable);
+        (*store.getTransform(entity))[3] = glm::vec4(float(i), 0.0f, 0.5f, 1.0f);
+        *store.getMesh(entity) = i;
+        *store.getBounds(entity) = {{-0.1f, -0.1f, -0.1f}, {0.1f, 0.1f, 0.1f}, {0.0f, 0.0f, 0.0f}, 0.1f};
+        entities.push_back(entity);
+    }
+    EXPECT_EQ(store.getChunkCount(), 3u);
+    EXPECT_EQ(*store.getMaterial(entities[0]), ENTITY_INVALID_HANDLE);
+
+    //Swapping the last entity into the hole keeps the data of both.
+    store.destroyEntity(entities[1]);
+    EXPECT_FALSE(store.isValid(entities[1]));
+    EXPECT_EQ(*store.getMesh(entities.back()), entities.size() - 1);
+    EXPECT_EQ(store.getEntityCount(), entities.size() - 1);
+
+    //Removing the flags moves the entity to a new archetype with its transform.
+    ASSERT_TRUE(store.setComponentMask(entities[2], renderable & ~ENTITY_COMPONENT_FLAGS_BIT));
+    EXPECT_EQ(store.getArchetypeCount(), 2u);
+    EXPECT_EQ(store.getFlags(entities[2]), nullptr);
+    EXPECT_EQ((*store.getTransform(entities[2]))[3].x, 2.0f);
+    EXPECT_EQ(*store.getMesh(entities[2]), 2u);
+
+    size_t visited = 0;
+    store.forEachChunk(ENTITY_COMPONENT_MESH_BIT, [&visited](const EntityChunkView &view)
+    {
+        visited += view.count;
+    });
+    EXPECT_EQ(visited, store.getEntityCount());
+
+    //Only entities 0 and 2 are within x of [-1, 1], and 2 has no flags.
+    Frustum frustum = FrustumCuller::extractFrustum(glm::mat4(1.0f));
+    ThreadPool threadPool;
+    ASSERT_TRUE(threadPool.initialize(2));
+    store.cullEntities(frustum, &threadPool);
+    std::vector<Entity> notCulled;
+    store.forEachChunk(ENTITY_COMPONENT_FLAGS_BIT, [&notCulled](const EntityChunkView &view)
+    {
+        for(uint32_t i = 0; i < view.count; ++i)
+        {
+            if(!(view.flags[i] & ENTITY_FLAG_CULLED))
+                notCulled.push_back(view.entities[i]);
+        }
+    });
+    EXPECT_EQ(notCulled, std::vector<Entity>{entities[0]});
+
+    //Destroyed handles are reused.
+    EXPECT_EQ(store.createEntity(ENTITY_COMPONENT_TRANSFORM_BIT), entities[1]);
+}
+
+TEST(ResourceRegistryTest, generationalHandlesTest)
+{
+    ResourcePool<MeshResource, MeshHandle> meshes;
+    MeshResource mesh;
+    mesh.vertexCount = 3;
+    MeshHandle first = meshes.add(mesh);
+    mesh.vertexCount = 6;
+    MeshHandle second = meshes.add(mesh);
+    ASSERT_TRUE(first.isValid());
+    EXPECT_EQ(meshes.get(second)->vertexCount, 6u);
+    EXPECT_FALSE(meshes.isValid(MeshHandle()));
+
+    //Released handles are stale at once but the slot waits for its frame.
+    ASSERT_TRUE(meshes.release(first, 5));
+    EXPECT_EQ(meshes.get(first), nullptr);
+    EXPECT_FALSE(meshes.release(first, 5));
+    uint32_t destroyed = 0;
+    auto countDestroyed = [&destroyed](MeshResource&){++destroyed;};
+    meshes.collect(4, countDestroyed);
+    EXPECT_EQ(destroyed, 0u);
+    MeshHandle third = meshes.add(mesh);
+    EXPECT_NE(third.getIndex(), first.getIndex());
+
+    meshes.collect(5, countDestroyed);
+    EXPECT_EQ(destroyed, 1u);
+    MeshHandle reused = meshes.add(mesh);
+    EXPECT_EQ(reused.getIndex(), first.getIndex());
+    EXPECT_NE(reused, first);
+    EXPECT_EQ(meshes.get(first), nullptr);
+    EXPECT_EQ(meshes.getCount(), 3u);
+
+    meshes.clear(countDestroyed);
+    EXPECT_EQ(destroyed, 4u);
+    EXPECT_EQ(meshes.getCount(), 0u);
+}
+
+TEST(RenderGraphTest, barriersCullingAndSubpassesTest)
+{
+    const VkExtent2D extent = {800, 600};
+    const RenderGraphResourceState unused = {0, 0, VK_IMAGE_LAYOUT_UNDEFINED};
+    RenderGraph graph;
+    RenderGraphResource swapchain = graph.importImage("swapchain", {VK_NULL_HANDLE, VK_NULL_HANDLE,
+                                                      VK_FORMAT_B8G8R8A8_SRGB, extent, VK_IMAGE_ASPECT_COLOR_BIT},
+                                                      {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, 0,
+                                                       VK_IMAGE_LAYOUT_UNDEFINED});
+    graph.setFinalState(swapchain, {VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR});
+    RenderGraphResource albedo = graph.importImage("albedo", {VK_NULL_HANDLE, VK_NULL_HANDLE, VK_FORMAT_R8G8B8A8_UNORM,
+                                                   extent, VK_IMAGE_ASPECT_COLOR_BIT}, unused);
+    RenderGraphResource depth = graph.importImage("depth", {VK_NULL_HANDLE, VK_NULL_HANDLE, VK_FORMAT_D16_UNORM,
+                                                  extent, VK_IMAGE_ASPECT_DEPTH_BIT}, unused);
+    RenderGraphResource debug = graph.importImage("debug", {VK_NULL_HANDLE, VK_NULL_HANDLE, VK_FORMAT_R8G8B8A8_UNORM,
+                                                  extent, VK_IMAGE_ASPECT_COLOR_BIT}, unused);
+    RenderGraphResource draws = graph.importBuffer("draws", VK_NULL_HANDLE, unused);
+
+    RenderGraphPass culling = graph.addPass("culling", RENDER_GRAPH_PASS_COMPUTE, nullptr);
+    ASSERT_TRUE(graph.write(culling, draws, RENDER_GRAPH_USAGE_STORAGE));
+    //Nothing reads what this pass writes.
+    RenderGraphPass visualize = graph.addPass("visualize", RENDER_GRAPH_PASS_COMPUTE, nullptr);
+    ASSERT_TRUE(graph.write(visualize, debug, RENDER_GRAPH_USAGE_STORAGE));
+    RenderGraphPass geometry = graph.addPass("geometry", RENDER_GRAPH_PASS_GRAPHICS, nullptr);
+    ASSERT_TRUE(graph.read(geometry, draws, RENDER_GRAPH_USAGE_INDIRECT));
+    ASSERT_TRUE(graph.write(geometry, albedo, RENDER_GRAPH_USAGE_COLOR_ATTACHMENT));
+    ASSERT_TRUE(graph.write(geometry, depth, RENDER_GRAPH_USAGE_DEPTH_ATTACHMENT));
+    graph.setClearValue(geometry, albedo, VkClearValue{});
+    graph.setClearValue(geometry, depth, VkClearValue{});
+    RenderGraphPass lighting = graph.addPass("lighting", RENDER_GRAPH_PASS_GRAPHICS, nullptr);
+    ASSERT_TRUE(graph.read(lighting, albedo, RENDER_GRAPH_USAGE_INPUT_ATTACHMENT));
+    ASSERT_TRUE(graph.write(lighting, swapchain, RENDER_GRAPH_USAGE_COLOR_ATTACHMENT));
+    EXPECT_FALSE(graph.write(lighting, draws, RENDER_GRAPH_USAGE_INDIRECT));
+    ASSERT_TRUE(graph.compile());
+
+    EXPECT_TRUE(graph.isPassCulled(visualize));
+    const std::vector<RenderGraphStep> &steps = graph.getSteps();
+    ASSERT_EQ(steps.size(), 2u);
+    EXPECT_EQ(steps[0].passes, std::vector<RenderGraphPass>{culling});
+    EXPECT_TRUE(steps[0].barrier.isEmpty());
+
+    //The geometry and lighting passes share a render pass. A single barrier in front of it
+    //makes the draws visible to the indirect draws and transitions the three attachments.
+    const RenderGraphStep &renderPass = steps[1];
+    EXPECT_EQ(renderPass.passes, (std::vector<RenderGraphPass>{geometry, lighting}));
+    EXPECT_EQ(renderPass.barrier.srcAccess, VkAccessFlags(VK_ACCESS_SHADER_WRITE_BIT));
+    EXPECT_EQ(renderPass.barrier.dstAccess, VkAccessFlags(VK_ACCESS_INDIRECT_COMMAND_READ_BIT));
+    EXPECT_EQ(renderPass.barrier.imageBarriers.size(), 3u);
+    EXPECT_EQ(renderPass.barrier.srcStages & VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, 0u);
+    ASSERT_EQ(renderPass.dependencies.size(), 1u);
+    EXPECT_EQ(renderPass.dependencies[0].dstAccessMask, VkAccessFlags(VK_ACCESS_INPUT_ATTACHMENT_READ_BIT));
+    EXPECT_EQ(renderPass.dependencies[0].dependencyFlags, VkDependencyFlags(VK_DEPENDENCY_BY_REGION_BIT));
+    //Only the swapchain image outlives the render pass.
+    ASSERT_EQ(renderPass.attachments, (std::vector<RenderGraphResource>{albedo, depth, swapchain}));
+    EXPECT_EQ(renderPass.attachmentDescriptions[0].loadOp, VK_ATTACHMENT_LOAD_OP_CLEAR);
+    EXPECT_EQ(renderPass.attachmentDescriptions[0].storeOp, VK_ATTACHMENT_STORE_OP_DONT_CARE);
+    EXPECT_EQ(renderPass.attachmentDescriptions[0].finalLayout, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    EXPECT_EQ(renderPass.attachmentDescriptions[1].storeOp, VK_ATTACHMENT_STORE_OP_DONT_CARE);
+    EXPECT_EQ(renderPass.attachmentDescriptions[2].storeOp, VK_ATTACHMENT_STORE_OP_STORE);
+    ASSERT_EQ(graph.getFinalBarrier().imageBarriers.size(), 1u);
+    EXPECT_EQ(graph.getFinalBarrier().imageBarriers[0].newLayout, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+
+    //Sampling the albedo needs it stored and transitioned outside of a render pass.
+    graph.reset();
+    swapchain = graph.importImage("swapchain", {VK_NULL_HANDLE, VK_NULL_HANDLE, VK_FORMAT_B8G8R8A8_SRGB, extent,
+                                  VK_IMAGE_ASPECT_COLOR_BIT}, unused);
+    graph.setFinalState(swapchain, {VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR});
+    albedo = graph.importImage("albedo", {VK_NULL_HANDLE, VK_NULL_HANDLE, VK_FORMAT_R8G8B8A8_UNORM, extent,
+                               VK_IMAGE_ASPECT_COLOR_BIT}, unused);
+    geometry = graph.addPass("geometry", RENDER_GRAPH_PASS_GRAPHICS, nullptr);
+    graph.write(geometry, albedo, RENDER_GRAPH_USAGE_COLOR_ATTACHMENT);
+    RenderGraphPass blur = graph.addPass("blur", RENDER_GRAPH_PASS_GRAPHICS, nullptr);
+    graph.read(blur, albedo, RENDER_GRAPH_USAGE_SAMPLED);
+    graph.write(blur, swapchain, RENDER_GRAPH_USAGE_COLOR_ATTACHMENT);
+    ASSERT_TRUE(graph.compile());
+    ASSERT_EQ(graph.getSteps().size(), 2u);
+    EXPECT_EQ(graph.getSteps()[0].attachmentDescriptions[0].storeOp, VK_ATTACHMENT_STORE_OP_STORE);
+    ASSERT_EQ(graph.getSteps()[1].barrier.imageBarriers.size(), 2u);
+    EXPECT_EQ(graph.getSteps()[1].barrier.imageBarriers[0].newLayout, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    EXPECT_EQ(graph.getSteps()[1].barrier.imageBarriers[0].srcAccessMask,
+              VkAccessFlags(VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT));
+}
+
+TEST(RenderGraphTest, transientAliasingTest)
+{
+    const VkExtent2D extent = {800, 600};
+    RenderGraph graph;
+    RenderGraphResource swapchain = graph.importImage("swapchain", {VK_NULL_HANDLE, VK_NULL_HANDLE,
+                                                      VK_FORMAT_B8G8R8A8_SRGB, extent, VK_IMAGE_ASPECT_COLOR_BIT},
+                                                      {0, 0, VK_IMAGE_LAYOUT_UNDEFINED});
+    graph.setFinalState(swapchain, {VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR});
+    RenderGraphResource scene = graph.createImage("scene", VK_FORMAT_R16G16B16A16_SFLOAT, extent,
+                                                  VK_IMAGE_ASPECT_COLOR_BIT);
+    RenderGraphResource depth = graph.createImage("depth", VK_FORMAT_D32_SFLOAT, extent, VK_IMAGE_ASPECT_DEPTH_BIT);
+    RenderGraphResource bloom = graph.createImage("bloom", VK_FORMAT_R16G16B16A16_SFLOAT, extent,
+                                                  VK_IMAGE_ASPECT_COLOR_BIT);
+    RenderGraphResource debug = graph.createImage("debug", VK_FORMAT_R8G8B8A8_UNORM, extent, VK_IMAGE_ASPECT_COLOR_BIT);
+    //Transient images cannot be outputs.
+    graph.setFinalState(scene, {VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, VK_IMAGE_LAYOUT_GENERAL});
+
+    RenderGraphPass geometry = graph.addPass("geometry", RENDER_GRAPH_PASS_GRAPHICS, nullptr);
+    graph.write(geometry, scene, RENDER_GRAPH_USAGE_COLOR_ATTACHMENT);
+    graph.write(geometry, depth, RENDER_GRAPH_USAGE_DEPTH_ATTACHMENT);
+    graph.setClearValue(geometry, scene, VkClearValue{});
+    graph.setClearValue(geometry, depth, VkClearValue{});
+    RenderGraphPass bloomPass = graph.addPass("bloom", RENDER_GRAPH_PASS_COMPUTE, nullptr);
+    graph.read(bloomPass, scene, RENDER_GRAPH_USAGE_SAMPLED);
+    graph.write(bloomPass, bloom, RENDER_GRAPH_USAGE_STORAGE);
+    RenderGraphPass visualize = graph.addPass("visualize", RENDER_GRAPH_PASS_COMPUTE, nullptr);
+    graph.write(visualize, debug, RENDER_GRAPH_USAGE_STORAGE);
+    RenderGraphPass composite = graph.addPass("composite", RENDER_GRAPH_PASS_GRAPHICS, nullptr);
+    graph.read(composite, scene, RENDER_GRAPH_USAGE_SAMPLED);
+    graph.read(composite, bloom, RENDER_GRAPH_USAGE_SAMPLED);
+    graph.write(composite, swapchain, RENDER_GRAPH_USAGE_COLOR_ATTACHMENT);
+    ASSERT_TRUE(graph.compile());
+    EXPECT_TRUE(graph.isPassCulled(visualize));
+
+    //The depth buffer never leaves the geometry render pass. The images of culled passes are not created.
+    const std::vector<RenderGraphTransientImage> &images = graph.getTransientImages();
+    ASSERT_EQ(images.size(), 3u);
+    EXPECT_EQ(images[0].resource, scene);
+    EXPECT_EQ(images[0].usage, VkImageUsageFlags(VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT));
+    EXPECT_FALSE(images[0].lazilyAllocated);
+    EXPECT_EQ(images[0].firstStep, 0u);
+    EXPECT_EQ(images[0].lastStep, 2u);
+    EXPECT_EQ(images[1].resource, depth);
+    EXPECT_TRUE(images[1].lazilyAllocated);
+    EXPECT_EQ(images[1].usage, VkImageUsageFlags(VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT |
+                                                 VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT));
+    EXPECT_EQ(images[2].resource, bloom);
+    EXPECT_EQ(images[2].firstStep, 1u);
+    EXPECT_EQ(images[2].usage, VkImageUsageFlags(VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT));
+
+    //The first use waits for the depth tests of the previous frame.
+    EXPECT_NE(graph.getSteps()[0].barrier.srcStages & VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT, 0u);
+    EXPECT_EQ(graph.getFinalBarrier().imageBarriers.size(), 1u);
+
+    //A and B are never in use at the same time and share memory, C overlaps both.
+    std::vector<VkDeviceSize> offsets;
+    VkDeviceSize blockSize = RenderGraph::placeAliasedImages({{0, 1, 100, 64}, {2, 3, 100, 64}, {1, 2, 50, 64}},
+                                                             offsets);
+    EXPECT_EQ(offsets, (std::vector<VkDeviceSize>{0, 0, 128}));
+    EXPECT_EQ(blockSize, 178u);
+}
+
+//Records the pipeline barriers of a batch instead of a command buffer.
+struct BarrierBatchTest : testing::Test
+{
+    struct RecordedBarrier
+    {
+        VkPipelineStageFlags srcStages;
+        VkPipelineStageFlags dstStages;
+        uint32_t memoryBarrierCount;
+        std::vector<VkBufferMemoryBarrier> bufferBarriers;
+        std::vector<VkImageMemoryBarrier> imageBarriers;
+    };
+    static inline std::vector<RecordedBarrier> recorded;
+    PFN_vkCmdPipelineBarrier original;
+
+    BarrierBatchTest()
+    {
+        original = vkCmdPipelineBarrier;
+        recorded.clear();
+        vkCmdPipelineBarrier = recordPipelineBarrier;
+    }
+    ~BarrierBatchTest()
+    {
+        vkCmdPipelineBarrier = original;
+    }
+
+    static VKAPI_ATTR void VKAPI_CALL recordPipelineBarrier(VkCommandBuffer, VkPipelineStageFlags srcStages,
+                                                            VkPipelineStageFlags dstStages, VkDependencyFlags,
+                                                            uint32_t memoryBarrierCount, const VkMemoryBarrier*,
+                                                            uint32_t bufferBarrierCount,
+                                                            const VkBufferMemoryBarrier *bufferBarriers,
+                                                            uint32_t imageBarrierCount,
+                                                            const VkImageMemoryBarrier *imageBarriers)
+    {
+        recorded.push_back({srcStages, dstStages, memoryBarrierCount,
+                            std::vector<VkBufferMemoryBarrier>(bufferBarriers, bufferBarriers + bufferBarrierCount),
+                            std::vector<VkImageMemoryBarrier>(imageBarriers, imageBarriers + imageBarrierCount)});
+    }
+};
+
+TEST_F(BarrierBatchTest, mergeAndFlushTest)
+{
+    VkBuffer buffers[2];
+    std::memset(buffers, 0, sizeof(buffers));
+    std::memset(&buffers[1], 1, 1);
+    VkImage image;
+    std::memset(&image, 2, sizeof(image));
+    {
+        BarrierBatch batch(VK_NULL_HANDLE);
+        batch.addBuffer(VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                        {buffers[0], VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
+                         VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED});
+        //The same transition again only adds its access.
+        batch.addBuffer(VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+                        {buffers[0], VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT,
+                         VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED});
+        batch.addBuffer(VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                        {buffers[1], VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
+                         VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED});
+        batch.addImage(0, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       {image, 0, VK_ACCESS_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_UNDEFINED,
+                        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED,
+                        VK_IMAGE_ASPECT_COLOR_BIT});
+        EXPECT_EQ(batch.getBufferBarrierCount(), 2u);
+        EXPECT_TRUE(recorded.empty());
+
+        //A second transition of the image has to come after the first one.
+        batch.addImage(VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                       {image, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
+                        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                        VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, VK_IMAGE_ASPECT_COLOR_BIT});
+        ASSERT_EQ(recorded.size(), 1u);
+        EXPECT_EQ(batch.getImageBarrierCount(), 1u);
+    }
+
+    //The destructor flushes the rest.
+    ASSERT_EQ(recorded.size(), 2u);
+    EXPECT_EQ(recorded[0].srcStages, VkPipelineStageFlags(VK_PIPELINE_STAGE_TRANSFER_BIT |
+                                                          VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT));
+    EXPECT_EQ(recorded[0].dstStages, VkPipelineStageFlags(VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT |
+                                                          VK_PIPELINE_STAGE_VERTEX_INPUT_BIT |
+                                                          VK_PIPELINE_STAGE_TRANSFER_BIT));
+    EXPECT_EQ(recorded[0].memoryBarrierCount, 0u);
+    ASSERT_EQ(recorded[0].bufferBarriers.size(), 2u);
+    EXPECT_EQ(recorded[0].bufferBarriers[0].dstAccessMask,
+              VkAccessFlags(VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT));
+    EXPECT_EQ(recorded[0].imageBarriers.size(), 1u);
+    EXPECT_EQ(recorded[1].imageBarriers[0].newLayout, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    EXPECT_TRUE(recorded[1].bufferBarriers.empty());
+
+    //More barriers than the batch holds are split over several pipeline barriers.
+    recorded.clear();
+    std::vector<BufferTransition> transitions(SETTINGS_BARRIER_BATCH_MAX_BUFFERS + 1);
+    for(size_t i = 0; i < transitions.size(); ++i)
+    {
+        std::memset(&transitions[i].buffer, 0, sizeof(VkBuffer));
+        std::memcpy(&transitions[i].buffer, &i, 1);
+        transitions[i].currentAccess = VK_ACCESS_SHADER_WRITE_BIT;
+        transitions[i].newAccess = VK_ACCESS_SHADER_READ_BIT;
+        transitions[i].currentQueueFamily = VK_QUEUE_FAMILY_IGNORED;
+        transitions[i].newQueueFamily = VK_QUEUE_FAMILY_IGNORED;
+    }
+    setBufferMemoryBarriers(VK_NULL_HANDLE, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, transitions);
+    ASSERT_EQ(recorded.size(), 2u);
+    EXPECT_EQ(recorded[0].bufferBarriers.size(), size_t(SETTINGS_BARRIER_BATCH_MAX_BUFFERS));
+    EXPECT_EQ(recorded[1].bufferBarriers.size(), 1u);
+}
+
+//Queue ownership transfers are recorded as barriers too.
+struct QueueSchedulerTest : BarrierBatchTest {};
+
+TEST_F(QueueSchedulerTest, familySelectionAndOwnershipTest)
+{
+    //A gpu with async compute and a transfer engine. Families without queues are skipped.
+    std::vector<VkQueueFamilyProperties> families(4, VkQueueFamilyProperties{});
+    families[0].queueFlags = VK_QUEUE_COMPUTE_BIT | VK_QUEUE_TRANSFER_BIT;
+    families[0].queueCount = 0;
+    families[1].queueFlags = VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT | VK_QUEUE_TRANSFER_BIT;
+    families[1].queueCount = 16;
+    families[2].queueFlags = VK_QUEUE_TRANSFER_BIT | VK_QUEUE_SPARSE_BINDING_BIT;
+    families[2].queueCount = 2;
+    families[3].queueFlags = VK_QUEUE_COMPUTE_BIT | VK_QUEUE_TRANSFER_BIT;
+    families[3].queueCount = 8;
+    std::array<uint32_t, QUEUE_TYPE_COUNT> familyIndices;
+    ASSERT_TRUE(QueueScheduler::selectQueueFamilies(families, familyIndices));
+    EXPECT_EQ(familyIndices[QUEUE_TYPE_GRAPHICS], 1u);
+    EXPECT_EQ(familyIndices[QUEUE_TYPE_COMPUTE], 3u);
+    EXPECT_EQ(familyIndices[QUEUE_TYPE_TRANSFER], 2u);
+
+    //Without a transfer engine transfers share the async compute family.
+    families[2].queueCount = 0;
+    ASSERT_TRUE(QueueScheduler::selectQueueFamilies(families, familyIndices));
+    EXPECT_EQ(familyIndices[QUEUE_TYPE_TRANSFER], 3u);
+    families[1].queueCount = 0;
+    EXPECT_FALSE(QueueScheduler::selectQueueFamilies(families, familyIndices));
+
+    VkBuffer buffer;
+    std::memset(&buffer, 1, sizeof(buffer));
+    VkImage image;
+    std::memset(&image, 2, sizeof(image));
+    QueueScheduler scheduler;
+    scheduler.initialize(nullptr, {{{0, 1, nullptr}, {16, 3, nullptr}, {17, 2, nullptr}}});
+    EXPECT_TRUE(scheduler.isAsync(QUEUE_TYPE_COMPUTE));
+    {
+        //Indirect commands written by async compute move to the graphics family.
+        BarrierBatch release(VK_NULL_HANDLE);
+        scheduler.releaseBuffer(release, QUEUE_TYPE_COMPUTE, QUEUE_TYPE_GRAPHICS,
+                                VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, buffer, VK_ACCESS_SHADER_WRITE_BIT);
+        release.flush();
+        BarrierBatch acquire(VK_NULL_HANDLE);
+        scheduler.acquireBuffer(acquire, QUEUE_TYPE_COMPUTE, QUEUE_TYPE_GRAPHICS,
+                                VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+                                buffer, VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT);
+    }
+    ASSERT_EQ(recorded.size(), 2u);
+    ASSERT_EQ(recorded[0].bufferBarriers.size(), 1u);
+    EXPECT_EQ(recorded[0].dstStages, static_cast<VkPipelineStageFlags>(VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT));
+    EXPECT_EQ(recorded[0].bufferBarriers[0].srcQueueFamilyIndex, 3u);
+    EXPECT_EQ(recorded[0].bufferBarriers[0].dstQueueFamilyIndex, 1u);
+    EXPECT_EQ(recorded[0].bufferBarriers[0].dstAccessMask, 0u);
+    ASSERT_EQ(recorded[1].bufferBarriers.size(), 1u);
+    EXPECT_EQ(recorded[1].srcStages, static_cast<VkPipelineStageFlags>(VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT));
+    EXPECT_EQ(recorded[1].bufferBarriers[0].srcAccessMask, 0u);
+    EXPECT_EQ(recorded[1].bufferBarriers[0].dstAccessMask,
+              static_cast<VkAccessFlags>(VK_ACCESS_INDIRECT_COMMAND_READ_BIT));
+
+    //Within a family a plain barrier behind the last use remains.
+    recorded.clear();
+    scheduler.initialize(nullptr, {{{0, 0, nullptr}, {0, 0, nullptr}, {0, 0, nullptr}}});
+    EXPECT_FALSE(scheduler.isAsync(QUEUE_TYPE_COMPUTE));
+    {
+        BarrierBatch batch(VK_NULL_HANDLE);
+        scheduler.releaseImage(batch, QUEUE_TYPE_COMPUTE, QUEUE_TYPE_GRAPHICS, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                               image, VK_IMAGE_ASPECT_COLOR_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+                               VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+        EXPECT_TRUE(batch.isEmpty());
+        scheduler.acquireImage(batch, QUEUE_TYPE_COMPUTE, QUEUE_TYPE_GRAPHICS, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                               VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, image, VK_IMAGE_ASPECT_COLOR_BIT,
+                               VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
+                               VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    }
+    ASSERT_EQ(recorded.size(), 1u);
+    EXPECT_EQ(recorded[0].srcStages, static_cast<VkPipelineStageFlags>(VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT));
+    ASSERT_EQ(recorded[0].imageBarriers.size(), 1u);
+    EXPECT_EQ(recorded[0].imageBarriers[0].srcQueueFamilyIndex, VK_QUEUE_FAMILY_IGNORED);
+    EXPECT_EQ(recorded[0].imageBarriers[0].srcAccessMask, static_cast<VkAccessFlags>(VK_ACCESS_SHADER_WRITE_BIT));
+    EXPECT_EQ(recorded[0].imageBarriers[0].newLayout, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+}
+
+//A fake gpu that finishes submissions when the test says so.
+struct GpuTimelineTest : MockDeviceTest
+{
+    struct Submission
+    {
+        VkFence fence;
+        VkSemaphore signalSemaphore;
+        uint64_t signalValue;
+        std::vector<uint64_t> waitValues;
+        uint32_t cmdBufferCount;
+        uint32_t waitSemaphoreCount;
+    };
+    static inline std::vector<Submission> submissions;
+    static inline size_t completedCount = 0;
+    static inline size_t createdFences = 0;
+    static inline std::vector<VkFence> signaledFences;
+    static inline size_t resetCalls = 0;
+    static inline size_t queueSubmitCalls = 0;
+
+    void SetUp() override
+    {
+        MockDeviceTest::SetUp();
+        submissions.clear();
+        completedCount = 0;
+        createdFences = 0;
+        signaledFences.clear();
+        resetCalls = 0;
+        queueSubmitCalls = 0;
+        vkCreateSemaphore = [](VkDevice, const VkSemaphoreCreateInfo*, const VkAllocationCallbacks*,
+                               VkSemaphore *semaphore) {return makeHandle(*semaphore);};
+        vkCreateFence = [](VkDevice, const VkFenceCreateInfo*, const VkAllocationCallbacks*, VkFence *fence)
+        {
+            ++createdFences;
+            return makeHandle(*fence);
+        };
+        vkDestroySemaphore = [](VkDevice, VkSemaphore, const VkAllocationCallbacks*){};
+        vkDestroyFence = [](VkDevice, VkFence, const VkAllocationCallbacks*){};
+        vkResetFences = [](VkDevice, uint32_t fenceCount, const VkFence *fences)
+        {
+            ++resetCalls;
+            for(uint32_t i = 0; i < fenceCount; ++i)
+                signaledFences.erase(std::remove(signaledFences.begin(), signaledFences.end(), fences[i]),
+                                     signaledFences.end());
+            return VK_SUCCESS;
+        };
+        //Every submit info is a submission, the fence belongs to the last one.
+        vkQueueSubmit = [](VkQueue, uint32_t submitCount, const VkSubmitInfo *submitInfos, VkFence fence)
+        {
+            ++queueSubmitCalls;
+            if(submitCount == 0)
+                submissions.push_back({fence, VK_NULL_HANDLE, 0, {}, 0, 0});
+            for(uint32_t i = 0; i < submitCount; ++i)
+            {
+                const VkSubmitInfo *submitInfo = &submitInfos[i];
+                Submission submission = {i + 1 == submitCount ? fence : VK_NULL_HANDLE, VK_NULL_HANDLE, 0, {},
+                                         submitInfo->commandBufferCount, submitInfo->waitSemaphoreCount};
+                const VkTimelineSemaphoreSubmitInfoKHR *timelineInfo =
+                        static_cast<const VkTimelineSemaphoreSubmitInfoKHR*>(submitInfo->pNext);
+                if(timelineInfo != nullptr)
+                {
+                    submission.signalSemaphore = submitInfo->pSignalSemaphores[0];
+                    submission.signalValue = timelineInfo->pSignalSemaphoreValues[0];
+                    submission.waitValues.assign(timelineInfo->pWaitSemaphoreValues,
+                                                 timelineInfo->pWaitSemaphoreValues + timelineInfo->waitSemaphoreValueCount);
+                }
+                submissions.push_back(submission);
+            }
+            return VK_SUCCESS;
+        };
+        vkGetFenceStatus = [](VkDevice, VkFence fence)
+        {
+            bool signaled = std::find(signaledFences.begin(), signaledFences.end(), fence) != signaledFences.end();
+            return signaled ? VK_SUCCESS : VK_NOT_READY;
+        };
+        vkGetSemaphoreCounterValueKHR = [](VkDevice, VkSemaphore semaphore, uint64_t *value)
+        {
+            *value = 0;
+            for(size_t i = 0; i < completedCount; ++i)
+            {
+                if(submissions[i].signalSemaphore == semaphore)
+                    *value = submissions[i].signalValue;
+            }
+            return VK_SUCCESS;
+        };
+        vkWaitSemaphoresKHR = [](VkDevice, const VkSemaphoreWaitInfoKHR*, uint64_t)
+        {
+            complete(submissions.size());
+            return VK_SUCCESS;
+        };
+        vkWaitForFences = [](VkDevice, uint32_t, const VkFence*, VkBool32, uint64_t)
+        {
+            complete(submissions.size());
+            return VK_SUCCESS;
+        };
+    }
+
+    //Finishes the submissions up to count.
+    static void complete(size_t count)
+    {
+        for(; completedCount < count; ++completedCount)
+        {
+            if(submissions[completedCount].fence != VK_NULL_HANDLE)
+                signaledFences.push_back(submissions[completedCount].fence);
+        }
+    }
+};
+
+TEST_F(GpuTimelineTest, timelineAndFenceFallbackTest)
+{
+    QueueSubmitter queue;
+    queue.initialize(VK_NULL_HANDLE);
+    {
+        SyncObjectPool syncObjects;
+        syncObjects.initialize(device);
+        GpuTimeline timeline;
+        ASSERT_TRUE(timeline.initialize(device, 2, true, &syncObjects));
+        ASSERT_TRUE(timeline.usesTimelineSemaphores());
+        GpuSyncPoint upload, compute;
+        ASSERT_TRUE(timeline.submit(0, queue, {}, {}, {}, upload));
+        EXPECT_EQ(upload.value, 1u);
+        //The compute queue waits for the upload on the gpu, a wait on its own queue is skipped.
+        ASSERT_TRUE(timeline.submit(1, queue, {}, {upload, {1, 0}},
+                                    {VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT},
+                                    compute));
+        ASSERT_EQ(submissions.size(), 2u);
+        EXPECT_EQ(submissions[1].waitValues, std::vector<uint64_t>{1});
+        EXPECT_EQ(submissions[1].signalValue, 1u);
+        EXPECT_FALSE(timeline.isComplete(upload));
+
+        complete(1);
+        EXPECT_TRUE(timeline.isComplete(upload));
+        EXPECT_FALSE(timeline.isComplete(compute));
+        EXPECT_TRUE(timeline.wait(compute, UINT64_MAX));
+        EXPECT_EQ(timeline.getCompletedValue(1), 1u);
+        EXPECT_EQ(createdFences, 0u);
+    }
+
+    //Without timeline semaphores the fences of finished frames are reused.
+    SyncObjectPool syncObjects;
+    syncObjects.initialize(device);
+    GpuTimeline fallback;
+    ASSERT_FALSE(fallback.initialize(device, 1, false, nullptr));
+    ASSERT_TRUE(fallback.initialize(device, 1, false, &syncObjects));
+    for(uint64_t frame = 1; frame <= 3; ++frame)
+    {
+        GpuSyncPoint frameDone;
+        ASSERT_TRUE(fallback.submit(0, queue, {}, {}, {}, frameDone));
+        EXPECT_EQ(frameDone.value, frame);
+        EXPECT_FALSE(fallback.isComplete(frameDone));
+        EXPECT_TRUE(fallback.wait(frameDone, UINT64_MAX));
+        EXPECT_EQ(fallback.getCompletedValue(0), frame);
+    }
+    EXPECT_EQ(syncObjects.getFenceCount(), 1u);
+    EXPECT_EQ(createdFences, 1u);
+}
+
+TEST_F(GpuTimelineTest, syncObjectPoolTest)
+{
+    SyncObjectPool pool;
+    pool.initialize(device);
+    VkFence first, second;
+    ASSERT_TRUE(pool.acquireFence(first));
+    ASSERT_TRUE(pool.acquireFence(second));
+    pool.releaseFence(first);
+    pool.releaseFence(second, 1);
+    EXPECT_TRUE(first == VK_NULL_HANDLE);
+
+    //Frame 1 has not finished, so only the first fence comes back.
+    pool.collect(0);
+    VkFence third, fourth;
+    ASSERT_TRUE(pool.acquireFence(third));
+    ASSERT_TRUE(pool.acquireFence(fourth));
+    EXPECT_EQ(createdFences, 3u);
+    EXPECT_EQ(resetCalls, 1u);
+
+    //Once the frame is done every fence is reused and they are reset with one call.
+    pool.releaseFence(third);
+    pool.releaseFence(fourth);
+    pool.collect(1);
+    std::vector<VkFence> fences(3);
+    for(VkFence &fence : fences)
+        ASSERT_TRUE(pool.acquireFence(fence));
+    EXPECT_EQ(createdFences, 3u);
+    EXPECT_EQ(resetCalls, 2u);
+    EXPECT_EQ(pool.getFenceCount(), 3u);
+    pool.releaseFences(fences);
+
+    VkSemaphore semaphore, other;
+    ASSERT_TRUE(pool.acquireSemaphore(semaphore));
+    pool.releaseSemaphore(semaphore, 2);
+    pool.collect(1);
+    ASSERT_TRUE(pool.acquireSemaphore(other));
+    EXPECT_EQ(pool.getSemaphoreCount(), 2u);
+    pool.collect(2);
+    ASSERT_TRUE(pool.acquireSemaphore(semaphore));
+    EXPECT_EQ(pool.getSemaphoreCount(), 2u);
+    pool.releaseSemaphore(semaphore, 2);
+    pool.releaseSemaphore(other, 2);
+}
+
+TEST_F(GpuTimelineTest, queueSubmitterTest)
+{
+    QueueSubmitter submitter;
+    submitter.initialize(VK_NULL_HANDLE);
+    VkCommandBuffer cmdBuffer = VK_NULL_HANDLE;
+    VkSemaphore semaphore;
+    makeHandle(semaphore);
+
+    //Producers on several threads queue their work for the frame.
+    std::vector<std::thread> producers;
+    for(int i = 0; i < 4; ++i)
+    {
+        producers.emplace_back([&submitter, cmdBuffer, semaphore]()
+        {
+            for(int j = 0; j < 8; ++j)
+                submitter.enqueue({cmdBuffer}, {{semaphore, VK_PIPELINE_STAGE_TRANSFER_BIT}}, {});
+        });
+    }
+    for(std::thread &producer : producers)
+        producer.join();
+    EXPECT_EQ(submitter.getPendingSubmitCount(), 32u);
+    EXPECT_EQ(queueSubmitCalls, 0u);
+
+    //All of it goes out with one call.
+    ASSERT_TRUE(submitter.flush());
+    EXPECT_EQ(queueSubmitCalls, 1u);
+    ASSERT_EQ(submissions.size(), 32u);
+    EXPECT_EQ(submissions[31].cmdBufferCount, 1u);
+    EXPECT_EQ(submissions[31].waitSemaphoreCount, 1u);
+
+    //A direct submit takes the queued work along and goes last.
+    submitter.enqueue({cmdBuffer, cmdBuffer}, {}, {});
+    std::vector<VkCommandBuffer> cmdBuffers = {cmdBuffer};
+    VkSubmitInfo submitInfo = VulkanStructures::submitInfo(cmdBuffers, {}, {}, {});
+    VkFence fence;
+    makeHandle(fence);
+    ASSERT_TRUE(submitter.submit(submitInfo, fence));
+    EXPECT_EQ(queueSubmitCalls, 2u);
+    ASSERT_EQ(submissions.size(), 34u);
+    EXPECT_EQ(submissions[32].cmdBufferCount, 2u);
+    EXPECT_EQ(submissions[33].cmdBufferCount, 1u);
+    EXPECT_TRUE(submissions[33].fence == fence);
+    EXPECT_EQ(submitter.getPendingSubmitCount(), 0u);
+
+    //Nothing queued and no fence, nothing to submit.
+    ASSERT_TRUE(submitter.flush());
+    EXPECT_EQ(queueSubmitCalls, 2u);
+}
+
+TEST(PostProcessChainTest, bloomLevelCountTest)
+{
+    //The first level is half the scene, the last keeps at least 2 texels on the short side.
+    EXPECT_EQ(PostProcessChain::computeBloomLevelCount(800, 800, 6), 6u);
+    EXPECT_EQ(PostProcessChain::computeBloomLevelCount(800, 800, 3), 3u);
+    EXPECT_EQ(PostProcessChain::computeBloomLevelCount(16, 16, 6), 3u);
+    EXPECT_EQ(PostProcessChain::computeBloomLevelCount(4000, 8, 6), 2u);
+    //Tiny scenes still get one level.
+    EXPECT_EQ(PostProcessChain::computeBloomLevelCount(3, 1, 6), 1u);
+}
+
+struct UniformRingTest : MockDeviceTest {};
+
+TEST_F(UniformRingTest, alignedWritesAndFlushTest)
+{
+    //Host visible memory without coherency, the ring has to flush what it wrote.
+    static std::vector<VkMappedMemoryRange> flushes;
+    flushes.clear();
+    vkFlushMappedMemoryRanges = [](VkDevice, uint32_t rangeCount, const VkMappedMemoryRange *ranges)
+    {
+        flushes.insert(flushes.end(), ranges, ranges + rangeCount);
+        return VK_SUCCESS;
+    };
+
+    VkPhysicalDeviceMemoryProperties memoryProperties = {};
+    memoryProperties.memoryTypeCount = 2;
+    memoryProperties.memoryTypes[0].propertyFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+    memoryProperties.memoryTypes[1].propertyFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+    VkPhysicalDeviceLimits limits = {};
+    limits.minUniformBufferOffsetAlignment = 256;
+    limits.nonCoherentAtomSize = 64;
+    limits.maxUniformBufferRange = 65536;
+
+    UniformRing ring;
+    EXPECT_FALSE(ring.initialize(device, memoryProperties, limits, 1000, 3, 2048));
+    ASSERT_TRUE(ring.initialize(device, memoryProperties, limits, 1000, 3, 128));
+    EXPECT_FALSE(ring.isCoherent());
+    EXPECT_EQ(ring.getFrameStride(), 1024u);
+    EXPECT_EQ(ring.getBuffer().size, 3072u);
+    BufferDescriptorInfo descriptor = ring.getDescriptorInfo(VK_NULL_HANDLE, 0);
+    EXPECT_EQ(descriptor.targetDescriptorType, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC);
+    EXPECT_EQ(descriptor.bufferInfos[0].range, 128u);
+
+    //Blocks start at aligned offsets and land in the mapped memory.
+    glm::mat4 block(2.0f);
+    uint32_t offset = 1;
+    ASSERT_TRUE(ring.write(block, offset));
+    EXPECT_EQ(offset, 0u);
+    ASSERT_TRUE(ring.write(block[0], offset));
+    EXPECT_EQ(offset, 256u);
+    EXPECT_EQ(std::memcmp(lastMappedMemory + 256, &block[0], sizeof(glm::vec4)), 0);
+    ASSERT_TRUE(ring.flush());
+    ASSERT_EQ(flushes.size(), 1u);
+    EXPECT_EQ(flushes[0].offset, 0u);
+    EXPECT_EQ(flushes[0].size, 320u);
+
+    //Only what was written since the last flush, widened to whole atoms.
+    ASSERT_TRUE(ring.write(block, offset));
+    EXPECT_EQ(offset, 512u);
+    ASSERT_TRUE(ring.flush());
+    ASSERT_EQ(flushes.size(), 2u);
+    EXPECT_EQ(flushes[1].offset, 256u);
+    EXPECT_EQ(flushes[1].size, 320u);
+    EXPECT_TRUE(ring.flush());
+    EXPECT_EQ(flushes.size(), 2u);
+
+    //The whole block range has to fit into the region.
+    ASSERT_TRUE(ring.write(block[0], offset));
+    EXPECT_EQ(offset, 768u);
+    EXPECT_FALSE(ring.write(block[0], offset));
+    EXPECT_EQ(offset, 768u);
+    uint8_t tooLarge[129] = {};
+    ring.beginFrame(1);
+    EXPECT_FALSE(ring.write(tooLarge, sizeof(tooLarge), offset));
+
+    //Frames rotate over the regions.
+    ASSERT_TRUE(ring.write(block, offset));
+    EXPECT_EQ(offset, 1024u);
+    ring.beginFrame(5);
+    ASSERT_TRUE(ring.write(block, offset));
+    EXPECT_EQ(offset, 2048u);
+
+    //Coherent memory is never flushed.
+    memoryProperties.memoryTypes[1].propertyFlags |= VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    flushes.clear();
+    ASSERT_TRUE(ring.initialize(device, memoryProperties, limits, 1000, 3, 128));
+    EXPECT_TRUE(ring.isCoherent());
+    ASSERT_TRUE(ring.write(block, offset));
+    EXPECT_TRUE(ring.flush());
+    EXPECT_TRUE(flushes.empty());
+    ring.destroy();
+}
+
+struct DrawParameterBindingTest : MockDeviceTest {};
+
+TEST_F(DrawParameterBindingTest, pushConstantsAndRingFallbackTest)
+{
+    static std::vector<uint8_t> pushed;
+    static uint32_t pushedOffset;
+    vkCmdPushConstants = [](VkCommandBuffer, VkPipelineLayout, VkShaderStageFlags, uint32_t offset, uint32_t size,
+                            const void *values)
+    {
+        pushed.assign(static_cast<const uint8_t*>(values), static_cast<const uint8_t*>(values) + size);
+        pushedOffset = offset;
+    };
+
+    VkPhysicalDeviceMemoryProperties memoryProperties = {};
+    memoryProperties.memoryTypeCount = 1;
+    memoryProperties.memoryTypes[0].propertyFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    VkPhysicalDeviceLimits limits = {};
+    limits.minUniformBufferOffsetAlignment = 256;
+    limits.nonCoherentAtomSize = 64;
+    limits.maxUniformBufferRange = 65536;
+    limits.maxPushConstantsSize = 128;
+    UniformRing ring;
+    ASSERT_TRUE(ring.initialize(device, memoryProperties, limits, 4096, 2, sizeof(DrawParameters)));
+
+    DrawParameters parameters = {glm::mat4(3.0f), 7, 9, {0, 0}};
+    std::vector<uint32_t> dynamicOffsets = {512};
+
+    //The guaranteed 128 bytes are enough, the block is pushed and the layout needs no descriptor.
+    DrawParameterBinding binding;
+    ASSERT_TRUE(binding.initialize(limits, VK_SHADER_STAGE_VERTEX_BIT, sizeof(DrawParameters), &ring));
+    EXPECT_TRUE(binding.usesPushConstants());
+    std::vector<VkPushConstantRange> ranges = binding.getPushConstantRanges();
+    ASSERT_EQ(ranges.size(), 1u);
+    EXPECT_EQ(ranges[0].stageFlags, static_cast<VkShaderStageFlags>(VK_SHADER_STAGE_VERTEX_BIT));
+    EXPECT_EQ(ranges[0].size, sizeof(DrawParameters));
+    EXPECT_TRUE(binding.getDescriptorSetLayoutBindings(1).empty());
+    EXPECT_TRUE(binding.getDescriptorInfos(VK_NULL_HANDLE, 1).empty());
+    ASSERT_TRUE(binding.record(VK_NULL_HANDLE, VK_NULL_HANDLE, parameters, dynamicOffsets));
+    ASSERT_EQ(pushed.size(), sizeof(DrawParameters));
+    EXPECT_EQ(pushedOffset, 0u);
+    EXPECT_EQ(std::memcmp(pushed.data(), &parameters, sizeof(DrawParameters)), 0);
+    EXPECT_EQ(ring.getFrameUsage(), 0u);
+    EXPECT_EQ(dynamicOffsets.size(), 1u);
+
+    //Too little push constant space, the block goes through the ring behind the set's own offsets.
+    pushed.clear();
+    limits.maxPushConstantsSize = 64;
+    ASSERT_TRUE(binding.initialize(limits, VK_SHADER_STAGE_VERTEX_BIT, sizeof(DrawParameters), &ring));
+    EXPECT_FALSE(binding.usesPushConstants());
+    EXPECT_TRUE(binding.getPushConstantRanges().empty());
+    std::vector<VkDescriptorSetLayoutBinding> layoutBindings = binding.getDescriptorSetLayoutBindings(1);
+    ASSERT_EQ(layoutBindings.size(), 1u);
+    EXPECT_EQ(layoutBindings[0].binding, 1u);
+    EXPECT_EQ(layoutBindings[0].descriptorType, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC);
+    std::vector<BufferDescriptorInfo> descriptors = binding.getDescriptorInfos(VK_NULL_HANDLE, 1);
+    ASSERT_EQ(descriptors.size(), 1u);
+    EXPECT_EQ(descriptors[0].targetDescriptorBinding, 1u);
+    ASSERT_TRUE(binding.record(VK_NULL_HANDLE, VK_NULL_HANDLE, parameters, dynamicOffsets));
+    ASSERT_TRUE(binding.record(VK_NULL_HANDLE, VK_NULL_HANDLE, parameters, dynamicOffsets));
+    EXPECT_TRUE(pushed.empty());
+    ASSERT_EQ(dynamicOffsets.size(), 3u);
+    EXPECT_EQ(dynamicOffsets[1], 0u);
+    EXPECT_EQ(dynamicOffsets[2], 256u);
+    EXPECT_EQ(std::memcmp(lastMappedMemory + 256, &parameters, sizeof(DrawParameters)), 0);
+
+    //Without a ring large enough for the block there is nothing to fall back to.
+    EXPECT_FALSE(binding.initialize(limits, VK_SHADER_STAGE_VERTEX_BIT, sizeof(DrawParameters), nullptr));
+    EXPECT_FALSE(binding.initialize(limits, VK_SHADER_STAGE_VERTEX_BIT, 6, &ring));
+    ring.destroy();
+}
+
+struct GpuCullerTest : MockDeviceTest {};
+
+TEST_F(GpuCullerTest, mockedDeviceTest)
+{
+    //Pipeline objects get fake handles and the recorded commands are captured.
+    static std::vector<uint32_t> shaderWords;
+    static GpuCullPushConstants pushConstants;
+    static uint32_t dispatchedGroups;
+    static uint32_t filledBuffers;
+    static std::vector<std::pair<VkDeviceSize, uint32_t>> indirectDraws;
+    static uint32_t countedDraws;
+    vkCreateDescriptorSetLayout = [](VkDevice, const VkDescriptorSetLayoutCreateInfo*, const VkAllocationCallbacks*,
+                                     VkDescriptorSetLayout *layout) {return makeHandle(*layout);};
+    vkCreateDescriptorPool = [](VkDevice, const VkDescriptorPoolCreateInfo*, const VkAllocationCallbacks*,
+                                VkDescriptorPool *pool) {return makeHandle(*pool);};
+    vkAllocateDescriptorSets = [](VkDevice, const VkDescriptorSetAllocateInfo *allocateInfo, VkDescriptorSet *sets)
+    {
+        for(uint32_t i = 0; i < allocateInfo->descriptorSetCount; ++i)
+            makeHandle(sets[i]);
+        return VK_SUCCESS;
+    };
+    vkUpdateDescriptorSets = [](VkDevice, uint32_t, const VkWriteDescriptorSet*, uint32_t, const VkCopyDescriptorSet*){};
+    vkCreatePipelineLayout = [](VkDevice, const VkPipelineLayoutCreateInfo*, const VkAllocationCallbacks*,
+                                VkPipelineLayout *layout) {return makeHandle(*layout);};
+    vkCreateShaderModule = [](VkDevice, const VkShaderModuleCreateInfo *createInfo, const VkAllocationCallbacks*,
+                              VkShaderModule *shaderModule)
+    {
+        shaderWords.assign(createInfo->pCode, createInfo->pCode + createInfo->codeSize / 4);
+        return makeHandle(*shaderModule);
+    };
+    vkCreateComputePipelines = [](VkDevice, VkPipelineCache, uint32_t count, const VkComputePipelineCreateInfo*,
+                                  const VkAllocationCallbacks*, VkPipeline *pipelines)
+    {
+        for(uint32_t i = 0; i < count; ++i)
+            makeHandle(pipelines[i]);
+        return VK_SUCCESS;
+    };
+    vkDestroyShaderModule = [](VkDevice, VkShaderModule, const VkAllocationCallbacks*){};
+    vkDestroyPipeline = [](VkDevice, VkPipeline, const VkAllocationCallbacks*){};
+    vkDestroyPipelineLayout = [](VkDevice, VkPipelineLayout, const VkAllocationCallbacks*){};
+    vkDestroyDescriptorPool = [](VkDevice, VkDescriptorPool, const VkAllocationCallbacks*){};
+    vkDestroyDescriptorSetLayout = [](VkDevice, VkDescriptorSetLayout, const VkAllocationCallbacks*){};
+    vkCmdPipelineBarrier = [](VkCommandBuffer, VkPipelineStageFlags, VkPipelineStageFlags, VkDependencyFlags,
+                              uint32_t, const VkMemoryBarrier*, uint32_t, const VkBufferMemoryBarrier*,
+                              uint32_t, const VkImageMemoryBarrier*){};
+    vkCmdFillBuffer = [](VkCommandBuffer, VkBuffer, VkDeviceSize, VkDeviceSize, uint32_t) {++filledBuffers;};
+    vkCmdBindPipeline = [](VkCommandBuffer, VkPipelineBindPoint, VkPipeline){};
+    vkCmdBindDescriptorSets = [](VkCommandBuffer, VkPipelineBindPoint, VkPipelineLayout, uint32_t, uint32_t,
+                                 const VkDescriptorSet*, uint32_t, const uint32_t*){};
+    vkCmdPushConstants = [](VkCommandBuffer, VkPipelineLayout, VkShaderStageFlags, uint32_t, uint32_t size,
+                            const void *values)
+    {
+        ASSERT_EQ(size, sizeof(GpuCullPushConstants));
+        std::memcpy(&pushConstants, values, size);
+    };
+    vkCmdDispatch = [](VkCommandBuffer, uint32_t groupCountX, uint32_t, uint32_t) {dispatchedGroups = groupCountX;};
+    vkCmdDrawIndexedIndirect = [](VkCommandBuffer, VkBuffer, VkDeviceSize offset, uint32_t drawCount, uint32_t)
+    {
+        indirectDraws.push_back({offset, drawCount});
+    };
+    vkCmdDrawIndexedIndirectCountKHR = [](VkCommandBuffer, VkBuffer, VkDeviceSize, VkBuffer, VkDeviceSize,
+                                          uint32_t maxDrawCount, uint32_t) {countedDraws = maxDrawCount;};
+
+    VkPhysicalDeviceMemoryProperties memoryProperties = {};
+    memoryProperties.memoryTypeCount = 1;
+    memoryProperties.memoryTypes[0].propertyFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT |
+                                                    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                                                    VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    //The fake device only looks at the header of the module.
+    TemporaryFile shaderFile("raven-test-comp.spv");
+    const std::string &shaderFilename = shaderFile.path;
+    const uint32_t shaderHeader[] = {0x07230203, 0x00010000, 0, 1, 0};
+    std::ofstream(shaderFilename, std::ios::binary).write(reinterpret_cast<const char*>(shaderHeader),
+                                                          sizeof(shaderHeader));
+
+    //The scene node handle is the first instance, so devices without it and missing
+    //shaders fail without throwing.
+    GpuCuller culler;
+    VkPhysicalDeviceFeatures features = {};
+    EXPECT_FALSE(culler.initialize(device, memoryProperties, features, false, shaderFilename, 128));
+    features.drawIndirectFirstInstance = VK_TRUE;
+    EXPECT_FALSE(culler.initialize(device, memoryProperties, features, false, "missing-comp.spv", 128));
+    EXPECT_FALSE(culler.isInitialized());
+
+    ASSERT_TRUE(culler.initialize(device, memoryProperties, features, false, shaderFilename, 128));
+    EXPECT_TRUE(culler.isInitialized());
+    EXPECT_FALSE(culler.isUsingDrawCount());
+    ASSERT_FALSE(shaderWords.empty());
+    EXPECT_EQ(shaderWords[0], 0x07230203u);
+
+    std::vector<GpuCullDraw> draws(100);
+    for(uint32_t i = 0; i < draws.size(); ++i)
+        draws[i] = {{0.0f, 0.0f, 0.0f}, 1.0f, 36, i * 36, 0, i};
+    EXPECT_FALSE(culler.setDraws(std::vector<GpuCullDraw>(129)));
+    ASSERT_TRUE(culler.setDraws(draws));
+    EXPECT_EQ(culler.getDrawCount(), 100u);
+    EXPECT_EQ(std::memcmp(lastMappedMemory + sizeof(GpuCullDraw) * 99, &draws[99], sizeof(GpuCullDraw)), 0);
+
+    //One thread per draw, the commands keep their slots without a draw count.
+    Frustum frustum = {};
+    frustum.planes[0] = glm::vec4(1.0f, 0.0f, 0.0f, 2.0f);
+    filledBuffers = 0;
+    culler.recordCulling(cmdBuffer, frustum);
+    EXPECT_EQ(dispatchedGroups, 2u);
+    EXPECT_EQ(pushConstants.drawCount, 100u);
+    EXPECT_EQ(pushConstants.compact, 0u);
+    EXPECT_EQ(pushConstants.phase, static_cast<uint32_t>(GPU_CULL_PHASE_FRUSTUM));
+    EXPECT_EQ(pushConstants.planes[0], frustum.planes[0]);
+    EXPECT_EQ(filledBuffers, 0u);
+
+    //Without multiDrawIndirect every command is its own draw.
+    indirectDraws.clear();
+    culler.recordDraws(cmdBuffer);
+    ASSERT_EQ(indirectDraws.size(), 100u);
+    EXPECT_EQ(indirectDraws[99].first, 99u * sizeof(VkDrawIndexedIndirectCommand));
+    EXPECT_EQ(indirectDraws[99].second, 1u);
+
+    features.multiDrawIndirect = VK_TRUE;
+    ASSERT_TRUE(culler.initialize(device, memoryProperties, features, false, shaderFilename, 128));
+    ASSERT_TRUE(culler.setDraws(draws));
+    indirectDraws.clear();
+    culler.recordDraws(cmdBuffer);
+    ASSERT_EQ(indirectDraws.size(), 1u);
+    EXPECT_EQ(indirectDraws[0].second, 100u);
+
+    //With a draw count the visible commands are packed, so the count is cleared first.
+    ASSERT_TRUE(culler.initialize(device, memoryProperties, features, true, shaderFilename, 128));
+    ASSERT_TRUE(culler.setDraws(draws));
+    culler.recordCulling(cmdBuffer, frustum);
+    EXPECT_EQ(pushConstants.compact, 1u);
+    EXPECT_EQ(filledBuffers, 1u);
+    indirectDraws.clear();
+    countedDraws = 0;
+    culler.recordDraws(cmdBuffer);
+    EXPECT_TRUE(indirectDraws.empty());
+    EXPECT_EQ(countedDraws, 100u);
+    culler.destroy();
+    EXPECT_FALSE(culler.isInitialized());
+}
+
+//A real device on a cpu implementation such as lavapipe, for tests that run shaders.
+//Without a Vulkan library or a cpu device the device is not available and the tests skip.
+struct SoftwareDeviceTest : MockDeviceTest
+{
+    LIBRARY_TYPE library = nullptr;
+    VkInstance instance = VK_NULL_HANDLE;
+    VkPhysicalDeviceMemoryProperties memoryProperties = {};
+    VkPhysicalDeviceFeatures enabledFeatures = {};
+    VkQueue queue = VK_NULL_HANDLE;
+    VkCommandPool cmdPool = VK_NULL_HANDLE;
+    bool available = false;
+
+    void SetUp() override
+    {
+        MockDeviceTest::SetUp();
+        device = VK_NULL_HANDLE;
+        try
+        {
+            loadVulkanLibrary(library);
+        }
+        catch(const std::exception&)
+        {
+            library = nullptr;
+            return;
+        }
+        std::vector<const char*> extensions;
+        std::vector<VkPhysicalDevice> physicalDevices;
+        if(!loadFunctionExportedFromVulkanLoaderLibrary(library) || !loadGlobalLevelFunctions() ||
+           !createVulkanInstance(extensions, "RavenTest", instance) ||
+           !loadInstanceLevelVulkanFunctions(instance, extensions) ||
+           !loadPhysicalDevices(instance, physicalDevices))
+        {
+            return;
+        }
+
+        VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+        for(VkPhysicalDevice &candidate : physicalDevices)
+        {
+            VkPhysicalDeviceFeatures features;
+            VkPhysicalDeviceProperties properties;
+            getPhysicalDeviceFeaturesAndProperties(candidate, features, properties);
+            if(properties.deviceType == VK_PHYSICAL_DEVICE_TYPE_CPU)
+            {
+                physicalDevice = candidate;
+                enabledFeatures.drawIndirectFirstInstance = features.drawIndirectFirstInstance;
+                break;
+            }
+        }
+        std::vector<VkQueueFamilyProperties> queueFamilies;
+        uint32_t queueFamilyIndex;
+        if(physicalDevice == VK_NULL_HANDLE ||
+           !getPhysicalDeviceQueuesWithProperties(physicalDevice, queueFamilies) ||
+           !getQueueFamilyIndex(queueFamilies, VK_QUEUE_COMPUTE_BIT, queueFamilyIndex))
+        {
+            return;
+        }
+        vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+
+        std::vector<float> priorities = {1.0f};
+        VkDeviceQueueCreateInfo queueInfo = VulkanStructures::deviceQueueCreateInfo(queueFamilyIndex, priorities);
+        VkDeviceCreateInfo createInfo = VulkanStructures::deviceCreateInfo();
+        createInfo.queueCreateInfoCount = 1;
+        createInfo.pQueueCreateInfos = &queueInfo;
+        createInfo.pEnabledFeatures = &enabledFeatures;
+        std::vector<const char*> deviceExtensions;
+        if(!createLogicalDevice(physicalDevice, createInfo, device) ||
+           !loadDeviceLevelFunctions(device, deviceExtensions))
+        {
+            device = VK_NULL_HANDLE;
+            return;
+        }
+        vkGetDeviceQueue(device, queueFamilyIndex, 0, &queue);
+        std::vector<VkCommandBuffer> cmdBuffers;
+        if(!createCommandPool(device, VulkanStructures::commandPoolCreateInfo(queueFamilyIndex), cmdPool) ||
+           !allocateCommandBuffer(device, VulkanStructures::commandBufferAllocateInfo(VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+                                                                                      cmdPool, 1), cmdBuffers))
+        {
+            return;
+        }
+        cmdBuffer = cmdBuffers[0];
+        available = true;
+    }
+
+    void TearDown() override
+    {
+        if(device != VK_NULL_HANDLE)
+        {
+            vkDeviceWaitIdle(device);
+            if(cmdPool != VK_NULL_HANDLE)
+                destroyCommandPool(device, cmdPool);
+            vkDestroyDevice(device, nullptr);
+        }
+        if(instance != VK_NULL_HANDLE)
+            vkDestroyInstance(instance, nullptr);
+        MockDeviceTest::TearDown();
+        if(library != nullptr)
+            freeVulkanLibrary(library);
+    }
+
+    //Creates a mapped buffer the host can read and write.
+    bool createHostBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VulkanBuffer &buffer, VkDeviceMemory &memory)
+    {
+        buffer.size = size;
+        VkMemoryRequirements memReq;
+        if(!createBuffer(device, VulkanStructures::bufferCreateInfo(size, usage, VK_SHARING_MODE_EXCLUSIVE),
+                         buffer.buffer))
+        {
+            return false;
+        }
+        vkGetBufferMemoryRequirements(device, buffer.buffer, &memReq);
+        return allocateMemory(device, memoryProperties, memReq,
+                              VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, memory) &&
+               buffer.bindMemoryObject(device, memory) &&
+               vkMapMemory(device, memory, 0, size, 0, &buffer.data) == VK_SUCCESS;
+    }
+
+    void destroyHostBuffer(VulkanBuffer &buffer, VkDeviceMemory &memory)
+    {
+        destroyBuffer(device, buffer.buffer);
+        freeMemory(device, memory);
+    }
+
+    //Records commands into the command buffer and waits until the device has executed them.
+    bool execute(const std::function<void(VkCommandBuffer)> &record)
+    {
+        VkFence fence;
+        if(!beginCommandBuffer(cmdBuffer, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT))
+            return false;
+        record(cmdBuffer);
+        std::vector<VkCommandBuffer> cmdBuffers = {cmdBuffer};
+        if(!endCommandBuffer(cmdBuffer) || !createFence(device, VK_FALSE, fence))
+            return false;
+        bool executed = submitCommandBuffers(queue, 1, VulkanStructures::submitInfo(cmdBuffers, {}, {}, {}), fence) &&
+                        vkWaitForFences(device, 1, &fence, VK_TRUE, UINT64_MAX) == VK_SUCCESS;
+        destroyFence(device, fence);
+        return executed;
+    }
+};
+
+TEST_F(SoftwareDeviceTest, gpuCullingMatchesFrustumCullerTest)
+{
+    //The shader is compiled by the asset build into the build directory.
+    const std::string shaderFilename = std::string("../") + SETTINGS_COOKED_ASSET_DIRECTORY +
+                                       "Shaders/culling/culling-comp.spv";
+    if(!available || !std::ifstream(shaderFilename))
+    {
+        std::cout << "Skipping gpu culling on a software device, no cpu Vulkan device or cooked culling shader."
+                  << std::endl;
+        return;
+    }
+    ASSERT_TRUE(enabledFeatures.drawIndirectFirstInstance);
+
+    //Spheres on a grid around the box [-1, 1] x [-1, 1] x [0, 1], placed by their world matrices.
+    //None of them touches a plane exactly, so rounding can not change the result.
+    const uint32_t drawCount = 1000;
+    std::vector<GpuCullDraw> draws(drawCount);
+    std::vector<glm::mat4> worldMatrices(drawCount);
+    FrustumCuller frustumCuller;
+    for(uint32_t i = 0; i < drawCount; ++i)
+    {
+        glm::vec3 position(-3.0f + 0.06f * float((i * 37) % 100) + 0.013f,
+                           -3.0f + 0.06f * float((i * 53) % 100) + 0.013f,
+                           -1.0f + 0.03f * float((i * 71) % 100) + 0.007f);
+        float scale = 1.0f + float(i % 2);
+        worldMatrices[i] = glm::mat4(scale);
+        worldMatrices[i][3] = glm::vec4(position, 1.0f);
+        draws[i] = {{0.0f, 0.0f, 0.0f}, 0.1f, 36, i * 36, 0, i};
+        frustumCuller.addSphere(position, 0.1f * scale);
+    }
+    Frustum frustum = FrustumCuller::extractFrustum(glm::mat4(1.0f));
+    std::vector<uint32_t> expected;
+    frustumCuller.cull(frustum, expected);
+    ASSERT_FALSE(expected.empty());
+    ASSERT_LT(expected.size(), drawCount);
+
+    VulkanBuffer instanceBuffer, readbackBuffer;
+    VkDeviceMemory instanceMemory, readbackMemory;
+    VkDeviceSize commandSize = sizeof(VkDrawIndexedIndirectCommand) * drawCount;
+    ASSERT_TRUE(createHostBuffer(sizeof(glm::mat4) * drawCount, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                 instanceBuffer, instanceMemory));
+    ASSERT_TRUE(createHostBuffer(commandSize + sizeof(uint32_t), VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                 readbackBuffer, readbackMemory));
+    std::memcpy(instanceBuffer.data, worldMatrices.data(), sizeof(glm::mat4) * drawCount);
+    const VkDrawIndexedIndirectCommand *commands = static_cast<const VkDrawIndexedIndirectCommand*>(readbackBuffer.data);
+
+    //Every draw keeps its slot without a draw count, and with one the visible draws are packed.
+    for(bool drawIndirectCount : {false, true})
+    {
+        GpuCuller culler;
+        ASSERT_TRUE(culler.initialize(device, memoryProperties, enabledFeatures, drawIndirectCount, shaderFilename,
+                                      drawCount));
+        culler.setInstanceBuffer(instanceBuffer.buffer);
+        ASSERT_TRUE(culler.setDraws(draws));
+        ASSERT_TRUE(execute([&](VkCommandBuffer recording)
+        {
+            culler.recordCulling(recording, frustum);
+            setBufferMemoryBarriers(recording, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                    {{culler.getCommandBuffer().buffer, VK_ACCESS_SHADER_WRITE_BIT,
+                                      VK_ACCESS_TRANSFER_READ_BIT, VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED},
+                                     {culler.getCountBuffer().buffer, VK_ACCESS_SHADER_WRITE_BIT,
+                                      VK_ACCESS_TRANSFER_READ_BIT, VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED}});
+            copyDataBetweenBuffers(recording, culler.getCommandBuffer().buffer, readbackBuffer.buffer,
+                                   {{0, 0, commandSize}});
+            copyDataBetweenBuffers(recording, culler.getCountBuffer().buffer, readbackBuffer.buffer,
+                                   {{0, commandSize, sizeof(uint32_t)}});
+            setBufferMemoryBarriers(recording, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT,
+                                    {{readbackBuffer.buffer, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_HOST_READ_BIT,
+                                      VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED}});
+        }));
+
+        std::vector<uint32_t> visible;
+        if(drawIndirectCount)
+        {
+            uint32_t visibleCount;
+            std::memcpy(&visibleCount, static_cast<const uint8_t*>(readbackBuffer.data) + commandSize,
+                        sizeof(visibleCount));
+            ASSERT_EQ(visibleCount, expected.size());
+            for(uint32_t i = 0; i < visibleCount; ++i)
+            {
+                EXPECT_EQ(commands[i].instanceCount, 1u);
+                visible.push_back(commands[i].firstInstance);
+            }
+            std::sort(visible.begin(), visible.end());
+        }
+        else
+        {
+            for(uint32_t i = 0; i < drawCount; ++i)
+            {
+                EXPECT_EQ(commands[i].firstInstance, i);
+                EXPECT_EQ(commands[i].firstIndex, i * 36);
+                if(commands[i].instanceCount != 0)
+                    visible.push_back(i);
+            }
+        }
+        EXPECT_EQ(visible, expected);
+        culler.destroy();
+    }
+    destroyHostBuffer(instanceBuffer, instanceMemory);
+    destroyHostBuffer(readbackBuffer, readbackMemory);
+}
+
+TEST(TextureStreamingTest, mipChainAndSelectionTest)
+{
+    std::vector<unsigned char> pixels(256 * 128 * 4, 200);
+    std::vector<TextureMipLevel> mipLevels;
+    generateMipChain(pixels.data(), 256, 128, mipLevels);
+
+    ASSERT_EQ(mipLevels.size(), 9u);
+    EXPECT_EQ(mipLevels[1].width, 128u);
+    EXPECT_EQ(mipLevels[1].height, 64u);
+    EXPECT_EQ(mipLevels.back().width, 1u);
+    EXPECT_EQ(mipLevels.back().pixels[0], 200);
+
+    //A texture drawn at its own size needs the finest mip, four times smaller skips two mips.
+    EXPECT_EQ(TextureStreamer::selectMipLevel(256, 128, 256.0f, 9), 0u);
+    EXPECT_EQ(TextureStreamer::selectMipLevel(256, 128, 64.0f, 9), 2u);
+    EXPECT_EQ(TextureStreamer::selectMipLevel(256, 128, 0.0f, 9), 8u);
+}
+
+TEST(TextureStreamingTest, screenSpaceSizeTest)
+{
+    //A sphere of radius 1 at a distance of 10 covers a tenth of the viewport with a 90 degree field of view.
+    glm::mat4 viewMatrix(1.0f);
+    glm::mat4 projectionMatrix(1.0f);
+    glm::vec3 center(0.0f, 0.0f, -10.0f);
+    EXPECT_FLOAT_EQ(TextureStreamer::calculateScreenSpaceSize(center, 1.0f, viewMatrix, projectionMatrix, 800.0f), 80.0f);
+
+    //Flipping y for Vulkan does not change the size.
+    projectionMatrix[1][1] = -1.0f;
+    EXPECT_FLOAT_EQ(TextureStreamer::calculateScreenSpaceSize(center, 1.0f, viewMatrix, projectionMatrix, 800.0f), 80.0f);
+
+    //Inside the sphere the whole viewport is covered.
+    EXPECT_FLOAT_EQ(TextureStreamer::calculateScreenSpaceSize(glm::vec3(0.0f), 1.0f, viewMatrix,
+                                                              projectionMatrix, 800.0f), 800.0f);
+}
+
+TEST(TextureStreamingTest, formatTest)
+{
+    std::vector<unsigned char> pixels(16 * 16 * 4, 200);
+    std::vector<TextureMipLevel> mipLevels;
+    generateMipChain(pixels.data(), 16, 16, mipLevels);
+
+    //The mips are RGBA8, so formats of any other size or channel order are rejected before any upload.
+    TextureStreamer textureStreamer;
+    uint32_t textureId = UINT32_MAX;
+    std::vector<TextureMipLevel> copy = mipLevels;
+    EXPECT_FALSE(textureStreamer.addTexture(std::move(copy), VK_FORMAT_R16G16B16A16_SFLOAT, textureId));
+    copy = mipLevels;
+    EXPECT_FALSE(textureStreamer.addTexture(std::move(copy), VK_FORMAT_B8G8R8A8_UNORM, textureId));
+
+    //Pixels that do not fill their mip are rejected as well.
+    mipLevels[1].pixels.resize(8 * 8 * 3);
+    EXPECT_FALSE(textureStreamer.addTexture(std::move(mipLevels), VK_FORMAT_R8G8B8A8_UNORM, textureId));
+    EXPECT_EQ(textureStreamer.getTextureCount(), 0u);
+}
+
 int main(int argc, char *argv[])
 {
     testing::InitGoogleTest(&argc, argv);
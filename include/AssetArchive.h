@@ -0,0 +1,143 @@
+#pragma once
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace Raven
+{
+    //Identifies the file as a Raven asset pack.
+    #define ASSET_ARCHIVE_MAGIC "RVPK"
+    #define ASSET_ARCHIVE_VERSION 1
+    //Default alignment of the entry data inside the pack.
+    #define ASSET_ARCHIVE_DEFAULT_ALIGNMENT 16
+
+    //How the bytes of an archive entry are stored.
+    enum class AssetCompression : uint32_t
+    {
+        None = 0,
+        LZ4 = 1,
+        //Reserved for Zstandard, which is not built into this version.
+        Zstd = 2
+    };
+
+    //Pack layout: header | table of contents | name strings | aligned entry data.
+    //Everything the runtime needs for a lookup sits at the front of the file so
+    //opening a pack reads the table sequentially before any entry is touched.
+    struct AssetArchiveHeader
+    {
+        char magic[4];
+        uint32_t version;
+        uint32_t entryCount;
+        uint32_t alignment;
+        uint64_t tableOffset;
+        uint64_t stringTableOffset;
+        uint64_t stringTableSize;
+        uint64_t dataOffset;
+    };
+
+    //A single table of contents entry. Entries are sorted by name hash.
+    struct AssetArchiveEntry
+    {
+        uint64_t nameHash;
+        uint64_t dataOffset;
+        uint64_t storedSize;
+        uint64_t originalSize;
+        uint32_t nameOffset;
+        uint32_t nameLength;
+        uint32_t compression;
+        uint32_t reserved;
+    };
+
+    static_assert(sizeof(AssetArchiveHeader) == 48, "Asset archive header layout changed!");
+    static_assert(sizeof(AssetArchiveEntry) == 48, "Asset archive entry layout changed!");
+
+    //A read-only view into asset bytes owned by an AssetArchive.
+    struct AssetSpan
+    {
+        const char *data = nullptr;
+        size_t size = 0;
+    };
+
+    //Hashes an asset name for the table of contents (64-bit FNV-1a).
+    uint64_t hashAssetName(const std::string &name) noexcept;
+
+    //Maps a pack file into memory and hands out views to its entries by name.
+    class AssetArchive
+    {
+        public:
+            AssetArchive();
+            ~AssetArchive();
+            AssetArchive(const AssetArchive&) = delete;
+            AssetArchive& operator=(const AssetArchive&) = delete;
+
+            //Maps the pack and validates its table of contents.
+            bool open(const std::string &filename);
+            //Unmaps the pack. Spans handed out earlier become invalid.
+            void close();
+            bool isOpen() const {return mappedData != nullptr;}
+
+            //Returns true if the archive holds an entry with the given name.
+            bool contains(const std::string &name) const;
+            //Returns a view to the uncompressed bytes of an entry. Compressed entries
+            //are decompressed once and cached for the lifetime of the archive.
+            bool getAsset(const std::string &name, AssetSpan &asset);
+            //Copies the uncompressed bytes of an entry into the data vector.
+            bool readAsset(const std::string &name, std::vector<char> &data);
+
+            uint32_t getEntryCount() const {return entryCount;}
+            //Returns the name of the entry at the given table of contents index.
+            std::string getEntryName(uint32_t index) const;
+        private:
+            //Binary searches the table of contents, returns nullptr if not found.
+            const AssetArchiveEntry* findEntry(const std::string &name) const;
+            //Decompresses an entry into the given memory.
+            bool decompressEntry(const AssetArchiveEntry &entry, char *destination) const;
+
+            const char *mappedData = nullptr;
+            size_t mappedSize = 0;
+            const AssetArchiveEntry *entries = nullptr;
+            const char *stringTable = nullptr;
+            uint32_t entryCount = 0;
+
+            //Platform specific file and mapping handles.
+            void *fileHandle = nullptr;
+            void *mappingHandle = nullptr;
+
+            //Decompressed entries, keyed by table of contents index.
+            std::map<uint32_t, std::unique_ptr<std::vector<char>>> decompressedEntries;
+            std::mutex decompressedEntriesMutex;
+    };
+
+    //Collects files and writes them into a pack that AssetArchive can open.
+    class AssetArchiveWriter
+    {
+        public:
+            AssetArchiveWriter(uint32_t alignment = ASSET_ARCHIVE_DEFAULT_ALIGNMENT);
+
+            //Adds an entry from memory. Compressed entries that do not shrink are stored as is.
+            bool addData(const std::string &name, const char *data, size_t size,
+                         AssetCompression compression = AssetCompression::None);
+            //Reads a file from the disk and adds it as an entry.
+            bool addFile(const std::string &name, const std::string &filename,
+                         AssetCompression compression = AssetCompression::None);
+            //Writes the pack. Entries stay in the writer so the same set can be written again.
+            bool write(const std::string &filename) const;
+
+            size_t getEntryCount() const {return pendingEntries.size();}
+        private:
+            struct PendingEntry
+            {
+                std::string name;
+                uint64_t nameHash;
+                uint64_t originalSize;
+                AssetCompression compression;
+                std::vector<char> storedData;
+            };
+
+            uint32_t alignment;
+            std::vector<PendingEntry> pendingEntries;
+    };
+}
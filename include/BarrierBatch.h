@@ -0,0 +1,49 @@
+#pragma once
+#include "VulkanBuffer.h"
+#include "VulkanImage.h"
+#include "Settings.h"
+#include <array>
+
+namespace Raven
+{
+    //Collects the barriers in front of a command and records them as a single pipeline
+    //barrier, with the stage masks of all of them merged. The barriers are stored inline,
+    //so recording does not allocate. Flushed right before the command that consumes them,
+    //and by the destructor.
+    class BarrierBatch
+    {
+        public:
+            explicit BarrierBatch(VkCommandBuffer cmdBuffer);
+            ~BarrierBatch();
+            BarrierBatch(const BarrierBatch&) = delete;
+            BarrierBatch& operator=(const BarrierBatch&) = delete;
+
+            //A resource that already has a different transition in the batch flushes it first,
+            //since the second transition has to happen after the first.
+            void addBuffer(VkPipelineStageFlags generatingStages, VkPipelineStageFlags consumingStages,
+                           const BufferTransition &transition, VkDeviceSize offset = 0,
+                           VkDeviceSize size = VK_WHOLE_SIZE);
+            void addImage(VkPipelineStageFlags generatingStages, VkPipelineStageFlags consumingStages,
+                          const ImageTransition &transition);
+            //A dependency on all memory, for resources that keep their layout and queue.
+            void addMemory(VkPipelineStageFlags generatingStages, VkPipelineStageFlags consumingStages,
+                           VkAccessFlags currentAccess, VkAccessFlags newAccess);
+
+            //Records the barriers added since the last flush.
+            void flush();
+
+            bool isEmpty() const {return bufferCount == 0 && imageCount == 0 && generatingStages == 0 && consumingStages == 0;}
+            uint32_t getBufferBarrierCount() const {return bufferCount;}
+            uint32_t getImageBarrierCount() const {return imageCount;}
+        private:
+            VkCommandBuffer cmdBuffer;
+            VkPipelineStageFlags generatingStages = 0;
+            VkPipelineStageFlags consumingStages = 0;
+            VkAccessFlags currentAccess = 0;
+            VkAccessFlags newAccess = 0;
+            std::array<VkBufferMemoryBarrier, SETTINGS_BARRIER_BATCH_MAX_BUFFERS> buffers;
+            std::array<VkImageMemoryBarrier, SETTINGS_BARRIER_BATCH_MAX_IMAGES> images;
+            uint32_t bufferCount = 0;
+            uint32_t imageCount = 0;
+    };
+}
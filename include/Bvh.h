@@ -0,0 +1,82 @@
+#pragma once
+#include "FrustumCuller.h"
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+
+namespace Raven
+{
+    //Largest number of primitives in a leaf unless they can not be split.
+    #define BVH_MAX_LEAF_SIZE 4
+    //Centroid bins per axis when searching for the best split.
+    #define BVH_SAH_BIN_COUNT 12
+    //Deepest node the build creates, also the size of the traversal stacks.
+    #define BVH_MAX_DEPTH 64
+    //Refits may make the tree this much more expensive than the build before rebuilding pays off.
+    #define BVH_REBUILD_COST_RATIO 1.5f
+
+    //Axis aligned bounding box.
+    struct BvhBounds
+    {
+        glm::vec3 min;
+        glm::vec3 max;
+    };
+
+    //A node is 32 bytes so that two of them share a 64-byte cache line. The children of an
+    //inner node are stored next to each other, the right one at leftOrFirst + 1.
+    struct alignas(32) BvhNode
+    {
+        float min[3];
+        //Left child of an inner node, first entry in the primitive indices of a leaf.
+        uint32_t leftOrFirst;
+        float max[3];
+        //Number of primitives, 0 for inner nodes.
+        uint32_t count;
+    };
+
+    //Bounding volume hierarchy over boxes, e.g. the world bounds of scene objects. It is
+    //built with the surface area heuristic and refitted when objects move, so moving
+    //objects only cost a rebuild once the tree has become noticeably worse.
+    class Bvh
+    {
+        public:
+            Bvh();
+            ~Bvh();
+
+            //Builds the tree over the boxes. A primitive's id is its index in the vector.
+            void build(const std::vector<BvhBounds> &primitiveBounds);
+            //Changes the box of a primitive. The tree is only updated by refit.
+            void setPrimitiveBounds(uint32_t primitive, const BvhBounds &bounds);
+            //Updates every node to enclose its children again, without changing the structure.
+            void refit();
+            //Returns true if refits have made the tree expensive enough to build it again.
+            bool needsRebuild() const;
+
+            //Collects the primitives whose boxes intersect the frustum.
+            void queryFrustum(const Frustum &frustum, std::vector<uint32_t> &results) const;
+            //Collects the primitives whose boxes overlap the box.
+            void queryOverlap(const BvhBounds &bounds, std::vector<uint32_t> &results) const;
+            //Finds the primitive whose box the ray enters first within maxDistance.
+            bool raycast(const glm::vec3 &origin, const glm::vec3 &direction, float maxDistance,
+                         uint32_t &hitPrimitive, float &hitDistance) const;
+
+            //World space box of a part's model space bounds.
+            static BvhBounds transformBounds(const glm::mat4 &modelMatrix, const MeshBounds &bounds);
+
+            const std::vector<BvhNode> &getNodes() const {return nodes;}
+            size_t getPrimitiveCount() const {return primitiveBounds.size();}
+        private:
+            //Splits a node with the surface area heuristic until its leaves are small enough.
+            void subdivide(uint32_t nodeIndex, uint32_t depth);
+            void updateNodeBounds(uint32_t nodeIndex);
+            //Sum of the node surface areas weighted like the heuristic, lower is better.
+            float computeCost() const;
+
+            std::vector<BvhNode> nodes;
+            std::vector<BvhBounds> primitiveBounds;
+            std::vector<glm::vec3> centroids;
+            //Primitive ids ordered so that every leaf references a contiguous range.
+            std::vector<uint32_t> primitiveIndices;
+            float builtCost = 0.0f;
+    };
+}
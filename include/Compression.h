@@ -0,0 +1,20 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+namespace Raven
+{
+    //Namespace for the block compression codecs used by the asset archive.
+    namespace Compression
+    {
+        //Returns the worst case size of an LZ4 block compressed from sourceSize bytes.
+        size_t lz4CompressBound(size_t sourceSize) noexcept;
+
+        //Compresses the source bytes into a single raw LZ4 block.
+        bool compressLZ4(const char *source, size_t sourceSize, std::vector<char> &destination) noexcept;
+
+        //Decompresses a raw LZ4 block. The destination size must be the exact original size.
+        bool decompressLZ4(const char *source, size_t sourceSize,
+                           char *destination, size_t destinationSize) noexcept;
+    }
+}
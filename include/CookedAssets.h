@@ -0,0 +1,92 @@
+#pragma once
+#include "Mesh.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Raven
+{
+    //Cooked assets are written by the AssetBuilder tool and loaded by the engine
+    //without any parsing or processing. All values are little endian.
+    #define COOKED_MESH_MAGIC "RMSH"
+    #define COOKED_MESH_VERSION 3
+    #define COOKED_MESH_EXTENSION ".rmesh"
+    #define COOKED_TEXTURE_MAGIC "RTEX"
+    #define COOKED_TEXTURE_VERSION 1
+    #define COOKED_TEXTURE_EXTENSION ".rtex"
+    //Written into the output directory by every run of the AssetBuilder.
+    #define COOKED_ASSET_DATABASE_FILENAME "AssetBuilder.db"
+
+    //A single mip level of a texture kept in system memory.
+    struct TextureMipLevel
+    {
+        uint32_t width;
+        uint32_t height;
+        std::vector<unsigned char> pixels;
+    };
+
+    //Vertex attributes that follow the position in a cooked mesh, in this order.
+    enum CookedMeshAttributeBits : uint32_t
+    {
+        COOKED_MESH_ATTRIBUTE_NORMAL_BIT = 0x1,
+        COOKED_MESH_ATTRIBUTE_TEXTURE_COORDINATE_BIT = 0x2,
+        COOKED_MESH_ATTRIBUTE_TANGENT_SPACE_BIT = 0x4
+    };
+
+    //Mesh layout: header | parts | levels of detail | interleaved vertex data | indices |
+    //meshlets | meshlet bounds | meshlet vertices | meshlet triangles.
+    struct CookedMeshHeader
+    {
+        char magic[4];
+        uint32_t version;
+        uint32_t attributes;
+        uint32_t vertexStride;
+        uint32_t vertexCount;
+        uint32_t partCount;
+        uint32_t lodCount;
+        uint32_t indexCount;
+        uint32_t meshletCount;
+        uint32_t meshletVertexCount;
+        uint32_t meshletTriangleIndexCount;
+    };
+
+    //Texture layout: header | for every mip level: width, height and RGBA8 pixels.
+    struct CookedTextureHeader
+    {
+        char magic[4];
+        uint32_t version;
+        uint32_t width;
+        uint32_t height;
+        uint32_t mipLevelCount;
+        uint32_t componentCount;
+    };
+
+    static_assert(sizeof(CookedMeshHeader) == 44, "Cooked mesh header layout changed!");
+    static_assert(sizeof(CookedTextureHeader) == 24, "Cooked texture header layout changed!");
+    static_assert(sizeof(Mesh::Part) == 32, "Mesh part layout changed!");
+    static_assert(sizeof(MeshLod) == 12, "Mesh level of detail layout changed!");
+    static_assert(sizeof(Meshlet) == 16, "Meshlet layout changed!");
+    static_assert(sizeof(MeshletBounds) == 48, "Meshlet bounds layout changed!");
+
+    //Builds a full mip chain from RGBA8 pixels with a box filter.
+    void generateMipChain(const unsigned char *pixels, uint32_t width, uint32_t height,
+                          std::vector<TextureMipLevel> &mipLevels);
+
+    //Namespace for reading and writing cooked asset files.
+    namespace CookedAssets
+    {
+        //Returns true if the filename ends with the given cooked extension.
+        bool hasExtension(const std::string &filename, const char *extension);
+
+        //Writes a mesh whose vertices hold a position and the given attributes.
+        bool writeMesh(const std::string &filename, const Mesh &mesh, uint32_t attributes);
+        //Reads a mesh from the contents of a cooked mesh file.
+        bool readMesh(const std::vector<char> &fileContents, Mesh &mesh,
+                      uint32_t *attributes, uint32_t *vertexStride);
+
+        //Writes a full RGBA8 mip chain.
+        bool writeTexture(const std::string &filename, const std::vector<TextureMipLevel> &mipLevels);
+        //Reads a mip chain from the contents of a cooked texture file.
+        bool readTexture(const std::vector<char> &fileContents, std::vector<TextureMipLevel> &mipLevels);
+    }
+}
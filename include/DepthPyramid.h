@@ -0,0 +1,69 @@
+#pragma once
+#include "Headers.h"
+#include "VulkanImage.h"
+#include <string>
+
+namespace Raven
+{
+    //Threads per workgroup side of the downsample shader, has to match depthpyramid.comp.
+    #define DEPTH_PYRAMID_WORKGROUP_SIZE 8
+    //Format of the pyramid levels.
+    #define DEPTH_PYRAMID_FORMAT VK_FORMAT_R32_SFLOAT
+
+    //Mip chain in which every texel holds the farthest depth of the texels it covers in a
+    //depth image. The first level is half the size of the depth image. Occlusion culling
+    //compares the nearest depth of an object's bounds against it.
+    class DepthPyramid
+    {
+        public:
+            DepthPyramid();
+            ~DepthPyramid();
+
+            //Creates the pyramid for a depth image of the given size and the downsample pipeline.
+            bool initialize(VkDevice logicalDevice,
+                            const VkPhysicalDeviceMemoryProperties &memoryProperties,
+                            uint32_t depthWidth, uint32_t depthHeight,
+                            const std::string &shaderFilename);
+            //Destroys everything. The gpu must not be using the pyramid anymore.
+            void destroy();
+
+            //Selects the depth image the pyramid is built from. It has to be in depthLayout,
+            //which allows sampling, whenever the pyramid is built.
+            void setDepthImage(VkImage depthImage, VkImageView depthImageView, VkImageLayout depthLayout);
+            //Records the downsample chain outside of a render pass, after the depth image
+            //has been rendered.
+            void recordBuild(VkCommandBuffer cmdBuffer);
+
+            //View of every level, sampled with getSampler in VK_IMAGE_LAYOUT_GENERAL.
+            VkImageView getImageView() const {return pyramidImage.imageView;}
+            VkSampler getSampler() const {return sampler;}
+            uint32_t getWidth() const {return width;}
+            uint32_t getHeight() const {return height;}
+            uint32_t getLevelCount() const {return levelCount;}
+
+            //Number of levels down to 1x1 for a first level of the given size.
+            static uint32_t computeLevelCount(uint32_t width, uint32_t height);
+        private:
+            VkDevice logicalDevice = VK_NULL_HANDLE;
+
+            VulkanImage pyramidImage = {};
+            VkDeviceMemory pyramidMemory = VK_NULL_HANDLE;
+            //A view per level, written by one dispatch and read by the next.
+            std::vector<VkImageView> levelViews;
+            VkSampler sampler = VK_NULL_HANDLE;
+
+            VkDescriptorSetLayout descriptorSetLayout = VK_NULL_HANDLE;
+            VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+            //One set per level, reading the level above it or the depth image.
+            std::vector<VkDescriptorSet> levelSets;
+            VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+            VkPipeline pipeline = VK_NULL_HANDLE;
+
+            VkImage depthImage = VK_NULL_HANDLE;
+            VkImageLayout depthLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+            uint32_t width = 0;
+            uint32_t height = 0;
+            uint32_t levelCount = 0;
+    };
+}
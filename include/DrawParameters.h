@@ -0,0 +1,57 @@
+#pragma once
+#include "Headers.h"
+#include "UniformRing.h"
+
+namespace Raven
+{
+    //Per-draw parameters of the diffuse shaders, matches DrawParameters in diffuse.vert and
+    //diffusefallback.vert.
+    struct DrawParameters
+    {
+        //Applied before the instance matrix, e.g. the offset of a part inside its object.
+        glm::mat4 transform;
+        uint32_t objectIndex;
+        uint32_t materialIndex;
+        uint32_t padding[2];
+    };
+
+    //Hands a small block of parameters to every draw. Blocks that fit into the device's
+    //push constants are pushed into the command buffer, which needs no descriptor or buffer
+    //at all. Larger blocks fall back to the uniform ring and are read through a dynamic
+    //uniform buffer descriptor, whose offset the draw passes to bindDescriptorSets.
+    class DrawParameterBinding
+    {
+        public:
+            //Picks push constants when blockSize fits into maxPushConstantsSize, otherwise the
+            //blocks are written into fallbackRing, which has to outlive the binding.
+            bool initialize(const VkPhysicalDeviceLimits &limits, VkShaderStageFlags stages,
+                            uint32_t blockSize, UniformRing *fallbackRing);
+
+            //Ranges for createPipelineLayout, empty when the ring is used.
+            std::vector<VkPushConstantRange> getPushConstantRanges() const;
+            //The dynamic uniform buffer binding of the descriptor set layout, nothing when
+            //push constants are used.
+            std::vector<VkDescriptorSetLayoutBinding> getDescriptorSetLayoutBindings(uint32_t binding) const;
+            //Descriptor updates for the bindings of getDescriptorSetLayoutBindings.
+            std::vector<BufferDescriptorInfo> getDescriptorInfos(VkDescriptorSet descriptorSet, uint32_t binding) const;
+
+            //Hands the block to the next draws of cmdBuffer. With the ring, the block's offset is
+            //appended to dynamicOffsets and the descriptor set has to be bound afterwards.
+            bool record(VkCommandBuffer cmdBuffer, VkPipelineLayout pipelineLayout, const void *block,
+                        std::vector<uint32_t> &dynamicOffsets) const;
+            template<typename T>
+            bool record(VkCommandBuffer cmdBuffer, VkPipelineLayout pipelineLayout, const T &block,
+                        std::vector<uint32_t> &dynamicOffsets) const
+            {
+                return record(cmdBuffer, pipelineLayout, static_cast<const void*>(&block), dynamicOffsets);
+            }
+
+            bool usesPushConstants() const {return pushConstants;}
+            uint32_t getBlockSize() const {return blockSize;}
+        private:
+            UniformRing *fallbackRing = nullptr;
+            VkShaderStageFlags stages = 0;
+            uint32_t blockSize = 0;
+            bool pushConstants = false;
+    };
+}
@@ -0,0 +1,141 @@
+#pragma once
+#include "FrustumCuller.h"
+#include "ThreadPool.h"
+#include <glm/glm.hpp>
+#include <functional>
+#include <memory>
+
+namespace Raven
+{
+    //Handle of an entity. Stays the same while the entity exists.
+    typedef uint32_t Entity;
+    #define ENTITY_INVALID UINT32_MAX
+    //Bytes of component data per chunk.
+    #define ENTITY_CHUNK_SIZE (16 * 1024)
+    //Alignment of every component array in a chunk.
+    #define ENTITY_COMPONENT_ALIGNMENT 16
+    //Chunks a single thread iterates at a time.
+    #define ENTITY_CHUNKS_PER_JOB 4
+    //Value of mesh and material handles that reference nothing.
+    #define ENTITY_INVALID_HANDLE UINT32_MAX
+
+    //Components a renderable entity can have.
+    enum EntityComponentBits : uint32_t
+    {
+        //World matrix, glm::mat4.
+        ENTITY_COMPONENT_TRANSFORM_BIT = 1 << 0,
+        //Mesh handle, uint32_t.
+        ENTITY_COMPONENT_MESH_BIT = 1 << 1,
+        //Material handle, uint32_t.
+        ENTITY_COMPONENT_MATERIAL_BIT = 1 << 2,
+        //Model space bounds, MeshBounds.
+        ENTITY_COMPONENT_BOUNDS_BIT = 1 << 3,
+        //Flags, uint32_t.
+        ENTITY_COMPONENT_FLAGS_BIT = 1 << 4
+    };
+    #define ENTITY_COMPONENT_COUNT 5
+
+    //Flag set by cullEntities for entities outside of the frustum.
+    #define ENTITY_FLAG_CULLED (1u << 0)
+
+    //The component arrays of a chunk. Components the archetype does not have are nullptr.
+    struct EntityChunkView
+    {
+        const Entity *entities;
+        glm::mat4 *transforms;
+        uint32_t *meshes;
+        uint32_t *materials;
+        MeshBounds *bounds;
+        uint32_t *flags;
+        uint32_t count;
+    };
+
+    //Stores renderable entities grouped by archetype, the set of components they have.
+    //Each archetype keeps its entities densely packed in 16 KB chunks holding a structure
+    //of arrays, so systems that run every frame stream through contiguous memory and
+    //chunks can be handed to different threads.
+    class EntityStore
+    {
+        public:
+            EntityStore();
+            ~EntityStore();
+            EntityStore(const EntityStore&) = delete;
+            EntityStore& operator=(const EntityStore&) = delete;
+
+            //Creates an entity with the given components set to their defaults.
+            Entity createEntity(uint32_t componentMask);
+            void destroyEntity(Entity entity);
+            bool isValid(Entity entity) const
+            {
+                return entity < locations.size() && locations[entity].archetype != UINT32_MAX;
+            }
+            //Adds and removes components by moving the entity to another archetype. Components
+            //in both archetypes keep their values.
+            bool setComponentMask(Entity entity, uint32_t componentMask);
+            uint32_t getComponentMask(Entity entity) const {return archetypes[locations[entity].archetype].componentMask;}
+
+            //Components of an entity, nullptr if it does not have them. The pointers are
+            //only valid until entities are created, destroyed or change their components.
+            glm::mat4 *getTransform(Entity entity);
+            uint32_t *getMesh(Entity entity);
+            uint32_t *getMaterial(Entity entity);
+            MeshBounds *getBounds(Entity entity);
+            uint32_t *getFlags(Entity entity);
+
+            //Calls function for every chunk whose archetype has all of the required components.
+            void forEachChunk(uint32_t requiredComponents,
+                              const std::function<void(const EntityChunkView&)> &function);
+            //Like forEachChunk but spreads the chunks over the pool's threads.
+            void parallelForEachChunk(uint32_t requiredComponents, ThreadPool &threadPool,
+                                      const std::function<void(const EntityChunkView&)> &function);
+
+            //Sets or clears ENTITY_FLAG_CULLED of every entity with a transform, bounds and flags.
+            void cullEntities(const Frustum &frustum, ThreadPool *threadPool = nullptr);
+
+            size_t getEntityCount() const {return entityCount;}
+            size_t getArchetypeCount() const {return archetypes.size();}
+            size_t getChunkCount() const;
+            //Entities that fit into a chunk of an archetype with the given components.
+            static uint32_t computeChunkCapacity(uint32_t componentMask);
+        private:
+            struct alignas(64) ChunkData
+            {
+                uint8_t bytes[ENTITY_CHUNK_SIZE];
+            };
+
+            struct Archetype
+            {
+                uint32_t componentMask;
+                uint32_t chunkCapacity;
+                //Byte offset of the entity array and of every component array in a chunk,
+                //UINT32_MAX for components the archetype does not have.
+                uint32_t entityOffset;
+                uint32_t componentOffsets[ENTITY_COMPONENT_COUNT];
+                std::vector<std::unique_ptr<ChunkData>> chunks;
+                //Entities in each chunk. Only the last chunk is not full.
+                std::vector<uint32_t> chunkCounts;
+            };
+
+            struct EntityLocation
+            {
+                uint32_t archetype;
+                uint32_t chunk;
+                uint32_t row;
+            };
+
+            static void computeLayout(Archetype &archetype);
+            uint32_t findOrCreateArchetype(uint32_t componentMask);
+            //Appends a row for the entity and fills its components with defaults.
+            EntityLocation allocateRow(uint32_t archetypeIndex, Entity entity);
+            //Moves the archetype's last row into the given one.
+            void removeRow(const EntityLocation &location);
+            void *getComponent(Entity entity, uint32_t component);
+            EntityChunkView makeView(Archetype &archetype, uint32_t chunk);
+
+            std::vector<Archetype> archetypes;
+            //Location of every entity handle, archetype UINT32_MAX for free handles.
+            std::vector<EntityLocation> locations;
+            std::vector<Entity> freeEntities;
+            size_t entityCount = 0;
+    };
+}
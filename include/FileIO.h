@@ -1,8 +1,11 @@
 #pragma once
 #include <string>
+#include <vector>
 
 namespace Raven
 {
+    class AssetArchive;
+
     //Namespace for reading and writing into files.
     namespace FileIO
     {
@@ -18,5 +21,14 @@ namespace Raven
         //Writes data into a file.
         bool writeBinaryFile(std::string destinationFilename);
 
+        //Makes file reads look into the given pack before the disk. Pass nullptr to unmount.
+        void mountArchive(AssetArchive *archive) noexcept;
+
+        //Converts a file path into the name it has inside an asset pack.
+        std::string getArchiveAssetName(const std::string &filename);
+
+        //Returns the cooked asset directory, or the source resources if nothing has been cooked.
+        std::string getAssetDirectory();
+
     }
 }
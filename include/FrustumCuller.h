@@ -0,0 +1,57 @@
+#pragma once
+#include "Mesh.h"
+#include "ThreadPool.h"
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Raven
+{
+    //Number of spheres a single thread culls at a time. Has to be a multiple of 8.
+    #define FRUSTUM_CULL_CHUNK_SIZE 4096
+
+    //Six planes facing into the frustum, xyz is the unit normal and w the distance.
+    struct Frustum
+    {
+        glm::vec4 planes[6];
+    };
+
+    //Culls bounding spheres against a frustum. The spheres are stored as structure of
+    //arrays so that AVX tests 8 and SSE 4 of them against a plane at once.
+    class FrustumCuller
+    {
+        public:
+            FrustumCuller();
+            ~FrustumCuller();
+
+            //Extracts the planes of a view projection matrix with Vulkan's 0 to 1 depth range.
+            static Frustum extractFrustum(const glm::mat4 &viewProjection);
+            //Moves the bounding sphere of a part into world space.
+            static void transformSphere(const glm::mat4 &modelMatrix, const MeshBounds &bounds,
+                                        glm::vec3 &center, float &radius);
+            //Returns how many pixels one view space unit covers at the given depth in front of the camera.
+            static float calculatePixelsPerUnit(const glm::mat4 &projectionMatrix, float viewportHeight, float depth);
+
+            void clear();
+            //Adds a sphere and returns its index, which is what cull reports.
+            uint32_t addSphere(const glm::vec3 &center, float radius);
+            void setSphere(uint32_t index, const glm::vec3 &center, float radius);
+            size_t getSphereCount() const {return sphereCount;}
+
+            //Writes the indices of all spheres that intersect the frustum into visible, in
+            //increasing order. Runs on the pool's threads if one is given.
+            void cull(const Frustum &frustum, std::vector<uint32_t> &visible,
+                      ThreadPool *threadPool = nullptr);
+        private:
+            //Sphere data padded to a multiple of 8. Padding has a radius of minus infinity
+            //so that it never passes.
+            std::vector<float> centersX;
+            std::vector<float> centersY;
+            std::vector<float> centersZ;
+            std::vector<float> radii;
+            size_t sphereCount = 0;
+            //Visible spheres of every chunk, merged after all chunks are done.
+            std::vector<std::vector<uint32_t>> chunkResults;
+    };
+}
@@ -0,0 +1,147 @@
+#pragma once
+#include "Headers.h"
+#include "VulkanBuffer.h"
+#include "FrustumCuller.h"
+#include "DepthPyramid.h"
+#include <string>
+
+namespace Raven
+{
+    //Threads per workgroup of the culling shader, has to match local_size_x in culling.comp.
+    #define GPU_CULL_WORKGROUP_SIZE 64
+
+    //Culling phases. The frustum phase only tests the frustum. The occlusion phase also
+    //tests a depth pyramid built from the previous frame. The early and late phases cull
+    //in two steps around a pyramid of the current frame: the early one draws what was
+    //visible last frame, the late one draws what has become visible since.
+    #define GPU_CULL_PHASE_FRUSTUM 0
+    #define GPU_CULL_PHASE_OCCLUSION 1
+    #define GPU_CULL_PHASE_EARLY 2
+    #define GPU_CULL_PHASE_LATE 3
+
+    //A draw the culling shader tests, 32 bytes to match DrawData in culling.comp.
+    struct GpuCullDraw
+    {
+        //Model space bounding sphere of the drawn part.
+        float center[3];
+        float radius;
+        uint32_t indexCount;
+        uint32_t firstIndex;
+        int32_t vertexOffset;
+        //Scene node handle. Selects the world matrix and becomes the first instance.
+        uint32_t instanceIndex;
+    };
+
+    //Push constants of the culling shader.
+    struct GpuCullPushConstants
+    {
+        glm::vec4 planes[6];
+        uint32_t drawCount;
+        //Non-zero when visible commands are packed and counted.
+        uint32_t compact;
+        uint32_t phase;
+    };
+
+    //Uniform data of the occlusion culling shader, matches OcclusionData in occlusionculling.comp.
+    struct GpuCullOcclusionData
+    {
+        //The view projection the depth pyramid was rendered with.
+        glm::mat4 viewProjection;
+        float pyramidSize[2];
+        float pyramidLevelCount;
+        float padding;
+    };
+
+    //Culls draws on the gpu with a compute shader that writes indexed indirect draw
+    //commands, so that the cpu records the same few commands no matter how many
+    //objects there are. With VK_KHR_draw_indirect_count the visible commands are packed
+    //and counted, otherwise culled commands draw zero instances.
+    class GpuCuller
+    {
+        public:
+            GpuCuller();
+            ~GpuCuller();
+
+            //Creates the pipeline and buffers for up to maxDraws draws.
+            bool initialize(VkDevice logicalDevice,
+                            const VkPhysicalDeviceMemoryProperties &memoryProperties,
+                            const VkPhysicalDeviceFeatures &enabledFeatures,
+                            bool drawIndirectCountEnabled,
+                            const std::string &shaderFilename,
+                            uint32_t maxDraws);
+            //Destroys everything. The gpu must not be using the culler anymore.
+            void destroy();
+            //Creates the occlusion culling pipeline, which reads the depth pyramid.
+            bool enableOcclusion(const VkPhysicalDeviceMemoryProperties &memoryProperties,
+                                 const DepthPyramid &depthPyramid,
+                                 const std::string &shaderFilename);
+
+            //Points the shader at the buffer holding a world matrix per instance index.
+            void setInstanceBuffer(VkBuffer instanceBuffer);
+            //Replaces the draws that are culled. Must not be called while a frame that
+            //culls them is still executing.
+            bool setDraws(const std::vector<GpuCullDraw> &draws);
+
+            //Records the culling dispatch, outside of a render pass. Occlusion phases test
+            //against the depth pyramid, which was rendered with occlusionViewProjection.
+            void recordCulling(VkCommandBuffer cmdBuffer, const Frustum &frustum,
+                               uint32_t phase = GPU_CULL_PHASE_FRUSTUM,
+                               const glm::mat4 &occlusionViewProjection = glm::mat4(1.0f));
+            //Records the indirect draws inside the render pass. The graphics pipeline,
+            //vertex buffers and index buffer have to be bound already.
+            void recordDraws(VkCommandBuffer cmdBuffer);
+
+            //False if initialize has not succeeded.
+            bool isInitialized() const {return pipeline != VK_NULL_HANDLE;}
+            bool isUsingDrawCount() const {return useDrawCount;}
+            bool isOcclusionEnabled() const {return occlusionPipeline != VK_NULL_HANDLE;}
+            uint32_t getDrawCount() const {return drawCount;}
+            //Draw commands and visible count written by the last culling pass.
+            const VulkanBuffer &getCommandBuffer() const {return commandBuffer;}
+            const VulkanBuffer &getCountBuffer() const {return countBuffer;}
+        private:
+            bool createCullingBuffer(const VkPhysicalDeviceMemoryProperties &memoryProperties,
+                                     VkDeviceSize size, VkBufferUsageFlags usage,
+                                     VkMemoryPropertyFlags memoryFlags,
+                                     VulkanBuffer &buffer, VkDeviceMemory &memory);
+
+            VkDevice logicalDevice = VK_NULL_HANDLE;
+            bool useDrawCount = false;
+            bool useMultiDraw = false;
+
+            VkDescriptorSetLayout descriptorSetLayout = VK_NULL_HANDLE;
+            VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+            VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+            VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+            VkPipeline pipeline = VK_NULL_HANDLE;
+
+            //Host visible and persistently mapped input draws.
+            VulkanBuffer drawBuffer;
+            VkDeviceMemory drawMemory = VK_NULL_HANDLE;
+            //Device local draw commands and visible count written by the shader.
+            VulkanBuffer commandBuffer;
+            VkDeviceMemory commandMemory = VK_NULL_HANDLE;
+            VulkanBuffer countBuffer;
+            VkDeviceMemory countMemory = VK_NULL_HANDLE;
+
+            //Occlusion culling, see enableOcclusion.
+            VkDescriptorSetLayout occlusionSetLayout = VK_NULL_HANDLE;
+            VkDescriptorPool occlusionPool = VK_NULL_HANDLE;
+            VkDescriptorSet occlusionSet = VK_NULL_HANDLE;
+            VkPipelineLayout occlusionPipelineLayout = VK_NULL_HANDLE;
+            VkPipeline occlusionPipeline = VK_NULL_HANDLE;
+            //Written with vkCmdUpdateBuffer so that every culling pass gets its own matrix.
+            VulkanBuffer occlusionDataBuffer;
+            VkDeviceMemory occlusionDataMemory = VK_NULL_HANDLE;
+            //Per draw visibility at the end of the last late phase.
+            VulkanBuffer visibilityBuffer;
+            VkDeviceMemory visibilityMemory = VK_NULL_HANDLE;
+            //False until the visibility buffer has been cleared for the current draws.
+            bool visibilityValid = false;
+            float pyramidSize[2] = {0.0f, 0.0f};
+            uint32_t pyramidLevelCount = 0;
+
+            uint32_t maxDraws = 0;
+            uint32_t drawCount = 0;
+    };
+}
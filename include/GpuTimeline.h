@@ -0,0 +1,74 @@
+#pragma once
+#include "Headers.h"
+#include "SyncObjectPool.h"
+#include "QueueSubmitter.h"
+#include <deque>
+
+namespace Raven
+{
+    //A point on the timeline of a queue. The work submitted to the queue up to the point has
+    //finished once the queue's timeline has reached the value.
+    struct GpuSyncPoint
+    {
+        uint32_t queue = 0;
+        uint64_t value = 0;
+    };
+
+    //A counter per queue that grows by one with every submission. With VK_KHR_timeline_semaphore
+    //the counter is a timeline semaphore, which the cpu can wait on for any value and other
+    //queues can wait on without a round trip through the cpu. Without it every submission
+    //signals a fence from the device's pool, and waits on other queues are done by the cpu.
+    class GpuTimeline
+    {
+        public:
+            GpuTimeline();
+            ~GpuTimeline();
+            GpuTimeline(const GpuTimeline&) = delete;
+            GpuTimeline& operator=(const GpuTimeline&) = delete;
+
+            //The fences of the fallback come from the pool.
+            bool initialize(VkDevice logicalDevice, uint32_t queueCount, bool timelineSemaphores,
+                            SyncObjectPool *syncObjects);
+            //Destroys the semaphores and returns the fences. The gpu must not be using them anymore.
+            void destroy();
+
+            //Submits the command buffers once the waits have been reached, and returns the point
+            //the submission reaches. Waits on the same queue are skipped, the submission order
+            //and the barriers at the start of the command buffers take care of them. Work queued
+            //on the submitter goes out in front of the command buffers.
+            bool submit(uint32_t queue, QueueSubmitter &submitter, const std::vector<VkCommandBuffer> &cmdBuffers,
+                        const std::vector<GpuSyncPoint> &waits, const std::vector<VkPipelineStageFlags> &waitStages,
+                        GpuSyncPoint &signaled);
+
+            bool isComplete(const GpuSyncPoint &point);
+            //Blocks until the point is reached or the timeout in nanoseconds runs out.
+            bool wait(const GpuSyncPoint &point, uint64_t timeout);
+
+            //Latest value the gpu has finished on the queue.
+            uint64_t getCompletedValue(uint32_t queue);
+            uint64_t getSubmittedValue(uint32_t queue) const {return queues[queue].submitted;}
+            bool usesTimelineSemaphores() const {return timelineSemaphores;}
+        private:
+            struct PendingFence
+            {
+                uint64_t value;
+                VkFence fence;
+            };
+
+            struct QueueTimeline
+            {
+                VkSemaphore semaphore;
+                uint64_t submitted;
+                uint64_t completed;
+                //Fences of the fallback in submission order.
+                std::deque<PendingFence> pending;
+            };
+
+            void retireFences(QueueTimeline &timeline);
+
+            VkDevice logicalDevice = VK_NULL_HANDLE;
+            bool timelineSemaphores = false;
+            SyncObjectPool *syncObjects = nullptr;
+            std::vector<QueueTimeline> queues;
+    };
+}
@@ -3,32 +3,24 @@
 #include "VulkanBuffer.h"
 #include "VulkanImage.h"
 #include "VulkanUtility.h"
+#include "TextureStreamer.h"
+#include "Mesh.h"
 
 /** GraphicsObject class is for everything we want
     to draw onto the screen. Graphics objects should be created from
     vertex data, have their own materials, textures, positions etc etc. **/
 namespace Raven
 {
-    struct Mesh
-    {
-        std::vector<float> data;
-        struct Part
-        {
-            uint32_t vertexOffset;
-            uint32_t vertexCount;
-        };
-        std::vector<Part> parts;
-    };
-
     class GraphicsObject
     {
         public:
             GraphicsObject();
             virtual ~GraphicsObject();
             //Loads the model data of a file.
-            bool loadModel(const VkDevice logicalDevice, const std::string filename,
-                           bool loadNormals, bool loadTextureCoordinates, bool generateTangentSpaceVectors,
-                           bool normalize, uint32_t *vertexStride);
+            bool loadModel(const std::string filename, bool loadNormals, bool loadTextureCoordinates,
+                           bool generateTangentSpaceVectors, bool normalize, uint32_t *vertexStride);
+            //Loads a model cooked by the AssetBuilder tool.
+            bool loadCookedModel(const std::string filename, uint32_t *vertexStride);
             //Adds a texture to the object.
             bool addTexture(const VkDevice logicalDevice,
                             VkPhysicalDeviceMemoryProperties memoryProperties,
@@ -37,16 +29,45 @@ namespace Raven
                             VkFormat format,
                             VkSampleCountFlagBits samples,
                             uint32_t mipLevelCount);
+            //Adds a texture whose mip levels are streamed in based on the object's screen size.
+            bool addStreamedTexture(TextureStreamer &textureStreamer,
+                                    const std::string filename,
+                                    VkFormat format);
+            //Requests the streamed texture to be sharp enough for the object's size on the screen.
+            void requestTextureResolution(TextureStreamer &textureStreamer, float screenSpaceSize);
+            //Points a combined image sampler at the streamed texture's current image when the
+            //image has been replaced. The descriptor set must not be in use by the gpu.
+            bool updateStreamedTextureDescriptor(const VkDevice logicalDevice,
+                                                 const TextureStreamer &textureStreamer,
+                                                 VkDescriptorSet descriptorSet, uint32_t binding,
+                                                 VkSampler sampler);
+            //Picks the level of detail of every part from the object's world space bounding sphere.
+            //Scale is the largest scale of the object's transform.
+            void selectLods(const glm::vec3 &center, float radius, float scale,
+                            const glm::mat4 &viewMatrix, const glm::mat4 &projectionMatrix,
+                            float viewportHeight,
+                            float maxScreenSpaceError = SETTINGS_LOD_MAX_SCREEN_SPACE_ERROR);
+
+            //Records a draw of every part, or of the given parts, using the selected levels of
+            //detail when the mesh is indexed. The vertex and index buffers have to be bound.
+            void recordDraws(VkCommandBuffer cmdBuffer, uint32_t instanceCount, uint32_t firstInstance,
+                             const std::vector<uint32_t> *visibleParts = nullptr) const;
 
             Mesh *getMesh(){return &mesh;}
+            const Mesh *getMesh() const {return &mesh;}
+            //Returns the id of the streamed texture or UINT32_MAX if the object has none.
+            uint32_t getStreamedTextureId() const {return streamedTextureId;}
+            //Returns the selected level of detail of a part relative to its lodOffset, 0 being the full part.
+            uint32_t getSelectedLod(size_t partIndex) const
+            {
+                return partIndex < selectedLods.size() ? selectedLods[partIndex] : 0;
+            }
         private:
-            void generateTangentSpaceVectors(Mesh &mesh);
-            void calculateTangentAndBitangent(float const *normalData,
-                                              const glm::vec3 &faceTangent,
-                                              const glm::vec3 &faceBitangent,
-                                              float *tangentData,
-                                              float *bitangentData);
             VulkanImage textureObject;
+            uint32_t streamedTextureId = UINT32_MAX;
+            //Image version of the streamed texture the descriptor was last written with.
+            uint32_t streamedTextureVersion = 0;
             Mesh mesh;
+            std::vector<uint32_t> selectedLods;
     };
 }
@@ -0,0 +1,66 @@
+#pragma once
+#include "Headers.h"
+#include "VulkanBuffer.h"
+#include "GraphicsObject.h"
+#include "Scene.h"
+#include <functional>
+
+namespace Raven
+{
+    //Instances that share a mesh and a material. Their world matrices are contiguous in
+    //the instance buffer so the whole group is a single instanced draw.
+    struct InstanceGroup
+    {
+        const GraphicsObject *drawable;
+        uint32_t materialId;
+        uint32_t firstInstance;
+        uint32_t instanceCount;
+    };
+
+    //Groups the objects of a frame by mesh and material and writes their world matrices
+    //into a per-instance vertex buffer, read with VK_VERTEX_INPUT_RATE_INSTANCE.
+    class InstanceBatcher
+    {
+        public:
+            InstanceBatcher();
+            ~InstanceBatcher();
+            //Creates a host visible instance buffer for capacity instances.
+            bool createInstanceBuffer(VkDevice logicalDevice,
+                                      const VkPhysicalDeviceMemoryProperties &memoryProperties,
+                                      uint32_t capacity);
+            //Destroys the instance buffer. The gpu must not be using it anymore.
+            void destroy();
+
+            //Removes the instances added for the previous frame.
+            void clear();
+            //Adds an instance of a drawable placed at a scene node.
+            void addInstance(const GraphicsObject *drawable, uint32_t materialId, SceneNode node);
+            //Groups the instances and writes their world matrices. Must not be called while
+            //a frame that draws the previous groups is still executing.
+            bool build(const Scene &scene);
+
+            //Records one draw per group and part. The pipeline has to read the instance buffer
+            //at instanceBinding. bindGroup binds a group's vertex and index buffers and material.
+            void recordDraws(VkCommandBuffer cmdBuffer, uint32_t instanceBinding,
+                             const std::function<void(VkCommandBuffer, const InstanceGroup&)> &bindGroup) const;
+
+            const std::vector<InstanceGroup> &getGroups() const {return groups;}
+            const VulkanBuffer &getInstanceBuffer() const {return instanceBuffer;}
+        private:
+            struct Instance
+            {
+                const GraphicsObject *drawable;
+                uint32_t materialId;
+                SceneNode node;
+            };
+            std::vector<Instance> instances;
+            std::vector<InstanceGroup> groups;
+
+            VkDevice logicalDevice = VK_NULL_HANDLE;
+            VulkanBuffer instanceBuffer;
+            VkDeviceMemory instanceMemory = VK_NULL_HANDLE;
+            //Persistently mapped instance buffer memory.
+            glm::mat4 *instanceData = nullptr;
+            uint32_t instanceCapacity = 0;
+    };
+}
@@ -49,6 +49,8 @@ INSTANCE_LEVEL_VULKAN_FUNCTION_FROM_EXTENSION(vkGetPhysicalDeviceSurfaceCapabili
 INSTANCE_LEVEL_VULKAN_FUNCTION_FROM_EXTENSION(vkGetPhysicalDeviceSurfaceFormatsKHR, VK_KHR_SURFACE_EXTENSION_NAME)
 INSTANCE_LEVEL_VULKAN_FUNCTION_FROM_EXTENSION(vkGetPhysicalDeviceSurfacePresentModesKHR, VK_KHR_SURFACE_EXTENSION_NAME)
 INSTANCE_LEVEL_VULKAN_FUNCTION_FROM_EXTENSION(vkDestroySurfaceKHR, VK_KHR_SURFACE_EXTENSION_NAME)
+INSTANCE_LEVEL_VULKAN_FUNCTION_FROM_EXTENSION(vkGetPhysicalDeviceMemoryProperties2KHR, VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME)
+INSTANCE_LEVEL_VULKAN_FUNCTION_FROM_EXTENSION(vkGetPhysicalDeviceFeatures2KHR, VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME)
 
 //What platform are we using?
 #ifdef VK_USE_PLATFORM_WIN32_KHR
@@ -130,13 +132,20 @@ DEVICE_LEVEL_VULKAN_FUNCTION(vkCreateComputePipelines)
 DEVICE_LEVEL_VULKAN_FUNCTION(vkDestroyPipeline)
 DEVICE_LEVEL_VULKAN_FUNCTION(vkGetPipelineCacheData)
 DEVICE_LEVEL_VULKAN_FUNCTION(vkMergePipelineCaches)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkCreateQueryPool)
 DEVICE_LEVEL_VULKAN_FUNCTION(vkDestroyQueryPool)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkGetQueryPoolResults)
 
 //Command buffer commands.
 DEVICE_LEVEL_VULKAN_FUNCTION(vkCmdPipelineBarrier)
 DEVICE_LEVEL_VULKAN_FUNCTION(vkCmdCopyBufferToImage)
 DEVICE_LEVEL_VULKAN_FUNCTION(vkCmdCopyImageToBuffer)
 DEVICE_LEVEL_VULKAN_FUNCTION(vkCmdCopyBuffer)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkCmdFillBuffer)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkCmdUpdateBuffer)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkCmdResetQueryPool)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkCmdBeginQuery)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkCmdEndQuery)
 DEVICE_LEVEL_VULKAN_FUNCTION(vkCmdBeginRenderPass)
 DEVICE_LEVEL_VULKAN_FUNCTION(vkCmdEndRenderPass)
 DEVICE_LEVEL_VULKAN_FUNCTION(vkCmdNextSubpass)
@@ -154,6 +163,7 @@ DEVICE_LEVEL_VULKAN_FUNCTION(vkCmdSetDepthBias)
 DEVICE_LEVEL_VULKAN_FUNCTION(vkCmdSetBlendConstants)
 DEVICE_LEVEL_VULKAN_FUNCTION(vkCmdDraw)
 DEVICE_LEVEL_VULKAN_FUNCTION(vkCmdDrawIndexed)
+DEVICE_LEVEL_VULKAN_FUNCTION(vkCmdDrawIndexedIndirect)
 DEVICE_LEVEL_VULKAN_FUNCTION(vkCmdDispatch)
 DEVICE_LEVEL_VULKAN_FUNCTION(vkCmdExecuteCommands)
 DEVICE_LEVEL_VULKAN_FUNCTION(vkCmdBindPipeline)
@@ -170,5 +180,8 @@ DEVICE_LEVEL_VULKAN_FUNCTION_FROM_EXTENSION(vkGetSwapchainImagesKHR, VK_KHR_SWAP
 DEVICE_LEVEL_VULKAN_FUNCTION_FROM_EXTENSION(vkAcquireNextImageKHR, VK_KHR_SWAPCHAIN_EXTENSION_NAME)
 DEVICE_LEVEL_VULKAN_FUNCTION_FROM_EXTENSION(vkQueuePresentKHR, VK_KHR_SWAPCHAIN_EXTENSION_NAME)
 DEVICE_LEVEL_VULKAN_FUNCTION_FROM_EXTENSION(vkDestroySwapchainKHR, VK_KHR_SWAPCHAIN_EXTENSION_NAME)
+DEVICE_LEVEL_VULKAN_FUNCTION_FROM_EXTENSION(vkCmdDrawIndexedIndirectCountKHR, VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME)
+DEVICE_LEVEL_VULKAN_FUNCTION_FROM_EXTENSION(vkGetSemaphoreCounterValueKHR, VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME)
+DEVICE_LEVEL_VULKAN_FUNCTION_FROM_EXTENSION(vkWaitSemaphoresKHR, VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME)
 
 #undef DEVICE_LEVEL_VULKAN_FUNCTION_FROM_EXTENSION
@@ -0,0 +1,85 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+namespace Raven
+{
+    //Meshlet size limits. 64 vertices and 124 triangles keep a meshlet's local
+    //indices in a byte and its data inside the shared memory of a single workgroup.
+    #define MESHLET_MAX_VERTICES 64
+    #define MESHLET_MAX_TRIANGLES 124
+
+    //A small cluster of triangles that is culled as a unit.
+    struct Meshlet
+    {
+        //First entry in Mesh::meshletVertices.
+        uint32_t vertexOffset;
+        //First entry in Mesh::meshletTriangles, three entries per triangle.
+        uint32_t triangleOffset;
+        uint32_t vertexCount;
+        uint32_t triangleCount;
+    };
+
+    //Culling data of a meshlet in model space. Laid out to be copied into a storage buffer as is.
+    struct MeshletBounds
+    {
+        float center[3];
+        float radius;
+        //The meshlet is back-facing when dot(normalize(coneApex - camera), coneAxis) >= coneCutoff.
+        float coneApex[3];
+        float coneCutoff;
+        float coneAxis[3];
+        float padding;
+    };
+
+    //A simplified version of a part, a range of Mesh::indices.
+    struct MeshLod
+    {
+        uint32_t indexOffset;
+        uint32_t indexCount;
+        //Largest distance between the simplified and the full surface in model space.
+        float error;
+    };
+
+    //Axis aligned box and bounding sphere of a part in model space.
+    struct MeshBounds
+    {
+        float min[3];
+        float max[3];
+        float center[3];
+        float radius;
+    };
+
+    //Interleaved vertex data of a model, split into parts that are drawn separately.
+    struct Mesh
+    {
+        std::vector<float> data;
+        //Vertex indices, empty if the mesh is drawn without an index buffer.
+        std::vector<uint32_t> indices;
+        struct Part
+        {
+            uint32_t vertexOffset;
+            uint32_t vertexCount;
+            uint32_t indexOffset = 0;
+            uint32_t indexCount = 0;
+            uint32_t meshletOffset = 0;
+            uint32_t meshletCount = 0;
+            //Levels of detail in Mesh::lods, finest first. The first one is the part itself.
+            uint32_t lodOffset = 0;
+            uint32_t lodCount = 0;
+        };
+        std::vector<Part> parts;
+        //Bounds of every part, see MeshLoader::computeBounds.
+        std::vector<MeshBounds> partBounds;
+        //Levels of detail of all parts, see MeshSimplifier.
+        std::vector<MeshLod> lods;
+
+        //Meshlets of all parts, see MeshletBuilder.
+        std::vector<Meshlet> meshlets;
+        std::vector<MeshletBounds> meshletBounds;
+        //Mesh vertex indices referenced by the meshlets.
+        std::vector<uint32_t> meshletVertices;
+        //Meshlet local vertex indices, three per triangle.
+        std::vector<uint8_t> meshletTriangles;
+    };
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include "Mesh.h"
+#include <string>
+
+namespace Raven
+{
+    //Namespace for building meshes from model files. Does not depend on vulkan
+    //so the asset tools can use the same code as the engine.
+    namespace MeshLoader
+    {
+        //Loads an .obj-file into an interleaved mesh.
+        bool loadObj(const std::string &filename, bool loadNormals, bool loadTextureCoordinates,
+                     bool generateTangentSpaceVectors, bool normalize,
+                     Mesh &mesh, uint32_t *vertexStride);
+
+        //Merges identical vertices of every part and fills the index buffer.
+        void generateIndices(Mesh &mesh, uint32_t vertexStride);
+
+        //Computes the bounding box and sphere of every part.
+        void computeBounds(Mesh &mesh, uint32_t vertexStride);
+
+        //Fills the tangent and bitangent of every vertex. Requires the full 14 float layout.
+        void generateTangentSpaceVectors(Mesh &mesh);
+    }
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include "Mesh.h"
+#include <cstddef>
+#include <vector>
+
+namespace Raven
+{
+    //Namespace for building levels of detail of indexed meshes with quadric error
+    //metric edge collapses and for picking a level at runtime.
+    namespace MeshSimplifier
+    {
+        //Simplifies a triangle list until it has at most targetIndexCount indices or the
+        //next collapse would move the surface further than maxError. Only the indices change.
+        bool simplify(const Mesh &mesh, uint32_t vertexStride,
+                      const uint32_t *indices, size_t indexCount,
+                      size_t targetIndexCount, float maxError,
+                      std::vector<uint32_t> &result, float &resultError);
+
+        //Gives every part up to lodCount levels of detail, the first being the part itself
+        //and each following one with about reduction times the triangles of the previous one.
+        bool generateLods(Mesh &mesh, uint32_t vertexStride, uint32_t lodCount,
+                          float reduction, float maxError);
+
+        //Returns the coarsest level of the part whose error covers at most maxScreenSpaceError
+        //pixels when a model space unit covers pixelsPerUnit pixels.
+        uint32_t selectLod(const Mesh &mesh, const Mesh::Part &part,
+                           float pixelsPerUnit, float maxScreenSpaceError);
+    }
+}
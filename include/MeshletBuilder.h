@@ -0,0 +1,21 @@
+#pragma once
+#include "Mesh.h"
+#include <glm/glm.hpp>
+
+namespace Raven
+{
+    //Namespace for splitting indexed meshes into meshlets and culling them.
+    namespace MeshletBuilder
+    {
+        //Splits every indexed part of the mesh into meshlets and computes their bounds.
+        bool buildMeshlets(Mesh &mesh, uint32_t vertexStride);
+
+        //Computes the bounding sphere and normal cone of a single meshlet.
+        MeshletBounds computeMeshletBounds(const Mesh &mesh, const Meshlet &meshlet, uint32_t vertexStride);
+
+        //Returns true if the meshlet faces away from the camera or lies outside the frustum.
+        //The camera position and the inward facing planes are given in model space.
+        bool isMeshletCulled(const MeshletBounds &bounds, const glm::vec3 &cameraPosition,
+                             const glm::vec4 *frustumPlanes, uint32_t frustumPlaneCount);
+    }
+}
@@ -0,0 +1,142 @@
+#pragma once
+#include "Headers.h"
+#include "VulkanDevice.h"
+#include "RenderGraph.h"
+#include <array>
+#include <string>
+
+namespace Raven
+{
+    //Threads per workgroup side of the post processing shaders, has to match the shaders
+    //in Shaders/postprocess.
+    #define POST_PROCESS_WORKGROUP_SIZE 8
+    //Format of the scene color and the bloom chain.
+    #define POST_PROCESS_HDR_FORMAT VK_FORMAT_R16G16B16A16_SFLOAT
+    //Format of the tonemapped image and the output.
+    #define POST_PROCESS_LDR_FORMAT VK_FORMAT_R8G8B8A8_UNORM
+
+    //Push constants of the post processing shaders, matches PushConstants in them.
+    struct PostProcessPushConstants
+    {
+        glm::vec2 sourceTexelSize;
+        float exposure;
+        //Scene color brighter than this feeds the bloom.
+        float bloomThreshold;
+        float bloomIntensity;
+        //Non-zero for the first downsample, which applies the threshold.
+        uint32_t prefilter;
+    };
+
+    //Compute post processing of the rendered scene: a bloom downsample and upsample chain,
+    //tonemapping and FXAA, each a dispatch writing a storage image. The chain runs on the
+    //async compute queue, so while it processes frame N the graphics queue already renders
+    //frame N + 1 into the next scene color image:
+    //  graphics: render into getSceneColor(N), recordSceneRelease, submit -> point G
+    //  compute:  recordChain(N), submit waiting for G -> point C
+    //  graphics: recordOutputAcquire(N) in a later frame, submitted waiting for C.
+    //Scene color and output images are rotated over SETTINGS_POST_PROCESS_FRAME_COUNT
+    //frames. The bloom levels and the tonemapped image are transient images of a render
+    //graph, which places images whose passes do not overlap in the same memory.
+    class PostProcessChain
+    {
+        public:
+            PostProcessChain();
+            ~PostProcessChain();
+
+            //Creates the images for a scene of the given size and the pipelines of every pass.
+            bool initialize(VulkanDevice *device, uint32_t sceneWidth, uint32_t sceneHeight,
+                            const std::string &shaderDirectory);
+            //Destroys everything. The gpu must not be using the chain anymore.
+            void destroy();
+
+            void setExposure(float exposure) {this->exposure = exposure;}
+            void setBloom(float threshold, float intensity) {bloomThreshold = threshold; bloomIntensity = intensity;}
+
+            //Records on the graphics queue after the geometry pass has rendered the frame's
+            //scene color and left it in VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL.
+            void recordSceneRelease(VkCommandBuffer cmdBuffer, uint64_t frame);
+            //Records every pass of the frame on the compute queue, outside of a render pass.
+            //Fails if the passes could not be compiled into a render graph.
+            bool recordChain(VkCommandBuffer cmdBuffer, uint64_t frame);
+            //Records on the graphics queue before the frame's output is read with consumingStages.
+            //The output is in VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL afterwards.
+            void recordOutputAcquire(VkCommandBuffer cmdBuffer, uint64_t frame,
+                                     VkPipelineStageFlags consumingStages, VkAccessFlags newAccess);
+            //Submits a command buffer with recordChain to the compute queue behind the
+            //graphics point the frame's scene color was finished at.
+            bool submit(VkCommandBuffer cmdBuffer, const GpuSyncPoint &sceneRendered, GpuSyncPoint &processed);
+
+            //Color attachment the geometry pass of the frame renders into.
+            const VulkanImage &getSceneColor(uint64_t frame) const {return frames[frame % SETTINGS_POST_PROCESS_FRAME_COUNT].sceneColor;}
+            //Tonemapped and antialiased result of the frame, sampled with getSampler.
+            const VulkanImage &getOutput(uint64_t frame) const {return frames[frame % SETTINGS_POST_PROCESS_FRAME_COUNT].output;}
+            VkSampler getSampler() const {return sampler;}
+            uint32_t getWidth() const {return width;}
+            uint32_t getHeight() const {return height;}
+            uint32_t getBloomLevelCount() const {return bloomLevelCount;}
+
+            //Number of bloom levels for a scene of the given size. The first level is half
+            //the size of the scene, further levels are added while they keep at least 2
+            //texels on either side.
+            static uint32_t computeBloomLevelCount(uint32_t width, uint32_t height, uint32_t maxLevels);
+        private:
+            //Images and descriptor sets of a frame in flight.
+            struct FrameResources
+            {
+                VulkanImage sceneColor = {};
+                VkDeviceMemory sceneColorMemory = VK_NULL_HANDLE;
+                VulkanImage output = {};
+                VkDeviceMemory outputMemory = VK_NULL_HANDLE;
+                //Scene color to the first bloom level.
+                VkDescriptorSet downsampleSet = VK_NULL_HANDLE;
+                VkDescriptorSet tonemapSet = VK_NULL_HANDLE;
+                VkDescriptorSet fxaaSet = VK_NULL_HANDLE;
+            };
+
+            bool createPipelines(const std::string &shaderDirectory);
+            //Points the descriptor sets at the views of the bloom levels followed by the tonemapped image.
+            void writeDescriptorSets(const std::vector<VkImageView> &transientViews);
+            void recordPass(VkCommandBuffer cmdBuffer, VkPipeline pipeline, VkPipelineLayout layout,
+                            VkDescriptorSet descriptorSet, uint32_t sourceWidth, uint32_t sourceHeight,
+                            uint32_t destinationWidth, uint32_t destinationHeight, uint32_t prefilter);
+
+            VulkanDevice *device = nullptr;
+            VkDevice logicalDevice = VK_NULL_HANDLE;
+
+            std::array<FrameResources, SETTINGS_POST_PROCESS_FRAME_COUNT> frames;
+            //Owns the bloom levels, each written by one dispatch and read by the next, and the
+            //tonemapped scene read by FXAA.
+            RenderGraph renderGraph;
+            //Transient views the descriptor sets were written with. They only change when the
+            //graph allocates new transient images.
+            std::vector<VkImageView> boundViews;
+            VkSampler sampler = VK_NULL_HANDLE;
+
+            //Downsample, upsample and FXAA read one image and write another.
+            VkDescriptorSetLayout passSetLayout = VK_NULL_HANDLE;
+            //Tonemapping reads the scene color and the bloom.
+            VkDescriptorSetLayout tonemapSetLayout = VK_NULL_HANDLE;
+            VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+            //Level i - 1 to level i, from the second level on.
+            std::vector<VkDescriptorSet> downsampleSets;
+            //Level i + 1 added onto level i.
+            std::vector<VkDescriptorSet> upsampleSets;
+            VkPipelineLayout passPipelineLayout = VK_NULL_HANDLE;
+            VkPipelineLayout tonemapPipelineLayout = VK_NULL_HANDLE;
+            VkPipeline downsamplePipeline = VK_NULL_HANDLE;
+            VkPipeline upsamplePipeline = VK_NULL_HANDLE;
+            VkPipeline tonemapPipeline = VK_NULL_HANDLE;
+            VkPipeline fxaaPipeline = VK_NULL_HANDLE;
+
+            //Stages the graphics queue last read an output with. Only waited for by the chain
+            //when compute shares the graphics queue.
+            VkPipelineStageFlags outputConsumingStages = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+
+            float exposure = 1.0f;
+            float bloomThreshold = 1.0f;
+            float bloomIntensity = 0.05f;
+            uint32_t width = 0;
+            uint32_t height = 0;
+            uint32_t bloomLevelCount = 0;
+    };
+}
@@ -0,0 +1,93 @@
+#pragma once
+#include "Headers.h"
+
+namespace Raven
+{
+    //Returned when a frame has no queries left.
+    #define QUERY_POOL_INVALID_QUERY UINT32_MAX
+
+    //Counters of a pipeline statistics query.
+    struct PipelineStatistics
+    {
+        uint64_t inputAssemblyVertices = 0;
+        uint64_t inputAssemblyPrimitives = 0;
+        uint64_t vertexShaderInvocations = 0;
+        uint64_t clippingInvocations = 0;
+        uint64_t clippingPrimitives = 0;
+        uint64_t fragmentShaderInvocations = 0;
+        uint64_t computeShaderInvocations = 0;
+    };
+
+    //Hands out occlusion and pipeline statistics queries from a ring of per-frame query
+    //pools. A frame's results are read without waiting when its pools come around again,
+    //and the occlusion results are kept as a visibility history per object.
+    class QueryPoolManager
+    {
+        public:
+            QueryPoolManager();
+            ~QueryPoolManager();
+
+            //Creates frameCount sets of pools. Statistics queries need the pipelineStatisticsQuery feature.
+            bool initialize(VkDevice logicalDevice, const VkPhysicalDeviceFeatures &enabledFeatures,
+                            uint32_t frameCount, uint32_t maxOcclusionQueries, uint32_t maxStatisticsQueries);
+            //Destroys the pools. The gpu must not be using them anymore.
+            void destroy();
+
+            //Reads the results of the frame that last used the next pools and resets them.
+            //Recorded outside of a render pass before any query of the frame.
+            void beginFrame(VkCommandBuffer cmdBuffer);
+
+            //Starts counting the samples an object's draws pass. Precise counts are only
+            //needed for more than visibility and require occlusionQueryPrecise.
+            uint32_t beginOcclusionQuery(VkCommandBuffer cmdBuffer, uint32_t objectId, bool precise = false);
+            void endOcclusionQuery(VkCommandBuffer cmdBuffer, uint32_t query);
+            //Starts counting the work of the commands until the end of the query.
+            uint32_t beginStatisticsQuery(VkCommandBuffer cmdBuffer);
+            void endStatisticsQuery(VkCommandBuffer cmdBuffer, uint32_t query);
+
+            //Adds a frame's visibility of an object to its history.
+            void recordVisibility(uint32_t objectId, bool visible);
+            //True if any sample passed in the latest result, or if there is none yet.
+            bool wasVisible(uint32_t objectId) const;
+            //A bit per resolved frame, the latest in bit 0. Unknown objects count as visible.
+            uint32_t getVisibilityHistory(uint32_t objectId) const;
+
+            bool isStatisticsSupported() const {return statisticsSupported;}
+            //Statistics of the latest frame whose results have been read.
+            const std::vector<PipelineStatistics> &getStatistics() const {return statistics;}
+            //Results that were not ready when read and counted as visible.
+            uint64_t getUnavailableResultCount() const {return unavailableResults;}
+        private:
+            //Queries of one frame in the ring.
+            struct FrameQueries
+            {
+                VkQueryPool occlusionPool = VK_NULL_HANDLE;
+                VkQueryPool statisticsPool = VK_NULL_HANDLE;
+                //The object of every occlusion query.
+                std::vector<uint32_t> occlusionObjects;
+                uint32_t statisticsCount = 0;
+                //True once the frame has recorded queries that have not been read.
+                bool pending = false;
+            };
+
+            bool createQueryPool(VkQueryType type, uint32_t queryCount, VkQueryPipelineStatisticFlags statisticFlags,
+                                 VkQueryPool &queryPool);
+            //Reads the available results of a frame without waiting for the rest.
+            void readResults(FrameQueries &frame);
+
+            VkDevice logicalDevice = VK_NULL_HANDLE;
+            std::vector<FrameQueries> frames;
+            //Ring position of the frame being recorded, frames.size() before the first frame.
+            uint32_t currentFrame = 0;
+            uint32_t maxOcclusionQueries = 0;
+            uint32_t maxStatisticsQueries = 0;
+            bool statisticsSupported = false;
+            bool preciseSupported = false;
+
+            std::vector<uint32_t> visibilityHistory;
+            //False for objects without a resolved query.
+            std::vector<bool> visibilityKnown;
+            std::vector<PipelineStatistics> statistics;
+            uint64_t unavailableResults = 0;
+    };
+}
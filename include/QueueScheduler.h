@@ -0,0 +1,84 @@
+#pragma once
+#include "GpuTimeline.h"
+#include "QueueSubmitter.h"
+#include "BarrierBatch.h"
+#include <array>
+
+namespace Raven
+{
+    //The kinds of work routed to their own queues.
+    enum QueueType
+    {
+        QUEUE_TYPE_GRAPHICS,
+        //Compute that can overlap graphics work, such as culling and post processing.
+        QUEUE_TYPE_COMPUTE,
+        //Copies, on a dedicated transfer engine when there is one.
+        QUEUE_TYPE_TRANSFER
+    };
+    #define QUEUE_TYPE_COUNT 3
+
+    //The queue a type of work runs on.
+    struct QueueRoute
+    {
+        //Index of the queue in the device's queue handles, submitters and timeline.
+        uint32_t queue;
+        uint32_t family;
+        QueueSubmitter *submitter;
+    };
+
+    //Routes work to the graphics, async compute and transfer queues and synchronizes them
+    //through the device's timeline. Resources with exclusive sharing that move between
+    //queue families need an ownership transfer: a release barrier recorded on the queue
+    //that used the resource last and a matching acquire barrier on the queue that uses it
+    //next, with the submission of the acquire waiting for the one of the release. Types that
+    //share a family skip the transfer and only a plain barrier remains.
+    class QueueScheduler
+    {
+        public:
+            //Graphics goes to a family with graphics and compute, compute to a family with
+            //compute but no graphics, and transfer to a family with transfers only. A type
+            //without a family of its own shares the one of the type before it.
+            static bool selectQueueFamilies(const std::vector<VkQueueFamilyProperties> &families,
+                                            std::array<uint32_t, QUEUE_TYPE_COUNT> &familyIndices);
+
+            void initialize(GpuTimeline *timeline, const std::array<QueueRoute, QUEUE_TYPE_COUNT> &routes);
+
+            //Submits to the queue of the type once the waits have been reached.
+            bool submit(QueueType type, const std::vector<VkCommandBuffer> &cmdBuffers,
+                        const std::vector<GpuSyncPoint> &waits, const std::vector<VkPipelineStageFlags> &waitStages,
+                        GpuSyncPoint &signaled);
+
+            const QueueRoute &getRoute(QueueType type) const {return routes[type];}
+            uint32_t getQueueFamilyIndex(QueueType type) const {return routes[type].family;}
+            QueueSubmitter &getSubmitter(QueueType type) const {return *routes[type].submitter;}
+            //True if the type runs on a different queue than graphics and can overlap it.
+            bool isAsync(QueueType type) const {return routes[type].queue != routes[QUEUE_TYPE_GRAPHICS].queue;}
+            bool needsOwnershipTransfer(QueueType from, QueueType to) const
+            {
+                return routes[from].family != routes[to].family;
+            }
+
+            //Release barriers, recorded on the queue of from after the last use. Image layouts
+            //change here and have to match in the acquire.
+            void releaseBuffer(BarrierBatch &barriers, QueueType from, QueueType to,
+                               VkPipelineStageFlags generatingStages, VkBuffer buffer,
+                               VkAccessFlags currentAccess) const;
+            void releaseImage(BarrierBatch &barriers, QueueType from, QueueType to,
+                              VkPipelineStageFlags generatingStages, VkImage image, VkImageAspectFlags aspect,
+                              VkAccessFlags currentAccess, VkImageLayout currentLayout,
+                              VkImageLayout newLayout) const;
+            //Acquire barriers, recorded on the queue of to before the first use. The submission
+            //has to wait for the release with consumingStages. The stages and access of the
+            //last use are only needed within a family, where no release was recorded.
+            void acquireBuffer(BarrierBatch &barriers, QueueType from, QueueType to,
+                               VkPipelineStageFlags generatingStages, VkPipelineStageFlags consumingStages,
+                               VkBuffer buffer, VkAccessFlags currentAccess, VkAccessFlags newAccess) const;
+            void acquireImage(BarrierBatch &barriers, QueueType from, QueueType to,
+                              VkPipelineStageFlags generatingStages, VkPipelineStageFlags consumingStages,
+                              VkImage image, VkImageAspectFlags aspect, VkAccessFlags currentAccess,
+                              VkAccessFlags newAccess, VkImageLayout currentLayout, VkImageLayout newLayout) const;
+        private:
+            GpuTimeline *timeline = nullptr;
+            std::array<QueueRoute, QUEUE_TYPE_COUNT> routes = {};
+    };
+}
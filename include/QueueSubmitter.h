@@ -0,0 +1,55 @@
+#pragma once
+#include "Headers.h"
+#include "CommandBufferManager.h"
+#include <mutex>
+
+namespace Raven
+{
+    //Gathers the work several producers submit to a queue during a frame and hands it to the
+    //driver with a single vkQueueSubmit. Queued submissions keep their order and go out at the
+    //next flush or direct submit, whichever comes first. All access to the queue goes through
+    //one lock, so producers on different threads do not race on it.
+    class QueueSubmitter
+    {
+        public:
+            QueueSubmitter();
+            ~QueueSubmitter();
+            QueueSubmitter(const QueueSubmitter&) = delete;
+            QueueSubmitter& operator=(const QueueSubmitter&) = delete;
+
+            void initialize(VkQueue queue);
+
+            //Queues command buffers with the semaphores they wait on and signal. Thread safe.
+            void enqueue(const std::vector<VkCommandBuffer> &cmdBuffers,
+                         const std::vector<WaitSemaphoreInfo> &waits,
+                         const std::vector<VkSemaphore> &signals);
+            //Submits everything queued. The fence is signaled once all of it has finished,
+            //without queued work only a fence is submitted.
+            bool flush(VkFence fence = VK_NULL_HANDLE);
+            //Submits the queued work and the submit info in one call, the submit info last.
+            //Its pNext chain is passed on as is.
+            bool submit(const VkSubmitInfo &submitInfo, VkFence fence);
+
+            VkQueue getQueue() const {return queue;}
+            size_t getPendingSubmitCount();
+        private:
+            struct PendingSubmit
+            {
+                std::vector<VkCommandBuffer> cmdBuffers;
+                std::vector<VkSemaphore> waitSemaphores;
+                std::vector<VkPipelineStageFlags> waitStages;
+                std::vector<VkSemaphore> signalSemaphores;
+            };
+
+            //Calls vkQueueSubmit with the queued work and an optional extra submit info. The
+            //lock must be held.
+            bool submitPending(const VkSubmitInfo *submitInfo, VkFence fence);
+
+            VkQueue queue = VK_NULL_HANDLE;
+            std::mutex mutex;
+            //Entries past pendingCount keep their vectors so that their memory is reused.
+            std::vector<PendingSubmit> pending;
+            size_t pendingCount = 0;
+            std::vector<VkSubmitInfo> submitInfos;
+    };
+}
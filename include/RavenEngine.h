@@ -5,11 +5,29 @@
 #include "CommandBufferManager.h"
 #include "VulkanRenderer.h"
 #include "VulkanPipeline.h"
+#include "AssetArchive.h"
+#include "TextureStreamer.h"
+#include "Scene.h"
+#include "ThreadPool.h"
+#include "GpuCuller.h"
+#include "QueryPoolManager.h"
+#include "InstanceBatcher.h"
+#include "ResourceRegistry.h"
+#include "PostProcessChain.h"
+#include "UniformRing.h"
+#include "DrawParameters.h"
 
 //The main class for Raven. RavenEngine should only give
 //instructions to other classes, not deal with the logic itself.
 namespace Raven
 {
+    //Matches uniformBuffer in diffuse.vert, written into the uniform ring for every draw.
+    struct DiffuseUniforms
+    {
+        glm::mat4 modelViewMatrix;
+        glm::mat4 projectionMatrix;
+    };
+
     class RavenEngine
     {
         public:
@@ -38,9 +56,10 @@ namespace Raven
                                VkSwapchainKHR &oldSwapchain,
                                VulkanWindow *window);
 
-            //Creates the vertex buffers.
+            //Creates the vertex buffers, and the index buffer of indexed meshes.
             bool buildVertexDataForShaders(GraphicsObject &graphicsObject, VulkanBuffer &vertexBuffer,
-                                      VkDeviceMemory &vertexMemory, VkCommandBuffer &cmdBuffer);
+                                      VkDeviceMemory &vertexMemory, VulkanBuffer &indexBuffer,
+                                      VkDeviceMemory &indexMemory, VkCommandBuffer &cmdBuffer);
 
             //Allocates the application command pools, buffers and records the actions.
             bool buildCommandBuffersForDrawingGeometry();
@@ -48,7 +67,8 @@ namespace Raven
             //Describes the data that is sent to the shaders.
             bool buildDescriptors(VkDescriptorSetLayout &descriptorSetLayout,
                                   VkDescriptorPool &descriptorPool,
-                                  VkBuffer &uniformBuffer,
+                                  const UniformRing &uniforms,
+                                  const DrawParameterBinding &drawParameters,
                                   std::vector<VkDescriptorSet> &descriptorSets);
 
             //Builds the renderpass(es).
@@ -57,6 +77,7 @@ namespace Raven
 
             bool buildGraphicsPipeline(VulkanPipeline &basicGraphicsPipeline,
                                        VkDescriptorSetLayout &descriptorSetLayout,
+                                       const DrawParameterBinding &drawParameters,
                                        VkRenderPass &renderPass,
                                        VkPipeline& graphicsPipeline);
 
@@ -71,6 +92,8 @@ namespace Raven
             //Vulkan variables, the ones starting with "selected"
             //are the ones that the software will be using to complete tasks.
             VkInstance selectedInstance;
+            //Required instance extensions plus the optional ones that are supported.
+            std::vector<const char*> enabledInstanceExtensions;
             std::vector<VkPhysicalDevice> physicalDevices;
             VkPhysicalDevice selectedPhysicalDevice;
 
@@ -93,5 +116,35 @@ namespace Raven
             //A renderer for RavenEngine.
             VulkanRenderer* vulkanRenderer = nullptr;
 
+            //Packed assets, mounted into FileIO when the pack exists.
+            AssetArchive assetArchive;
+            //Cooked assets, or the source resources if nothing has been cooked.
+            std::string assetDirectory;
+
+            //Streams texture mips under the device memory budget.
+            TextureStreamer textureStreamer;
+
+            //Worker threads for per-frame jobs.
+            ThreadPool threadPool;
+            //Transform hierarchy of everything that is drawn.
+            Scene scene;
+            //Groups identical objects into instanced draws.
+            InstanceBatcher instanceBatcher;
+            //Culls draws and writes their indirect commands on the gpu.
+            GpuCuller gpuCuller;
+            //Farthest depth mip chain the occlusion culling tests against.
+            DepthPyramid depthPyramid;
+            //Per-draw uniform blocks, bound once as a dynamic uniform buffer.
+            UniformRing uniformRing;
+            //Pushes the per-draw parameters, or writes them into the uniform ring when they do
+            //not fit into the device's push constants.
+            DrawParameterBinding drawParameterBinding;
+            //Bloom, tonemapping and FXAA on the async compute queue.
+            PostProcessChain postProcessChain;
+            //Hardware occlusion and pipeline statistics queries.
+            QueryPoolManager queryPoolManager;
+            //Buffers, textures, meshes and pipelines referred to by handles.
+            ResourceRegistry resourceRegistry;
+
     };
 }
@@ -0,0 +1,284 @@
+#pragma once
+#include "VulkanRenderer.h"
+#include "Settings.h"
+#include <memory>
+
+namespace Raven
+{
+    typedef uint32_t RenderGraphResource;
+    typedef uint32_t RenderGraphPass;
+    #define RENDER_GRAPH_INVALID UINT32_MAX
+
+    enum RenderGraphPassType
+    {
+        RENDER_GRAPH_PASS_GRAPHICS,
+        RENDER_GRAPH_PASS_COMPUTE,
+        RENDER_GRAPH_PASS_TRANSFER
+    };
+
+    //How a pass uses a resource. Sets the stages, access and image layout of the use.
+    enum RenderGraphUsage
+    {
+        RENDER_GRAPH_USAGE_COLOR_ATTACHMENT,
+        //Read only if the pass does not write it.
+        RENDER_GRAPH_USAGE_DEPTH_ATTACHMENT,
+        RENDER_GRAPH_USAGE_INPUT_ATTACHMENT,
+        RENDER_GRAPH_USAGE_SAMPLED,
+        RENDER_GRAPH_USAGE_STORAGE,
+        RENDER_GRAPH_USAGE_UNIFORM,
+        //Vertex or index buffer.
+        RENDER_GRAPH_USAGE_VERTEX,
+        RENDER_GRAPH_USAGE_INDIRECT,
+        RENDER_GRAPH_USAGE_TRANSFER_SRC,
+        RENDER_GRAPH_USAGE_TRANSFER_DST
+    };
+
+    //The last use of an imported resource before the graph, or its first use after it.
+    struct RenderGraphResourceState
+    {
+        VkPipelineStageFlags stages;
+        VkAccessFlags access;
+        //Ignored for buffers.
+        VkImageLayout layout;
+    };
+
+    //An image owned by someone else, such as a swapchain image.
+    struct RenderGraphImage
+    {
+        VkImage image;
+        VkImageView view;
+        VkFormat format;
+        VkExtent2D extent;
+        VkImageAspectFlags aspect;
+    };
+
+    //All dependencies in front of a step, recorded as a single pipeline barrier. Buffers and
+    //images that keep their layout share one global memory barrier.
+    struct RenderGraphBarrier
+    {
+        VkPipelineStageFlags srcStages = 0;
+        VkPipelineStageFlags dstStages = 0;
+        VkAccessFlags srcAccess = 0;
+        VkAccessFlags dstAccess = 0;
+        std::vector<VkImageMemoryBarrier> imageBarriers;
+        //Resource of every image barrier.
+        std::vector<RenderGraphResource> imageResources;
+
+        bool isEmpty() const {return srcStages == 0 && dstStages == 0 && imageBarriers.empty();}
+    };
+
+    struct RenderGraphSubpass
+    {
+        std::vector<VkAttachmentReference> inputAttachments;
+        std::vector<VkAttachmentReference> colorAttachments;
+        //Attachment VK_ATTACHMENT_UNUSED without depth.
+        VkAttachmentReference depthAttachment;
+        std::vector<uint32_t> preserveAttachments;
+    };
+
+    //Passes recorded back to back. Either a single compute or transfer pass, or graphics
+    //passes merged into the subpasses of one render pass.
+    struct RenderGraphStep
+    {
+        RenderGraphPassType type;
+        std::vector<RenderGraphPass> passes;
+        RenderGraphBarrier barrier;
+
+        //Render pass of graphics steps.
+        VkExtent2D extent = {0, 0};
+        std::vector<RenderGraphResource> attachments;
+        std::vector<VkAttachmentDescription> attachmentDescriptions;
+        std::vector<VkClearValue> clearValues;
+        std::vector<RenderGraphSubpass> subpasses;
+        std::vector<VkSubpassDependency> dependencies;
+        VkRenderPass renderPass = VK_NULL_HANDLE;
+        VkFramebuffer framebuffer = VK_NULL_HANDLE;
+    };
+
+    //An image the graph creates. Images whose lifetimes do not overlap share memory.
+    struct RenderGraphTransientImage
+    {
+        RenderGraphResource resource;
+        VkImageUsageFlags usage;
+        //Steps of the first and the last use.
+        uint32_t firstStep;
+        uint32_t lastStep;
+        //Never leaves the tile memory of its render pass, so it gets lazily allocated memory
+        //of its own instead of a place in a shared block.
+        bool lazilyAllocated;
+        uint32_t memoryBlock;
+        VkDeviceSize offset;
+        VkImage image;
+        VkImageView view;
+    };
+
+    //Lifetime and memory requirements of an image placed in a shared memory block.
+    struct RenderGraphAliasingRequest
+    {
+        uint32_t firstStep;
+        uint32_t lastStep;
+        VkDeviceSize size;
+        VkDeviceSize alignment;
+    };
+
+    //Passes declare the resources they read and write, and compile works out the rest: the
+    //order of the passes, which of them contribute to the outputs, the barriers and layout
+    //transitions between them, and which graphics passes can share a render pass as
+    //subpasses. The graph is declared again every frame. Compiled graphs are cached by
+    //their structure, so a frame that declares the same graph as an earlier one reuses its
+    //schedule, render passes and framebuffers. Of the engine's own work only the post
+    //processing chain is declared into a graph yet, other graphs are built and executed by
+    //the application.
+    class RenderGraph
+    {
+        public:
+            RenderGraph();
+            ~RenderGraph();
+            RenderGraph(const RenderGraph&) = delete;
+            RenderGraph& operator=(const RenderGraph&) = delete;
+
+            //Without a device and renderer only the schedule is compiled, no render passes,
+            //framebuffers or transient images.
+            void initialize(VkDevice logicalDevice, VkPhysicalDeviceMemoryProperties memoryProperties,
+                            VulkanRenderer *renderer);
+            //Destroys the cached render passes, framebuffers and transient images. The gpu must
+            //not be using them anymore.
+            void destroy();
+
+            //Starts declaring a new graph. The cache is kept.
+            void reset();
+
+            RenderGraphResource importImage(const std::string &name, const RenderGraphImage &image,
+                                            const RenderGraphResourceState &initialState);
+            RenderGraphResource importBuffer(const std::string &name, VkBuffer buffer,
+                                             const RenderGraphResourceState &initialState);
+            //An image that only lives within the graph, such as a depth buffer or an intermediate
+            //post processing target. Its contents are undefined before its first write.
+            RenderGraphResource createImage(const std::string &name, VkFormat format, VkExtent2D extent,
+                                            VkImageAspectFlags aspect);
+            //Makes the resource an output of the graph. Passes that do not contribute to an
+            //output or have side effects are culled.
+            void setFinalState(RenderGraphResource resource, const RenderGraphResourceState &finalState);
+
+            RenderGraphPass addPass(const std::string &name, RenderGraphPassType type,
+                                    std::function<void(VkCommandBuffer)> record);
+            //A pass uses each resource in a single way, but can both read and write it.
+            //Reading and writing a color attachment loads its earlier contents.
+            bool read(RenderGraphPass pass, RenderGraphResource resource, RenderGraphUsage usage);
+            bool write(RenderGraphPass pass, RenderGraphResource resource, RenderGraphUsage usage);
+            //Clears an attachment the pass writes at the start of its render pass.
+            void setClearValue(RenderGraphPass pass, RenderGraphResource resource, VkClearValue clearValue);
+            //Keeps the pass even if nothing reads what it writes.
+            void setSideEffects(RenderGraphPass pass);
+
+            bool compile();
+            //Records the steps with their barriers, and the barrier to the final states.
+            void execute(VkCommandBuffer cmdBuffer);
+
+            //The render pass and subpass a graphics pass is recorded in, for creating its pipelines.
+            //Only valid after compile, and only changes when the structure of the graph does.
+            bool getSubpass(RenderGraphPass pass, VkRenderPass &renderPass, uint32_t &subpass) const;
+            const std::vector<RenderGraphStep> &getSteps() const;
+            const RenderGraphBarrier &getFinalBarrier() const;
+            bool isPassCulled(RenderGraphPass pass) const;
+            const std::vector<RenderGraphTransientImage> &getTransientImages() const;
+            //Memory of the shared blocks and lazily allocated images, before lazy allocation.
+            VkDeviceSize getTransientMemorySize() const;
+
+            //Places every image at the lowest offset where it does not overlap an image in use
+            //during the same steps. Returns the size of the block.
+            static VkDeviceSize placeAliasedImages(const std::vector<RenderGraphAliasingRequest> &requests,
+                                                   std::vector<VkDeviceSize> &offsets);
+        private:
+            struct ResourceData
+            {
+                std::string name;
+                bool isImage;
+                RenderGraphImage image;
+                VkBuffer buffer;
+                RenderGraphResourceState initialState;
+                RenderGraphResourceState finalState;
+                bool isOutput;
+                bool isTransient;
+            };
+
+            struct Access
+            {
+                RenderGraphResource resource;
+                RenderGraphUsage usage;
+                bool read;
+                bool write;
+                bool clear;
+                VkClearValue clearValue;
+            };
+
+            struct PassData
+            {
+                std::string name;
+                RenderGraphPassType type;
+                std::vector<Access> accesses;
+                bool sideEffects;
+                std::function<void(VkCommandBuffer)> record;
+            };
+
+            //Synchronization state of a resource while the passes are scheduled.
+            struct ResourceState
+            {
+                VkImageLayout layout;
+                //Stages and access of the last write, or of the last layout transition.
+                VkPipelineStageFlags writeStages;
+                VkAccessFlags writeAccess;
+                //Stages that read since the last write.
+                VkPipelineStageFlags readStages;
+                //Stages and access the last write has been made visible to.
+                VkPipelineStageFlags visibleStages;
+                VkAccessFlags visibleAccess;
+            };
+
+            //The transient images of a schedule and their memory. Schedules that only differ in
+            //imported resources, e.g. the swapchain image, share them.
+            struct TransientAllocation
+            {
+                std::vector<uint64_t> signature;
+                std::vector<RenderGraphTransientImage> images;
+                std::vector<VkDeviceMemory> memoryBlocks;
+                VkDeviceSize memorySize = 0;
+            };
+
+            //A schedule with its Vulkan objects, keyed by the structure of the graph.
+            struct CompiledGraph
+            {
+                std::vector<uint64_t> signature;
+                std::vector<RenderGraphStep> steps;
+                RenderGraphBarrier finalBarrier;
+                std::vector<bool> culledPasses;
+                //Step and subpass of every pass.
+                std::vector<uint32_t> passSteps;
+                std::vector<uint32_t> passSubpasses;
+                //Stages and write access of the last use of every resource.
+                std::vector<VkPipelineStageFlags> lastStages;
+                std::vector<VkAccessFlags> lastWriteAccess;
+                std::shared_ptr<TransientAllocation> transients;
+                uint64_t lastUsed;
+            };
+
+            bool addAccess(RenderGraphPass pass, RenderGraphResource resource, RenderGraphUsage usage, bool write);
+            void computeSignature(std::vector<uint64_t> &signature) const;
+            bool schedule(CompiledGraph &graph) const;
+            void planTransientImages(const CompiledGraph &graph, TransientAllocation &transients) const;
+            bool allocateTransientImages(TransientAllocation &transients);
+            void bindTransientImages(CompiledGraph &graph) const;
+            bool createRenderPasses(CompiledGraph &graph);
+            void destroyCompiledGraph(CompiledGraph &graph);
+
+            VkDevice logicalDevice = VK_NULL_HANDLE;
+            VkPhysicalDeviceMemoryProperties memoryProperties = {};
+            VulkanRenderer *renderer = nullptr;
+            std::vector<ResourceData> resources;
+            std::vector<PassData> passes;
+            std::vector<CompiledGraph> cache;
+            //Index of the graph compiled last, RENDER_GRAPH_INVALID before the first compile.
+            uint32_t current = RENDER_GRAPH_INVALID;
+            uint64_t compileCount = 0;
+    };
+}
@@ -0,0 +1,96 @@
+#pragma once
+#include "Headers.h"
+#include "GraphicsObject.h"
+#include <unordered_map>
+
+namespace Raven
+{
+    //Bits of each field in a render queue sort key, from the most significant one down.
+    #define RENDER_QUEUE_PASS_BITS 4
+    #define RENDER_QUEUE_PIPELINE_BITS 12
+    #define RENDER_QUEUE_DESCRIPTOR_SET_BITS 12
+    #define RENDER_QUEUE_VERTEX_BUFFER_BITS 12
+    #define RENDER_QUEUE_DEPTH_BITS 24
+    //Dynamic offsets a draw can give its descriptor set.
+    #define RENDER_QUEUE_MAX_DYNAMIC_OFFSETS 4
+
+    //A draw waiting in the render queue.
+    struct RenderItem
+    {
+        VkPipeline pipeline;
+        VkPipelineLayout pipelineLayout;
+        VkDescriptorSet descriptorSet;
+        VkBuffer vertexBuffer;
+        //VK_NULL_HANDLE for non-indexed meshes.
+        VkBuffer indexBuffer;
+        const GraphicsObject *drawable;
+        uint32_t instanceCount;
+        uint32_t firstInstance;
+        //Offsets of the dynamic buffers in descriptorSet, e.g. the draw's block in a UniformRing.
+        uint32_t dynamicOffsetCount;
+        uint32_t dynamicOffsets[RENDER_QUEUE_MAX_DYNAMIC_OFFSETS];
+    };
+
+    //Draws and state changes recorded since the last reset, i.e. during the current frame.
+    struct RenderQueueStatistics
+    {
+        uint32_t drawCount = 0;
+        uint32_t pipelineBinds = 0;
+        uint32_t descriptorSetBinds = 0;
+        uint32_t vertexBufferBinds = 0;
+        uint32_t indexBufferBinds = 0;
+        //Binds skipped because the state was already set.
+        uint32_t redundantBindsSkipped = 0;
+    };
+
+    //Collects the draws of a frame, orders them by a 64-bit key made of the pass, pipeline,
+    //descriptor set, vertex buffer and depth, and records them without rebinding state that
+    //is already bound.
+    class RenderQueue
+    {
+        public:
+            RenderQueue();
+            ~RenderQueue();
+
+            //Removes every draw, called at the start of a frame.
+            void reset();
+            //Makes a pass sort its draws back to front instead of front to back, e.g. for blending.
+            void setBackToFront(uint32_t pass, bool backToFront);
+            //Adds a draw. Depth is the view space distance of the drawn object.
+            void submit(uint32_t pass, const RenderItem &item, float depth);
+            //Sorts the draws by their keys. Called by record if needed.
+            void sort();
+
+            //Records the draws of a pass inside its render pass. Vertex buffers are bound at vertexBinding.
+            void record(VkCommandBuffer cmdBuffer, uint32_t pass, uint32_t vertexBinding);
+
+            //Builds a sort key from already compacted ids.
+            static uint64_t makeKey(uint32_t pass, uint32_t pipelineId, uint32_t descriptorSetId,
+                                    uint32_t vertexBufferId, float depth, bool backToFront);
+
+            size_t getItemCount() const {return items.size();}
+            //Items in the sorted order, valid after sort.
+            const RenderItem &getSortedItem(size_t index) const {return items[sortedIndices[index]];}
+            uint64_t getSortedKey(size_t index) const {return sortedKeys[index];}
+            const RenderQueueStatistics &getStatistics() const {return statistics;}
+        private:
+            //Maps a handle to a small id in the order the handles are first seen this frame.
+            static uint32_t compactId(std::unordered_map<uint64_t, uint32_t> &ids, uint64_t handle, uint32_t bits);
+
+            std::vector<RenderItem> items;
+            std::vector<uint64_t> keys;
+            std::vector<uint64_t> sortedKeys;
+            std::vector<uint32_t> sortedIndices;
+            //Scratch buffers of the radix sort.
+            std::vector<uint64_t> scratchKeys;
+            std::vector<uint32_t> scratchIndices;
+            bool sorted = true;
+
+            std::unordered_map<uint64_t, uint32_t> pipelineIds;
+            std::unordered_map<uint64_t, uint32_t> descriptorSetIds;
+            std::unordered_map<uint64_t, uint32_t> vertexBufferIds;
+            uint32_t backToFrontPasses = 0;
+
+            RenderQueueStatistics statistics;
+    };
+}
@@ -0,0 +1,234 @@
+#pragma once
+#include "VulkanBuffer.h"
+#include "VulkanImage.h"
+#include "Mesh.h"
+#include <deque>
+
+namespace Raven
+{
+    //A handle is the slot index in the low bits and the slot's generation in the high bits.
+    #define RESOURCE_HANDLE_INDEX_BITS 20
+    #define RESOURCE_HANDLE_INDEX_MASK ((1u << RESOURCE_HANDLE_INDEX_BITS) - 1)
+    #define RESOURCE_HANDLE_GENERATION_MASK ((1u << (32 - RESOURCE_HANDLE_INDEX_BITS)) - 1)
+    //The last index is never used so that no live handle equals the invalid one.
+    #define RESOURCE_HANDLE_MAX_SLOTS RESOURCE_HANDLE_INDEX_MASK
+    #define RESOURCE_HANDLE_INVALID UINT32_MAX
+
+    //A 32-bit reference to a resource in a ResourcePool. The tag keeps handles of different
+    //resource types from being mixed up.
+    template<class Tag>
+    struct ResourceHandle
+    {
+        uint32_t value = RESOURCE_HANDLE_INVALID;
+
+        uint32_t getIndex() const {return value & RESOURCE_HANDLE_INDEX_MASK;}
+        uint32_t getGeneration() const {return value >> RESOURCE_HANDLE_INDEX_BITS;}
+        bool isValid() const {return value != RESOURCE_HANDLE_INVALID;}
+        bool operator==(const ResourceHandle &other) const {return value == other.value;}
+        bool operator!=(const ResourceHandle &other) const {return value != other.value;}
+    };
+
+    typedef ResourceHandle<struct BufferResourceTag> BufferHandle;
+    typedef ResourceHandle<struct TextureResourceTag> TextureHandle;
+    typedef ResourceHandle<struct MeshResourceTag> MeshHandle;
+    typedef ResourceHandle<struct PipelineResourceTag> PipelineHandle;
+
+    //A buffer and the memory object it owns, VK_NULL_HANDLE if it is bound to shared memory.
+    struct BufferResource
+    {
+        VulkanBuffer buffer = {};
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+    };
+
+    //An image with its view and memory, and an optional sampler.
+    struct TextureResource
+    {
+        VulkanImage image = {};
+        VkSampler sampler = VK_NULL_HANDLE;
+    };
+
+    //Draw data of a mesh. The buffers are separate resources so that meshes can share them.
+    struct MeshResource
+    {
+        BufferHandle vertexBuffer;
+        BufferHandle indexBuffer;
+        VkDeviceSize vertexOffset = 0;
+        VkDeviceSize indexOffset = 0;
+        uint32_t vertexCount = 0;
+        uint32_t indexCount = 0;
+        MeshBounds bounds = {};
+    };
+
+    //A pipeline and the layout it owns, VK_NULL_HANDLE if the layout is shared.
+    struct PipelineResource
+    {
+        VkPipeline pipeline = VK_NULL_HANDLE;
+        VkPipelineLayout layout = VK_NULL_HANDLE;
+        VkPipelineBindPoint bindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    };
+
+    //Resources stored in an array indexed by the handles. Every slot has a generation that
+    //changes when its resource is released, so stale handles are detected with a single
+    //compare. Released slots are only reused after the frame that released them is done.
+    template<class T, class Handle>
+    class ResourcePool
+    {
+        public:
+            Handle add(const T &resource)
+            {
+                uint32_t index;
+                if(!freeSlots.empty())
+                {
+                    index = freeSlots.back();
+                    freeSlots.pop_back();
+                }
+                else
+                {
+                    if(slots.size() >= RESOURCE_HANDLE_MAX_SLOTS)
+                    {
+                        std::cerr << "Failed to add a resource, the pool is full!" << std::endl;
+                        return Handle();
+                    }
+                    index = static_cast<uint32_t>(slots.size());
+                    slots.emplace_back();
+                    generations.push_back(0);
+                }
+                slots[index] = resource;
+                ++count;
+
+                Handle handle;
+                handle.value = (generations[index] << RESOURCE_HANDLE_INDEX_BITS) | index;
+                return handle;
+            }
+
+            //The resource of a handle, nullptr if it has been released.
+            T *get(Handle handle)
+            {
+                uint32_t index = handle.getIndex();
+                return index < slots.size() && generations[index] == handle.getGeneration() ? &slots[index] : nullptr;
+            }
+            const T *get(Handle handle) const
+            {
+                uint32_t index = handle.getIndex();
+                return index < slots.size() && generations[index] == handle.getGeneration() ? &slots[index] : nullptr;
+            }
+            bool isValid(Handle handle) const {return get(handle) != nullptr;}
+
+            //Invalidates the handle at once and keeps the resource until collect is called
+            //with a frame at least as late as the given one.
+            bool release(Handle handle, uint64_t frame)
+            {
+                if(!isValid(handle))
+                    return false;
+
+                uint32_t index = handle.getIndex();
+                generations[index] = (generations[index] + 1) & RESOURCE_HANDLE_GENERATION_MASK;
+                pendingReleases.push_back({index, frame});
+                --count;
+                return true;
+            }
+
+            //Destroys the resources released in frames up to completedFrame and frees their slots.
+            template<class Destroy>
+            void collect(uint64_t completedFrame, Destroy destroy)
+            {
+                while(!pendingReleases.empty() && pendingReleases.front().frame <= completedFrame)
+                {
+                    uint32_t index = pendingReleases.front().index;
+                    pendingReleases.pop_front();
+                    destroy(slots[index]);
+                    slots[index] = T();
+                    freeSlots.push_back(index);
+                }
+            }
+
+            //Destroys every resource, live or released. The gpu must not be using them anymore.
+            template<class Destroy>
+            void clear(Destroy destroy)
+            {
+                std::vector<bool> freeSlot(slots.size(), false);
+                for(uint32_t index : freeSlots)
+                    freeSlot[index] = true;
+                for(size_t i = 0; i < slots.size(); ++i)
+                {
+                    if(!freeSlot[i])
+                        destroy(slots[i]);
+                }
+                slots.clear();
+                generations.clear();
+                freeSlots.clear();
+                pendingReleases.clear();
+                count = 0;
+            }
+
+            //Live resources, not counting released ones waiting for their frame.
+            size_t getCount() const {return count;}
+            size_t getPendingReleaseCount() const {return pendingReleases.size();}
+        private:
+            struct PendingRelease
+            {
+                uint32_t index;
+                uint64_t frame;
+            };
+
+            std::vector<T> slots;
+            std::vector<uint32_t> generations;
+            std::vector<uint32_t> freeSlots;
+            //Ordered by frame since frames only grow.
+            std::deque<PendingRelease> pendingReleases;
+            size_t count = 0;
+    };
+
+    //Owns the buffers, textures, meshes and pipelines that are referred to by handles.
+    //Releasing a resource defers its destruction until the gpu has finished the frames
+    //that might still use it, which the owner of the frame fences reports with collect.
+    class ResourceRegistry
+    {
+        public:
+            ResourceRegistry();
+            ~ResourceRegistry();
+            ResourceRegistry(const ResourceRegistry&) = delete;
+            ResourceRegistry& operator=(const ResourceRegistry&) = delete;
+
+            void initialize(VkDevice logicalDevice);
+            //Destroys every resource. The gpu must not be using them anymore.
+            void destroy();
+
+            BufferHandle addBuffer(const BufferResource &buffer) {return buffers.add(buffer);}
+            TextureHandle addTexture(const TextureResource &texture) {return textures.add(texture);}
+            //Does not take ownership of the mesh's buffers.
+            MeshHandle addMesh(const MeshResource &mesh) {return meshes.add(mesh);}
+            PipelineHandle addPipeline(const PipelineResource &pipeline) {return pipelines.add(pipeline);}
+
+            BufferResource *getBuffer(BufferHandle handle) {return buffers.get(handle);}
+            TextureResource *getTexture(TextureHandle handle) {return textures.get(handle);}
+            MeshResource *getMesh(MeshHandle handle) {return meshes.get(handle);}
+            PipelineResource *getPipeline(PipelineHandle handle) {return pipelines.get(handle);}
+
+            //The handle is invalid right away, the resource is destroyed once the current
+            //frame has been collected.
+            bool releaseBuffer(BufferHandle handle) {return buffers.release(handle, currentFrame);}
+            bool releaseTexture(TextureHandle handle) {return textures.release(handle, currentFrame);}
+            bool releaseMesh(MeshHandle handle) {return meshes.release(handle, currentFrame);}
+            bool releasePipeline(PipelineHandle handle) {return pipelines.release(handle, currentFrame);}
+
+            //Number of the frame being recorded. Releases are tagged with it.
+            uint64_t getCurrentFrame() const {return currentFrame;}
+            //Starts the next frame. Returns the number of the frame that ended.
+            uint64_t endFrame() {return currentFrame++;}
+            //Destroys what was released in frames up to completedFrame. Called once the fence
+            //of that frame is signaled.
+            void collect(uint64_t completedFrame);
+
+            size_t getPendingReleaseCount() const;
+        private:
+            VkDevice logicalDevice = VK_NULL_HANDLE;
+            uint64_t currentFrame = 0;
+            ResourcePool<BufferResource, BufferHandle> buffers;
+            ResourcePool<TextureResource, TextureHandle> textures;
+            ResourcePool<MeshResource, MeshHandle> meshes;
+            ResourcePool<PipelineResource, PipelineHandle> pipelines;
+    };
+
+    static_assert(sizeof(MeshHandle) == sizeof(uint32_t), "Handles have to stay 32-bit.");
+}
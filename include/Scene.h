@@ -0,0 +1,98 @@
+#pragma once
+#include "Headers.h"
+#include "VulkanBuffer.h"
+#include "ThreadPool.h"
+#include <glm/gtc/quaternion.hpp>
+
+namespace Raven
+{
+    //Handle of a scene node. Stays the same while the node exists and doubles as
+    //the node's index in the instance buffer.
+    typedef uint32_t SceneNode;
+    #define SCENE_INVALID_NODE UINT32_MAX
+    //Number of nodes a single thread updates at a time.
+    #define SCENE_UPDATE_CHUNK_SIZE 2048
+
+    //A transform hierarchy stored as structure of arrays. Nodes are kept sorted by
+    //their depth in the hierarchy so that every parent is updated before its children
+    //and all nodes of the same depth can be updated in parallel. Only nodes whose
+    //local transform changed, and their descendants, get new world matrices.
+    class Scene
+    {
+        public:
+            Scene();
+            ~Scene();
+            //Creates a host visible instance buffer for capacity nodes. Every update writes
+            //the changed world matrices straight into it at the nodes' handles.
+            bool createInstanceBuffer(VkDevice logicalDevice,
+                                      const VkPhysicalDeviceMemoryProperties &memoryProperties,
+                                      uint32_t capacity);
+            //Destroys the instance buffer. The nodes are kept.
+            void destroy();
+
+            //Creates a node with an identity transform. Returns SCENE_INVALID_NODE on failure.
+            SceneNode createNode(SceneNode parent = SCENE_INVALID_NODE);
+            //Destroys a node and all of its descendants.
+            void destroyNode(SceneNode node);
+            //Moves a node and its subtree under a new parent.
+            bool setParent(SceneNode node, SceneNode parent);
+            bool isValid(SceneNode node) const
+            {
+                return node < handleToIndex.size() && handleToIndex[node] != SCENE_INVALID_NODE;
+            }
+
+            //Local transform relative to the parent.
+            void setPosition(SceneNode node, const glm::vec3 &position);
+            void setRotation(SceneNode node, const glm::quat &rotation);
+            void setScale(SceneNode node, const glm::vec3 &scale);
+            void setTransform(SceneNode node, const glm::vec3 &position,
+                              const glm::quat &rotation, const glm::vec3 &scale);
+            const glm::vec3 &getPosition(SceneNode node) const {return positions[handleToIndex[node]];}
+            const glm::quat &getRotation(SceneNode node) const {return rotations[handleToIndex[node]];}
+            const glm::vec3 &getScale(SceneNode node) const {return scales[handleToIndex[node]];}
+            SceneNode getParent(SceneNode node) const {return parentHandles[handleToIndex[node]];}
+            //World matrix as of the last update.
+            const glm::mat4 &getWorldMatrix(SceneNode node) const {return worldMatrices[handleToIndex[node]];}
+
+            //Recomputes the world matrices of dirty subtrees, in parallel if a pool is given.
+            void update(ThreadPool *threadPool = nullptr);
+
+            size_t getNodeCount() const {return handles.size();}
+            //Instance buffer with one world matrix per node handle.
+            const VulkanBuffer &getInstanceBuffer() const {return instanceBuffer;}
+            uint32_t getInstanceCapacity() const {return instanceCapacity;}
+        private:
+            //Recomputes depths and reorders every array so that depth levels are contiguous.
+            void sortByDepth();
+            //Updates the nodes [begin, end) of a single depth level.
+            void updateRange(size_t begin, size_t end);
+            void markDirty(SceneNode node);
+
+            //Local transforms and hierarchy, indexed by the sorted position.
+            std::vector<glm::vec3> positions;
+            std::vector<glm::quat> rotations;
+            std::vector<glm::vec3> scales;
+            std::vector<uint32_t> parentIndices;
+            std::vector<SceneNode> parentHandles;
+            std::vector<SceneNode> handles;
+            std::vector<glm::mat4> worldMatrices;
+            //Bytes instead of bools so that threads can write neighbouring flags.
+            std::vector<uint8_t> localDirty;
+            std::vector<uint8_t> worldChanged;
+            //First node of every depth level, plus the node count at the end.
+            std::vector<size_t> levelOffsets;
+
+            //Sorted position of every handle, SCENE_INVALID_NODE for free handles.
+            std::vector<uint32_t> handleToIndex;
+            std::vector<SceneNode> freeHandles;
+            bool hierarchyChanged = false;
+            bool anyDirty = false;
+
+            VkDevice logicalDevice = VK_NULL_HANDLE;
+            VulkanBuffer instanceBuffer;
+            VkDeviceMemory instanceMemory = VK_NULL_HANDLE;
+            //Persistently mapped instance buffer memory.
+            glm::mat4 *instanceData = nullptr;
+            uint32_t instanceCapacity = 0;
+    };
+}
@@ -14,3 +14,66 @@
 //Define the default window values.
 #define SETTINGS_DEFAULT_PRESENTATION_MODE VK_PRESENT_MODE_FIFO_KHR;
 #define SETTINGS_WINDOW_SWAPHAIN_IMAGE_COUNT 3
+
+//Asset pack that is mounted on startup, loose files are used if it does not exist.
+#define SETTINGS_ASSET_ARCHIVE_PATH "../Resources/Raven.rpak"
+//Directory the AssetBuilder tool writes cooked models, textures and shaders into. The
+//CookAssets target cooks into the build directory, which is where the engine runs from.
+#define SETTINGS_COOKED_ASSET_DIRECTORY "Cooked/"
+//Source assets, loaded instead when nothing has been cooked.
+#define SETTINGS_RESOURCE_DIRECTORY "../Resources/"
+
+//Texture streaming:
+//Device memory the streamed textures may use when no other budget is given.
+#define SETTINGS_TEXTURE_STREAMING_BUDGET (256ull * 1024ull * 1024ull)
+//Maximum amount of texture data uploaded per frame.
+#define SETTINGS_TEXTURE_STREAMING_UPLOAD_LIMIT (16ull * 1024ull * 1024ull)
+//Mips this size or smaller are always resident.
+#define SETTINGS_TEXTURE_STREAMING_TAIL_SIZE 64
+//How many frames a texture keeps its mips after it was last requested.
+#define SETTINGS_TEXTURE_STREAMING_RETAIN_FRAMES 120
+
+//Level of detail:
+//Largest distance in pixels between a selected level of detail and the full mesh.
+#define SETTINGS_LOD_MAX_SCREEN_SPACE_ERROR 1.0f
+
+//Scene:
+//Largest number of scene nodes, sets the size of the instance buffer.
+#define SETTINGS_SCENE_MAX_NODES 131072
+//Largest number of instances drawn with instanced draws per frame.
+#define SETTINGS_INSTANCE_BATCH_MAX_INSTANCES SETTINGS_SCENE_MAX_NODES
+
+//Gpu culling:
+//Largest number of draws culled in a single pass, sets the size of the indirect buffers.
+#define SETTINGS_GPU_CULL_MAX_DRAWS 65536
+
+//Query pools:
+//Frames in the query pool ring. Results are read when a pool comes around again, so this
+//has to be larger than the number of frames in flight for the results to be ready.
+#define SETTINGS_QUERY_POOL_FRAME_COUNT 4
+//Largest number of occlusion and pipeline statistics queries in a frame.
+#define SETTINGS_QUERY_POOL_MAX_OCCLUSION_QUERIES 4096
+#define SETTINGS_QUERY_POOL_MAX_STATISTICS_QUERIES 32
+
+//Render graph:
+//Compiled graphs kept with their render passes and framebuffers, e.g. one per swapchain
+//image. Has to be larger than the number of frames in flight.
+#define SETTINGS_RENDER_GRAPH_CACHE_SIZE 8
+
+//Barrier batches:
+//Buffer and image barriers a batch holds inline. A full batch flushes by itself.
+#define SETTINGS_BARRIER_BATCH_MAX_BUFFERS 16
+#define SETTINGS_BARRIER_BATCH_MAX_IMAGES 16
+
+//Post processing:
+//Frames of scene color and output images. The compute queue processes one frame while the
+//graphics queue renders the next, so this has to be at least 2.
+#define SETTINGS_POST_PROCESS_FRAME_COUNT 2
+//Largest number of bloom levels, each half the size of the one before.
+#define SETTINGS_POST_PROCESS_MAX_BLOOM_LEVELS 6
+
+//Uniform ring:
+//Bytes of per-draw uniform blocks a frame can write.
+#define SETTINGS_UNIFORM_RING_FRAME_SIZE (1024ull * 1024ull)
+//Regions in the ring. Has to be larger than the number of frames in flight.
+#define SETTINGS_UNIFORM_RING_FRAME_COUNT 3
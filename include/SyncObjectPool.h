@@ -0,0 +1,59 @@
+#pragma once
+#include "Headers.h"
+#include <deque>
+
+namespace Raven
+{
+    //Recycles fences and binary semaphores so that none are created once the pool covers the
+    //frames in flight. Objects given back with a frame are only reused after collect has been
+    //called with that frame, since the gpu may still signal or wait on them until then.
+    //Returned fences are reset together with a single call when the pool runs out of reset ones.
+    class SyncObjectPool
+    {
+        public:
+            SyncObjectPool();
+            ~SyncObjectPool();
+            SyncObjectPool(const SyncObjectPool&) = delete;
+            SyncObjectPool& operator=(const SyncObjectPool&) = delete;
+
+            void initialize(VkDevice logicalDevice);
+            //Destroys every fence and semaphore of the pool, including those waiting for their
+            //frame. The gpu must not be using them anymore.
+            void destroy();
+
+            //Returns an unsignaled fence.
+            bool acquireFence(VkFence &fence);
+            bool acquireSemaphore(VkSemaphore &semaphore);
+
+            //For fences that have been signaled or never submitted.
+            void releaseFence(VkFence &fence);
+            void releaseFences(const std::vector<VkFence> &fences);
+            //For objects the gpu may still use until the frame has finished.
+            void releaseFence(VkFence &fence, uint64_t frame);
+            void releaseSemaphore(VkSemaphore &semaphore, uint64_t frame);
+            //Makes the objects released in frames up to completedFrame available again.
+            void collect(uint64_t completedFrame);
+
+            //Objects the pool has created and not destroyed, in use or not.
+            size_t getFenceCount() const {return fenceCount;}
+            size_t getSemaphoreCount() const {return semaphoreCount;}
+        private:
+            template<class T>
+            struct PendingRelease
+            {
+                uint64_t frame;
+                T object;
+            };
+
+            VkDevice logicalDevice = VK_NULL_HANDLE;
+            std::vector<VkFence> freeFences;
+            //Returned fences that still have to be reset.
+            std::vector<VkFence> usedFences;
+            std::vector<VkSemaphore> freeSemaphores;
+            //Ordered by frame since frames only grow.
+            std::deque<PendingRelease<VkFence>> pendingFences;
+            std::deque<PendingRelease<VkSemaphore>> pendingSemaphores;
+            size_t fenceCount = 0;
+            size_t semaphoreCount = 0;
+    };
+}
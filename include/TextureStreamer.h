@@ -0,0 +1,142 @@
+#pragma once
+#include "Headers.h"
+#include "VulkanBuffer.h"
+#include "VulkanImage.h"
+#include "CookedAssets.h"
+#include "SyncObjectPool.h"
+#include "QueueSubmitter.h"
+#include "GpuTimeline.h"
+
+namespace Raven
+{
+    //A texture whose finer mip levels are loaded and evicted on demand.
+    //The gpu image only holds the mips [residentMip, mipLevels.size()).
+    struct StreamedTexture
+    {
+        //Every mip level of the texture, 0 being the finest.
+        std::vector<TextureMipLevel> mipLevels;
+        VkFormat format;
+        //The gpu image. Recreated every time the resident mip range changes.
+        VulkanImage image = {VK_NULL_HANDLE, VK_NULL_HANDLE, VK_NULL_HANDLE};
+        VkDeviceSize memorySize = 0;
+        //Device memory an image holding the mips [i, end) requires, from its memory requirements.
+        std::vector<VkDeviceSize> mipMemorySizes;
+        //The finest mip level that is currently on the gpu.
+        uint32_t residentMip;
+        //Mips from this level onwards are never evicted.
+        uint32_t tailMip;
+        //The finest mip level requested since the last update.
+        uint32_t requestedMip;
+        //Largest on-screen size requested since the last update, used as the priority.
+        float requestedScreenSize = 0.0f;
+        //Frame index of the last request.
+        uint64_t lastRequestFrame = 0;
+        //True while a new image for this texture is being uploaded.
+        bool uploadPending = false;
+        //Incremented every time the image is replaced so users can rewrite their descriptors.
+        uint32_t version = 0;
+    };
+
+    //Streams texture mip levels in and out of device memory. Textures start with
+    //only their smallest mips resident. Each frame objects request the resolution
+    //they are drawn at and the streamer loads finer mips for the most important
+    //textures while keeping the total size under the memory budget.
+    class TextureStreamer
+    {
+        public:
+            TextureStreamer();
+            ~TextureStreamer();
+            //Prepares the streamer. A budget of 0 uses SETTINGS_TEXTURE_STREAMING_BUDGET. Replaced
+            //images are kept until the timeline of the queue that samples them has passed their last use.
+            bool initialize(VkPhysicalDevice physicalDevice, VkDevice logicalDevice,
+                            uint32_t queueFamilyIndex, QueueSubmitter *submitter, SyncObjectPool *syncObjects,
+                            GpuTimeline *timeline, uint32_t timelineQueue,
+                            VkDeviceSize memoryBudget, bool memoryBudgetExtensionEnabled);
+            //Waits for uploads to finish and destroys every texture.
+            void destroy();
+
+            //Loads a cooked texture or an image file and uploads the smallest mips.
+            bool addTexture(const std::string &filename, VkFormat format, uint32_t &textureId);
+            //Adds a texture from already built RGBA8 mip levels. The format has to be R8G8B8A8 UNORM or SRGB.
+            bool addTexture(std::vector<TextureMipLevel> &&mipLevels, VkFormat format, uint32_t &textureId);
+
+            //Requests the mip level that covers screenSpaceSize pixels. Call every frame per visible object.
+            void requestResolution(uint32_t textureId, float screenSpaceSize);
+            //Finishes completed uploads, evicts and schedules new uploads. Call once per frame.
+            bool update();
+
+            //Returns the current image of a texture. The image changes when its version changes.
+            const VulkanImage &getImage(uint32_t textureId) const {return textures[textureId].image;}
+            uint32_t getImageVersion(uint32_t textureId) const {return textures[textureId].version;}
+            uint32_t getResidentMip(uint32_t textureId) const {return textures[textureId].residentMip;}
+            size_t getTextureCount() const {return textures.size();}
+            //Device memory used by resident textures.
+            VkDeviceSize getResidentMemory() const {return residentMemory;}
+            //The budget used by the last update.
+            VkDeviceSize getCurrentBudget() const {return currentBudget;}
+
+            //Returns the height in pixels a bounding sphere covers on the screen.
+            static float calculateScreenSpaceSize(const glm::vec3 &center, float radius,
+                                                  const glm::mat4 &viewMatrix,
+                                                  const glm::mat4 &projectionMatrix,
+                                                  float viewportHeight);
+            //Returns the finest mip level worth sampling for a given on-screen size.
+            static uint32_t selectMipLevel(uint32_t width, uint32_t height,
+                                           float screenSpaceSize, uint32_t mipLevelCount);
+        private:
+            //Resources of a finished or replaced upload that the gpu may still be using.
+            struct RetiredResources
+            {
+                //The last submission that may sample the image.
+                GpuSyncPoint lastUse;
+                VulkanImage image;
+                VulkanBuffer stagingBuffer;
+                VkDeviceMemory stagingMemory;
+            };
+
+            //An upload that has been submitted but not finished yet.
+            struct PendingUpload
+            {
+                uint32_t textureId;
+                uint32_t residentMip;
+                VkDeviceSize memorySize;
+                VulkanImage image;
+                VulkanBuffer stagingBuffer;
+                VkDeviceMemory stagingMemory;
+                VkCommandBuffer cmdBuffer;
+                VkFence fence;
+            };
+
+            //Creates a new image holding the mips [residentMip, end) and submits the upload.
+            bool uploadTexture(uint32_t textureId, uint32_t residentMip);
+            //Swaps in images whose uploads have finished.
+            void completeUploads();
+            //Destroys retired resources that are no longer in use. Forced destruction skips the timeline check.
+            void releaseRetiredResources(bool force);
+            //Fills mipMemorySizes by querying the requirements of images that are never bound.
+            bool queryMemorySizes(StreamedTexture &texture) const;
+            //Returns the bytes of pixels in the mips [residentMip, end), which is what gets staged.
+            VkDeviceSize calculateUploadSize(const StreamedTexture &texture, uint32_t residentMip) const;
+            //Returns the budget for this frame, limited by VK_EXT_memory_budget when enabled.
+            VkDeviceSize queryBudget() const;
+
+            VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+            VkDevice logicalDevice = VK_NULL_HANDLE;
+            VkPhysicalDeviceMemoryProperties memoryProperties;
+            QueueSubmitter *submitter = nullptr;
+            SyncObjectPool *syncObjects = nullptr;
+            GpuTimeline *timeline = nullptr;
+            uint32_t timelineQueue = 0;
+            VkCommandPool cmdPool = VK_NULL_HANDLE;
+            bool memoryBudgetExtensionEnabled = false;
+
+            VkDeviceSize memoryBudget = 0;
+            VkDeviceSize currentBudget = 0;
+            VkDeviceSize residentMemory = 0;
+            uint64_t frameIndex = 0;
+
+            std::vector<StreamedTexture> textures;
+            std::vector<PendingUpload> pendingUploads;
+            std::vector<RetiredResources> retiredResources;
+    };
+}
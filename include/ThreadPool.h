@@ -0,0 +1,60 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Raven
+{
+    //Persistent worker threads for splitting per-frame work into chunks. Creating
+    //threads every frame costs more than most of the jobs they would run.
+    class ThreadPool
+    {
+        public:
+            ThreadPool();
+            ~ThreadPool();
+            ThreadPool(const ThreadPool&) = delete;
+            ThreadPool& operator=(const ThreadPool&) = delete;
+
+            //Starts the workers. A count of 0 uses one worker per hardware thread minus the caller.
+            bool initialize(uint32_t workerCount = 0);
+            //Stops and joins the workers.
+            void destroy();
+
+            //Runs function(begin, end) over [0, count) in chunks of chunkSize on the workers
+            //and the calling thread. Returns once every chunk has finished. Must not be
+            //called from inside a job.
+            void parallelFor(size_t count, size_t chunkSize,
+                             const std::function<void(size_t, size_t)> &function);
+
+            uint32_t getWorkerCount() const {return static_cast<uint32_t>(workers.size());}
+        private:
+            void workerLoop();
+            //Runs chunks of the current job until none are left.
+            void runChunks();
+
+            std::vector<std::thread> workers;
+            //Serializes callers of parallelFor.
+            std::mutex jobMutex;
+            //Guards the job state below and the conditions.
+            std::mutex mutex;
+            std::condition_variable wakeCondition;
+            std::condition_variable doneCondition;
+
+            const std::function<void(size_t, size_t)> *jobFunction = nullptr;
+            size_t jobCount = 0;
+            size_t jobChunkSize = 0;
+            size_t jobChunkCount = 0;
+            std::atomic<size_t> nextChunk{0};
+            std::atomic<size_t> finishedChunks{0};
+            //Incremented for every job so sleeping workers know there is new work.
+            uint64_t jobGeneration = 0;
+            //Workers currently inside runChunks.
+            uint32_t activeWorkers = 0;
+            bool stopping = false;
+    };
+}
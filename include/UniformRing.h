@@ -0,0 +1,72 @@
+#pragma once
+#include "Headers.h"
+#include "VulkanBuffer.h"
+#include "VulkanDescriptorManager.h"
+
+namespace Raven
+{
+    //Per-frame uniform data in one persistently mapped, host visible buffer. The buffer is
+    //split into a region per frame in flight and bound once as a dynamic uniform buffer.
+    //Every draw copies its block into the frame's region and passes the returned offset as
+    //the dynamic offset of bindDescriptorSets, so updating per-draw constants costs a memcpy
+    //and no api calls. A region is reused frameCount frames later, by which time the gpu
+    //must be done with it.
+    class UniformRing
+    {
+        public:
+            UniformRing();
+            ~UniformRing();
+
+            //Creates the buffer with frameCount regions of at least frameSize bytes. Every
+            //draw reads blockRange bytes from its offset.
+            bool initialize(VkDevice logicalDevice, const VkPhysicalDeviceMemoryProperties &memoryProperties,
+                            const VkPhysicalDeviceLimits &limits, VkDeviceSize frameSize, uint32_t frameCount,
+                            VkDeviceSize blockRange);
+            //Destroys the buffer. The gpu must not be using it anymore.
+            void destroy();
+
+            //Starts writing into the region of the frame, discarding what was written there before.
+            void beginFrame(uint64_t frame);
+            //Copies a block of at most blockRange bytes into the frame's region. False if the
+            //region is full.
+            bool write(const void *data, VkDeviceSize size, uint32_t &dynamicOffset);
+            template<typename T>
+            bool write(const T &block, uint32_t &dynamicOffset) {return write(&block, sizeof(T), dynamicOffset);}
+            //Makes the blocks written since the last flush visible to the device. Nothing to do
+            //with coherent memory, otherwise call before submitting the frame.
+            bool flush();
+
+            //A dynamic uniform buffer descriptor covering one block, for updateDescriptorSets.
+            BufferDescriptorInfo getDescriptorInfo(VkDescriptorSet descriptorSet, uint32_t binding) const;
+            const VulkanBuffer &getBuffer() const {return buffer;}
+            VkDeviceSize getBlockRange() const {return blockRange;}
+            VkDeviceSize getFrameStride() const {return frameStride;}
+            //Bytes written into the current frame's region, including alignment padding.
+            VkDeviceSize getFrameUsage() const {return head;}
+            bool isCoherent() const {return coherent;}
+
+            static VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment)
+            {
+                return (value + alignment - 1) / alignment * alignment;
+            }
+        private:
+            VkDevice logicalDevice = VK_NULL_HANDLE;
+            VulkanBuffer buffer;
+            VkDeviceMemory memory = VK_NULL_HANDLE;
+            uint8_t *mapped = nullptr;
+            bool coherent = false;
+
+            //Offsets are multiples of minUniformBufferOffsetAlignment and nonCoherentAtomSize, so
+            //that the flushed ranges of frames do not overlap.
+            VkDeviceSize alignment = 0;
+            VkDeviceSize atomSize = 1;
+            VkDeviceSize blockRange = 0;
+            VkDeviceSize frameStride = 0;
+            uint32_t frameCount = 0;
+
+            VkDeviceSize frameStart = 0;
+            //Write position and how far the region has been flushed, relative to frameStart.
+            VkDeviceSize head = 0;
+            VkDeviceSize flushed = 0;
+    };
+}
@@ -4,6 +4,11 @@
 #include "VulkanBuffer.h"
 #include "VulkanRenderer.h"
 #include "GraphicsObject.h"
+#include "GpuTimeline.h"
+#include "QueueSubmitter.h"
+#include "QueueScheduler.h"
+#include "DrawParameters.h"
+#include <deque>
 
 namespace Raven
 {
@@ -26,7 +31,8 @@ namespace Raven
             bool initializeDevice(VkPhysicalDevice &physicalDevice,
                                   std::vector<const char*>  &desiredExtensions);
             //Sends commands to the gpu for computing. This function also chooses the
-            //queue which the commands will be submitted to.
+            //queue which the commands will be submitted to. Work queued on the queue's
+            //submitter goes out with it.
             bool executeCommands(VkSubmitInfo &submitInfo, VkFence &submitFence);
 
             //Creates a sampled image.
@@ -131,11 +137,13 @@ namespace Raven
                                                       std::vector<std::vector<VkPipeline>> &graphicsPipelines);
 
             //Records a command buffer for drawign geometry with dynamic viewport and scissor test.
+            //The draw parameters are pushed, or written into the ring with their offset appended
+            //to dynamicOffsets, as the binding chose.
             bool recordCommandBufferForDrawingGeometry(VkCommandBuffer cmdBuffer,
                                                        VkImage swapchainImage,
                                                        uint32_t presentQueueFamilyIndex,
                                                        uint32_t graphicsQueueFamilyIndex,
-                                                       VulkanRenderer vulkanRenderer,
+                                                       VulkanRenderer &vulkanRenderer,
                                                        VkRenderPass renderPass,
                                                        VkFramebuffer framebuffer,
                                                        VkExtent2D framebufferSize,
@@ -143,24 +151,44 @@ namespace Raven
                                                        VkPipeline graphicsPipeline,
                                                        uint32_t firstVertexBufferBinding,
                                                        const std::vector<VertexBufferParameters> &bufferParams,
+                                                       VkBuffer indexBuffer,
                                                        VkPipelineLayout pipelineLayout,
                                                        const std::vector<VkDescriptorSet> &descriptorSets,
                                                        uint32_t firstDescritorSetIndex,
-                                                       GraphicsObject drawable,
+                                                       const std::vector<uint32_t> &dynamicOffsets,
+                                                       const DrawParameterBinding &drawParameterBinding,
+                                                       const DrawParameters &drawParameters,
+                                                       const GraphicsObject &drawable,
                                                        uint32_t instances,
-                                                       uint32_t firstInstance);
+                                                       uint32_t firstInstance,
+                                                       const std::vector<uint32_t> *visibleParts = nullptr);
 
             //Returns a queue family reference by index
             inline VkQueueFamilyProperties& getQueueFamily(int index){return queueFamilies[index];}
-            //Returns the queueFamilyIndex for the family that is currently used.
-            //At this point Raven only uses one queue family which supports all the possible
-            //operations. This will most probably change in the future as I experiment with
-            //different graphics cards.
+            //Returns the queueFamilyIndex of the graphics family, whose first queue is queue handle 0.
+            //The async compute and transfer families are found through the scheduler.
             inline uint32_t getPrimaryQueueFamilyIndex(){return primaryQueueFamilyIndex;}
             //Returns a reference to the logical device.
             inline VkDevice &getLogicalDevice(){return logicalDevice;}
             //Returns queue handles.
             inline std::vector<VkQueue> &getQueueHandles(){return deviceQueueHandles;}
+            //Returns the scheduler that routes graphics, async compute and transfer work to their queues.
+            inline QueueScheduler &getScheduler(){return scheduler;}
+            //Returns the submitter of a queue. Every submission to the queue should go through it.
+            inline QueueSubmitter &getQueueSubmitter(uint32_t index){return queueSubmitters[index];}
+            //Returns true if the extension was enabled when the logical device was created.
+            bool isExtensionEnabled(const char *extension) const;
+            //Returns the properties of the physical device, including its limits.
+            inline const VkPhysicalDeviceProperties &getPhysicalDeviceProperties() const {return physicalDeviceProperties;}
+            //Returns the memory types and heaps of the physical device.
+            inline const VkPhysicalDeviceMemoryProperties &getMemoryProperties() const {return physicalDeviceMemoryProperties;}
+            //Returns the features enabled on the logical device.
+            inline const VkPhysicalDeviceFeatures &getEnabledFeatures() const {return enabledFeatures;}
+            //Returns the timelines of the device queues, backed by timeline semaphores when the
+            //device supports them.
+            inline GpuTimeline &getTimeline(){return timeline;}
+            //Returns the pool of fences and binary semaphores. Collect it with every finished frame.
+            inline SyncObjectPool &getSyncObjectPool(){return syncObjects;}
         private:
             //Creates a logical device for the VulkanDevice
             bool createDevice();
@@ -171,16 +199,32 @@ namespace Raven
             VkPhysicalDevice physicalDevice;
             //Memory properties of the physical device.
             VkPhysicalDeviceMemoryProperties physicalDeviceMemoryProperties;
+            //Properties and limits of the physical device.
+            VkPhysicalDeviceProperties physicalDeviceProperties = {};
             //The logical device created under the physical device
             VkDevice logicalDevice;
             //Every queue family the physical device supports
             std::vector<VkQueueFamilyProperties> queueFamilies;
             //Device queue family indices
             uint32_t primaryQueueFamilyIndex;
+            //Family of every QueueType.
+            std::array<uint32_t, QUEUE_TYPE_COUNT> queueTypeFamilies = {};
             //A vector containing all queue family informations.
             std::vector<VulkanQueueInfo> queueFamilyInfo;
             //Holds all of the device queue handles.
             std::vector<VkQueue> deviceQueueHandles;
+            //A submitter for every queue handle. A deque since the submitters cannot be moved.
+            std::deque<QueueSubmitter> queueSubmitters;
+            //Extensions enabled on the logical device.
+            std::vector<std::string> enabledExtensions;
+            //Features enabled on the logical device.
+            VkPhysicalDeviceFeatures enabledFeatures = {};
+            //Recycled fences and semaphores, also used by the timeline.
+            SyncObjectPool syncObjects;
+            //Submission timelines of the device queues.
+            GpuTimeline timeline;
+            //Routes work to the queues by type.
+            QueueScheduler scheduler;
     };
 
 }
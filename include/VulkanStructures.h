@@ -129,10 +129,11 @@ namespace VulkanStructures
         return createInfo;
     }
 
-    inline VkSubmitInfo submitInfo(std::vector<VkCommandBuffer> cmdBuffers,
-                                   std::vector<VkSemaphore> waitSemaphores,
-                                   std::vector<VkPipelineStageFlags> waitSemaphoreStages,
-                                   std::vector<VkSemaphore> signalSemaphores)
+    //The submit info points into the vectors, so they have to outlive it.
+    inline VkSubmitInfo submitInfo(const std::vector<VkCommandBuffer> &cmdBuffers,
+                                   const std::vector<VkSemaphore> &waitSemaphores,
+                                   const std::vector<VkPipelineStageFlags> &waitSemaphoreStages,
+                                   const std::vector<VkSemaphore> &signalSemaphores)
     {
         VkSubmitInfo info = {};
         info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
@@ -398,7 +399,7 @@ namespace VulkanStructures
 
     inline VkRenderPassBeginInfo renderPassBeginInfo(VkRenderPass renderPass,
                                                      VkFramebuffer framebuffer,
-                                                     std::vector<VkClearValue> clearValues,
+                                                     const std::vector<VkClearValue> &clearValues,
                                                      VkRect2D renderArea)
     {
         VkRenderPassBeginInfo beginInfo = {};
@@ -413,7 +414,7 @@ namespace VulkanStructures
     }
 
     inline VkFramebufferCreateInfo framebufferCreateInfo(VkRenderPass renderPass,
-                                                         std::vector<VkImageView> attachments,
+                                                         const std::vector<VkImageView> &attachments,
                                                          uint32_t width,
                                                          uint32_t height,
                                                          uint32_t layers)
@@ -431,7 +432,7 @@ namespace VulkanStructures
         return createInfo;
     }
 
-    inline VkShaderModuleCreateInfo shaderModuleCreateInfo (std::vector<char> sourceCode)
+    inline VkShaderModuleCreateInfo shaderModuleCreateInfo (const std::vector<char> &sourceCode)
     {
         VkShaderModuleCreateInfo createInfo = {};
         createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
@@ -625,8 +626,8 @@ namespace VulkanStructures
     }
 
     inline VkPipelineLayoutCreateInfo
-        pipelineLayoutCreateInfo(std::vector<VkDescriptorSetLayout> descriptorSetLayouts,
-                                 std::vector<VkPushConstantRange> pushConstantRanges)
+        pipelineLayoutCreateInfo(const std::vector<VkDescriptorSetLayout> &descriptorSetLayouts,
+                                 const std::vector<VkPushConstantRange> &pushConstantRanges)
     {
         VkPipelineLayoutCreateInfo createInfo = {};
         createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
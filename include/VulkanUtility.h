@@ -2,6 +2,8 @@
 #include "Headers.h"
 #include "VulkanBuffer.h"
 #include "VulkanImage.h"
+#include "SyncObjectPool.h"
+#include "QueueSubmitter.h"
 
 //List of all vulkan utility functions used by the Raven application.
 namespace Raven
@@ -9,6 +11,10 @@ namespace Raven
     //Checks available instance extensions.
     bool checkAvailableInstanceExtensions(std::vector<VkExtensionProperties> &availableExtensions);
 
+    //Checks available physical device extensions.
+    bool checkAvailableDeviceExtensions(VkPhysicalDevice &physicalDevice,
+                                        std::vector<VkExtensionProperties> &availableExtensions);
+
     //Checks if a given extension is found in a list of extensions.
     bool isExtensionSupported(std::vector<VkExtensionProperties> &availableExtensions,
                               const char *desiredProperty);
@@ -123,13 +129,13 @@ namespace Raven
     void setBufferMemoryBarriers(VkCommandBuffer commandBuffer,
                                  const VkPipelineStageFlags generatingStages,
                                  const VkPipelineStageFlags consumingStages,
-                                 std::vector<BufferTransition> bufferTransitions) noexcept;
+                                 const std::vector<BufferTransition> &bufferTransitions) noexcept;
 
     //Sets image memory barriers.
     void setImageMemoryBarriers(VkCommandBuffer commandBuffer,
                                 const VkPipelineStageFlags generatingStages,
                                 const VkPipelineStageFlags consumingStages,
-                                std::vector<ImageTransition> imageTransitions) noexcept;
+                                const std::vector<ImageTransition> &imageTransitions) noexcept;
 
     //Makes the application wait until the selected device is idle.
     bool waitUntilDeviceIdle(VkDevice &logicalDevice);
@@ -226,8 +232,9 @@ namespace Raven
                                        VkAccessFlags destinationBufferNewAccess,
                                        VkPipelineStageFlags destinationBufferGeneratingStages,
                                        VkPipelineStageFlags destinationBufferConsumingStages,
-                                       VkQueue queue,
+                                       QueueSubmitter &submitter,
                                        VkCommandBuffer cmdBuffer,
+                                       SyncObjectPool &syncObjects,
                                        std::vector<VkSemaphore> signalSemaphores);
 
     //Updates an image that is using device-local memory.
@@ -275,6 +282,11 @@ namespace Raven
                             std::vector<char> sourceCode,
                             VkShaderModule &module) noexcept;
 
+    //Reads a SPIR-V file and creates a shader module from it.
+    bool loadShaderModule(const VkDevice logicalDevice,
+                          const std::string &filename,
+                          VkShaderModule &module) noexcept;
+
     //Destroys a shader module
     void destroyShaderModule(const VkDevice logicalDevice, VkShaderModule &shaderModule) noexcept;
 
@@ -331,4 +343,14 @@ namespace Raven
 
     //Sets dynamic scissors.
     void setScissorState(VkCommandBuffer cmdBuffer, uint32_t firstScissor, const std::vector<VkRect2D> &scissors);
+
+    //Returns a handle as an integer, e.g. for hashing or sorting. Non-dispatchable handles
+    //are pointers or 64-bit integers depending on the platform.
+    template<typename Handle>
+    uint64_t handleValue(Handle handle)
+    {
+        uint64_t value = 0;
+        std::memcpy(&value, &handle, sizeof(handle));
+        return value;
+    }
 }
@@ -0,0 +1,506 @@
+#include "AssetArchive.h"
+#include "Compression.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#if defined _WIN32
+    #ifndef NOMINMAX
+        #define NOMINMAX
+    #endif
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+namespace Raven
+{
+    /**
+     * @brief Hashes an asset name with 64-bit FNV-1a.
+     * @param name
+     * @return The name hash.
+     */
+    uint64_t hashAssetName(const std::string &name) noexcept
+    {
+        uint64_t hash = 14695981039346656037ull;
+        for(unsigned char character : name)
+        {
+            hash ^= character;
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    AssetArchive::AssetArchive()
+    {
+
+    }
+
+    AssetArchive::~AssetArchive()
+    {
+        close();
+    }
+
+    /**
+     * @brief Maps the pack file into memory and validates the header and the table of contents.
+     * @param filename
+     * @return False if the file could not be mapped or it is not a valid pack.
+     */
+    bool AssetArchive::open(const std::string &filename)
+    {
+        close();
+
+#if defined _WIN32
+        HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                                  OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if(file == INVALID_HANDLE_VALUE)
+            return false;
+
+        LARGE_INTEGER fileSize;
+        if(!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+        {
+            CloseHandle(file);
+            std::cerr << "Failed to read asset archive size!" << std::endl;
+            return false;
+        }
+
+        HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if(mapping == nullptr)
+        {
+            CloseHandle(file);
+            std::cerr << "Failed to create asset archive file mapping!" << std::endl;
+            return false;
+        }
+
+        void *view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        if(view == nullptr)
+        {
+            CloseHandle(mapping);
+            CloseHandle(file);
+            std::cerr << "Failed to map asset archive into memory!" << std::endl;
+            return false;
+        }
+
+        fileHandle = file;
+        mappingHandle = mapping;
+        mappedData = static_cast<const char*>(view);
+        mappedSize = static_cast<size_t>(fileSize.QuadPart);
+#else
+        int file = ::open(filename.c_str(), O_RDONLY);
+        if(file < 0)
+            return false;
+
+        struct stat fileStatus;
+        if(fstat(file, &fileStatus) != 0 || fileStatus.st_size == 0)
+        {
+            ::close(file);
+            std::cerr << "Failed to read asset archive size!" << std::endl;
+            return false;
+        }
+
+        void *view = mmap(nullptr, static_cast<size_t>(fileStatus.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+        //The mapping keeps its own reference to the file.
+        ::close(file);
+        if(view == MAP_FAILED)
+        {
+            std::cerr << "Failed to map asset archive into memory!" << std::endl;
+            return false;
+        }
+
+        mappedData = static_cast<const char*>(view);
+        mappedSize = static_cast<size_t>(fileStatus.st_size);
+        //The table of contents is read front to back on lookups, let the kernel prefetch it.
+        madvise(view, mappedSize, MADV_WILLNEED);
+#endif
+
+        //Validate the header.
+        if(mappedSize < sizeof(AssetArchiveHeader))
+        {
+            std::cerr << "Failed to open asset archive, the file is too small!" << std::endl;
+            close();
+            return false;
+        }
+
+        AssetArchiveHeader header;
+        std::memcpy(&header, mappedData, sizeof(header));
+        if(std::memcmp(header.magic, ASSET_ARCHIVE_MAGIC, 4) != 0 ||
+           header.version != ASSET_ARCHIVE_VERSION)
+        {
+            std::cerr << "Failed to open asset archive, unknown file format or version!" << std::endl;
+            close();
+            return false;
+        }
+
+        uint64_t tableSize = uint64_t(header.entryCount) * sizeof(AssetArchiveEntry);
+        if(header.tableOffset % alignof(AssetArchiveEntry) != 0 ||
+           header.tableOffset > mappedSize || tableSize > mappedSize - header.tableOffset ||
+           header.stringTableOffset > mappedSize || header.stringTableSize > mappedSize - header.stringTableOffset)
+        {
+            std::cerr << "Failed to open asset archive, the table of contents is corrupted!" << std::endl;
+            close();
+            return false;
+        }
+
+        entries = reinterpret_cast<const AssetArchiveEntry*>(mappedData + header.tableOffset);
+        stringTable = mappedData + header.stringTableOffset;
+        entryCount = header.entryCount;
+
+        //Check every entry once so lookups can trust the offsets.
+        for(uint32_t i = 0; i < entryCount; ++i)
+        {
+            const AssetArchiveEntry &entry = entries[i];
+            bool valid = entry.dataOffset <= mappedSize &&
+                         entry.storedSize <= mappedSize - entry.dataOffset &&
+                         uint64_t(entry.nameOffset) + entry.nameLength <= header.stringTableSize &&
+                         (i == 0 || entries[i - 1].nameHash <= entry.nameHash);
+
+            if(entry.compression == static_cast<uint32_t>(AssetCompression::None))
+                valid = valid && entry.storedSize == entry.originalSize;
+            else if(entry.compression != static_cast<uint32_t>(AssetCompression::LZ4) &&
+                    entry.compression != static_cast<uint32_t>(AssetCompression::Zstd))
+                valid = false;
+
+            if(!valid)
+            {
+                std::cerr << "Failed to open asset archive, entry " << i << " is corrupted!" << std::endl;
+                close();
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * @brief Unmaps the pack and releases all decompressed entries.
+     */
+    void AssetArchive::close()
+    {
+        {
+            std::lock_guard<std::mutex> lock(decompressedEntriesMutex);
+            decompressedEntries.clear();
+        }
+
+        if(mappedData != nullptr)
+        {
+#if defined _WIN32
+            UnmapViewOfFile(mappedData);
+#else
+            munmap(const_cast<char*>(mappedData), mappedSize);
+#endif
+        }
+#if defined _WIN32
+        if(mappingHandle != nullptr)
+            CloseHandle(static_cast<HANDLE>(mappingHandle));
+        if(fileHandle != nullptr)
+            CloseHandle(static_cast<HANDLE>(fileHandle));
+#endif
+        mappingHandle = nullptr;
+        fileHandle = nullptr;
+        mappedData = nullptr;
+        mappedSize = 0;
+        entries = nullptr;
+        stringTable = nullptr;
+        entryCount = 0;
+    }
+
+    /**
+     * @brief Finds a table of contents entry by binary searching the sorted name hashes.
+     *        Hash collisions are resolved by comparing the stored names.
+     * @param name
+     * @return The entry or nullptr if the archive does not hold the name.
+     */
+    const AssetArchiveEntry* AssetArchive::findEntry(const std::string &name) const
+    {
+        if(entries == nullptr)
+            return nullptr;
+
+        uint64_t hash = hashAssetName(name);
+        const AssetArchiveEntry *end = entries + entryCount;
+        const AssetArchiveEntry *entry =
+                std::lower_bound(entries, end, hash,
+                                 [](const AssetArchiveEntry &e, uint64_t value){return e.nameHash < value;});
+
+        for(; entry != end && entry->nameHash == hash; ++entry)
+        {
+            if(entry->nameLength == name.size() &&
+               std::memcmp(stringTable + entry->nameOffset, name.data(), name.size()) == 0)
+                return entry;
+        }
+        return nullptr;
+    }
+
+    /**
+     * @brief Checks if the archive holds an entry with the given name.
+     * @param name
+     * @return True if the entry exists.
+     */
+    bool AssetArchive::contains(const std::string &name) const
+    {
+        return findEntry(name) != nullptr;
+    }
+
+    /**
+     * @brief Decompresses an entry into memory that holds at least entry.originalSize bytes.
+     * @param entry
+     * @param destination
+     * @return False if the codec is not supported or the data is corrupted.
+     */
+    bool AssetArchive::decompressEntry(const AssetArchiveEntry &entry, char *destination) const
+    {
+        const char *source = mappedData + entry.dataOffset;
+        switch(static_cast<AssetCompression>(entry.compression))
+        {
+            case AssetCompression::None:
+                std::memcpy(destination, source, static_cast<size_t>(entry.originalSize));
+                return true;
+            case AssetCompression::LZ4:
+                return Compression::decompressLZ4(source, static_cast<size_t>(entry.storedSize),
+                                                  destination, static_cast<size_t>(entry.originalSize));
+            default:
+                std::cerr << "Failed to decompress asset, the compression codec is not supported!" << std::endl;
+                return false;
+        }
+    }
+
+    /**
+     * @brief Returns a view to the uncompressed bytes of an entry. Uncompressed entries point
+     *        straight into the mapped file, compressed ones into a cache owned by the archive.
+     * @param name
+     * @param asset
+     * @return False if the entry does not exist or could not be decompressed.
+     */
+    bool AssetArchive::getAsset(const std::string &name, AssetSpan &asset)
+    {
+        const AssetArchiveEntry *entry = findEntry(name);
+        if(entry == nullptr)
+            return false;
+
+        if(entry->compression == static_cast<uint32_t>(AssetCompression::None))
+        {
+            asset.data = mappedData + entry->dataOffset;
+            asset.size = static_cast<size_t>(entry->originalSize);
+            return true;
+        }
+
+        uint32_t index = static_cast<uint32_t>(entry - entries);
+        std::lock_guard<std::mutex> lock(decompressedEntriesMutex);
+        auto cached = decompressedEntries.find(index);
+        if(cached == decompressedEntries.end())
+        {
+            std::unique_ptr<std::vector<char>> data(new std::vector<char>(static_cast<size_t>(entry->originalSize)));
+            if(!decompressEntry(*entry, data->data()))
+                return false;
+            cached = decompressedEntries.emplace(index, std::move(data)).first;
+        }
+
+        asset.data = cached->second->data();
+        asset.size = cached->second->size();
+        return true;
+    }
+
+    /**
+     * @brief Copies the uncompressed bytes of an entry into a vector. Does not populate the
+     *        decompression cache, use this for data that is consumed once.
+     * @param name
+     * @param data
+     * @return False if the entry does not exist or could not be decompressed.
+     */
+    bool AssetArchive::readAsset(const std::string &name, std::vector<char> &data)
+    {
+        const AssetArchiveEntry *entry = findEntry(name);
+        if(entry == nullptr)
+            return false;
+
+        data.resize(static_cast<size_t>(entry->originalSize));
+        if(!decompressEntry(*entry, data.data()))
+        {
+            data.clear();
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Returns the name of an entry by its table of contents index.
+     * @param index
+     * @return The entry name or an empty string if the index is out of range.
+     */
+    std::string AssetArchive::getEntryName(uint32_t index) const
+    {
+        if(index >= entryCount)
+            return std::string();
+        return std::string(stringTable + entries[index].nameOffset, entries[index].nameLength);
+    }
+
+    AssetArchiveWriter::AssetArchiveWriter(uint32_t alignment)
+        : alignment(alignment < alignof(AssetArchiveEntry) ? uint32_t(alignof(AssetArchiveEntry)) : alignment)
+    {
+
+    }
+
+    /**
+     * @brief Adds an entry from memory to the pack. If compression does not make the
+     *        entry smaller it is stored uncompressed so reads can use the mapping directly.
+     * @param name
+     * @param data
+     * @param size
+     * @param compression
+     * @return False if the name is already in use or the compression fails.
+     */
+    bool AssetArchiveWriter::addData(const std::string &name, const char *data, size_t size,
+                                     AssetCompression compression)
+    {
+        for(const PendingEntry &entry : pendingEntries)
+        {
+            if(entry.name == name)
+            {
+                std::cerr << "Failed to add asset " << name << ", the name is already in use!" << std::endl;
+                return false;
+            }
+        }
+
+        PendingEntry entry;
+        entry.name = name;
+        entry.nameHash = hashAssetName(name);
+        entry.originalSize = size;
+        entry.compression = AssetCompression::None;
+
+        if(compression == AssetCompression::LZ4)
+        {
+            if(!Compression::compressLZ4(data, size, entry.storedData))
+                return false;
+            if(entry.storedData.size() < size)
+                entry.compression = AssetCompression::LZ4;
+        }
+        else if(compression == AssetCompression::Zstd)
+        {
+            std::cerr << "Zstd compression is not supported, storing " << name << " uncompressed." << std::endl;
+        }
+
+        if(entry.compression == AssetCompression::None)
+            entry.storedData.assign(data, data + size);
+
+        pendingEntries.push_back(std::move(entry));
+        return true;
+    }
+
+    /**
+     * @brief Reads a file from the disk and adds it to the pack.
+     * @param name
+     * @param filename
+     * @param compression
+     * @return False if the file could not be read or added.
+     */
+    bool AssetArchiveWriter::addFile(const std::string &name, const std::string &filename,
+                                     AssetCompression compression)
+    {
+        std::ifstream file(filename, std::ios::ate | std::ios::binary);
+        if(!file.is_open())
+        {
+            std::cerr << "Failed to open " << filename << " for packing!" << std::endl;
+            return false;
+        }
+
+        std::vector<char> contents(static_cast<size_t>(file.tellg()));
+        file.seekg(0);
+        file.read(contents.data(), contents.size());
+        if(!file)
+        {
+            std::cerr << "Failed to read " << filename << " for packing!" << std::endl;
+            return false;
+        }
+        return addData(name, contents.data(), contents.size(), compression);
+    }
+
+    /**
+     * @brief Writes the pack. The table of contents is sorted by name hash and the entry data
+     *        is laid out in the same order so a cold start reads the file sequentially.
+     * @param filename
+     * @return False if the file could not be written.
+     */
+    bool AssetArchiveWriter::write(const std::string &filename) const
+    {
+        std::vector<const PendingEntry*> sortedEntries;
+        sortedEntries.reserve(pendingEntries.size());
+        for(const PendingEntry &entry : pendingEntries)
+            sortedEntries.push_back(&entry);
+        std::sort(sortedEntries.begin(), sortedEntries.end(),
+                  [](const PendingEntry *a, const PendingEntry *b)
+                  {
+                      return a->nameHash != b->nameHash ? a->nameHash < b->nameHash : a->name < b->name;
+                  });
+
+        auto alignUp = [this](uint64_t value){return (value + alignment - 1) / alignment * alignment;};
+
+        AssetArchiveHeader header = {};
+        std::memcpy(header.magic, ASSET_ARCHIVE_MAGIC, 4);
+        header.version = ASSET_ARCHIVE_VERSION;
+        header.entryCount = static_cast<uint32_t>(sortedEntries.size());
+        header.alignment = alignment;
+        header.tableOffset = sizeof(AssetArchiveHeader);
+        header.stringTableOffset = header.tableOffset + sortedEntries.size() * sizeof(AssetArchiveEntry);
+
+        std::vector<AssetArchiveEntry> table(sortedEntries.size());
+        std::string strings;
+        for(size_t i = 0; i < sortedEntries.size(); ++i)
+        {
+            table[i].nameHash = sortedEntries[i]->nameHash;
+            table[i].nameOffset = static_cast<uint32_t>(strings.size());
+            table[i].nameLength = static_cast<uint32_t>(sortedEntries[i]->name.size());
+            table[i].compression = static_cast<uint32_t>(sortedEntries[i]->compression);
+            table[i].storedSize = sortedEntries[i]->storedData.size();
+            table[i].originalSize = sortedEntries[i]->originalSize;
+            strings += sortedEntries[i]->name;
+        }
+        header.stringTableSize = strings.size();
+        header.dataOffset = alignUp(header.stringTableOffset + header.stringTableSize);
+
+        uint64_t offset = header.dataOffset;
+        for(AssetArchiveEntry &entry : table)
+        {
+            entry.dataOffset = offset;
+            offset = alignUp(offset + entry.storedSize);
+        }
+
+        std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+        if(!file.is_open())
+        {
+            std::cerr << "Failed to open " << filename << " for writing!" << std::endl;
+            return false;
+        }
+
+        const char padding[256] = {};
+        auto writePadding = [&](uint64_t target)
+        {
+            uint64_t position = static_cast<uint64_t>(file.tellp());
+            while(position < target)
+            {
+                uint64_t count = std::min<uint64_t>(target - position, sizeof(padding));
+                file.write(padding, static_cast<std::streamsize>(count));
+                position += count;
+            }
+        };
+
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(table.data()),
+                   static_cast<std::streamsize>(table.size() * sizeof(AssetArchiveEntry)));
+        file.write(strings.data(), static_cast<std::streamsize>(strings.size()));
+        for(size_t i = 0; i < sortedEntries.size(); ++i)
+        {
+            writePadding(table[i].dataOffset);
+            file.write(sortedEntries[i]->storedData.data(),
+                       static_cast<std::streamsize>(sortedEntries[i]->storedData.size()));
+        }
+
+        if(!file)
+        {
+            std::cerr << "Failed to write asset archive " << filename << "!" << std::endl;
+            return false;
+        }
+        return true;
+    }
+}
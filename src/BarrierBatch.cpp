@@ -0,0 +1,140 @@
+#include "BarrierBatch.h"
+#include "VulkanStructures.h"
+
+namespace Raven
+{
+    BarrierBatch::BarrierBatch(VkCommandBuffer cmdBuffer) : cmdBuffer(cmdBuffer)
+    {
+
+    }
+
+    BarrierBatch::~BarrierBatch()
+    {
+        flush();
+    }
+
+    /**
+     * @brief Adds a buffer barrier. The same transition of the same range is only added once.
+     * @param generatingStages Stages that have been using the buffer so far.
+     * @param consumingStages Stages that will use the buffer after the barrier.
+     * @param transition
+     * @param offset
+     * @param size
+     */
+    void BarrierBatch::addBuffer(VkPipelineStageFlags generatingStages, VkPipelineStageFlags consumingStages,
+                                 const BufferTransition &transition, VkDeviceSize offset, VkDeviceSize size)
+    {
+        for(uint32_t i = 0; i < bufferCount; ++i)
+        {
+            VkBufferMemoryBarrier &barrier = buffers[i];
+            if(barrier.buffer != transition.buffer)
+                continue;
+            if(barrier.offset == offset && barrier.size == size &&
+               barrier.srcQueueFamilyIndex == transition.currentQueueFamily &&
+               barrier.dstQueueFamilyIndex == transition.newQueueFamily)
+            {
+                barrier.srcAccessMask |= transition.currentAccess;
+                barrier.dstAccessMask |= transition.newAccess;
+                this->generatingStages |= generatingStages;
+                this->consumingStages |= consumingStages;
+                return;
+            }
+            flush();
+            break;
+        }
+
+        if(bufferCount == buffers.size())
+            flush();
+        buffers[bufferCount++] = VulkanStructures::bufferMemoryBarrier(transition.currentAccess, transition.newAccess,
+                                                                       transition.currentQueueFamily,
+                                                                       transition.newQueueFamily, transition.buffer,
+                                                                       offset, size);
+        this->generatingStages |= generatingStages;
+        this->consumingStages |= consumingStages;
+    }
+
+    /**
+     * @brief Adds an image barrier for all mip levels and layers. The same transition of the
+     *        same image is only added once.
+     * @param generatingStages Stages that have been using the image so far.
+     * @param consumingStages Stages that will use the image after the barrier.
+     * @param transition
+     */
+    void BarrierBatch::addImage(VkPipelineStageFlags generatingStages, VkPipelineStageFlags consumingStages,
+                                const ImageTransition &transition)
+    {
+        for(uint32_t i = 0; i < imageCount; ++i)
+        {
+            VkImageMemoryBarrier &barrier = images[i];
+            if(barrier.image != transition.image)
+                continue;
+            if(barrier.subresourceRange.aspectMask == transition.aspect &&
+               barrier.oldLayout == transition.currentLayout && barrier.newLayout == transition.newLayout &&
+               barrier.srcQueueFamilyIndex == transition.currentQueueFamily &&
+               barrier.dstQueueFamilyIndex == transition.newQueueFamily)
+            {
+                barrier.srcAccessMask |= transition.currentAccess;
+                barrier.dstAccessMask |= transition.newAccess;
+                this->generatingStages |= generatingStages;
+                this->consumingStages |= consumingStages;
+                return;
+            }
+            flush();
+            break;
+        }
+
+        if(imageCount == images.size())
+            flush();
+        images[imageCount++] = VulkanStructures::imageMemoryBarrier(transition.image, transition.currentAccess,
+                                                                    transition.newAccess,
+                                                                    transition.currentQueueFamily,
+                                                                    transition.newQueueFamily,
+                                                                    transition.currentLayout, transition.newLayout,
+                                                                    {
+                                                                        transition.aspect,
+                                                                        0,
+                                                                        VK_REMAINING_MIP_LEVELS,
+                                                                        0,
+                                                                        VK_REMAINING_ARRAY_LAYERS
+                                                                    });
+        this->generatingStages |= generatingStages;
+        this->consumingStages |= consumingStages;
+    }
+
+    void BarrierBatch::addMemory(VkPipelineStageFlags generatingStages, VkPipelineStageFlags consumingStages,
+                                 VkAccessFlags currentAccess, VkAccessFlags newAccess)
+    {
+        this->generatingStages |= generatingStages;
+        this->consumingStages |= consumingStages;
+        this->currentAccess |= currentAccess;
+        this->newAccess |= newAccess;
+    }
+
+    void BarrierBatch::flush()
+    {
+        if(isEmpty())
+            return;
+
+        //Stage masks of a pipeline barrier may not be empty.
+        VkPipelineStageFlags srcStages = generatingStages != 0 ? generatingStages :
+                                         static_cast<VkPipelineStageFlags>(VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
+        VkPipelineStageFlags dstStages = consumingStages != 0 ? consumingStages :
+                                         static_cast<VkPipelineStageFlags>(VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT);
+        VkMemoryBarrier memoryBarrier = {};
+        memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        memoryBarrier.pNext = nullptr;
+        memoryBarrier.srcAccessMask = currentAccess;
+        memoryBarrier.dstAccessMask = newAccess;
+        bool hasMemoryBarrier = currentAccess != 0 || newAccess != 0;
+        vkCmdPipelineBarrier(cmdBuffer, srcStages, dstStages, 0,
+                             hasMemoryBarrier ? 1 : 0, hasMemoryBarrier ? &memoryBarrier : nullptr,
+                             bufferCount, buffers.data(), imageCount, images.data());
+
+        generatingStages = 0;
+        consumingStages = 0;
+        currentAccess = 0;
+        newAccess = 0;
+        bufferCount = 0;
+        imageCount = 0;
+    }
+}
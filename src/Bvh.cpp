@@ -0,0 +1,509 @@
+#include "Bvh.h"
+#include <algorithm>
+#include <limits>
+#include <numeric>
+
+static_assert(sizeof(Raven::BvhNode) == 32, "Two BVH nodes have to fit into a cache line.");
+
+namespace Raven
+{
+    namespace
+    {
+        const float INFINITE_DISTANCE = std::numeric_limits<float>::infinity();
+
+        float surfaceArea(const glm::vec3 &min, const glm::vec3 &max)
+        {
+            glm::vec3 extent = max - min;
+            return 2.0f * (extent.x * extent.y + extent.y * extent.z + extent.z * extent.x);
+        }
+
+        //Returns true if the box is outside of a plane, otherwise clears the bits of the planes
+        //the box is completely in front of.
+        bool isOutsideFrustum(const Frustum &frustum, const float *min, const float *max, uint32_t &planeMask)
+        {
+            for(uint32_t p = 0; p < 6; ++p)
+            {
+                if(!(planeMask & (1u << p)))
+                    continue;
+
+                //The corner furthest along the normal decides if the box is outside, the
+                //opposite corner if it is completely inside.
+                const glm::vec4 &plane = frustum.planes[p];
+                float farthest = plane.w + plane.x * (plane.x >= 0.0f ? max[0] : min[0]) +
+                                           plane.y * (plane.y >= 0.0f ? max[1] : min[1]) +
+                                           plane.z * (plane.z >= 0.0f ? max[2] : min[2]);
+                if(farthest < 0.0f)
+                    return true;
+                float nearest = plane.w + plane.x * (plane.x >= 0.0f ? min[0] : max[0]) +
+                                          plane.y * (plane.y >= 0.0f ? min[1] : max[1]) +
+                                          plane.z * (plane.z >= 0.0f ? min[2] : max[2]);
+                if(nearest >= 0.0f)
+                    planeMask &= ~(1u << p);
+            }
+            return false;
+        }
+
+        bool overlaps(const float *min, const float *max, const BvhBounds &bounds)
+        {
+            return min[0] <= bounds.max.x && max[0] >= bounds.min.x &&
+                   min[1] <= bounds.max.y && max[1] >= bounds.min.y &&
+                   min[2] <= bounds.max.z && max[2] >= bounds.min.z;
+        }
+
+        //Distance at which the ray enters the box, infinity if it misses it.
+        float intersectRay(const glm::vec3 &origin, const glm::vec3 &inverseDirection,
+                           const float *min, const float *max)
+        {
+            float entry = 0.0f;
+            float exit = INFINITE_DISTANCE;
+            for(int axis = 0; axis < 3; ++axis)
+            {
+                float t0 = (min[axis] - origin[axis]) * inverseDirection[axis];
+                float t1 = (max[axis] - origin[axis]) * inverseDirection[axis];
+                entry = std::max(entry, std::min(t0, t1));
+                exit = std::min(exit, std::max(t0, t1));
+            }
+            return entry <= exit ? entry : INFINITE_DISTANCE;
+        }
+    }
+
+    Bvh::Bvh()
+    {
+
+    }
+
+    Bvh::~Bvh()
+    {
+
+    }
+
+    /**
+     * @brief Builds the tree from scratch over the boxes.
+     * @param primitiveBounds
+     */
+    void Bvh::build(const std::vector<BvhBounds> &primitiveBounds)
+    {
+        this->primitiveBounds = primitiveBounds;
+        size_t count = primitiveBounds.size();
+        centroids.resize(count);
+        for(size_t i = 0; i < count; ++i)
+            centroids[i] = 0.5f * (primitiveBounds[i].min + primitiveBounds[i].max);
+        primitiveIndices.resize(count);
+        std::iota(primitiveIndices.begin(), primitiveIndices.end(), 0);
+
+        nodes.clear();
+        builtCost = 0.0f;
+        if(count == 0)
+            return;
+
+        //A binary tree with n leaves has at most 2n - 1 nodes.
+        nodes.reserve(2 * count - 1);
+        BvhNode root = {};
+        root.leftOrFirst = 0;
+        root.count = static_cast<uint32_t>(count);
+        nodes.push_back(root);
+        updateNodeBounds(0);
+        subdivide(0, 0);
+        builtCost = computeCost();
+    }
+
+    void Bvh::setPrimitiveBounds(uint32_t primitive, const BvhBounds &bounds)
+    {
+        primitiveBounds[primitive] = bounds;
+        centroids[primitive] = 0.5f * (bounds.min + bounds.max);
+    }
+
+    /**
+     * @brief Refits the nodes bottom up. Children are always stored after their parent, so
+     *        walking the nodes backwards visits the children first.
+     */
+    void Bvh::refit()
+    {
+        for(size_t i = nodes.size(); i-- > 0;)
+        {
+            BvhNode &node = nodes[i];
+            if(node.count > 0)
+            {
+                updateNodeBounds(static_cast<uint32_t>(i));
+                continue;
+            }
+
+            const BvhNode &left = nodes[node.leftOrFirst];
+            const BvhNode &right = nodes[node.leftOrFirst + 1];
+            for(int axis = 0; axis < 3; ++axis)
+            {
+                node.min[axis] = std::min(left.min[axis], right.min[axis]);
+                node.max[axis] = std::max(left.max[axis], right.max[axis]);
+            }
+        }
+    }
+
+    bool Bvh::needsRebuild() const
+    {
+        return builtCost > 0.0f && computeCost() > builtCost * BVH_REBUILD_COST_RATIO;
+    }
+
+    /**
+     * @brief Walks the tree and tests each node against the planes its parent was not
+     *        completely in front of. Everything below a node that is inside all of them is
+     *        collected without further plane tests.
+     * @param frustum
+     * @param results Receives the primitive ids, cleared first.
+     */
+    void Bvh::queryFrustum(const Frustum &frustum, std::vector<uint32_t> &results) const
+    {
+        results.clear();
+        if(nodes.empty())
+            return;
+
+        struct StackEntry
+        {
+            uint32_t node;
+            uint32_t planeMask;
+        };
+        StackEntry stack[BVH_MAX_DEPTH];
+        uint32_t stackSize = 0;
+        stack[stackSize++] = {0, 0x3F};
+        while(stackSize > 0)
+        {
+            StackEntry entry = stack[--stackSize];
+            const BvhNode &node = nodes[entry.node];
+            uint32_t planeMask = entry.planeMask;
+            if(planeMask != 0 && isOutsideFrustum(frustum, node.min, node.max, planeMask))
+                continue;
+
+            if(node.count == 0)
+            {
+                stack[stackSize++] = {node.leftOrFirst + 1, planeMask};
+                stack[stackSize++] = {node.leftOrFirst, planeMask};
+                continue;
+            }
+
+            for(uint32_t i = 0; i < node.count; ++i)
+            {
+                uint32_t primitive = primitiveIndices[node.leftOrFirst + i];
+                uint32_t primitiveMask = planeMask;
+                const BvhBounds &bounds = primitiveBounds[primitive];
+                if(primitiveMask == 0 || !isOutsideFrustum(frustum, &bounds.min.x, &bounds.max.x, primitiveMask))
+                    results.push_back(primitive);
+            }
+        }
+    }
+
+    /**
+     * @brief Collects the primitives whose boxes overlap the given box.
+     * @param bounds
+     * @param results Receives the primitive ids, cleared first.
+     */
+    void Bvh::queryOverlap(const BvhBounds &bounds, std::vector<uint32_t> &results) const
+    {
+        results.clear();
+        if(nodes.empty())
+            return;
+
+        uint32_t stack[BVH_MAX_DEPTH];
+        uint32_t stackSize = 0;
+        stack[stackSize++] = 0;
+        while(stackSize > 0)
+        {
+            const BvhNode &node = nodes[stack[--stackSize]];
+            if(!overlaps(node.min, node.max, bounds))
+                continue;
+
+            if(node.count == 0)
+            {
+                stack[stackSize++] = node.leftOrFirst + 1;
+                stack[stackSize++] = node.leftOrFirst;
+                continue;
+            }
+
+            for(uint32_t i = 0; i < node.count; ++i)
+            {
+                uint32_t primitive = primitiveIndices[node.leftOrFirst + i];
+                const BvhBounds &primitiveBox = primitiveBounds[primitive];
+                if(overlaps(&primitiveBox.min.x, &primitiveBox.max.x, bounds))
+                    results.push_back(primitive);
+            }
+        }
+    }
+
+    /**
+     * @brief Casts a ray against the primitive boxes. The nearer child is visited first and
+     *        nodes behind the closest hit so far are skipped.
+     * @param origin
+     * @param direction Does not have to be normalized, distances are in units of its length.
+     * @param maxDistance
+     * @param hitPrimitive Id of the primitive that was hit.
+     * @param hitDistance Distance at which the ray enters the primitive's box, 0 if it starts inside.
+     * @return False if no box is hit within maxDistance.
+     */
+    bool Bvh::raycast(const glm::vec3 &origin, const glm::vec3 &direction, float maxDistance,
+                      uint32_t &hitPrimitive, float &hitDistance) const
+    {
+        if(nodes.empty())
+            return false;
+
+        glm::vec3 inverseDirection(1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z);
+        float closest = maxDistance;
+        bool hit = false;
+
+        struct StackEntry
+        {
+            uint32_t node;
+            float distance;
+        };
+        StackEntry stack[BVH_MAX_DEPTH];
+        uint32_t stackSize = 0;
+        float rootDistance = intersectRay(origin, inverseDirection, nodes[0].min, nodes[0].max);
+        if(rootDistance <= closest)
+            stack[stackSize++] = {0, rootDistance};
+
+        while(stackSize > 0)
+        {
+            StackEntry entry = stack[--stackSize];
+            if(entry.distance > closest)
+                continue;
+
+            const BvhNode &node = nodes[entry.node];
+            if(node.count > 0)
+            {
+                for(uint32_t i = 0; i < node.count; ++i)
+                {
+                    uint32_t primitive = primitiveIndices[node.leftOrFirst + i];
+                    const BvhBounds &bounds = primitiveBounds[primitive];
+                    float distance = intersectRay(origin, inverseDirection, &bounds.min.x, &bounds.max.x);
+                    if(distance <= closest && (!hit || distance < closest))
+                    {
+                        closest = distance;
+                        hitPrimitive = primitive;
+                        hit = true;
+                    }
+                }
+                continue;
+            }
+
+            uint32_t near = node.leftOrFirst;
+            uint32_t far = node.leftOrFirst + 1;
+            float nearDistance = intersectRay(origin, inverseDirection, nodes[near].min, nodes[near].max);
+            float farDistance = intersectRay(origin, inverseDirection, nodes[far].min, nodes[far].max);
+            if(farDistance < nearDistance)
+            {
+                std::swap(near, far);
+                std::swap(nearDistance, farDistance);
+            }
+            //The nearer child goes on top of the stack.
+            if(farDistance <= closest)
+                stack[stackSize++] = {far, farDistance};
+            if(nearDistance <= closest)
+                stack[stackSize++] = {near, nearDistance};
+        }
+
+        if(hit)
+            hitDistance = closest;
+        return hit;
+    }
+
+    /**
+     * @brief Transforms a box by projecting the matrix columns onto its extents (Arvo), which
+     *        gives the tightest box around the transformed corners without transforming them.
+     * @param modelMatrix
+     * @param bounds
+     * @return World space box.
+     */
+    BvhBounds Bvh::transformBounds(const glm::mat4 &modelMatrix, const MeshBounds &bounds)
+    {
+        BvhBounds result;
+        for(int row = 0; row < 3; ++row)
+        {
+            result.min[row] = modelMatrix[3][row];
+            result.max[row] = modelMatrix[3][row];
+            for(int column = 0; column < 3; ++column)
+            {
+                float a = modelMatrix[column][row] * bounds.min[column];
+                float b = modelMatrix[column][row] * bounds.max[column];
+                result.min[row] += std::min(a, b);
+                result.max[row] += std::max(a, b);
+            }
+        }
+        return result;
+    }
+
+    /**
+     * @brief Looks for the cheapest split along every axis by sorting the centroids into
+     *        bins. A node stays a leaf when splitting would cost more than testing all of its
+     *        primitives, unless it has more than BVH_MAX_LEAF_SIZE of them.
+     * @param nodeIndex
+     * @param depth
+     */
+    void Bvh::subdivide(uint32_t nodeIndex, uint32_t depth)
+    {
+        uint32_t first = nodes[nodeIndex].leftOrFirst;
+        uint32_t count = nodes[nodeIndex].count;
+        //The traversal stacks hold one entry per level.
+        if(count <= 1 || depth + 2 >= BVH_MAX_DEPTH)
+            return;
+
+        glm::vec3 centroidMin = centroids[primitiveIndices[first]];
+        glm::vec3 centroidMax = centroidMin;
+        for(uint32_t i = 1; i < count; ++i)
+        {
+            const glm::vec3 &centroid = centroids[primitiveIndices[first + i]];
+            centroidMin = glm::vec3(std::min(centroidMin.x, centroid.x), std::min(centroidMin.y, centroid.y),
+                                    std::min(centroidMin.z, centroid.z));
+            centroidMax = glm::vec3(std::max(centroidMax.x, centroid.x), std::max(centroidMax.y, centroid.y),
+                                    std::max(centroidMax.z, centroid.z));
+        }
+
+        struct Bin
+        {
+            glm::vec3 min;
+            glm::vec3 max;
+            uint32_t count;
+        };
+        int bestAxis = -1;
+        uint32_t bestSplit = 0;
+        float bestCost = INFINITE_DISTANCE;
+        for(int axis = 0; axis < 3; ++axis)
+        {
+            float extent = centroidMax[axis] - centroidMin[axis];
+            if(!(extent > 0.0f))
+                continue;
+
+            Bin bins[BVH_SAH_BIN_COUNT];
+            for(Bin &bin : bins)
+                bin = {glm::vec3(INFINITE_DISTANCE), glm::vec3(-INFINITE_DISTANCE), 0};
+            float binScale = BVH_SAH_BIN_COUNT / extent;
+            for(uint32_t i = 0; i < count; ++i)
+            {
+                uint32_t primitive = primitiveIndices[first + i];
+                uint32_t binIndex = std::min<uint32_t>(BVH_SAH_BIN_COUNT - 1,
+                        static_cast<uint32_t>((centroids[primitive][axis] - centroidMin[axis]) * binScale));
+                Bin &bin = bins[binIndex];
+                const BvhBounds &bounds = primitiveBounds[primitive];
+                bin.min = glm::vec3(std::min(bin.min.x, bounds.min.x), std::min(bin.min.y, bounds.min.y),
+                                    std::min(bin.min.z, bounds.min.z));
+                bin.max = glm::vec3(std::max(bin.max.x, bounds.max.x), std::max(bin.max.y, bounds.max.y),
+                                    std::max(bin.max.z, bounds.max.z));
+                ++bin.count;
+            }
+
+            //Sweep from both sides to get the cost of every split between two bins.
+            float leftCosts[BVH_SAH_BIN_COUNT - 1];
+            uint32_t leftCounts[BVH_SAH_BIN_COUNT - 1];
+            Bin accumulated = {glm::vec3(INFINITE_DISTANCE), glm::vec3(-INFINITE_DISTANCE), 0};
+            for(uint32_t i = 0; i + 1 < BVH_SAH_BIN_COUNT; ++i)
+            {
+                accumulated.min = glm::vec3(std::min(accumulated.min.x, bins[i].min.x), std::min(accumulated.min.y, bins[i].min.y),
+                                            std::min(accumulated.min.z, bins[i].min.z));
+                accumulated.max = glm::vec3(std::max(accumulated.max.x, bins[i].max.x), std::max(accumulated.max.y, bins[i].max.y),
+                                            std::max(accumulated.max.z, bins[i].max.z));
+                accumulated.count += bins[i].count;
+                leftCounts[i] = accumulated.count;
+                leftCosts[i] = accumulated.count > 0 ? accumulated.count * surfaceArea(accumulated.min, accumulated.max) : 0.0f;
+            }
+            accumulated = {glm::vec3(INFINITE_DISTANCE), glm::vec3(-INFINITE_DISTANCE), 0};
+            for(uint32_t i = BVH_SAH_BIN_COUNT - 1; i > 0; --i)
+            {
+                accumulated.min = glm::vec3(std::min(accumulated.min.x, bins[i].min.x), std::min(accumulated.min.y, bins[i].min.y),
+                                            std::min(accumulated.min.z, bins[i].min.z));
+                accumulated.max = glm::vec3(std::max(accumulated.max.x, bins[i].max.x), std::max(accumulated.max.y, bins[i].max.y),
+                                            std::max(accumulated.max.z, bins[i].max.z));
+                accumulated.count += bins[i].count;
+                if(accumulated.count == 0 || leftCounts[i - 1] == 0)
+                    continue;
+
+                float cost = leftCosts[i - 1] + accumulated.count * surfaceArea(accumulated.min, accumulated.max);
+                if(cost < bestCost)
+                {
+                    bestCost = cost;
+                    bestAxis = axis;
+                    bestSplit = i - 1;
+                }
+            }
+        }
+
+        uint32_t middle;
+        if(bestAxis < 0)
+        {
+            //Every centroid is in the same place, only the primitive count can be split.
+            if(count <= BVH_MAX_LEAF_SIZE)
+                return;
+            middle = first + count / 2;
+        }
+        else
+        {
+            const BvhNode &node = nodes[nodeIndex];
+            float nodeArea = std::max(surfaceArea(glm::vec3(node.min[0], node.min[1], node.min[2]),
+                                                  glm::vec3(node.max[0], node.max[1], node.max[2])),
+                                      std::numeric_limits<float>::min());
+            //Traversing a node costs about as much as testing a primitive.
+            float splitCost = 1.0f + bestCost / nodeArea;
+            if(splitCost >= float(count) && count <= BVH_MAX_LEAF_SIZE)
+                return;
+
+            float binScale = BVH_SAH_BIN_COUNT / (centroidMax[bestAxis] - centroidMin[bestAxis]);
+            float axisMin = centroidMin[bestAxis];
+            auto split = std::partition(primitiveIndices.begin() + first, primitiveIndices.begin() + first + count,
+                                        [&](uint32_t primitive)
+            {
+                uint32_t binIndex = std::min<uint32_t>(BVH_SAH_BIN_COUNT - 1,
+                        static_cast<uint32_t>((centroids[primitive][bestAxis] - axisMin) * binScale));
+                return binIndex <= bestSplit;
+            });
+            middle = static_cast<uint32_t>(split - primitiveIndices.begin());
+        }
+
+        uint32_t leftIndex = static_cast<uint32_t>(nodes.size());
+        BvhNode left = {};
+        left.leftOrFirst = first;
+        left.count = middle - first;
+        BvhNode right = {};
+        right.leftOrFirst = middle;
+        right.count = first + count - middle;
+        nodes.push_back(left);
+        nodes.push_back(right);
+        nodes[nodeIndex].leftOrFirst = leftIndex;
+        nodes[nodeIndex].count = 0;
+
+        updateNodeBounds(leftIndex);
+        updateNodeBounds(leftIndex + 1);
+        subdivide(leftIndex, depth + 1);
+        subdivide(leftIndex + 1, depth + 1);
+    }
+
+    void Bvh::updateNodeBounds(uint32_t nodeIndex)
+    {
+        BvhNode &node = nodes[nodeIndex];
+        for(int axis = 0; axis < 3; ++axis)
+        {
+            node.min[axis] = INFINITE_DISTANCE;
+            node.max[axis] = -INFINITE_DISTANCE;
+        }
+        for(uint32_t i = 0; i < node.count; ++i)
+        {
+            const BvhBounds &bounds = primitiveBounds[primitiveIndices[node.leftOrFirst + i]];
+            for(int axis = 0; axis < 3; ++axis)
+            {
+                node.min[axis] = std::min(node.min[axis], bounds.min[axis]);
+                node.max[axis] = std::max(node.max[axis], bounds.max[axis]);
+            }
+        }
+    }
+
+    float Bvh::computeCost() const
+    {
+        if(nodes.empty())
+            return 0.0f;
+
+        float cost = 0.0f;
+        for(const BvhNode &node : nodes)
+        {
+            float area = surfaceArea(glm::vec3(node.min[0], node.min[1], node.min[2]),
+                                     glm::vec3(node.max[0], node.max[1], node.max[2]));
+            cost += area * (node.count > 0 ? float(node.count) : 1.0f);
+        }
+        float rootArea = surfaceArea(glm::vec3(nodes[0].min[0], nodes[0].min[1], nodes[0].min[2]),
+                                     glm::vec3(nodes[0].max[0], nodes[0].max[1], nodes[0].max[2]));
+        return cost / std::max(rootArea, std::numeric_limits<float>::min());
+    }
+}
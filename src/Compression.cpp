@@ -0,0 +1,218 @@
+#include "Compression.h"
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+namespace Raven
+{
+    namespace Compression
+    {
+        //LZ4 block format constants. Every match is at least four bytes long,
+        //the last five bytes of a block are always literals and the last match
+        //has to start at least twelve bytes before the end of the block.
+        static const size_t LZ4_MIN_MATCH = 4;
+        static const size_t LZ4_LAST_LITERALS = 5;
+        static const size_t LZ4_MATCH_FIND_LIMIT = 12;
+        static const size_t LZ4_MAX_OFFSET = 65535;
+        static const uint32_t LZ4_HASH_BITS = 16;
+
+        static inline uint32_t read32(const uint8_t *memory)
+        {
+            uint32_t value;
+            std::memcpy(&value, memory, sizeof(value));
+            return value;
+        }
+
+        static inline uint32_t hashSequence(uint32_t sequence)
+        {
+            return (sequence * 2654435761u) >> (32 - LZ4_HASH_BITS);
+        }
+
+        //Writes the extra length bytes that follow a saturated token nibble.
+        static inline void writeLength(std::vector<char> &destination, size_t length)
+        {
+            while(length >= 255)
+            {
+                destination.push_back(static_cast<char>(255));
+                length -= 255;
+            }
+            destination.push_back(static_cast<char>(length));
+        }
+
+        //Reads the extra length bytes that follow a saturated token nibble.
+        static inline bool readLength(const uint8_t *source, size_t sourceSize, size_t &position, size_t &length)
+        {
+            uint8_t value = 0;
+            do
+            {
+                if(position >= sourceSize)
+                    return false;
+                value = source[position++];
+                length += value;
+            } while(value == 255);
+            return true;
+        }
+
+        /**
+         * @brief Returns the worst case size of an LZ4 block, used for reserving memory.
+         * @param sourceSize
+         * @return Maximum compressed size.
+         */
+        size_t lz4CompressBound(size_t sourceSize) noexcept
+        {
+            return sourceSize + sourceSize / 255 + 16;
+        }
+
+        /**
+         * @brief Compresses data into a raw LZ4 block (no frame header). Uses a greedy
+         *        single-probe hash table, which is what the reference "fast" mode does too.
+         * @param source
+         * @param sourceSize
+         * @param destination
+         * @return False if the compression fails.
+         */
+        bool compressLZ4(const char *source, size_t sourceSize, std::vector<char> &destination) noexcept
+        {
+            destination.clear();
+            if(source == nullptr && sourceSize != 0)
+            {
+                std::cerr << "Failed to compress data since the source was a null pointer!" << std::endl;
+                return false;
+            }
+
+            try
+            {
+                destination.reserve(lz4CompressBound(sourceSize));
+
+                const uint8_t *src = reinterpret_cast<const uint8_t*>(source);
+                size_t anchor = 0;
+                size_t position = 0;
+
+                if(sourceSize >= LZ4_MATCH_FIND_LIMIT)
+                {
+                    //Positions are stored +1 so that zero means "empty slot".
+                    std::vector<uint32_t> hashTable(size_t(1) << LZ4_HASH_BITS, 0);
+                    const size_t matchLimit = sourceSize - LZ4_LAST_LITERALS;
+
+                    while(position + LZ4_MATCH_FIND_LIMIT <= sourceSize)
+                    {
+                        uint32_t sequence = read32(src + position);
+                        uint32_t hash = hashSequence(sequence);
+                        size_t candidate = hashTable[hash];
+                        hashTable[hash] = static_cast<uint32_t>(position + 1);
+
+                        if(candidate == 0 ||
+                           position - (candidate - 1) > LZ4_MAX_OFFSET ||
+                           read32(src + candidate - 1) != sequence)
+                        {
+                            ++position;
+                            continue;
+                        }
+                        candidate -= 1;
+
+                        //Extend the match as far as the format allows.
+                        size_t matchLength = LZ4_MIN_MATCH;
+                        while(position + matchLength < matchLimit &&
+                              src[candidate + matchLength] == src[position + matchLength])
+                        {
+                            ++matchLength;
+                        }
+
+                        size_t literalLength = position - anchor;
+                        size_t extraMatchLength = matchLength - LZ4_MIN_MATCH;
+                        uint8_t token = static_cast<uint8_t>(((literalLength < 15 ? literalLength : 15) << 4) |
+                                                             (extraMatchLength < 15 ? extraMatchLength : 15));
+                        destination.push_back(static_cast<char>(token));
+                        if(literalLength >= 15)
+                            writeLength(destination, literalLength - 15);
+                        destination.insert(destination.end(), source + anchor, source + position);
+
+                        size_t offset = position - candidate;
+                        destination.push_back(static_cast<char>(offset & 0xFF));
+                        destination.push_back(static_cast<char>((offset >> 8) & 0xFF));
+                        if(extraMatchLength >= 15)
+                            writeLength(destination, extraMatchLength - 15);
+
+                        position += matchLength;
+                        anchor = position;
+                    }
+                }
+
+                //The last sequence only holds literals.
+                size_t literalLength = sourceSize - anchor;
+                destination.push_back(static_cast<char>((literalLength < 15 ? literalLength : 15) << 4));
+                if(literalLength >= 15)
+                    writeLength(destination, literalLength - 15);
+                destination.insert(destination.end(), source + anchor, source + sourceSize);
+            }
+            catch(const std::bad_alloc&)
+            {
+                std::cerr << "Failed to allocate memory for LZ4 compression!" << std::endl;
+                destination.clear();
+                return false;
+            }
+            return true;
+        }
+
+        /**
+         * @brief Decompresses a raw LZ4 block. Every read and write is bounds checked so
+         *        corrupted archives fail instead of overrunning memory.
+         * @param source
+         * @param sourceSize
+         * @param destination
+         * @param destinationSize The exact size of the original data.
+         * @return False if the block is malformed or does not match the destination size.
+         */
+        bool decompressLZ4(const char *source, size_t sourceSize,
+                           char *destination, size_t destinationSize) noexcept
+        {
+            const uint8_t *src = reinterpret_cast<const uint8_t*>(source);
+            uint8_t *dst = reinterpret_cast<uint8_t*>(destination);
+            size_t inputPosition = 0;
+            size_t outputPosition = 0;
+
+            while(inputPosition < sourceSize)
+            {
+                uint8_t token = src[inputPosition++];
+
+                size_t literalLength = token >> 4;
+                if(literalLength == 15 && !readLength(src, sourceSize, inputPosition, literalLength))
+                    break;
+                if(literalLength > sourceSize - inputPosition ||
+                   literalLength > destinationSize - outputPosition)
+                    break;
+
+                std::memcpy(dst + outputPosition, src + inputPosition, literalLength);
+                inputPosition += literalLength;
+                outputPosition += literalLength;
+
+                //The final sequence has no match part.
+                if(inputPosition == sourceSize)
+                    return outputPosition == destinationSize;
+
+                if(sourceSize - inputPosition < 2)
+                    break;
+                size_t offset = size_t(src[inputPosition]) | (size_t(src[inputPosition + 1]) << 8);
+                inputPosition += 2;
+                if(offset == 0 || offset > outputPosition)
+                    break;
+
+                size_t matchLength = token & 0x0F;
+                if(matchLength == 15 && !readLength(src, sourceSize, inputPosition, matchLength))
+                    break;
+                matchLength += LZ4_MIN_MATCH;
+                if(matchLength > destinationSize - outputPosition)
+                    break;
+
+                //Matches may overlap the output so copy byte by byte.
+                const uint8_t *match = dst + outputPosition - offset;
+                for(size_t i = 0; i < matchLength; ++i)
+                    dst[outputPosition + i] = match[i];
+                outputPosition += matchLength;
+            }
+
+            std::cerr << "Failed to decompress LZ4 block, the data is corrupted!" << std::endl;
+            return false;
+        }
+    }
+}
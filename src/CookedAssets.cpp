@@ -0,0 +1,348 @@
+#include "CookedAssets.h"
+#include "MeshLoader.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace Raven
+{
+    /**
+     * @brief Builds a full mip chain from RGBA8 pixels. Each level averages 2x2 texels of the
+     *        previous one, odd edges reuse the last row or column.
+     * @param pixels
+     * @param width
+     * @param height
+     * @param mipLevels
+     */
+    void generateMipChain(const unsigned char *pixels, uint32_t width, uint32_t height,
+                          std::vector<TextureMipLevel> &mipLevels)
+    {
+        mipLevels.clear();
+        if(pixels == nullptr || width == 0 || height == 0)
+            return;
+
+        TextureMipLevel base;
+        base.width = width;
+        base.height = height;
+        base.pixels.assign(pixels, pixels + size_t(width) * height * 4);
+        mipLevels.push_back(std::move(base));
+
+        while(mipLevels.back().width > 1 || mipLevels.back().height > 1)
+        {
+            const TextureMipLevel &source = mipLevels.back();
+            TextureMipLevel level;
+            level.width = std::max(1u, source.width / 2);
+            level.height = std::max(1u, source.height / 2);
+            level.pixels.resize(size_t(level.width) * level.height * 4);
+
+            for(uint32_t y = 0; y < level.height; ++y)
+            {
+                uint32_t y0 = std::min(2 * y, source.height - 1);
+                uint32_t y1 = std::min(2 * y + 1, source.height - 1);
+                for(uint32_t x = 0; x < level.width; ++x)
+                {
+                    uint32_t x0 = std::min(2 * x, source.width - 1);
+                    uint32_t x1 = std::min(2 * x + 1, source.width - 1);
+                    for(uint32_t c = 0; c < 4; ++c)
+                    {
+                        uint32_t sum = source.pixels[(size_t(y0) * source.width + x0) * 4 + c] +
+                                       source.pixels[(size_t(y0) * source.width + x1) * 4 + c] +
+                                       source.pixels[(size_t(y1) * source.width + x0) * 4 + c] +
+                                       source.pixels[(size_t(y1) * source.width + x1) * 4 + c];
+                        level.pixels[(size_t(y) * level.width + x) * 4 + c] = static_cast<unsigned char>((sum + 2) / 4);
+                    }
+                }
+            }
+            mipLevels.push_back(std::move(level));
+        }
+    }
+
+    namespace CookedAssets
+    {
+        //Copies a value out of the file contents and advances the read position.
+        template<typename T>
+        static bool readValue(const std::vector<char> &fileContents, size_t &position, T &value)
+        {
+            if(position > fileContents.size() || fileContents.size() - position < sizeof(T))
+                return false;
+            std::memcpy(&value, fileContents.data() + position, sizeof(T));
+            position += sizeof(T);
+            return true;
+        }
+
+        //Copies an array out of the file contents and advances the read position.
+        template<typename T>
+        static bool readArray(const std::vector<char> &fileContents, size_t &position, size_t count,
+                              std::vector<T> &values)
+        {
+            if(position > fileContents.size() || (fileContents.size() - position) / sizeof(T) < count)
+                return false;
+            values.resize(count);
+            if(count > 0)
+                std::memcpy(values.data(), fileContents.data() + position, count * sizeof(T));
+            position += count * sizeof(T);
+            return true;
+        }
+
+        template<typename T>
+        static void writeArray(std::ofstream &file, const std::vector<T> &values)
+        {
+            file.write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T));
+        }
+
+        /**
+         * @brief Checks the extension of a filename.
+         * @param filename
+         * @param extension Extension with the leading dot.
+         * @return True if the filename ends with the extension.
+         */
+        bool hasExtension(const std::string &filename, const char *extension)
+        {
+            size_t extensionLength = std::strlen(extension);
+            return filename.size() >= extensionLength &&
+                   filename.compare(filename.size() - extensionLength, extensionLength, extension) == 0;
+        }
+
+        /**
+         * @brief Writes a mesh into a cooked mesh file.
+         * @param filename
+         * @param mesh
+         * @param attributes CookedMeshAttributeBits describing what follows the position of a vertex.
+         * @return False if the mesh is inconsistent or the file could not be written.
+         */
+        bool writeMesh(const std::string &filename, const Mesh &mesh, uint32_t attributes)
+        {
+            uint32_t strideFloats = 3 +
+                    ((attributes & COOKED_MESH_ATTRIBUTE_NORMAL_BIT) ? 3 : 0) +
+                    ((attributes & COOKED_MESH_ATTRIBUTE_TEXTURE_COORDINATE_BIT) ? 2 : 0) +
+                    ((attributes & COOKED_MESH_ATTRIBUTE_TANGENT_SPACE_BIT) ? 6 : 0);
+            if(mesh.data.size() % strideFloats != 0)
+            {
+                std::cerr << "Failed to write cooked mesh since the data does not match the attributes!" << std::endl;
+                return false;
+            }
+
+            CookedMeshHeader header = {};
+            std::memcpy(header.magic, COOKED_MESH_MAGIC, sizeof(header.magic));
+            header.version = COOKED_MESH_VERSION;
+            header.attributes = attributes;
+            header.vertexStride = strideFloats * sizeof(float);
+            header.vertexCount = static_cast<uint32_t>(mesh.data.size() / strideFloats);
+            header.partCount = static_cast<uint32_t>(mesh.parts.size());
+            header.lodCount = static_cast<uint32_t>(mesh.lods.size());
+            header.indexCount = static_cast<uint32_t>(mesh.indices.size());
+            header.meshletCount = static_cast<uint32_t>(mesh.meshlets.size());
+            header.meshletVertexCount = static_cast<uint32_t>(mesh.meshletVertices.size());
+            header.meshletTriangleIndexCount = static_cast<uint32_t>(mesh.meshletTriangles.size());
+            if(mesh.meshletBounds.size() != mesh.meshlets.size())
+            {
+                std::cerr << "Failed to write cooked mesh since meshlets are missing their bounds!" << std::endl;
+                return false;
+            }
+
+            std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+            if(!file.is_open())
+            {
+                std::cerr << "Failed to open " << filename << " for writing!" << std::endl;
+                return false;
+            }
+            file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            writeArray(file, mesh.parts);
+            writeArray(file, mesh.lods);
+            writeArray(file, mesh.data);
+            writeArray(file, mesh.indices);
+            writeArray(file, mesh.meshlets);
+            writeArray(file, mesh.meshletBounds);
+            writeArray(file, mesh.meshletVertices);
+            writeArray(file, mesh.meshletTriangles);
+            if(!file.good())
+            {
+                std::cerr << "Failed to write cooked mesh " << filename << "!" << std::endl;
+                return false;
+            }
+            return true;
+        }
+
+        /**
+         * @brief Reads a cooked mesh.
+         * @param fileContents Contents of the file, see FileIO::readBinaryFile.
+         * @param mesh
+         * @param attributes Optional CookedMeshAttributeBits of the vertices.
+         * @param vertexStride Optional size of a single vertex in bytes.
+         * @return False if the file is not a valid cooked mesh.
+         */
+        bool readMesh(const std::vector<char> &fileContents, Mesh &mesh,
+                      uint32_t *attributes, uint32_t *vertexStride)
+        {
+            size_t position = 0;
+            CookedMeshHeader header;
+            if(!readValue(fileContents, position, header) ||
+               std::memcmp(header.magic, COOKED_MESH_MAGIC, sizeof(header.magic)) != 0 ||
+               header.version != COOKED_MESH_VERSION ||
+               header.vertexStride == 0 || header.vertexStride % sizeof(float) != 0)
+            {
+                std::cerr << "Failed to read cooked mesh, the header is invalid!" << std::endl;
+                return false;
+            }
+
+            Mesh result;
+            if(!readArray(fileContents, position, header.partCount, result.parts) ||
+               !readArray(fileContents, position, header.lodCount, result.lods) ||
+               !readArray(fileContents, position, size_t(header.vertexCount) * header.vertexStride / sizeof(float), result.data) ||
+               !readArray(fileContents, position, header.indexCount, result.indices) ||
+               !readArray(fileContents, position, header.meshletCount, result.meshlets) ||
+               !readArray(fileContents, position, header.meshletCount, result.meshletBounds) ||
+               !readArray(fileContents, position, header.meshletVertexCount, result.meshletVertices) ||
+               !readArray(fileContents, position, header.meshletTriangleIndexCount, result.meshletTriangles) ||
+               position != fileContents.size())
+            {
+                std::cerr << "Failed to read cooked mesh, the file is truncated!" << std::endl;
+                return false;
+            }
+
+            //Validate every range so a corrupted file can not make the renderer read out of bounds.
+            for(const Mesh::Part &part : result.parts)
+            {
+                if(uint64_t(part.vertexOffset) + part.vertexCount > header.vertexCount ||
+                   uint64_t(part.indexOffset) + part.indexCount > header.indexCount ||
+                   uint64_t(part.meshletOffset) + part.meshletCount > header.meshletCount ||
+                   uint64_t(part.lodOffset) + part.lodCount > header.lodCount)
+                {
+                    std::cerr << "Failed to read cooked mesh, a part is invalid!" << std::endl;
+                    return false;
+                }
+            }
+            for(const MeshLod &lod : result.lods)
+            {
+                if(uint64_t(lod.indexOffset) + lod.indexCount > header.indexCount || lod.indexCount % 3 != 0 ||
+                   !(lod.error >= 0.0f))
+                {
+                    std::cerr << "Failed to read cooked mesh, a level of detail is invalid!" << std::endl;
+                    return false;
+                }
+            }
+            for(const Meshlet &meshlet : result.meshlets)
+            {
+                if(uint64_t(meshlet.vertexOffset) + meshlet.vertexCount > header.meshletVertexCount ||
+                   uint64_t(meshlet.triangleOffset) + uint64_t(meshlet.triangleCount) * 3 > header.meshletTriangleIndexCount ||
+                   meshlet.vertexCount > MESHLET_MAX_VERTICES || meshlet.triangleCount > MESHLET_MAX_TRIANGLES)
+                {
+                    std::cerr << "Failed to read cooked mesh, a meshlet is invalid!" << std::endl;
+                    return false;
+                }
+
+                //Triangle indices are local to the meshlet's own vertices.
+                auto triangles = result.meshletTriangles.begin() + meshlet.triangleOffset;
+                if(std::any_of(triangles, triangles + size_t(meshlet.triangleCount) * 3,
+                               [&meshlet](uint8_t index){return index >= meshlet.vertexCount;}))
+                {
+                    std::cerr << "Failed to read cooked mesh, a meshlet triangle is out of range!" << std::endl;
+                    return false;
+                }
+            }
+            if(std::any_of(result.indices.begin(), result.indices.end(),
+                           [&header](uint32_t index){return index >= header.vertexCount;}) ||
+               std::any_of(result.meshletVertices.begin(), result.meshletVertices.end(),
+                           [&header](uint32_t index){return index >= header.vertexCount;}))
+            {
+                std::cerr << "Failed to read cooked mesh, an index is out of range!" << std::endl;
+                return false;
+            }
+
+            //Bounds are cheap to compute and not worth a format change.
+            MeshLoader::computeBounds(result, header.vertexStride);
+            mesh = std::move(result);
+            if(attributes)
+                *attributes = header.attributes;
+            if(vertexStride)
+                *vertexStride = header.vertexStride;
+            return true;
+        }
+
+        /**
+         * @brief Writes a mip chain into a cooked texture file.
+         * @param filename
+         * @param mipLevels RGBA8 mip levels, 0 being the finest.
+         * @return False if there is nothing to write or the file could not be written.
+         */
+        bool writeTexture(const std::string &filename, const std::vector<TextureMipLevel> &mipLevels)
+        {
+            if(mipLevels.empty())
+            {
+                std::cerr << "Failed to write cooked texture without mip levels!" << std::endl;
+                return false;
+            }
+
+            CookedTextureHeader header = {};
+            std::memcpy(header.magic, COOKED_TEXTURE_MAGIC, sizeof(header.magic));
+            header.version = COOKED_TEXTURE_VERSION;
+            header.width = mipLevels[0].width;
+            header.height = mipLevels[0].height;
+            header.mipLevelCount = static_cast<uint32_t>(mipLevels.size());
+            header.componentCount = 4;
+
+            std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+            if(!file.is_open())
+            {
+                std::cerr << "Failed to open " << filename << " for writing!" << std::endl;
+                return false;
+            }
+            file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            for(const TextureMipLevel &level : mipLevels)
+            {
+                file.write(reinterpret_cast<const char*>(&level.width), sizeof(level.width));
+                file.write(reinterpret_cast<const char*>(&level.height), sizeof(level.height));
+                file.write(reinterpret_cast<const char*>(level.pixels.data()), level.pixels.size());
+            }
+            if(!file.good())
+            {
+                std::cerr << "Failed to write cooked texture " << filename << "!" << std::endl;
+                return false;
+            }
+            return true;
+        }
+
+        /**
+         * @brief Reads a cooked texture.
+         * @param fileContents Contents of the file, see FileIO::readBinaryFile.
+         * @param mipLevels
+         * @return False if the file is not a valid cooked texture.
+         */
+        bool readTexture(const std::vector<char> &fileContents, std::vector<TextureMipLevel> &mipLevels)
+        {
+            size_t position = 0;
+            CookedTextureHeader header;
+            if(!readValue(fileContents, position, header) ||
+               std::memcmp(header.magic, COOKED_TEXTURE_MAGIC, sizeof(header.magic)) != 0 ||
+               header.version != COOKED_TEXTURE_VERSION ||
+               header.componentCount != 4 || header.mipLevelCount == 0 || header.mipLevelCount > 32)
+            {
+                std::cerr << "Failed to read cooked texture, the header is invalid!" << std::endl;
+                return false;
+            }
+
+            std::vector<TextureMipLevel> result(header.mipLevelCount);
+            for(TextureMipLevel &level : result)
+            {
+                if(!readValue(fileContents, position, level.width) ||
+                   !readValue(fileContents, position, level.height))
+                {
+                    std::cerr << "Failed to read cooked texture, a mip level is truncated!" << std::endl;
+                    return false;
+                }
+                size_t levelSize = size_t(level.width) * level.height * 4;
+                if(fileContents.size() - position < levelSize)
+                {
+                    std::cerr << "Failed to read cooked texture, a mip level is truncated!" << std::endl;
+                    return false;
+                }
+                level.pixels.assign(fileContents.data() + position, fileContents.data() + position + levelSize);
+                position += levelSize;
+            }
+
+            mipLevels = std::move(result);
+            return true;
+        }
+    }
+}
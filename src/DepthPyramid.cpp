@@ -0,0 +1,262 @@
+#include "DepthPyramid.h"
+#include "VulkanUtility.h"
+#include "VulkanStructures.h"
+#include "VulkanDescriptorManager.h"
+#include <algorithm>
+
+namespace Raven
+{
+    DepthPyramid::DepthPyramid()
+    {
+
+    }
+
+    DepthPyramid::~DepthPyramid()
+    {
+        destroy();
+    }
+
+    /**
+     * @brief Creates the pyramid image with a view per level, the sampler and the downsample pipeline.
+     * @param logicalDevice
+     * @param memoryProperties
+     * @param depthWidth Width of the depth image the pyramid is built from.
+     * @param depthHeight
+     * @param shaderFilename Compiled depthpyramid.comp.
+     * @return False if anything could not be created.
+     */
+    bool DepthPyramid::initialize(VkDevice logicalDevice,
+                                  const VkPhysicalDeviceMemoryProperties &memoryProperties,
+                                  uint32_t depthWidth, uint32_t depthHeight,
+                                  const std::string &shaderFilename)
+    {
+        destroy();
+        if(depthWidth == 0 || depthHeight == 0)
+        {
+            std::cerr << "Failed to initialize depth pyramid for an empty depth image!" << std::endl;
+            return false;
+        }
+        this->logicalDevice = logicalDevice;
+        width = std::max(depthWidth / 2, 1u);
+        height = std::max(depthHeight / 2, 1u);
+        levelCount = computeLevelCount(width, height);
+
+        VkImageCreateInfo imageInfo = VulkanStructures::imageCreateInfo(VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+                                                                        VK_IMAGE_TYPE_2D, DEPTH_PYRAMID_FORMAT,
+                                                                        {width, height, 1}, 1, VK_SAMPLE_COUNT_1_BIT,
+                                                                        VK_IMAGE_LAYOUT_UNDEFINED, VK_SHARING_MODE_EXCLUSIVE,
+                                                                        levelCount, false);
+        if(!createImage(logicalDevice, imageInfo, pyramidImage.image))
+        {
+            destroy();
+            return false;
+        }
+        VkMemoryRequirements memReq;
+        vkGetImageMemoryRequirements(logicalDevice, pyramidImage.image, &memReq);
+        if(!allocateMemory(logicalDevice, memoryProperties, memReq, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, pyramidMemory) ||
+           !pyramidImage.bindMemoryObject(logicalDevice, pyramidMemory))
+        {
+            destroy();
+            return false;
+        }
+
+        VkImageViewCreateInfo viewInfo = VulkanStructures::imageViewCreateInfo(pyramidImage.image, DEPTH_PYRAMID_FORMAT,
+                                                                               VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_VIEW_TYPE_2D);
+        if(!createImageView(logicalDevice, viewInfo, pyramidImage.imageView))
+        {
+            destroy();
+            return false;
+        }
+        levelViews.resize(levelCount, VK_NULL_HANDLE);
+        for(uint32_t level = 0; level < levelCount; ++level)
+        {
+            viewInfo.subresourceRange.baseMipLevel = level;
+            viewInfo.subresourceRange.levelCount = 1;
+            if(!createImageView(logicalDevice, viewInfo, levelViews[level]))
+            {
+                destroy();
+                return false;
+            }
+        }
+
+        //Levels are read with texelFetch and textureLod at exact levels, nothing is filtered.
+        VkSamplerCreateInfo samplerInfo = VulkanStructures::samplerCreateInfo(VK_FILTER_NEAREST, VK_FILTER_NEAREST,
+                                                                              VK_SAMPLER_MIPMAP_MODE_NEAREST,
+                                                                              VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+                                                                              VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+                                                                              VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+                                                                              0.0f, VK_FALSE, 1.0f, VK_FALSE,
+                                                                              VK_COMPARE_OP_ALWAYS, 0.0f,
+                                                                              static_cast<float>(levelCount),
+                                                                              VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE, VK_FALSE);
+        if(!createSampler(logicalDevice, samplerInfo, sampler))
+        {
+            destroy();
+            return false;
+        }
+
+        //The level above and the level written.
+        std::vector<VkDescriptorSetLayoutBinding> bindings =
+        {
+            {0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr},
+            {1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr}
+        };
+        std::vector<VkDescriptorPoolSize> poolSizes =
+        {
+            {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, levelCount},
+            {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, levelCount}
+        };
+        if(!VulkanDescriptorManager::createDescriptorSetLayout(logicalDevice, bindings, descriptorSetLayout) ||
+           !VulkanDescriptorManager::createDescriptorPool(logicalDevice, VK_FALSE, levelCount, poolSizes, descriptorPool) ||
+           !VulkanDescriptorManager::allocateDescriptorSets(logicalDevice, descriptorPool,
+                                                            std::vector<VkDescriptorSetLayout>(levelCount, descriptorSetLayout),
+                                                            levelSets) ||
+           !createPipelineLayout(logicalDevice, {descriptorSetLayout}, {}, pipelineLayout))
+        {
+            destroy();
+            return false;
+        }
+
+        //The first level reads the depth image, set by setDepthImage.
+        std::vector<ImageDescriptorInfo> imageDescriptors;
+        for(uint32_t level = 0; level < levelCount; ++level)
+        {
+            if(level > 0)
+            {
+                imageDescriptors.push_back({levelSets[level], 0, 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                                            {{sampler, levelViews[level - 1], VK_IMAGE_LAYOUT_GENERAL}}});
+            }
+            imageDescriptors.push_back({levelSets[level], 1, 0, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                                        {{VK_NULL_HANDLE, levelViews[level], VK_IMAGE_LAYOUT_GENERAL}}});
+        }
+        VulkanDescriptorManager::updateDescriptorSets(logicalDevice, imageDescriptors, {}, {}, {});
+
+        VkShaderModule shaderModule = VK_NULL_HANDLE;
+        if(!loadShaderModule(logicalDevice, shaderFilename, shaderModule))
+        {
+            std::cerr << "Failed to load depth pyramid shader!" << std::endl;
+            destroy();
+            return false;
+        }
+
+        VkComputePipelineCreateInfo pipelineInfo = {};
+        pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        pipelineInfo.stage = VulkanStructures::pipelineShaderStageCreateInfo(VK_SHADER_STAGE_COMPUTE_BIT,
+                                                                             shaderModule, "main", nullptr);
+        pipelineInfo.layout = pipelineLayout;
+        pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+        pipelineInfo.basePipelineIndex = -1;
+        std::vector<VkPipeline> pipelines;
+        bool pipelineCreated = createComputePipelines(logicalDevice, VK_NULL_HANDLE, {pipelineInfo}, pipelines);
+        destroyShaderModule(logicalDevice, shaderModule);
+        if(!pipelineCreated)
+        {
+            destroy();
+            return false;
+        }
+        pipeline = pipelines[0];
+        return true;
+    }
+
+    void DepthPyramid::destroy()
+    {
+        if(logicalDevice == VK_NULL_HANDLE)
+            return;
+
+        destroyPipeline(logicalDevice, pipeline);
+        destroyPipelineLayout(logicalDevice, pipelineLayout);
+        VulkanDescriptorManager::destroyDescriptorPool(logicalDevice, descriptorPool);
+        VulkanDescriptorManager::destroyDescriptorSetLayout(logicalDevice, descriptorSetLayout);
+        levelSets.clear();
+
+        destroySampler(logicalDevice, sampler);
+        for(VkImageView &view : levelViews)
+            destroyImageView(logicalDevice, view);
+        levelViews.clear();
+        destroyImageView(logicalDevice, pyramidImage.imageView);
+        destroyImage(logicalDevice, pyramidImage.image);
+        freeMemory(logicalDevice, pyramidMemory);
+        pyramidImage = {};
+
+        depthImage = VK_NULL_HANDLE;
+        depthLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        width = 0;
+        height = 0;
+        levelCount = 0;
+        logicalDevice = VK_NULL_HANDLE;
+    }
+
+    /**
+     * @brief Points the first downsample at the depth image. Must not be called while a
+     *        frame that builds the pyramid is still executing.
+     * @param depthImage
+     * @param depthImageView View of the depth aspect.
+     * @param depthLayout E.g. VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL.
+     */
+    void DepthPyramid::setDepthImage(VkImage depthImage, VkImageView depthImageView, VkImageLayout depthLayout)
+    {
+        this->depthImage = depthImage;
+        this->depthLayout = depthLayout;
+        ImageDescriptorInfo depthDescriptor = {levelSets[0], 0, 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                                               {{sampler, depthImageView, depthLayout}}};
+        VulkanDescriptorManager::updateDescriptorSets(logicalDevice, {depthDescriptor}, {}, {}, {});
+    }
+
+    /**
+     * @brief Records one dispatch per level. Every level waits for the one above it, the
+     *        last barrier makes the pyramid visible to the culling shader.
+     * @param cmdBuffer
+     */
+    void DepthPyramid::recordBuild(VkCommandBuffer cmdBuffer)
+    {
+        if(depthImage == VK_NULL_HANDLE)
+        {
+            std::cerr << "Failed to build depth pyramid without a depth image!" << std::endl;
+            return;
+        }
+
+        //The depth writes have to finish and the previous frame's culling has to be done
+        //reading the old pyramid, which is discarded.
+        setImageMemoryBarriers(cmdBuffer,
+                               VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                               VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                               {
+                                   {depthImage, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
+                                    depthLayout, depthLayout, VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED,
+                                    VK_IMAGE_ASPECT_DEPTH_BIT},
+                                   {pyramidImage.image, 0, VK_ACCESS_SHADER_WRITE_BIT,
+                                    VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL,
+                                    VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, VK_IMAGE_ASPECT_COLOR_BIT}
+                               });
+
+        vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+        for(uint32_t level = 0; level < levelCount; ++level)
+        {
+            uint32_t levelWidth = std::max(width >> level, 1u);
+            uint32_t levelHeight = std::max(height >> level, 1u);
+            VulkanDescriptorManager::bindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout,
+                                                        0, {levelSets[level]}, {});
+            vkCmdDispatch(cmdBuffer, (levelWidth + DEPTH_PYRAMID_WORKGROUP_SIZE - 1) / DEPTH_PYRAMID_WORKGROUP_SIZE,
+                          (levelHeight + DEPTH_PYRAMID_WORKGROUP_SIZE - 1) / DEPTH_PYRAMID_WORKGROUP_SIZE, 1);
+
+            setImageMemoryBarriers(cmdBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                                   {
+                                       {pyramidImage.image, VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
+                                        VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_GENERAL,
+                                        VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, VK_IMAGE_ASPECT_COLOR_BIT}
+                                   });
+        }
+    }
+
+    uint32_t DepthPyramid::computeLevelCount(uint32_t width, uint32_t height)
+    {
+        uint32_t levels = 1;
+        while(std::max(width, height) > 1)
+        {
+            width = std::max(width / 2, 1u);
+            height = std::max(height / 2, 1u);
+            ++levels;
+        }
+        return levels;
+    }
+}
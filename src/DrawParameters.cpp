@@ -0,0 +1,79 @@
+#include "DrawParameters.h"
+
+namespace Raven
+{
+    /**
+     * @brief Chooses how blocks reach the shaders.
+     * @param limits Limits of the physical device.
+     * @param stages Shader stages that read the block.
+     * @param blockSize Size of the block in bytes, a multiple of 4.
+     * @param fallbackRing Ring for blocks too large for push constants. Its block range has to
+     *        cover blockSize. May be null if the block is known to fit.
+     * @return False if the block fits neither into push constants nor into the ring.
+     */
+    bool DrawParameterBinding::initialize(const VkPhysicalDeviceLimits &limits, VkShaderStageFlags stages,
+                                          uint32_t blockSize, UniformRing *fallbackRing)
+    {
+        if(blockSize == 0 || blockSize % 4 != 0)
+        {
+            std::cerr << "Failed to create draw parameters, the size has to be a multiple of 4!" << std::endl;
+            return false;
+        }
+        bool fits = blockSize <= limits.maxPushConstantsSize;
+        if(!fits && (fallbackRing == nullptr || fallbackRing->getBlockRange() < blockSize))
+        {
+            std::cerr << "Failed to create draw parameters larger than push constants without a uniform ring for them!" << std::endl;
+            return false;
+        }
+        this->stages = stages;
+        this->blockSize = blockSize;
+        this->fallbackRing = fallbackRing;
+        pushConstants = fits;
+        return true;
+    }
+
+    std::vector<VkPushConstantRange> DrawParameterBinding::getPushConstantRanges() const
+    {
+        if(!pushConstants)
+            return {};
+        return {{stages, 0, blockSize}};
+    }
+
+    std::vector<VkDescriptorSetLayoutBinding> DrawParameterBinding::getDescriptorSetLayoutBindings(uint32_t binding) const
+    {
+        if(pushConstants)
+            return {};
+        return {{binding, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1, stages, nullptr}};
+    }
+
+    std::vector<BufferDescriptorInfo> DrawParameterBinding::getDescriptorInfos(VkDescriptorSet descriptorSet,
+                                                                               uint32_t binding) const
+    {
+        if(pushConstants)
+            return {};
+        return {fallbackRing->getDescriptorInfo(descriptorSet, binding)};
+    }
+
+    /**
+     * @brief Pushes the block, or writes it into the ring's current frame.
+     * @param cmdBuffer
+     * @param pipelineLayout Layout with the ranges of getPushConstantRanges.
+     * @param block blockSize bytes.
+     * @param dynamicOffsets Offsets of the descriptor set the ring's binding is in.
+     * @return False if the ring's region is full.
+     */
+    bool DrawParameterBinding::record(VkCommandBuffer cmdBuffer, VkPipelineLayout pipelineLayout,
+                                      const void *block, std::vector<uint32_t> &dynamicOffsets) const
+    {
+        if(pushConstants)
+        {
+            vkCmdPushConstants(cmdBuffer, pipelineLayout, stages, 0, blockSize, block);
+            return true;
+        }
+        uint32_t dynamicOffset;
+        if(!fallbackRing->write(block, blockSize, dynamicOffset))
+            return false;
+        dynamicOffsets.push_back(dynamicOffset);
+        return true;
+    }
+}
@@ -0,0 +1,383 @@
+#include "EntityStore.h"
+#include <cstring>
+#include <iostream>
+
+namespace Raven
+{
+    namespace
+    {
+        //Size of each component, in the order of the component bits.
+        const uint32_t COMPONENT_SIZES[ENTITY_COMPONENT_COUNT] =
+        {
+            sizeof(glm::mat4),
+            sizeof(uint32_t),
+            sizeof(uint32_t),
+            sizeof(MeshBounds),
+            sizeof(uint32_t)
+        };
+
+        uint32_t alignOffset(uint32_t offset)
+        {
+            return (offset + ENTITY_COMPONENT_ALIGNMENT - 1) & ~uint32_t(ENTITY_COMPONENT_ALIGNMENT - 1);
+        }
+
+        void setDefaultComponent(uint32_t component, void *data)
+        {
+            switch(component)
+            {
+                case 0:
+                {
+                    glm::mat4 identity(1.0f);
+                    std::memcpy(data, &identity, sizeof(identity));
+                    break;
+                }
+                case 1:
+                case 2:
+                {
+                    uint32_t handle = ENTITY_INVALID_HANDLE;
+                    std::memcpy(data, &handle, sizeof(handle));
+                    break;
+                }
+                default:
+                    std::memset(data, 0, COMPONENT_SIZES[component]);
+                    break;
+            }
+        }
+    }
+
+    EntityStore::EntityStore()
+    {
+
+    }
+
+    EntityStore::~EntityStore()
+    {
+
+    }
+
+    /**
+     * @brief Creates an entity in the archetype of its components, reusing a destroyed handle if there is one.
+     * @param componentMask EntityComponentBits.
+     * @return The new entity, ENTITY_INVALID if the mask has unknown bits.
+     */
+    Entity EntityStore::createEntity(uint32_t componentMask)
+    {
+        if(componentMask >> ENTITY_COMPONENT_COUNT)
+        {
+            std::cerr << "Failed to create an entity with unknown components!" << std::endl;
+            return ENTITY_INVALID;
+        }
+
+        Entity entity;
+        if(!freeEntities.empty())
+        {
+            entity = freeEntities.back();
+            freeEntities.pop_back();
+        }
+        else
+        {
+            entity = static_cast<Entity>(locations.size());
+            locations.push_back({UINT32_MAX, 0, 0});
+        }
+        locations[entity] = allocateRow(findOrCreateArchetype(componentMask), entity);
+        ++entityCount;
+        return entity;
+    }
+
+    void EntityStore::destroyEntity(Entity entity)
+    {
+        if(!isValid(entity))
+            return;
+
+        removeRow(locations[entity]);
+        locations[entity].archetype = UINT32_MAX;
+        freeEntities.push_back(entity);
+        --entityCount;
+    }
+
+    /**
+     * @brief Moves an entity into the archetype of the new components. Components both
+     *        archetypes have are copied, new ones start with their defaults.
+     * @param entity
+     * @param componentMask
+     * @return False if the entity does not exist or the mask has unknown bits.
+     */
+    bool EntityStore::setComponentMask(Entity entity, uint32_t componentMask)
+    {
+        if(!isValid(entity) || (componentMask >> ENTITY_COMPONENT_COUNT))
+        {
+            std::cerr << "Failed to change the components of an entity!" << std::endl;
+            return false;
+        }
+        if(archetypes[locations[entity].archetype].componentMask == componentMask)
+            return true;
+
+        //Creating the archetype may reallocate the archetype vector, so it is done before
+        //anything refers into it.
+        uint32_t newArchetypeIndex = findOrCreateArchetype(componentMask);
+        EntityLocation oldLocation = locations[entity];
+        EntityLocation newLocation = allocateRow(newArchetypeIndex, entity);
+
+        const Archetype &oldArchetype = archetypes[oldLocation.archetype];
+        Archetype &newArchetype = archetypes[newArchetypeIndex];
+        uint8_t *oldChunk = oldArchetype.chunks[oldLocation.chunk]->bytes;
+        uint8_t *newChunk = newArchetype.chunks[newLocation.chunk]->bytes;
+        for(uint32_t component = 0; component < ENTITY_COMPONENT_COUNT; ++component)
+        {
+            if(!(oldArchetype.componentMask & newArchetype.componentMask & (1u << component)))
+                continue;
+            std::memcpy(newChunk + newArchetype.componentOffsets[component] + newLocation.row * COMPONENT_SIZES[component],
+                        oldChunk + oldArchetype.componentOffsets[component] + oldLocation.row * COMPONENT_SIZES[component],
+                        COMPONENT_SIZES[component]);
+        }
+
+        removeRow(oldLocation);
+        locations[entity] = newLocation;
+        return true;
+    }
+
+    glm::mat4 *EntityStore::getTransform(Entity entity)
+    {
+        return static_cast<glm::mat4*>(getComponent(entity, 0));
+    }
+
+    uint32_t *EntityStore::getMesh(Entity entity)
+    {
+        return static_cast<uint32_t*>(getComponent(entity, 1));
+    }
+
+    uint32_t *EntityStore::getMaterial(Entity entity)
+    {
+        return static_cast<uint32_t*>(getComponent(entity, 2));
+    }
+
+    MeshBounds *EntityStore::getBounds(Entity entity)
+    {
+        return static_cast<MeshBounds*>(getComponent(entity, 3));
+    }
+
+    uint32_t *EntityStore::getFlags(Entity entity)
+    {
+        return static_cast<uint32_t*>(getComponent(entity, 4));
+    }
+
+    void EntityStore::forEachChunk(uint32_t requiredComponents,
+                                   const std::function<void(const EntityChunkView&)> &function)
+    {
+        for(Archetype &archetype : archetypes)
+        {
+            if((archetype.componentMask & requiredComponents) != requiredComponents)
+                continue;
+            for(uint32_t chunk = 0; chunk < archetype.chunks.size(); ++chunk)
+                function(makeView(archetype, chunk));
+        }
+    }
+
+    /**
+     * @brief Collects the matching chunks and runs the function over them on the pool's
+     *        threads. Every chunk is visited by a single thread.
+     * @param requiredComponents
+     * @param threadPool
+     * @param function Must not create or destroy entities or change their components.
+     */
+    void EntityStore::parallelForEachChunk(uint32_t requiredComponents, ThreadPool &threadPool,
+                                           const std::function<void(const EntityChunkView&)> &function)
+    {
+        std::vector<EntityChunkView> views;
+        forEachChunk(requiredComponents, [&views](const EntityChunkView &view)
+        {
+            views.push_back(view);
+        });
+
+        threadPool.parallelFor(views.size(), ENTITY_CHUNKS_PER_JOB, [&](size_t begin, size_t end)
+        {
+            for(size_t i = begin; i < end; ++i)
+                function(views[i]);
+        });
+    }
+
+    /**
+     * @brief Tests the world space bounding sphere of every entity with a transform, bounds
+     *        and flags against the frustum.
+     * @param frustum
+     * @param threadPool Runs the chunks in parallel if given.
+     */
+    void EntityStore::cullEntities(const Frustum &frustum, ThreadPool *threadPool)
+    {
+        auto cullChunk = [&frustum](const EntityChunkView &view)
+        {
+            for(uint32_t i = 0; i < view.count; ++i)
+            {
+                glm::vec3 center;
+                float radius;
+                FrustumCuller::transformSphere(view.transforms[i], view.bounds[i], center, radius);
+                bool inside = true;
+                for(const glm::vec4 &plane : frustum.planes)
+                    inside = inside && plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w >= -radius;
+                view.flags[i] = inside ? (view.flags[i] & ~ENTITY_FLAG_CULLED) : (view.flags[i] | ENTITY_FLAG_CULLED);
+            }
+        };
+
+        const uint32_t required = ENTITY_COMPONENT_TRANSFORM_BIT | ENTITY_COMPONENT_BOUNDS_BIT | ENTITY_COMPONENT_FLAGS_BIT;
+        if(threadPool != nullptr)
+            parallelForEachChunk(required, *threadPool, cullChunk);
+        else
+            forEachChunk(required, cullChunk);
+    }
+
+    size_t EntityStore::getChunkCount() const
+    {
+        size_t count = 0;
+        for(const Archetype &archetype : archetypes)
+            count += archetype.chunks.size();
+        return count;
+    }
+
+    uint32_t EntityStore::computeChunkCapacity(uint32_t componentMask)
+    {
+        uint32_t entitySize = sizeof(Entity);
+        for(uint32_t component = 0; component < ENTITY_COMPONENT_COUNT; ++component)
+        {
+            if(componentMask & (1u << component))
+                entitySize += COMPONENT_SIZES[component];
+        }
+        //Every array may start up to an alignment after the previous one ends.
+        uint32_t padding = (ENTITY_COMPONENT_COUNT + 1) * ENTITY_COMPONENT_ALIGNMENT;
+        return (ENTITY_CHUNK_SIZE - padding) / entitySize;
+    }
+
+    /**
+     * @brief Places the entity array and then every component array of the archetype one
+     *        after another in the chunk.
+     * @param archetype
+     */
+    void EntityStore::computeLayout(Archetype &archetype)
+    {
+        archetype.chunkCapacity = computeChunkCapacity(archetype.componentMask);
+        uint32_t offset = 0;
+        archetype.entityOffset = offset;
+        offset += archetype.chunkCapacity * sizeof(Entity);
+        for(uint32_t component = 0; component < ENTITY_COMPONENT_COUNT; ++component)
+        {
+            if(!(archetype.componentMask & (1u << component)))
+            {
+                archetype.componentOffsets[component] = UINT32_MAX;
+                continue;
+            }
+            offset = alignOffset(offset);
+            archetype.componentOffsets[component] = offset;
+            offset += archetype.chunkCapacity * COMPONENT_SIZES[component];
+        }
+    }
+
+    uint32_t EntityStore::findOrCreateArchetype(uint32_t componentMask)
+    {
+        for(uint32_t i = 0; i < archetypes.size(); ++i)
+        {
+            if(archetypes[i].componentMask == componentMask)
+                return i;
+        }
+
+        Archetype archetype;
+        archetype.componentMask = componentMask;
+        computeLayout(archetype);
+        archetypes.push_back(std::move(archetype));
+        return static_cast<uint32_t>(archetypes.size() - 1);
+    }
+
+    EntityStore::EntityLocation EntityStore::allocateRow(uint32_t archetypeIndex, Entity entity)
+    {
+        Archetype &archetype = archetypes[archetypeIndex];
+        if(archetype.chunks.empty() || archetype.chunkCounts.back() == archetype.chunkCapacity)
+        {
+            archetype.chunks.emplace_back(new ChunkData);
+            archetype.chunkCounts.push_back(0);
+        }
+
+        EntityLocation location;
+        location.archetype = archetypeIndex;
+        location.chunk = static_cast<uint32_t>(archetype.chunks.size() - 1);
+        location.row = archetype.chunkCounts.back()++;
+
+        uint8_t *chunk = archetype.chunks[location.chunk]->bytes;
+        std::memcpy(chunk + archetype.entityOffset + location.row * sizeof(Entity), &entity, sizeof(Entity));
+        for(uint32_t component = 0; component < ENTITY_COMPONENT_COUNT; ++component)
+        {
+            if(archetype.componentMask & (1u << component))
+            {
+                setDefaultComponent(component, chunk + archetype.componentOffsets[component] +
+                                               location.row * COMPONENT_SIZES[component]);
+            }
+        }
+        return location;
+    }
+
+    /**
+     * @brief Fills the hole with the archetype's last entity so that the chunks stay dense,
+     *        and frees the last chunk once it is empty.
+     * @param location
+     */
+    void EntityStore::removeRow(const EntityLocation &location)
+    {
+        Archetype &archetype = archetypes[location.archetype];
+        uint32_t lastChunk = static_cast<uint32_t>(archetype.chunks.size() - 1);
+        uint32_t lastRow = archetype.chunkCounts[lastChunk] - 1;
+        if(location.chunk != lastChunk || location.row != lastRow)
+        {
+            uint8_t *destination = archetype.chunks[location.chunk]->bytes;
+            const uint8_t *source = archetype.chunks[lastChunk]->bytes;
+            Entity movedEntity;
+            std::memcpy(&movedEntity, source + archetype.entityOffset + lastRow * sizeof(Entity), sizeof(Entity));
+            std::memcpy(destination + archetype.entityOffset + location.row * sizeof(Entity), &movedEntity, sizeof(Entity));
+            for(uint32_t component = 0; component < ENTITY_COMPONENT_COUNT; ++component)
+            {
+                if(!(archetype.componentMask & (1u << component)))
+                    continue;
+                uint32_t size = COMPONENT_SIZES[component];
+                std::memcpy(destination + archetype.componentOffsets[component] + location.row * size,
+                            source + archetype.componentOffsets[component] + lastRow * size, size);
+            }
+            locations[movedEntity].chunk = location.chunk;
+            locations[movedEntity].row = location.row;
+        }
+
+        if(--archetype.chunkCounts[lastChunk] == 0)
+        {
+            archetype.chunks.pop_back();
+            archetype.chunkCounts.pop_back();
+        }
+    }
+
+    void *EntityStore::getComponent(Entity entity, uint32_t component)
+    {
+        if(!isValid(entity))
+            return nullptr;
+
+        const EntityLocation &location = locations[entity];
+        Archetype &archetype = archetypes[location.archetype];
+        if(!(archetype.componentMask & (1u << component)))
+            return nullptr;
+        return archetype.chunks[location.chunk]->bytes + archetype.componentOffsets[component] +
+               location.row * COMPONENT_SIZES[component];
+    }
+
+    EntityChunkView EntityStore::makeView(Archetype &archetype, uint32_t chunk)
+    {
+        uint8_t *bytes = archetype.chunks[chunk]->bytes;
+        auto componentArray = [&](uint32_t component) -> void*
+        {
+            return archetype.componentOffsets[component] == UINT32_MAX ? nullptr :
+                                                                         bytes + archetype.componentOffsets[component];
+        };
+
+        EntityChunkView view;
+        view.entities = reinterpret_cast<const Entity*>(bytes + archetype.entityOffset);
+        view.transforms = static_cast<glm::mat4*>(componentArray(0));
+        view.meshes = static_cast<uint32_t*>(componentArray(1));
+        view.materials = static_cast<uint32_t*>(componentArray(2));
+        view.bounds = static_cast<MeshBounds*>(componentArray(3));
+        view.flags = static_cast<uint32_t*>(componentArray(4));
+        view.count = archetype.chunkCounts[chunk];
+        return view;
+    }
+}
@@ -1,5 +1,8 @@
 #include "Headers.h"
 #include "FileIO.h"
+#include "AssetArchive.h"
+#include "CookedAssets.h"
+#include <algorithm>
 #include <fstream>
 #include <iostream>
 #define STB_IMAGE_IMPLEMENTATION
@@ -9,7 +12,54 @@ namespace Raven
 {
     namespace FileIO
     {
-    /**
+        //The pack that is searched before loose files. Not owned.
+        static AssetArchive *mountedArchive = nullptr;
+
+        /**
+         * @brief Mounts an asset pack. Reads through FileIO will look for the file
+         *        inside the pack first and fall back to the disk if it is not there.
+         * @param archive Open archive or nullptr to unmount.
+         */
+        void mountArchive(AssetArchive *archive) noexcept
+        {
+            mountedArchive = archive;
+        }
+
+        /**
+         * @brief Returns the name a file has inside an asset pack. Packs are built from
+         *        the Resources directory, so everything up to and including "Resources/"
+         *        is stripped from the path.
+         * @param filename
+         * @return The pack entry name.
+         */
+        std::string getArchiveAssetName(const std::string &filename)
+        {
+            std::string name = filename;
+            std::replace(name.begin(), name.end(), '\\', '/');
+
+            const std::string resourceDirectory = "Resources/";
+            size_t position = name.rfind(resourceDirectory);
+            if(position != std::string::npos)
+                return name.substr(position + resourceDirectory.size());
+
+            while(name.compare(0, 3, "../") == 0 || name.compare(0, 2, "./") == 0)
+                name.erase(0, name[0] == '.' && name[1] == '.' ? 3 : 2);
+            return name;
+        }
+
+        /**
+         * @brief Returns the directory assets are loaded from. Cooked assets are preferred,
+         *        the source resources are used if the AssetBuilder has not run, e.g. when the
+         *        engine was built without the CookAssets target.
+         * @return The directory, ending in a slash.
+         */
+        std::string getAssetDirectory()
+        {
+            std::ifstream database(SETTINGS_COOKED_ASSET_DIRECTORY COOKED_ASSET_DATABASE_FILENAME);
+            return database.is_open() ? SETTINGS_COOKED_ASSET_DIRECTORY : SETTINGS_RESOURCE_DIRECTORY;
+        }
+
+        /**
          * @brief Reads an image file and loads the texture data.
          * @param filename
          * @param imageData
@@ -28,12 +78,19 @@ namespace Raven
             int height = 0;
             int components = 0;
 
-            std::unique_ptr<unsigned char, void(*)(void*)> stbiData(stbi_load(filename.c_str(),
-                                                                              &width,
-                                                                              &height,
-                                                                              &components,
-                                                                              requestedComponentCount),
-                                                                    stbi_image_free);
+            //Decode straight from the mapped pack if the image is packed.
+            AssetSpan packedImage;
+            bool isPacked = mountedArchive != nullptr &&
+                            mountedArchive->getAsset(getArchiveAssetName(filename), packedImage);
+
+            std::unique_ptr<unsigned char, void(*)(void*)> stbiData(
+                        isPacked ? stbi_load_from_memory(reinterpret_cast<const stbi_uc*>(packedImage.data),
+                                                         static_cast<int>(packedImage.size),
+                                                         &width, &height, &components,
+                                                         requestedComponentCount)
+                                 : stbi_load(filename.c_str(), &width, &height, &components,
+                                             requestedComponentCount),
+                        stbi_image_free);
 
             if((!stbiData)  ||
                (width <= 0) ||
@@ -69,6 +126,14 @@ namespace Raven
          */
         std::vector<char> readBinaryFile(std::string filename)
         {
+            //Look into the mounted pack before touching the disk.
+            if(mountedArchive != nullptr)
+            {
+                std::vector<char> packedContents;
+                if(mountedArchive->readAsset(getArchiveAssetName(filename), packedContents))
+                    return packedContents;
+            }
+
             //Open the file.
             std::ifstream file(filename, std::ios::ate | std::ios::binary);
             if(!file.is_open())
@@ -0,0 +1,308 @@
+#include "FrustumCuller.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+    #define FRUSTUM_CULLER_X86
+    #include <immintrin.h>
+    #if defined(_MSC_VER)
+        #include <intrin.h>
+    #endif
+#endif
+
+//GCC and Clang only emit AVX for functions that ask for it, MSVC always does.
+#if defined(FRUSTUM_CULLER_X86) && (defined(__GNUC__) || defined(__clang__))
+    #define FRUSTUM_CULLER_TARGET_AVX __attribute__((target("avx")))
+#else
+    #define FRUSTUM_CULLER_TARGET_AVX
+#endif
+
+static_assert(FRUSTUM_CULL_CHUNK_SIZE % 8 == 0, "Chunks have to hold whole AVX batches.");
+
+namespace Raven
+{
+    namespace
+    {
+        //Culls the spheres [begin, end), end being a multiple of the batch size.
+        typedef void (*CullFunction)(const Frustum &frustum, const float *centersX, const float *centersY,
+                                     const float *centersZ, const float *radii, size_t begin, size_t end,
+                                     std::vector<uint32_t> &visible);
+
+#ifndef FRUSTUM_CULLER_X86
+        void cullScalar(const Frustum &frustum, const float *centersX, const float *centersY,
+                        const float *centersZ, const float *radii, size_t begin, size_t end,
+                        std::vector<uint32_t> &visible)
+        {
+            for(size_t i = begin; i < end; ++i)
+            {
+                bool inside = true;
+                for(int p = 0; p < 6 && inside; ++p)
+                {
+                    const glm::vec4 &plane = frustum.planes[p];
+                    float distance = plane.x * centersX[i] + plane.y * centersY[i] + plane.z * centersZ[i] + plane.w;
+                    inside = distance >= -radii[i];
+                }
+                if(inside)
+                    visible.push_back(static_cast<uint32_t>(i));
+            }
+        }
+#else
+        void cullSse(const Frustum &frustum, const float *centersX, const float *centersY,
+                     const float *centersZ, const float *radii, size_t begin, size_t end,
+                     std::vector<uint32_t> &visible)
+        {
+            __m128 planeX[6], planeY[6], planeZ[6], planeW[6];
+            for(int p = 0; p < 6; ++p)
+            {
+                planeX[p] = _mm_set1_ps(frustum.planes[p].x);
+                planeY[p] = _mm_set1_ps(frustum.planes[p].y);
+                planeZ[p] = _mm_set1_ps(frustum.planes[p].z);
+                planeW[p] = _mm_set1_ps(frustum.planes[p].w);
+            }
+
+            for(size_t i = begin; i < end; i += 4)
+            {
+                __m128 x = _mm_loadu_ps(centersX + i);
+                __m128 y = _mm_loadu_ps(centersY + i);
+                __m128 z = _mm_loadu_ps(centersZ + i);
+                __m128 negativeRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(radii + i));
+                __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+                for(int p = 0; p < 6; ++p)
+                {
+                    __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(planeX[p], x), _mm_mul_ps(planeY[p], y)),
+                                                 _mm_add_ps(_mm_mul_ps(planeZ[p], z), planeW[p]));
+                    inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negativeRadius));
+                }
+
+                int mask = _mm_movemask_ps(inside);
+                for(int lane = 0; mask != 0; ++lane, mask >>= 1)
+                {
+                    if(mask & 1)
+                        visible.push_back(static_cast<uint32_t>(i + lane));
+                }
+            }
+        }
+
+        FRUSTUM_CULLER_TARGET_AVX
+        void cullAvx(const Frustum &frustum, const float *centersX, const float *centersY,
+                     const float *centersZ, const float *radii, size_t begin, size_t end,
+                     std::vector<uint32_t> &visible)
+        {
+            __m256 planeX[6], planeY[6], planeZ[6], planeW[6];
+            for(int p = 0; p < 6; ++p)
+            {
+                planeX[p] = _mm256_set1_ps(frustum.planes[p].x);
+                planeY[p] = _mm256_set1_ps(frustum.planes[p].y);
+                planeZ[p] = _mm256_set1_ps(frustum.planes[p].z);
+                planeW[p] = _mm256_set1_ps(frustum.planes[p].w);
+            }
+
+            for(size_t i = begin; i < end; i += 8)
+            {
+                __m256 x = _mm256_loadu_ps(centersX + i);
+                __m256 y = _mm256_loadu_ps(centersY + i);
+                __m256 z = _mm256_loadu_ps(centersZ + i);
+                __m256 negativeRadius = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(radii + i));
+                __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+                for(int p = 0; p < 6; ++p)
+                {
+                    __m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(planeX[p], x), _mm256_mul_ps(planeY[p], y)),
+                                                    _mm256_add_ps(_mm256_mul_ps(planeZ[p], z), planeW[p]));
+                    inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, negativeRadius, _CMP_GE_OQ));
+                }
+
+                int mask = _mm256_movemask_ps(inside);
+                for(int lane = 0; mask != 0; ++lane, mask >>= 1)
+                {
+                    if(mask & 1)
+                        visible.push_back(static_cast<uint32_t>(i + lane));
+                }
+            }
+        }
+
+        bool isAvxSupported()
+        {
+#if defined(_MSC_VER)
+            int info[4];
+            __cpuid(info, 1);
+            //AVX needs both the CPU flag and an OS that saves the YMM registers.
+            bool osSavesRegisters = (info[2] & (1 << 27)) != 0;
+            bool cpuHasAvx = (info[2] & (1 << 28)) != 0;
+            return osSavesRegisters && cpuHasAvx && (_xgetbv(0) & 6) == 6;
+#else
+            return __builtin_cpu_supports("avx");
+#endif
+        }
+#endif
+
+        //Picks the widest implementation the CPU supports.
+        CullFunction selectCullFunction()
+        {
+#ifdef FRUSTUM_CULLER_X86
+            return isAvxSupported() ? cullAvx : cullSse;
+#else
+            return cullScalar;
+#endif
+        }
+    }
+
+    FrustumCuller::FrustumCuller()
+    {
+
+    }
+
+    FrustumCuller::~FrustumCuller()
+    {
+
+    }
+
+    /**
+     * @brief Extracts the frustum planes from the rows of a view projection matrix
+     *        (Gribb and Hartmann). Clip space depth goes from 0 to w as in Vulkan.
+     * @param viewProjection
+     * @return Normalized planes facing into the frustum.
+     */
+    Frustum FrustumCuller::extractFrustum(const glm::mat4 &viewProjection)
+    {
+        //glm is column major, so a row is made of the i-th element of every column.
+        glm::vec4 rows[4];
+        for(int i = 0; i < 4; ++i)
+            rows[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+
+        Frustum frustum;
+        frustum.planes[0] = rows[3] + rows[0];
+        frustum.planes[1] = rows[3] - rows[0];
+        frustum.planes[2] = rows[3] + rows[1];
+        frustum.planes[3] = rows[3] - rows[1];
+        frustum.planes[4] = rows[2];
+        frustum.planes[5] = rows[3] - rows[2];
+        for(glm::vec4 &plane : frustum.planes)
+        {
+            float length = std::sqrt(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
+            if(length > 0.0f)
+                plane *= 1.0f / length;
+        }
+        return frustum;
+    }
+
+    /**
+     * @brief Transforms the center of a part's bounding sphere and scales its radius by
+     *        the largest axis scale of the matrix, so the sphere still encloses the part.
+     * @param modelMatrix
+     * @param bounds
+     * @param center
+     * @param radius
+     */
+    void FrustumCuller::transformSphere(const glm::mat4 &modelMatrix, const MeshBounds &bounds,
+                                        glm::vec3 &center, float &radius)
+    {
+        glm::vec4 worldCenter = modelMatrix * glm::vec4(bounds.center[0], bounds.center[1], bounds.center[2], 1.0f);
+        center = glm::vec3(worldCenter.x, worldCenter.y, worldCenter.z);
+
+        float maxSquaredScale = 0.0f;
+        for(int column = 0; column < 3; ++column)
+        {
+            const glm::vec4 &axis = modelMatrix[column];
+            maxSquaredScale = std::max(maxSquaredScale, axis.x * axis.x + axis.y * axis.y + axis.z * axis.z);
+        }
+        radius = bounds.radius * std::sqrt(maxSquaredScale);
+    }
+
+    /**
+     * @brief Returns how many pixels one view space unit covers at a depth in front of the camera.
+     *        projection[1][1] is cot(fovY / 2), which maps view space height to NDC. It is negative
+     *        when the projection flips y for Vulkan, so only its magnitude is used.
+     * @param projectionMatrix
+     * @param viewportHeight
+     * @param depth Distance along the view direction, has to be positive.
+     * @return Pixels per view space unit.
+     */
+    float FrustumCuller::calculatePixelsPerUnit(const glm::mat4 &projectionMatrix, float viewportHeight, float depth)
+    {
+        return std::fabs(projectionMatrix[1][1]) * viewportHeight * 0.5f / depth;
+    }
+
+    void FrustumCuller::clear()
+    {
+        centersX.clear();
+        centersY.clear();
+        centersZ.clear();
+        radii.clear();
+        sphereCount = 0;
+    }
+
+    /**
+     * @brief Appends a sphere. The arrays grow in batches of 8 so that the SIMD paths
+     *        never have to handle a partial batch.
+     * @param center
+     * @param radius
+     * @return Index of the sphere.
+     */
+    uint32_t FrustumCuller::addSphere(const glm::vec3 &center, float radius)
+    {
+        if(sphereCount == radii.size())
+        {
+            size_t paddedCount = radii.size() + 8;
+            centersX.resize(paddedCount, 0.0f);
+            centersY.resize(paddedCount, 0.0f);
+            centersZ.resize(paddedCount, 0.0f);
+            radii.resize(paddedCount, -std::numeric_limits<float>::infinity());
+        }
+
+        uint32_t index = static_cast<uint32_t>(sphereCount++);
+        setSphere(index, center, radius);
+        return index;
+    }
+
+    void FrustumCuller::setSphere(uint32_t index, const glm::vec3 &center, float radius)
+    {
+        centersX[index] = center.x;
+        centersY[index] = center.y;
+        centersZ[index] = center.z;
+        radii[index] = radius;
+    }
+
+    /**
+     * @brief Tests every sphere against the six planes. A sphere is culled once it lies
+     *        completely behind any of them. Every chunk writes into its own list and the
+     *        lists are joined in order, so the result does not depend on the thread count.
+     * @param frustum
+     * @param visible Receives the indices of the visible spheres.
+     * @param threadPool Optional pool to spread the chunks over.
+     */
+    void FrustumCuller::cull(const Frustum &frustum, std::vector<uint32_t> &visible, ThreadPool *threadPool)
+    {
+        static const CullFunction cullFunction = selectCullFunction();
+
+        visible.clear();
+        size_t chunkCount = (sphereCount + FRUSTUM_CULL_CHUNK_SIZE - 1) / FRUSTUM_CULL_CHUNK_SIZE;
+        if(chunkResults.size() < chunkCount)
+            chunkResults.resize(chunkCount);
+
+        auto cullChunk = [&](size_t begin, size_t end)
+        {
+            std::vector<uint32_t> &chunkVisible = chunkResults[begin / FRUSTUM_CULL_CHUNK_SIZE];
+            chunkVisible.clear();
+            //The padding after the last sphere completes its batch.
+            cullFunction(frustum, centersX.data(), centersY.data(), centersZ.data(), radii.data(),
+                         begin, std::min((end + 7) & ~size_t(7), radii.size()), chunkVisible);
+        };
+        if(threadPool)
+        {
+            threadPool->parallelFor(sphereCount, FRUSTUM_CULL_CHUNK_SIZE, cullChunk);
+        }
+        else
+        {
+            for(size_t begin = 0; begin < sphereCount; begin += FRUSTUM_CULL_CHUNK_SIZE)
+                cullChunk(begin, std::min(begin + FRUSTUM_CULL_CHUNK_SIZE, sphereCount));
+        }
+
+        size_t visibleCount = 0;
+        for(size_t chunk = 0; chunk < chunkCount; ++chunk)
+            visibleCount += chunkResults[chunk].size();
+        visible.reserve(visibleCount);
+        for(size_t chunk = 0; chunk < chunkCount; ++chunk)
+            visible.insert(visible.end(), chunkResults[chunk].begin(), chunkResults[chunk].end());
+    }
+}
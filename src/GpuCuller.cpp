@@ -0,0 +1,484 @@
+#include "GpuCuller.h"
+#include "VulkanUtility.h"
+#include "VulkanStructures.h"
+#include "VulkanDescriptorManager.h"
+#include "BarrierBatch.h"
+#include <cstring>
+
+static_assert(sizeof(Raven::GpuCullDraw) == 32, "GpuCullDraw has to match DrawData in culling.comp.");
+static_assert(sizeof(Raven::GpuCullOcclusionData) == 80, "GpuCullOcclusionData has to match OcclusionData in occlusionculling.comp.");
+static_assert(sizeof(VkDrawIndexedIndirectCommand) == 20, "Commands are written with a stride of 20 bytes.");
+
+namespace Raven
+{
+    GpuCuller::GpuCuller()
+    {
+
+    }
+
+    GpuCuller::~GpuCuller()
+    {
+        destroy();
+    }
+
+    /**
+     * @brief Creates the culling pipeline and its buffers.
+     * @param logicalDevice
+     * @param memoryProperties
+     * @param enabledFeatures Features of the logical device. drawIndirectFirstInstance is required
+     *        since the first instance carries the scene node handle.
+     * @param drawIndirectCountEnabled True if VK_KHR_draw_indirect_count is enabled.
+     * @param shaderFilename Compiled culling.comp.
+     * @param maxDraws
+     * @return False if the device lacks a required feature or anything could not be created.
+     */
+    bool GpuCuller::initialize(VkDevice logicalDevice,
+                               const VkPhysicalDeviceMemoryProperties &memoryProperties,
+                               const VkPhysicalDeviceFeatures &enabledFeatures,
+                               bool drawIndirectCountEnabled,
+                               const std::string &shaderFilename,
+                               uint32_t maxDraws)
+    {
+        destroy();
+        if(!enabledFeatures.drawIndirectFirstInstance)
+        {
+            std::cerr << "Failed to initialize gpu culling, indirect draws can not set the first instance!" << std::endl;
+            return false;
+        }
+        if(maxDraws == 0)
+        {
+            std::cerr << "Failed to initialize gpu culling without any draws!" << std::endl;
+            return false;
+        }
+        this->logicalDevice = logicalDevice;
+        this->maxDraws = maxDraws;
+        useDrawCount = drawIndirectCountEnabled;
+        useMultiDraw = enabledFeatures.multiDrawIndirect == VK_TRUE;
+
+        if(!createCullingBuffer(memoryProperties, sizeof(GpuCullDraw) * maxDraws,
+                                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                                drawBuffer, drawMemory) ||
+           !createCullingBuffer(memoryProperties, sizeof(VkDrawIndexedIndirectCommand) * maxDraws,
+                                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT |
+                                VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, commandBuffer, commandMemory) ||
+           !createCullingBuffer(memoryProperties, sizeof(uint32_t),
+                                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT |
+                                VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, countBuffer, countMemory))
+        {
+            destroy();
+            return false;
+        }
+
+        if(vkMapMemory(logicalDevice, drawMemory, 0, drawBuffer.size, 0, &drawBuffer.data) != VK_SUCCESS)
+        {
+            std::cerr << "Failed to map gpu culling draw memory!" << std::endl;
+            drawBuffer.data = nullptr;
+            destroy();
+            return false;
+        }
+
+        //Instances, draws, commands and the count.
+        std::vector<VkDescriptorSetLayoutBinding> bindings(4);
+        for(uint32_t i = 0; i < bindings.size(); ++i)
+            bindings[i] = {i, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr};
+        VkDescriptorPoolSize poolSize = {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, static_cast<uint32_t>(bindings.size())};
+        std::vector<VkDescriptorSet> descriptorSets;
+        VkPushConstantRange pushConstantRange = {VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(GpuCullPushConstants)};
+        if(!VulkanDescriptorManager::createDescriptorSetLayout(logicalDevice, bindings, descriptorSetLayout) ||
+           !VulkanDescriptorManager::createDescriptorPool(logicalDevice, VK_FALSE, 1, {poolSize}, descriptorPool) ||
+           !VulkanDescriptorManager::allocateDescriptorSets(logicalDevice, descriptorPool,
+                                                            {descriptorSetLayout}, descriptorSets) ||
+           !createPipelineLayout(logicalDevice, {descriptorSetLayout}, {pushConstantRange}, pipelineLayout))
+        {
+            destroy();
+            return false;
+        }
+        descriptorSet = descriptorSets[0];
+
+        BufferDescriptorInfo drawDescriptor = {descriptorSet, 1, 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                                               {{drawBuffer.buffer, 0, VK_WHOLE_SIZE}}};
+        BufferDescriptorInfo commandDescriptor = {descriptorSet, 2, 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                                                  {{commandBuffer.buffer, 0, VK_WHOLE_SIZE}}};
+        BufferDescriptorInfo countDescriptor = {descriptorSet, 3, 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                                                {{countBuffer.buffer, 0, VK_WHOLE_SIZE}}};
+        VulkanDescriptorManager::updateDescriptorSets(logicalDevice, {},
+                                                      {drawDescriptor, commandDescriptor, countDescriptor}, {}, {});
+
+        VkShaderModule shaderModule = VK_NULL_HANDLE;
+        if(!loadShaderModule(logicalDevice, shaderFilename, shaderModule))
+        {
+            std::cerr << "Failed to load gpu culling shader!" << std::endl;
+            destroy();
+            return false;
+        }
+
+        VkComputePipelineCreateInfo pipelineInfo = {};
+        pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        pipelineInfo.stage = VulkanStructures::pipelineShaderStageCreateInfo(VK_SHADER_STAGE_COMPUTE_BIT,
+                                                                             shaderModule, "main", nullptr);
+        pipelineInfo.layout = pipelineLayout;
+        pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+        pipelineInfo.basePipelineIndex = -1;
+        std::vector<VkPipeline> pipelines;
+        bool pipelineCreated = createComputePipelines(logicalDevice, VK_NULL_HANDLE, {pipelineInfo}, pipelines);
+        //The module is not needed once the pipeline exists.
+        destroyShaderModule(logicalDevice, shaderModule);
+        if(!pipelineCreated)
+        {
+            destroy();
+            return false;
+        }
+        pipeline = pipelines[0];
+        return true;
+    }
+
+    void GpuCuller::destroy()
+    {
+        if(logicalDevice == VK_NULL_HANDLE)
+            return;
+
+        destroyPipeline(logicalDevice, occlusionPipeline);
+        destroyPipelineLayout(logicalDevice, occlusionPipelineLayout);
+        VulkanDescriptorManager::destroyDescriptorPool(logicalDevice, occlusionPool);
+        VulkanDescriptorManager::destroyDescriptorSetLayout(logicalDevice, occlusionSetLayout);
+        occlusionSet = VK_NULL_HANDLE;
+        destroyBuffer(logicalDevice, occlusionDataBuffer.buffer);
+        destroyBuffer(logicalDevice, visibilityBuffer.buffer);
+        freeMemory(logicalDevice, occlusionDataMemory);
+        freeMemory(logicalDevice, visibilityMemory);
+        occlusionDataBuffer = VulkanBuffer();
+        visibilityBuffer = VulkanBuffer();
+        visibilityValid = false;
+        pyramidLevelCount = 0;
+
+        destroyPipeline(logicalDevice, pipeline);
+        destroyPipelineLayout(logicalDevice, pipelineLayout);
+        //Destroying the pool frees the descriptor set.
+        VulkanDescriptorManager::destroyDescriptorPool(logicalDevice, descriptorPool);
+        VulkanDescriptorManager::destroyDescriptorSetLayout(logicalDevice, descriptorSetLayout);
+        descriptorSet = VK_NULL_HANDLE;
+
+        if(drawBuffer.data != nullptr)
+            vkUnmapMemory(logicalDevice, drawMemory);
+        destroyBuffer(logicalDevice, drawBuffer.buffer);
+        destroyBuffer(logicalDevice, commandBuffer.buffer);
+        destroyBuffer(logicalDevice, countBuffer.buffer);
+        freeMemory(logicalDevice, drawMemory);
+        freeMemory(logicalDevice, commandMemory);
+        freeMemory(logicalDevice, countMemory);
+        drawBuffer = VulkanBuffer();
+        commandBuffer = VulkanBuffer();
+        countBuffer = VulkanBuffer();
+
+        maxDraws = 0;
+        drawCount = 0;
+        logicalDevice = VK_NULL_HANDLE;
+    }
+
+    /**
+     * @brief Creates the occlusion culling pipeline. It shares the culling descriptor set and
+     *        adds a second one with the depth pyramid, the occlusion data and the per draw
+     *        visibility of the two-phase culling.
+     * @param memoryProperties
+     * @param depthPyramid Has to outlive the culler or be replaced by calling this again.
+     * @param shaderFilename Compiled occlusionculling.comp.
+     * @return False if the culler is not initialized or anything could not be created.
+     */
+    bool GpuCuller::enableOcclusion(const VkPhysicalDeviceMemoryProperties &memoryProperties,
+                                    const DepthPyramid &depthPyramid,
+                                    const std::string &shaderFilename)
+    {
+        if(logicalDevice == VK_NULL_HANDLE)
+        {
+            std::cerr << "Failed to enable occlusion culling before the gpu culler is initialized!" << std::endl;
+            return false;
+        }
+
+        //A new pyramid replaces the old pipeline.
+        destroyPipeline(logicalDevice, occlusionPipeline);
+        destroyPipelineLayout(logicalDevice, occlusionPipelineLayout);
+        VulkanDescriptorManager::destroyDescriptorPool(logicalDevice, occlusionPool);
+        VulkanDescriptorManager::destroyDescriptorSetLayout(logicalDevice, occlusionSetLayout);
+        occlusionSet = VK_NULL_HANDLE;
+        pyramidSize[0] = static_cast<float>(depthPyramid.getWidth());
+        pyramidSize[1] = static_cast<float>(depthPyramid.getHeight());
+        pyramidLevelCount = depthPyramid.getLevelCount();
+
+        if((occlusionDataBuffer.buffer == VK_NULL_HANDLE &&
+            !createCullingBuffer(memoryProperties, sizeof(GpuCullOcclusionData),
+                                 VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, occlusionDataBuffer, occlusionDataMemory)) ||
+           (visibilityBuffer.buffer == VK_NULL_HANDLE &&
+            !createCullingBuffer(memoryProperties, sizeof(uint32_t) * maxDraws,
+                                 VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, visibilityBuffer, visibilityMemory)))
+        {
+            return false;
+        }
+        visibilityValid = false;
+
+        std::vector<VkDescriptorSetLayoutBinding> bindings =
+        {
+            {0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr},
+            {1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr},
+            {2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr}
+        };
+        std::vector<VkDescriptorPoolSize> poolSizes =
+        {
+            {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1},
+            {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1},
+            {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1}
+        };
+        std::vector<VkDescriptorSet> descriptorSets;
+        VkPushConstantRange pushConstantRange = {VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(GpuCullPushConstants)};
+        if(!VulkanDescriptorManager::createDescriptorSetLayout(logicalDevice, bindings, occlusionSetLayout) ||
+           !VulkanDescriptorManager::createDescriptorPool(logicalDevice, VK_FALSE, 1, poolSizes, occlusionPool) ||
+           !VulkanDescriptorManager::allocateDescriptorSets(logicalDevice, occlusionPool,
+                                                            {occlusionSetLayout}, descriptorSets) ||
+           !createPipelineLayout(logicalDevice, {descriptorSetLayout, occlusionSetLayout}, {pushConstantRange},
+                                 occlusionPipelineLayout))
+        {
+            return false;
+        }
+        occlusionSet = descriptorSets[0];
+
+        BufferDescriptorInfo dataDescriptor = {occlusionSet, 0, 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+                                               {{occlusionDataBuffer.buffer, 0, VK_WHOLE_SIZE}}};
+        ImageDescriptorInfo pyramidDescriptor = {occlusionSet, 1, 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                                                 {{depthPyramid.getSampler(), depthPyramid.getImageView(),
+                                                   VK_IMAGE_LAYOUT_GENERAL}}};
+        BufferDescriptorInfo visibilityDescriptor = {occlusionSet, 2, 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                                                     {{visibilityBuffer.buffer, 0, VK_WHOLE_SIZE}}};
+        VulkanDescriptorManager::updateDescriptorSets(logicalDevice, {pyramidDescriptor},
+                                                      {dataDescriptor, visibilityDescriptor}, {}, {});
+
+        VkShaderModule shaderModule = VK_NULL_HANDLE;
+        if(!loadShaderModule(logicalDevice, shaderFilename, shaderModule))
+        {
+            std::cerr << "Failed to load occlusion culling shader!" << std::endl;
+            return false;
+        }
+
+        VkComputePipelineCreateInfo pipelineInfo = {};
+        pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        pipelineInfo.stage = VulkanStructures::pipelineShaderStageCreateInfo(VK_SHADER_STAGE_COMPUTE_BIT,
+                                                                             shaderModule, "main", nullptr);
+        pipelineInfo.layout = occlusionPipelineLayout;
+        pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+        pipelineInfo.basePipelineIndex = -1;
+        std::vector<VkPipeline> pipelines;
+        bool pipelineCreated = createComputePipelines(logicalDevice, VK_NULL_HANDLE, {pipelineInfo}, pipelines);
+        destroyShaderModule(logicalDevice, shaderModule);
+        if(!pipelineCreated)
+            return false;
+        occlusionPipeline = pipelines[0];
+        return true;
+    }
+
+    /**
+     * @brief Binds the buffer the shader reads world matrices from, e.g. the scene instance buffer.
+     * @param instanceBuffer
+     */
+    void GpuCuller::setInstanceBuffer(VkBuffer instanceBuffer)
+    {
+        BufferDescriptorInfo instanceDescriptor = {descriptorSet, 0, 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                                                   {{instanceBuffer, 0, VK_WHOLE_SIZE}}};
+        VulkanDescriptorManager::updateDescriptorSets(logicalDevice, {}, {instanceDescriptor}, {}, {});
+    }
+
+    /**
+     * @brief Copies the draws into the mapped draw buffer.
+     * @param draws
+     * @return False if there are more draws than the culler was created for.
+     */
+    bool GpuCuller::setDraws(const std::vector<GpuCullDraw> &draws)
+    {
+        if(draws.size() > maxDraws)
+        {
+            std::cerr << "Failed to set gpu culling draws, there are more than " << maxDraws << "!" << std::endl;
+            return false;
+        }
+        if(!draws.empty())
+            std::memcpy(drawBuffer.data, draws.data(), sizeof(GpuCullDraw) * draws.size());
+        drawCount = static_cast<uint32_t>(draws.size());
+        //The visibility of the previous draws says nothing about the new ones.
+        visibilityValid = false;
+        return true;
+    }
+
+    /**
+     * @brief Records the culling dispatch. The barriers before it keep the previous pass's
+     *        indirect reads ahead of the new writes, the one after it makes the commands
+     *        visible to the indirect draws.
+     *
+     *        For two-phase occlusion culling a frame records the early phase, draws it,
+     *        builds the depth pyramid from that depth, records the late phase with the
+     *        frame's view projection and draws again on top.
+     * @param cmdBuffer
+     * @param frustum World space frustum.
+     * @param phase One of GPU_CULL_PHASE_*. Every phase but the frustum one needs enableOcclusion.
+     * @param occlusionViewProjection The view projection of the depth in the pyramid, the
+     *        previous frame's for the occlusion phase and the current one for the late phase.
+     */
+    void GpuCuller::recordCulling(VkCommandBuffer cmdBuffer, const Frustum &frustum,
+                                  uint32_t phase, const glm::mat4 &occlusionViewProjection)
+    {
+        if(drawCount == 0)
+            return;
+        bool occlusion = phase != GPU_CULL_PHASE_FRUSTUM;
+        if(occlusion && !isOcclusionEnabled())
+        {
+            std::cerr << "Failed to record occlusion culling, it has not been enabled!" << std::endl;
+            return;
+        }
+
+        //The previous indirect reads have to finish before the commands are rewritten.
+        //Everything the transfers write waits in one barrier, and so does everything the
+        //dispatch uses.
+        BarrierBatch barriers(cmdBuffer);
+        VkPipelineStageFlags generatingStages = VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT;
+        std::vector<BufferTransition> transitions =
+        {
+            {commandBuffer.buffer, VK_ACCESS_INDIRECT_COMMAND_READ_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+             VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED}
+        };
+        if(useDrawCount)
+        {
+            barriers.addBuffer(VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                               {countBuffer.buffer, VK_ACCESS_INDIRECT_COMMAND_READ_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+                                VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED});
+            generatingStages |= VK_PIPELINE_STAGE_TRANSFER_BIT;
+            transitions.push_back({countBuffer.buffer, VK_ACCESS_TRANSFER_WRITE_BIT,
+                                   VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+                                   VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED});
+        }
+        //Only the command and count buffers are read by the draws.
+        std::vector<BufferTransition> indirectTransitions = transitions;
+
+        bool clearVisibility = occlusion && !visibilityValid;
+        if(occlusion)
+        {
+            barriers.addBuffer(VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                               {occlusionDataBuffer.buffer, VK_ACCESS_UNIFORM_READ_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+                                VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED});
+            //The late phase of the last frame may still be reading and writing the visibility.
+            if(clearVisibility)
+            {
+                barriers.addBuffer(VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                   {visibilityBuffer.buffer, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+                                    VK_ACCESS_TRANSFER_WRITE_BIT, VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED});
+            }
+        }
+        barriers.flush();
+
+        if(useDrawCount)
+            vkCmdFillBuffer(cmdBuffer, countBuffer.buffer, 0, sizeof(uint32_t), 0);
+        if(occlusion)
+        {
+            //The data is updated in the command buffer, so passes recorded earlier keep theirs.
+            GpuCullOcclusionData occlusionData;
+            occlusionData.viewProjection = occlusionViewProjection;
+            occlusionData.pyramidSize[0] = pyramidSize[0];
+            occlusionData.pyramidSize[1] = pyramidSize[1];
+            occlusionData.pyramidLevelCount = static_cast<float>(pyramidLevelCount);
+            occlusionData.padding = 0.0f;
+            vkCmdUpdateBuffer(cmdBuffer, occlusionDataBuffer.buffer, 0, sizeof(GpuCullOcclusionData), &occlusionData);
+            generatingStages |= VK_PIPELINE_STAGE_TRANSFER_BIT;
+            transitions.push_back({occlusionDataBuffer.buffer, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_UNIFORM_READ_BIT,
+                                   VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED});
+
+            //Nothing counts as visible last frame until a late phase has run, so the first
+            //early phase draws nothing and the late phase draws everything visible.
+            if(clearVisibility)
+            {
+                vkCmdFillBuffer(cmdBuffer, visibilityBuffer.buffer, 0, VK_WHOLE_SIZE, 0);
+                transitions.push_back({visibilityBuffer.buffer, VK_ACCESS_TRANSFER_WRITE_BIT,
+                                       VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+                                       VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED});
+                visibilityValid = true;
+            }
+            else
+            {
+                generatingStages |= VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+                transitions.push_back({visibilityBuffer.buffer, VK_ACCESS_SHADER_WRITE_BIT,
+                                       VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+                                       VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED});
+            }
+        }
+        for(const BufferTransition &transition : transitions)
+            barriers.addBuffer(generatingStages, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, transition);
+        barriers.flush();
+
+        GpuCullPushConstants pushConstants;
+        std::memcpy(pushConstants.planes, frustum.planes, sizeof(pushConstants.planes));
+        pushConstants.drawCount = drawCount;
+        pushConstants.compact = useDrawCount ? 1 : 0;
+        pushConstants.phase = phase;
+
+        VkPipelineLayout layout = occlusion ? occlusionPipelineLayout : pipelineLayout;
+        std::vector<VkDescriptorSet> descriptorSets = {descriptorSet};
+        if(occlusion)
+            descriptorSets.push_back(occlusionSet);
+        vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, occlusion ? occlusionPipeline : pipeline);
+        VulkanDescriptorManager::bindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, layout,
+                                                    0, descriptorSets, {});
+        vkCmdPushConstants(cmdBuffer, layout, VK_SHADER_STAGE_COMPUTE_BIT, 0,
+                           sizeof(GpuCullPushConstants), &pushConstants);
+        vkCmdDispatch(cmdBuffer, (drawCount + GPU_CULL_WORKGROUP_SIZE - 1) / GPU_CULL_WORKGROUP_SIZE, 1, 1);
+
+        for(BufferTransition &transition : indirectTransitions)
+        {
+            transition.currentAccess = VK_ACCESS_SHADER_WRITE_BIT;
+            transition.newAccess = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+            barriers.addBuffer(VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, transition);
+        }
+    }
+
+    /**
+     * @brief Draws the commands of the last culling pass. With a draw count only the visible
+     *        commands are read. Without multiDrawIndirect every command needs its own call,
+     *        which is the only case where the cpu cost grows with the draw count.
+     * @param cmdBuffer
+     */
+    void GpuCuller::recordDraws(VkCommandBuffer cmdBuffer)
+    {
+        if(drawCount == 0)
+            return;
+
+        const uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+        if(useDrawCount)
+        {
+            vkCmdDrawIndexedIndirectCountKHR(cmdBuffer, commandBuffer.buffer, 0, countBuffer.buffer, 0,
+                                             drawCount, stride);
+        }
+        else if(useMultiDraw)
+        {
+            vkCmdDrawIndexedIndirect(cmdBuffer, commandBuffer.buffer, 0, drawCount, stride);
+        }
+        else
+        {
+            for(uint32_t i = 0; i < drawCount; ++i)
+                vkCmdDrawIndexedIndirect(cmdBuffer, commandBuffer.buffer, VkDeviceSize(i) * stride, 1, stride);
+        }
+    }
+
+    bool GpuCuller::createCullingBuffer(const VkPhysicalDeviceMemoryProperties &memoryProperties,
+                                        VkDeviceSize size, VkBufferUsageFlags usage,
+                                        VkMemoryPropertyFlags memoryFlags,
+                                        VulkanBuffer &buffer, VkDeviceMemory &memory)
+    {
+        buffer.size = size;
+        buffer.usageFlags = usage;
+        VkBufferCreateInfo bufferInfo = VulkanStructures::bufferCreateInfo(size, usage, VK_SHARING_MODE_EXCLUSIVE);
+        if(!createBuffer(logicalDevice, bufferInfo, buffer.buffer))
+            return false;
+
+        VkMemoryRequirements memReq;
+        vkGetBufferMemoryRequirements(logicalDevice, buffer.buffer, &memReq);
+        return allocateMemory(logicalDevice, memoryProperties, memReq, memoryFlags, memory) &&
+               buffer.bindMemoryObject(logicalDevice, memory);
+    }
+}
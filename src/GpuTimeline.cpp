@@ -0,0 +1,239 @@
+#include "GpuTimeline.h"
+#include "VulkanUtility.h"
+#include <algorithm>
+
+namespace Raven
+{
+    GpuTimeline::GpuTimeline()
+    {
+
+    }
+
+    GpuTimeline::~GpuTimeline()
+    {
+        destroy();
+    }
+
+    /**
+     * @brief Creates a timeline semaphore for every queue, or prepares the fence fallback.
+     * @param logicalDevice
+     * @param queueCount
+     * @param timelineSemaphores True if the timelineSemaphore feature was enabled on the device.
+     * @param syncObjects Pool of the fences used without timeline semaphores.
+     * @return False if a semaphore could not be created.
+     */
+    bool GpuTimeline::initialize(VkDevice logicalDevice, uint32_t queueCount, bool timelineSemaphores,
+                                 SyncObjectPool *syncObjects)
+    {
+        destroy();
+        this->logicalDevice = logicalDevice;
+        this->syncObjects = syncObjects;
+        this->timelineSemaphores = timelineSemaphores && vkGetSemaphoreCounterValueKHR != nullptr &&
+                                   vkWaitSemaphoresKHR != nullptr;
+        queues.assign(queueCount, QueueTimeline{VK_NULL_HANDLE, 0, 0, {}});
+        if(!this->timelineSemaphores)
+        {
+            if(syncObjects != nullptr)
+                return true;
+            std::cerr << "Failed to initialize the gpu timeline, the fence fallback needs a pool!" << std::endl;
+            destroy();
+            return false;
+        }
+
+        VkSemaphoreTypeCreateInfoKHR typeInfo = {};
+        typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO_KHR;
+        typeInfo.pNext = nullptr;
+        typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE_KHR;
+        typeInfo.initialValue = 0;
+        VkSemaphoreCreateInfo createInfo = {};
+        createInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+        createInfo.pNext = &typeInfo;
+        createInfo.flags = 0;
+        for(QueueTimeline &timeline : queues)
+        {
+            if(vkCreateSemaphore(logicalDevice, &createInfo, nullptr, &timeline.semaphore) != VK_SUCCESS)
+            {
+                std::cerr << "Failed to create a timeline semaphore!" << std::endl;
+                destroy();
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void GpuTimeline::destroy()
+    {
+        if(logicalDevice == VK_NULL_HANDLE)
+            return;
+
+        for(QueueTimeline &timeline : queues)
+        {
+            destroySemaphore(logicalDevice, timeline.semaphore);
+            for(PendingFence &pending : timeline.pending)
+                syncObjects->releaseFence(pending.fence);
+        }
+        queues.clear();
+        logicalDevice = VK_NULL_HANDLE;
+    }
+
+    /**
+     * @brief Submits command buffers that signal the next value of the queue's timeline.
+     * @param queue Index of the queue's timeline.
+     * @param submitter Submitter of the queue.
+     * @param cmdBuffers
+     * @param waits Points on other queues the submission waits for.
+     * @param waitStages Stages that wait for each point.
+     * @param signaled The point the submission reaches.
+     * @return False if the submission fails.
+     */
+    bool GpuTimeline::submit(uint32_t queue, QueueSubmitter &submitter, const std::vector<VkCommandBuffer> &cmdBuffers,
+                             const std::vector<GpuSyncPoint> &waits, const std::vector<VkPipelineStageFlags> &waitStages,
+                             GpuSyncPoint &signaled)
+    {
+        if(queue >= queues.size() || waits.size() != waitStages.size())
+        {
+            std::cerr << "Failed to submit to the gpu timeline, the queue or the waits are invalid!" << std::endl;
+            return false;
+        }
+
+        QueueTimeline &timeline = queues[queue];
+        uint64_t signalValue = timeline.submitted + 1;
+        VkSubmitInfo submitInfo = {};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.pNext = nullptr;
+        submitInfo.commandBufferCount = static_cast<uint32_t>(cmdBuffers.size());
+        submitInfo.pCommandBuffers = cmdBuffers.data();
+
+        if(timelineSemaphores)
+        {
+            std::vector<VkSemaphore> waitSemaphores;
+            std::vector<uint64_t> waitValues;
+            std::vector<VkPipelineStageFlags> stages;
+            for(size_t i = 0; i < waits.size(); ++i)
+            {
+                if(waits[i].queue == queue || waits[i].queue >= queues.size())
+                    continue;
+                waitSemaphores.push_back(queues[waits[i].queue].semaphore);
+                waitValues.push_back(waits[i].value);
+                stages.push_back(waitStages[i]);
+            }
+
+            VkTimelineSemaphoreSubmitInfoKHR timelineInfo = {};
+            timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO_KHR;
+            timelineInfo.pNext = nullptr;
+            timelineInfo.waitSemaphoreValueCount = static_cast<uint32_t>(waitValues.size());
+            timelineInfo.pWaitSemaphoreValues = waitValues.data();
+            timelineInfo.signalSemaphoreValueCount = 1;
+            timelineInfo.pSignalSemaphoreValues = &signalValue;
+            submitInfo.pNext = &timelineInfo;
+            submitInfo.waitSemaphoreCount = static_cast<uint32_t>(waitSemaphores.size());
+            submitInfo.pWaitSemaphores = waitSemaphores.data();
+            submitInfo.pWaitDstStageMask = stages.data();
+            submitInfo.signalSemaphoreCount = 1;
+            submitInfo.pSignalSemaphores = &timeline.semaphore;
+            if(!submitter.submit(submitInfo, VK_NULL_HANDLE))
+                return false;
+        }
+        else
+        {
+            for(const GpuSyncPoint &point : waits)
+            {
+                if(point.queue != queue && !wait(point, UINT64_MAX))
+                    return false;
+            }
+
+            VkFence fence;
+            if(!syncObjects->acquireFence(fence))
+                return false;
+            if(!submitter.submit(submitInfo, fence))
+            {
+                syncObjects->releaseFence(fence);
+                return false;
+            }
+            timeline.pending.push_back({signalValue, fence});
+        }
+
+        timeline.submitted = signalValue;
+        signaled = {queue, signalValue};
+        return true;
+    }
+
+    bool GpuTimeline::isComplete(const GpuSyncPoint &point)
+    {
+        return point.queue >= queues.size() || getCompletedValue(point.queue) >= point.value;
+    }
+
+    /**
+     * @brief Blocks the calling thread until the gpu has reached the point.
+     * @param point
+     * @param timeout In nanoseconds.
+     * @return False if the timeout ran out or the wait failed.
+     */
+    bool GpuTimeline::wait(const GpuSyncPoint &point, uint64_t timeout)
+    {
+        if(isComplete(point))
+            return true;
+
+        QueueTimeline &timeline = queues[point.queue];
+        if(timelineSemaphores)
+        {
+            VkSemaphoreWaitInfoKHR waitInfo = {};
+            waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO_KHR;
+            waitInfo.pNext = nullptr;
+            waitInfo.flags = 0;
+            waitInfo.semaphoreCount = 1;
+            waitInfo.pSemaphores = &timeline.semaphore;
+            waitInfo.pValues = &point.value;
+            if(vkWaitSemaphoresKHR(logicalDevice, &waitInfo, timeout) != VK_SUCCESS)
+                return false;
+            timeline.completed = std::max(timeline.completed, point.value);
+            return true;
+        }
+
+        //The first submission that reaches the point signals its fence when the point is reached.
+        for(const PendingFence &pending : timeline.pending)
+        {
+            if(pending.value < point.value)
+                continue;
+            if(vkWaitForFences(logicalDevice, 1, &pending.fence, VK_TRUE, timeout) != VK_SUCCESS)
+                return false;
+            retireFences(timeline);
+            return true;
+        }
+        std::cerr << "Failed to wait for a point that has not been submitted!" << std::endl;
+        return false;
+    }
+
+    uint64_t GpuTimeline::getCompletedValue(uint32_t queue)
+    {
+        QueueTimeline &timeline = queues[queue];
+        if(timelineSemaphores)
+        {
+            uint64_t value = 0;
+            if(vkGetSemaphoreCounterValueKHR(logicalDevice, timeline.semaphore, &value) == VK_SUCCESS)
+                timeline.completed = std::max(timeline.completed, value);
+        }
+        else
+        {
+            retireFences(timeline);
+        }
+        return timeline.completed;
+    }
+
+    /**
+     * @brief Gives the fences of finished submissions back to the pool, which resets them
+     *        together.
+     * @param timeline
+     */
+    void GpuTimeline::retireFences(QueueTimeline &timeline)
+    {
+        std::vector<VkFence> signaled;
+        while(!timeline.pending.empty() && vkGetFenceStatus(logicalDevice, timeline.pending.front().fence) == VK_SUCCESS)
+        {
+            timeline.completed = timeline.pending.front().value;
+            signaled.push_back(timeline.pending.front().fence);
+            timeline.pending.pop_front();
+        }
+        syncObjects->releaseFences(signaled);
+    }
+}
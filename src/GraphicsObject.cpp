@@ -2,8 +2,12 @@
 #include "VulkanStructures.h"
 #include "VulkanUtility.h"
 #include "FileIO.h"
-#define TINYOBJLOADER_IMPLEMENTATION
-#include "tiny_obj_loader.h"
+#include "MeshLoader.h"
+#include "CookedAssets.h"
+#include "MeshSimplifier.h"
+#include "VulkanDescriptorManager.h"
+#include "FrustumCuller.h"
+#include <algorithm>
 
 namespace Raven
 {
@@ -18,170 +22,35 @@ namespace Raven
     }
 
     /**
-     * @brief Loads the given file and creates a model from it. This function is mostly
-     *        from VulkanCookbook with some changes of mine.
+     * @brief Loads the given .obj-file and creates a model from it.
      * @param filename
      * @return False if something went wrong.
      */
-    bool GraphicsObject::loadModel(const VkDevice logicalDevice, const std::string filename,
-                                   bool loadNormals, bool loadTextureCoordinates, bool generateTangentVectors,
-                                   bool normalize, uint32_t *vertexStride)
+    bool GraphicsObject::loadModel(const std::string filename, bool loadNormals, bool loadTextureCoordinates,
+                                   bool generateTangentVectors, bool normalize, uint32_t *vertexStride)
     {
-        //First load the model from .obj-file.
-        tinyobj::attrib_t attributes;
-        std::vector<tinyobj::shape_t> shapes;
-        std::vector<tinyobj::material_t> materials;
-        std::string error;
-
-        bool result = tinyobj::LoadObj(&attributes, &shapes, &materials, &error, filename.c_str());
-        if(!result)
-        {
-            std::cout << "Failed to load file: " << filename << std::endl;
-            if(error.size() > 0)
-            {
-                std::cout << error << std::endl;
-            }
-            return false;
-        }
-
-        //If we want to generate tangent space vectors, we will also require normals and texture coordinates.
-        if(!loadNormals || !loadTextureCoordinates)
-        {
-            generateTangentVectors = false;
-        }
-
-        //Load model data and normalize its size and position.
-        float minX = attributes.vertices[0];
-        float maxX = attributes.vertices[0];
-        float minY = attributes.vertices[1];
-        float maxY = attributes.vertices[1];
-        float minZ = attributes.vertices[2];
-        float maxZ = attributes.vertices[2];
-
-        //Load the data to the mesh-object owned by the GraphicsObject class.
-        mesh = {};
-        uint32_t offset = 0;
-        for(auto &shape : shapes)
-        {
-            uint32_t partOffset = offset;
-            for(auto &index : shape.mesh.indices)
-            {
-                mesh.data.emplace_back(attributes.vertices[3 * index.vertex_index + 0]);
-                mesh.data.emplace_back(attributes.vertices[3 * index.vertex_index + 1]);
-                mesh.data.emplace_back(attributes.vertices[3 * index.vertex_index + 2]);
-                offset++;
-
-                //Load normal data.
-                if(loadNormals)
-                {
-                    if(attributes.normals.size() == 0)
-                    {
-                        std::cout << "Failed to load normals for file: " << filename << std::endl;
-                        return false;
-                    }
-                    else
-                    {
-                        mesh.data.emplace_back(attributes.normals[3 * index.normal_index + 0]);
-                        mesh.data.emplace_back(attributes.normals[3 * index.normal_index + 1]);
-                        mesh.data.emplace_back(attributes.normals[3 * index.normal_index + 2]);
-                    }
-                }
-
-                //Load texture coordinates.
-                if(loadTextureCoordinates)
-                {
-                    if(attributes.texcoords.size() == 0)
-                    {
-                        std::cout << "Failed to load normals for file: " << filename << std::endl;
-                        return false;
-                    }
-                    else
-                    {
-                        mesh.data.emplace_back(attributes.texcoords[2 * index.texcoord_index + 0]);
-                        mesh.data.emplace_back(attributes.texcoords[2 * index.texcoord_index + 1]);
-                    }
-                }
-
-                //Generate tangent space vectors.
-                if(generateTangentVectors)
-                {
-                    //Insert temporary tangent space vectors data.
-                    for(int i = 0; i < 6; ++i)
-                    {
-                        mesh.data.emplace_back(0.0f);
-                    }
-                }
-
-                if(normalize)
-                {
-                    if(attributes.vertices[3 * index.vertex_index + 0] < minX )
-                    {
-                        minX = attributes.vertices[3 * index.vertex_index + 0];
-                    }
-                    if(attributes.vertices[3 * index.vertex_index + 0] > maxX )
-                    {
-                        maxX = attributes.vertices[3 * index.vertex_index + 0];
-                    }
-                    if(attributes.vertices[3 * index.vertex_index + 1] < minY )
-                    {
-                        minY = attributes.vertices[3 * index.vertex_index + 1];
-                    }
-                    if(attributes.vertices[3 * index.vertex_index + 1] > maxY )
-                    {
-                        maxY = attributes.vertices[3 * index.vertex_index + 1];
-                    }
-                    if(attributes.vertices[3 * index.vertex_index + 2] < minZ )
-                    {
-                        minZ = attributes.vertices[3 * index.vertex_index + 2];
-                    }
-                    if(attributes.vertices[3 * index.vertex_index + 2] > maxZ )
-                    {
-                        maxZ = attributes.vertices[3 * index.vertex_index + 2];
-                    }
-                }
-            }
-
-            uint32_t partVertexCount = offset - partOffset;
-            if(partVertexCount > 0)
-            {
-                mesh.parts.push_back({partOffset, partVertexCount});
-            }
-        }
-
-        //Define the stride.
-        uint32_t stride = 3 + (loadNormals ? 3 : 0) + (loadTextureCoordinates ? 2 : 0) +
-                          (generateTangentVectors ? 6 : 0);
-        if(vertexStride)
-        {
-            *vertexStride = stride * sizeof(float);
-        }
+        return MeshLoader::loadObj(filename, loadNormals, loadTextureCoordinates, generateTangentVectors,
+                                   normalize, mesh, vertexStride);
+    }
 
-        if(generateTangentVectors)
+    /**
+     * @brief Loads a model cooked by the AssetBuilder tool. The vertex layout was decided
+     *        when the model was cooked so only the stride is returned.
+     * @param filename
+     * @param vertexStride
+     * @return False if the file could not be read or is not a cooked mesh.
+     */
+    bool GraphicsObject::loadCookedModel(const std::string filename, uint32_t *vertexStride)
+    {
+        try
         {
-            generateTangentSpaceVectors(mesh);
+            return CookedAssets::readMesh(FileIO::readBinaryFile(filename), mesh, nullptr, vertexStride);
         }
-
-        if(normalize)
+        catch(const std::runtime_error&)
         {
-            float offsetX = 0.5f * (minX + maxX);
-            float offsetY = 0.5f * (minY + maxY);
-            float offsetZ = 0.5f * (minZ + maxZ);
-            //abs returns the absolute value of a variable so, for an example 23 is 23 and -11 is 11.
-            float scaleX = abs(minX - offsetX) > abs(maxX - offsetX) ? abs(minX - offsetX) : abs(maxX - offsetX);
-            float scaleY = abs(minY - offsetY) > abs(maxY - offsetY) ? abs(minY - offsetY) : abs(maxY - offsetY);
-            float scaleZ = abs(minZ - offsetZ) > abs(maxZ - offsetZ) ? abs(minZ - offsetZ) : abs(maxZ - offsetZ);
-            float scale = scaleX > scaleY ? scaleX : scaleY;
-            scale = scaleZ > scale ? 1.0f / scaleZ : 1.0f / scale;
-
-            for(size_t i = 0; i < mesh.data.size(); ++i)
-            {
-                mesh.data[i + 0] = scale * (mesh.data[i + 0] - offsetX);
-                mesh.data[i + 1] = scale * (mesh.data[i + 1] - offsetY);
-                mesh.data[i + 2] = scale * (mesh.data[i + 2] - offsetZ);
-            }
+            std::cerr << "Failed to open cooked model " << filename << "!" << std::endl;
+            return false;
         }
-
-        return true;
     }
 
     /**
@@ -262,91 +131,141 @@ namespace Raven
         return true;
     }
 
-    // Based on:
-    // Lengyel, Eric. "Computing Tangent Space Basis Vectors for an Arbitrary Mesh".
-    // Terathon Software 3D Graphics Library, 2001.
-    // http://www.terathon.com/code/tangent.html
-
     /**
-     * @brief GraphicsObject::calculateTangentAndBitangent
-     * @param normalData
-     * @param faceTangent
-     * @param faceBitangent
-     * @param tangentData
-     * @param bitangentData
+     * @brief Adds a texture that is streamed by the given streamer. Only the smallest
+     *        mips are loaded at first, finer ones follow when the object is drawn larger.
+     * @param textureStreamer
+     * @param filename
+     * @param format
+     * @return False if the texture could not be added to the streamer.
      */
-    void GraphicsObject::calculateTangentAndBitangent(float const *normalData,
-                                                      const glm::vec3 &faceTangent,
-                                                      const glm::vec3 &faceBitangent,
-                                                      float *tangentData,
-                                                      float *bitangentData)
+    bool GraphicsObject::addStreamedTexture(TextureStreamer &textureStreamer,
+                                            const std::string filename,
+                                            VkFormat format)
     {
-        // Gram-Schmidt orthogonalize
-        const glm::vec3 normal = {normalData[0], normalData[1], normalData[2]};
-        const glm::vec3 tangent = glm::normalize(faceTangent - normal * glm::dot(normal, faceTangent));
-
-        //Calculate the "handedness".
-        float handedness = (glm::dot(glm::cross(normal, tangent), faceBitangent) < 0.0f) ? -1.0f : 1.0f;
-
-        const glm::vec3 bitangent = handedness * glm::cross(normal, tangent);
-
-        tangentData[0] = tangent[0];
-        tangentData[1] = tangent[1];
-        tangentData[2] = tangent[2];
+        uint32_t textureId;
+        if(!textureStreamer.addTexture(filename, format, textureId))
+            return false;
+        streamedTextureId = textureId;
+        return true;
+    }
 
-        bitangentData[0] = bitangent[0];
-        bitangentData[1] = bitangent[1];
-        bitangentData[2] = bitangent[2];
+    /**
+     * @brief Requests the streamed texture for the object's current on-screen size.
+     * @param textureStreamer
+     * @param screenSpaceSize Size of the object on the screen in pixels, see
+     *        TextureStreamer::calculateScreenSpaceSize.
+     */
+    void GraphicsObject::requestTextureResolution(TextureStreamer &textureStreamer, float screenSpaceSize)
+    {
+        if(streamedTextureId != UINT32_MAX)
+            textureStreamer.requestResolution(streamedTextureId, screenSpaceSize);
     }
 
     /**
-     * @brief Generates tangent space vectors for a mesh object from normal and texture
-     *        coordinate data.
-     * @param mesh
+     * @brief Rewrites the object's texture descriptor after the streamer has replaced the
+     *        streamed image. Call after TextureStreamer::update for a descriptor set that
+     *        the gpu is not using, e.g. the one of the frame that is being recorded.
+     * @param logicalDevice
+     * @param textureStreamer
+     * @param descriptorSet
+     * @param binding Binding of a VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER.
+     * @param sampler
+     * @return True if the descriptor was written.
      */
-    void GraphicsObject::generateTangentSpaceVectors(Mesh &mesh)
+    bool GraphicsObject::updateStreamedTextureDescriptor(const VkDevice logicalDevice,
+                                                         const TextureStreamer &textureStreamer,
+                                                         VkDescriptorSet descriptorSet, uint32_t binding,
+                                                         VkSampler sampler)
     {
-        size_t const normalOffset = 3;
-        size_t const texCoordOffset = 6;
-        size_t const tangentOffset = 8;
-        size_t const bitangentOffset = 11;
-        size_t const stride = 14;
+        if(streamedTextureId == UINT32_MAX)
+            return false;
+
+        //Version 0 has no image yet, the first upload is still pending.
+        uint32_t version = textureStreamer.getImageVersion(streamedTextureId);
+        if(version == 0 || version == streamedTextureVersion)
+            return false;
 
-        for(auto &part : mesh.parts)
+        ImageDescriptorInfo imageDescriptorUpdate =
         {
-            for(size_t i = 0; i < mesh.data.size(); i += stride * 3)
+            descriptorSet,
+            binding,
+            0,
+            VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
             {
-                size_t i1 = i;
-                size_t i2 = i1 + stride;
-                size_t i3 = i2 + stride;
-                glm::vec3 const v1 = {mesh.data[i1], mesh.data[i1 + 1], mesh.data[i1 + 2]};
-                glm::vec3 const v2 = {mesh.data[i2], mesh.data[i2 + 1], mesh.data[i2 + 2]};
-                glm::vec3 const v3 = {mesh.data[i3], mesh.data[i3 + 1], mesh.data[i3 + 2]};
+                {
+                    sampler,
+                    textureStreamer.getImage(streamedTextureId).imageView,
+                    VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+                }
+            }
+        };
+
+        VulkanDescriptorManager::updateDescriptorSets(logicalDevice, {imageDescriptorUpdate}, {}, {}, {});
+        streamedTextureVersion = version;
+        return true;
+    }
 
-                std::array<float, 2> const w1 = { mesh.data[i1 + texCoordOffset], mesh.data[i1 + texCoordOffset +1]};
-                std::array<float, 2> const w2 = { mesh.data[i2 + texCoordOffset], mesh.data[i2 + texCoordOffset +1]};
-                std::array<float, 2> const w3 = { mesh.data[i3 + texCoordOffset], mesh.data[i3 + texCoordOffset +1]};
+    /**
+     * @brief Picks the coarsest level of detail of every part whose error stays under
+     *        maxScreenSpaceError pixels. The error is projected at the point of the bounding
+     *        sphere closest to the camera so the object never looks coarser than allowed.
+     * @param center World space center of the object's bounding sphere.
+     * @param radius World space radius of the bounding sphere.
+     * @param scale Largest scale of the object's transform, converts the model space errors.
+     * @param viewMatrix
+     * @param projectionMatrix
+     * @param viewportHeight
+     * @param maxScreenSpaceError
+     */
+    void GraphicsObject::selectLods(const glm::vec3 &center, float radius, float scale,
+                                    const glm::mat4 &viewMatrix, const glm::mat4 &projectionMatrix,
+                                    float viewportHeight, float maxScreenSpaceError)
+    {
+        selectedLods.assign(mesh.parts.size(), 0);
 
-                float x1 = v2[0] - v1[0];
-                float x2 = v3[0] - v1[0];
-                float y1 = v2[1] - v1[1];
-                float y2 = v3[1] - v1[1];
-                float z1 = v2[2] - v1[2];
-                float z2 = v3[2] - v1[2];
+        glm::vec4 viewPosition = viewMatrix * glm::vec4(center, 1.0f);
+        //The camera looks down the negative z-axis. Inside the sphere the full parts are used.
+        float depth = -viewPosition.z - radius;
+        if(depth <= 0.0f)
+            return;
 
-                float s1 = w2[0] - w1[0];
-                float s2 = w3[0] - w1[0];
-                float t1 = w2[1] - w1[1];
-                float t2 = w3[1] - w1[1];
+        float pixelsPerUnit = scale * FrustumCuller::calculatePixelsPerUnit(projectionMatrix, viewportHeight, depth);
+        for(size_t i = 0; i < mesh.parts.size(); ++i)
+            selectedLods[i] = MeshSimplifier::selectLod(mesh, mesh.parts[i], pixelsPerUnit, maxScreenSpaceError);
+    }
 
-                float r = 1.0f / (s1 * t2 - s2 * t1);
-                glm::vec3 faceTangent = {(t2 * x1 - t1 * x2) * r, (t2 * y1 - t1 * y2) * r, (t2 * z1 - t1 * z2) * r};
-                glm::vec3 faceBitangent = {(s1 * x2 - s2 * x1) * r, (s1 * y2 - s2 * y1) * r, (s1 * z2 - s2 * z1) * r};
+    /**
+     * @brief Records the draws of the object's parts. Indexed meshes draw the index range of
+     *        each part's selected level of detail, the indices refer to the whole vertex buffer.
+     * @param cmdBuffer
+     * @param instanceCount
+     * @param firstInstance
+     * @param visibleParts Optional indices of the parts to draw, all parts are drawn without it.
+     */
+    void GraphicsObject::recordDraws(VkCommandBuffer cmdBuffer, uint32_t instanceCount, uint32_t firstInstance,
+                                     const std::vector<uint32_t> *visibleParts) const
+    {
+        size_t drawCount = visibleParts ? visibleParts->size() : mesh.parts.size();
+        for(size_t i = 0; i < drawCount; ++i)
+        {
+            size_t partIndex = visibleParts ? (*visibleParts)[i] : i;
+            if(partIndex >= mesh.parts.size())
+                continue;
 
-                calculateTangentAndBitangent(&mesh.data[i1 + normalOffset], faceTangent, faceBitangent,
-                                             &mesh.data[i1 + tangentOffset], &mesh.data[i1 + bitangentOffset]);
-                calculateTangentAndBitangent(&mesh.data[i2 + normalOffset], faceTangent, faceBitangent,
-                                             &mesh.data[i2 + tangentOffset], &mesh.data[i2 + bitangentOffset]);
+            const Mesh::Part &part = mesh.parts[partIndex];
+            if(mesh.indices.empty())
+            {
+                vkCmdDraw(cmdBuffer, part.vertexCount, instanceCount, part.vertexOffset, firstInstance);
+            }
+            else if(part.lodCount > 0)
+            {
+                const MeshLod &lod = mesh.lods[part.lodOffset + std::min(getSelectedLod(partIndex), part.lodCount - 1)];
+                vkCmdDrawIndexed(cmdBuffer, lod.indexCount, instanceCount, lod.indexOffset, 0, firstInstance);
+            }
+            else
+            {
+                vkCmdDrawIndexed(cmdBuffer, part.indexCount, instanceCount, part.indexOffset, 0, firstInstance);
             }
         }
     }
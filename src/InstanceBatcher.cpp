@@ -0,0 +1,159 @@
+#include "InstanceBatcher.h"
+#include "VulkanUtility.h"
+#include "VulkanStructures.h"
+#include <algorithm>
+
+namespace Raven
+{
+    InstanceBatcher::InstanceBatcher()
+    {
+
+    }
+
+    InstanceBatcher::~InstanceBatcher()
+    {
+        destroy();
+    }
+
+    /**
+     * @brief Creates a persistently mapped instance buffer. The cpu rewrites it every frame
+     *        so host visible memory avoids a staging copy.
+     * @param logicalDevice
+     * @param memoryProperties
+     * @param capacity Largest number of instances per frame.
+     * @return False if the buffer could not be created.
+     */
+    bool InstanceBatcher::createInstanceBuffer(VkDevice logicalDevice,
+                                               const VkPhysicalDeviceMemoryProperties &memoryProperties,
+                                               uint32_t capacity)
+    {
+        destroy();
+        if(capacity == 0)
+        {
+            std::cerr << "Failed to create instance buffer without any capacity!" << std::endl;
+            return false;
+        }
+        this->logicalDevice = logicalDevice;
+
+        instanceBuffer.size = sizeof(glm::mat4) * capacity;
+        instanceBuffer.usageFlags = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
+        VkBufferCreateInfo bufferInfo = VulkanStructures::bufferCreateInfo(instanceBuffer.size,
+                                                                           instanceBuffer.usageFlags,
+                                                                           VK_SHARING_MODE_EXCLUSIVE);
+        if(!createBuffer(logicalDevice, bufferInfo, instanceBuffer.buffer))
+            return false;
+
+        VkMemoryRequirements memReq;
+        vkGetBufferMemoryRequirements(logicalDevice, instanceBuffer.buffer, &memReq);
+        if(!allocateMemory(logicalDevice, memoryProperties, memReq,
+                           VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                           instanceMemory) ||
+           !instanceBuffer.bindMemoryObject(logicalDevice, instanceMemory))
+        {
+            destroy();
+            return false;
+        }
+
+        void *data;
+        if(vkMapMemory(logicalDevice, instanceMemory, 0, instanceBuffer.size, 0, &data) != VK_SUCCESS)
+        {
+            std::cerr << "Failed to map instance buffer memory!" << std::endl;
+            destroy();
+            return false;
+        }
+        instanceBuffer.data = data;
+        instanceData = static_cast<glm::mat4*>(data);
+        instanceCapacity = capacity;
+        return true;
+    }
+
+    void InstanceBatcher::destroy()
+    {
+        if(logicalDevice == VK_NULL_HANDLE)
+            return;
+        if(instanceData != nullptr)
+            vkUnmapMemory(logicalDevice, instanceMemory);
+        destroyBuffer(logicalDevice, instanceBuffer.buffer);
+        freeMemory(logicalDevice, instanceMemory);
+        instanceBuffer = VulkanBuffer();
+        instanceData = nullptr;
+        instanceCapacity = 0;
+        logicalDevice = VK_NULL_HANDLE;
+    }
+
+    void InstanceBatcher::clear()
+    {
+        instances.clear();
+        groups.clear();
+    }
+
+    void InstanceBatcher::addInstance(const GraphicsObject *drawable, uint32_t materialId, SceneNode node)
+    {
+        instances.push_back({drawable, materialId, node});
+    }
+
+    /**
+     * @brief Sorts the instances by mesh and material and builds a group of each run. The
+     *        sort is stable so instances keep the order they were added in within a group.
+     *        Instances of destroyed scene nodes are skipped.
+     * @param scene Scene the instances' nodes belong to.
+     * @return False if there are more instances than the instance buffer holds.
+     */
+    bool InstanceBatcher::build(const Scene &scene)
+    {
+        groups.clear();
+        std::stable_sort(instances.begin(), instances.end(), [](const Instance &a, const Instance &b)
+        {
+            if(a.drawable != b.drawable)
+                return std::less<const GraphicsObject*>()(a.drawable, b.drawable);
+            return a.materialId < b.materialId;
+        });
+
+        uint32_t instanceCount = 0;
+        for(const Instance &instance : instances)
+        {
+            if(instance.drawable == nullptr || !scene.isValid(instance.node))
+                continue;
+            if(instanceData != nullptr)
+            {
+                if(instanceCount == instanceCapacity)
+                {
+                    std::cerr << "Failed to batch instances, there are more than " << instanceCapacity << "!" << std::endl;
+                    groups.clear();
+                    return false;
+                }
+                instanceData[instanceCount] = scene.getWorldMatrix(instance.node);
+            }
+
+            if(groups.empty() || groups.back().drawable != instance.drawable ||
+               groups.back().materialId != instance.materialId)
+            {
+                groups.push_back({instance.drawable, instance.materialId, instanceCount, 0});
+            }
+            ++groups.back().instanceCount;
+            ++instanceCount;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Binds the instance buffer once and draws every group with a single instanced
+     *        draw per part.
+     * @param cmdBuffer
+     * @param instanceBinding Vertex input binding with VK_VERTEX_INPUT_RATE_INSTANCE.
+     * @param bindGroup Called before each group's draws.
+     */
+    void InstanceBatcher::recordDraws(VkCommandBuffer cmdBuffer, uint32_t instanceBinding,
+                                      const std::function<void(VkCommandBuffer, const InstanceGroup&)> &bindGroup) const
+    {
+        if(groups.empty())
+            return;
+
+        bindVertexBuffers(cmdBuffer, instanceBinding, {{instanceBuffer.buffer, 0}});
+        for(const InstanceGroup &group : groups)
+        {
+            bindGroup(cmdBuffer, group);
+            group.drawable->recordDraws(cmdBuffer, group.instanceCount, group.firstInstance);
+        }
+    }
+}
@@ -0,0 +1,390 @@
+#include "MeshLoader.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <glm/glm.hpp>
+#define TINYOBJLOADER_IMPLEMENTATION
+#include "tiny_obj_loader.h"
+
+namespace Raven
+{
+    namespace MeshLoader
+    {
+        /**
+         * @brief Loads the given file and creates a mesh from it. This function is mostly
+         *        from VulkanCookbook with some changes of mine.
+         * @param filename
+         * @param loadNormals
+         * @param loadTextureCoordinates
+         * @param generateTangentVectors Requires normals and texture coordinates.
+         * @param normalize Centers the model and scales it to fit a unit cube.
+         * @param mesh
+         * @param vertexStride Size of a single vertex in bytes.
+         * @return False if something went wrong.
+         */
+        bool loadObj(const std::string &filename, bool loadNormals, bool loadTextureCoordinates,
+                     bool generateTangentVectors, bool normalize,
+                     Mesh &mesh, uint32_t *vertexStride)
+        {
+            //First load the model from .obj-file.
+            tinyobj::attrib_t attributes;
+            std::vector<tinyobj::shape_t> shapes;
+            std::vector<tinyobj::material_t> materials;
+            std::string error;
+
+            bool result = tinyobj::LoadObj(&attributes, &shapes, &materials, &error, filename.c_str());
+            if(!result)
+            {
+                std::cout << "Failed to load file: " << filename << std::endl;
+                if(error.size() > 0)
+                {
+                    std::cout << error << std::endl;
+                }
+                return false;
+            }
+            if(attributes.vertices.size() < 3)
+            {
+                std::cout << "Failed to load file since it has no vertices: " << filename << std::endl;
+                return false;
+            }
+
+            //If we want to generate tangent space vectors, we will also require normals and texture coordinates.
+            if(!loadNormals || !loadTextureCoordinates)
+            {
+                generateTangentVectors = false;
+            }
+
+            //Load model data and normalize its size and position.
+            float minX = attributes.vertices[0];
+            float maxX = attributes.vertices[0];
+            float minY = attributes.vertices[1];
+            float maxY = attributes.vertices[1];
+            float minZ = attributes.vertices[2];
+            float maxZ = attributes.vertices[2];
+
+            //Load the data to the mesh-object.
+            mesh = {};
+            uint32_t offset = 0;
+            for(auto &shape : shapes)
+            {
+                uint32_t partOffset = offset;
+                for(auto &index : shape.mesh.indices)
+                {
+                    mesh.data.emplace_back(attributes.vertices[3 * index.vertex_index + 0]);
+                    mesh.data.emplace_back(attributes.vertices[3 * index.vertex_index + 1]);
+                    mesh.data.emplace_back(attributes.vertices[3 * index.vertex_index + 2]);
+                    offset++;
+
+                    //Load normal data.
+                    if(loadNormals)
+                    {
+                        if(attributes.normals.size() == 0)
+                        {
+                            std::cout << "Failed to load normals for file: " << filename << std::endl;
+                            return false;
+                        }
+                        else
+                        {
+                            mesh.data.emplace_back(attributes.normals[3 * index.normal_index + 0]);
+                            mesh.data.emplace_back(attributes.normals[3 * index.normal_index + 1]);
+                            mesh.data.emplace_back(attributes.normals[3 * index.normal_index + 2]);
+                        }
+                    }
+
+                    //Load texture coordinates.
+                    if(loadTextureCoordinates)
+                    {
+                        if(attributes.texcoords.size() == 0)
+                        {
+                            std::cout << "Failed to load texture coordinates for file: " << filename << std::endl;
+                            return false;
+                        }
+                        else
+                        {
+                            mesh.data.emplace_back(attributes.texcoords[2 * index.texcoord_index + 0]);
+                            mesh.data.emplace_back(attributes.texcoords[2 * index.texcoord_index + 1]);
+                        }
+                    }
+
+                    //Generate tangent space vectors.
+                    if(generateTangentVectors)
+                    {
+                        //Insert temporary tangent space vectors data.
+                        for(int i = 0; i < 6; ++i)
+                        {
+                            mesh.data.emplace_back(0.0f);
+                        }
+                    }
+
+                    if(normalize)
+                    {
+                        minX = std::min(minX, attributes.vertices[3 * index.vertex_index + 0]);
+                        maxX = std::max(maxX, attributes.vertices[3 * index.vertex_index + 0]);
+                        minY = std::min(minY, attributes.vertices[3 * index.vertex_index + 1]);
+                        maxY = std::max(maxY, attributes.vertices[3 * index.vertex_index + 1]);
+                        minZ = std::min(minZ, attributes.vertices[3 * index.vertex_index + 2]);
+                        maxZ = std::max(maxZ, attributes.vertices[3 * index.vertex_index + 2]);
+                    }
+                }
+
+                uint32_t partVertexCount = offset - partOffset;
+                if(partVertexCount > 0)
+                {
+                    mesh.parts.push_back({partOffset, partVertexCount});
+                }
+            }
+
+            //Define the stride.
+            uint32_t stride = 3 + (loadNormals ? 3 : 0) + (loadTextureCoordinates ? 2 : 0) +
+                              (generateTangentVectors ? 6 : 0);
+            if(vertexStride)
+            {
+                *vertexStride = stride * sizeof(float);
+            }
+
+            if(generateTangentVectors)
+            {
+                generateTangentSpaceVectors(mesh);
+            }
+
+            if(normalize)
+            {
+                float offsetX = 0.5f * (minX + maxX);
+                float offsetY = 0.5f * (minY + maxY);
+                float offsetZ = 0.5f * (minZ + maxZ);
+                //The largest half extent is scaled to one.
+                float scale = std::max(std::max(maxX - offsetX, maxY - offsetY), maxZ - offsetZ);
+                scale = scale > 0.0f ? 1.0f / scale : 1.0f;
+
+                //Only the positions at the start of every vertex are moved.
+                for(size_t i = 0; i + 2 < mesh.data.size(); i += stride)
+                {
+                    mesh.data[i + 0] = scale * (mesh.data[i + 0] - offsetX);
+                    mesh.data[i + 1] = scale * (mesh.data[i + 1] - offsetY);
+                    mesh.data[i + 2] = scale * (mesh.data[i + 2] - offsetZ);
+                }
+            }
+
+            computeBounds(mesh, stride * sizeof(float));
+            return true;
+        }
+
+        //Hashes the bytes of a single vertex (64-bit FNV-1a).
+        static uint64_t hashVertex(const float *vertex, uint32_t vertexStride)
+        {
+            const unsigned char *bytes = reinterpret_cast<const unsigned char*>(vertex);
+            uint64_t hash = 14695981039346656037ull;
+            for(uint32_t i = 0; i < vertexStride; ++i)
+            {
+                hash ^= bytes[i];
+                hash *= 1099511628211ull;
+            }
+            return hash;
+        }
+
+        /**
+         * @brief Turns a mesh with three vertices per triangle into an indexed mesh. Vertices
+         *        whose bytes are identical are merged. Parts keep their own vertex ranges
+         *        and the indices refer to the whole vertex data.
+         * @param mesh A mesh without indices.
+         * @param vertexStride Size of a single vertex in bytes.
+         */
+        void generateIndices(Mesh &mesh, uint32_t vertexStride)
+        {
+            size_t strideFloats = vertexStride / sizeof(float);
+            if(!mesh.indices.empty() || strideFloats == 0)
+                return;
+
+            std::vector<float> data;
+            std::vector<uint32_t> indices;
+            data.reserve(mesh.data.size());
+            indices.reserve(mesh.data.size() / strideFloats);
+
+            for(Mesh::Part &part : mesh.parts)
+            {
+                uint32_t firstVertex = static_cast<uint32_t>(data.size() / strideFloats);
+
+                //Open addressing table of merged vertex indices, at most half full.
+                size_t tableSize = 1;
+                while(tableSize < size_t(part.vertexCount) * 2)
+                    tableSize <<= 1;
+                std::vector<uint32_t> table(tableSize, UINT32_MAX);
+
+                part.indexOffset = static_cast<uint32_t>(indices.size());
+                for(uint32_t i = 0; i < part.vertexCount; ++i)
+                {
+                    const float *vertex = &mesh.data[(size_t(part.vertexOffset) + i) * strideFloats];
+                    size_t slot = hashVertex(vertex, vertexStride) & (tableSize - 1);
+                    while(table[slot] != UINT32_MAX &&
+                          std::memcmp(&data[table[slot] * strideFloats], vertex, vertexStride) != 0)
+                    {
+                        slot = (slot + 1) & (tableSize - 1);
+                    }
+
+                    if(table[slot] == UINT32_MAX)
+                    {
+                        table[slot] = static_cast<uint32_t>(data.size() / strideFloats);
+                        data.insert(data.end(), vertex, vertex + strideFloats);
+                    }
+                    indices.push_back(table[slot]);
+                }
+                part.indexCount = static_cast<uint32_t>(indices.size()) - part.indexOffset;
+                part.vertexOffset = firstVertex;
+                part.vertexCount = static_cast<uint32_t>(data.size() / strideFloats) - firstVertex;
+            }
+
+            mesh.data.swap(data);
+            mesh.indices.swap(indices);
+        }
+
+        /**
+         * @brief Computes the bounding box of every part and a sphere around the center of
+         *        the box that reaches the farthest vertex. Used for culling parts.
+         * @param mesh
+         * @param vertexStride Size of a single vertex in bytes, the position has to come first.
+         */
+        void computeBounds(Mesh &mesh, uint32_t vertexStride)
+        {
+            size_t strideFloats = vertexStride / sizeof(float);
+            mesh.partBounds.clear();
+            if(strideFloats < 3)
+                return;
+
+            mesh.partBounds.resize(mesh.parts.size());
+            for(size_t partIndex = 0; partIndex < mesh.parts.size(); ++partIndex)
+            {
+                const Mesh::Part &part = mesh.parts[partIndex];
+                MeshBounds &bounds = mesh.partBounds[partIndex];
+                size_t first = part.vertexOffset;
+                size_t last = std::min(size_t(part.vertexOffset) + part.vertexCount, mesh.data.size() / strideFloats);
+                if(first >= last)
+                {
+                    bounds = {};
+                    continue;
+                }
+
+                for(int axis = 0; axis < 3; ++axis)
+                {
+                    bounds.min[axis] = mesh.data[first * strideFloats + axis];
+                    bounds.max[axis] = mesh.data[first * strideFloats + axis];
+                }
+                for(size_t vertex = first + 1; vertex < last; ++vertex)
+                {
+                    for(int axis = 0; axis < 3; ++axis)
+                    {
+                        bounds.min[axis] = std::min(bounds.min[axis], mesh.data[vertex * strideFloats + axis]);
+                        bounds.max[axis] = std::max(bounds.max[axis], mesh.data[vertex * strideFloats + axis]);
+                    }
+                }
+
+                float squaredRadius = 0.0f;
+                for(int axis = 0; axis < 3; ++axis)
+                    bounds.center[axis] = 0.5f * (bounds.min[axis] + bounds.max[axis]);
+                for(size_t vertex = first; vertex < last; ++vertex)
+                {
+                    const float *position = &mesh.data[vertex * strideFloats];
+                    float dx = position[0] - bounds.center[0];
+                    float dy = position[1] - bounds.center[1];
+                    float dz = position[2] - bounds.center[2];
+                    squaredRadius = std::max(squaredRadius, dx * dx + dy * dy + dz * dz);
+                }
+                bounds.radius = std::sqrt(squaredRadius);
+            }
+        }
+
+        // Based on:
+        // Lengyel, Eric. "Computing Tangent Space Basis Vectors for an Arbitrary Mesh".
+        // Terathon Software 3D Graphics Library, 2001.
+        // http://www.terathon.com/code/tangent.html
+
+        /**
+         * @brief Calculates the tangent and bitangent of a single vertex.
+         * @param normalData
+         * @param faceTangent
+         * @param faceBitangent
+         * @param tangentData
+         * @param bitangentData
+         */
+        static void calculateTangentAndBitangent(float const *normalData,
+                                                 const glm::vec3 &faceTangent,
+                                                 const glm::vec3 &faceBitangent,
+                                                 float *tangentData,
+                                                 float *bitangentData)
+        {
+            // Gram-Schmidt orthogonalize
+            const glm::vec3 normal = {normalData[0], normalData[1], normalData[2]};
+            const glm::vec3 tangent = glm::normalize(faceTangent - normal * glm::dot(normal, faceTangent));
+
+            //Calculate the "handedness".
+            float handedness = (glm::dot(glm::cross(normal, tangent), faceBitangent) < 0.0f) ? -1.0f : 1.0f;
+
+            const glm::vec3 bitangent = handedness * glm::cross(normal, tangent);
+
+            tangentData[0] = tangent[0];
+            tangentData[1] = tangent[1];
+            tangentData[2] = tangent[2];
+
+            bitangentData[0] = bitangent[0];
+            bitangentData[1] = bitangent[1];
+            bitangentData[2] = bitangent[2];
+        }
+
+        /**
+         * @brief Generates tangent space vectors for a mesh object from normal and texture
+         *        coordinate data.
+         * @param mesh
+         */
+        void generateTangentSpaceVectors(Mesh &mesh)
+        {
+            size_t const normalOffset = 3;
+            size_t const texCoordOffset = 6;
+            size_t const tangentOffset = 8;
+            size_t const bitangentOffset = 11;
+            size_t const stride = 14;
+
+            for(auto &part : mesh.parts)
+            {
+                size_t partBegin = size_t(part.vertexOffset) * stride;
+                size_t partEnd = partBegin + size_t(part.vertexCount) * stride;
+                for(size_t i = partBegin; i + stride * 3 <= partEnd; i += stride * 3)
+                {
+                    size_t i1 = i;
+                    size_t i2 = i1 + stride;
+                    size_t i3 = i2 + stride;
+                    glm::vec3 const v1 = {mesh.data[i1], mesh.data[i1 + 1], mesh.data[i1 + 2]};
+                    glm::vec3 const v2 = {mesh.data[i2], mesh.data[i2 + 1], mesh.data[i2 + 2]};
+                    glm::vec3 const v3 = {mesh.data[i3], mesh.data[i3 + 1], mesh.data[i3 + 2]};
+
+                    std::array<float, 2> const w1 = { mesh.data[i1 + texCoordOffset], mesh.data[i1 + texCoordOffset +1]};
+                    std::array<float, 2> const w2 = { mesh.data[i2 + texCoordOffset], mesh.data[i2 + texCoordOffset +1]};
+                    std::array<float, 2> const w3 = { mesh.data[i3 + texCoordOffset], mesh.data[i3 + texCoordOffset +1]};
+
+                    float x1 = v2[0] - v1[0];
+                    float x2 = v3[0] - v1[0];
+                    float y1 = v2[1] - v1[1];
+                    float y2 = v3[1] - v1[1];
+                    float z1 = v2[2] - v1[2];
+                    float z2 = v3[2] - v1[2];
+
+                    float s1 = w2[0] - w1[0];
+                    float s2 = w3[0] - w1[0];
+                    float t1 = w2[1] - w1[1];
+                    float t2 = w3[1] - w1[1];
+
+                    float r = 1.0f / (s1 * t2 - s2 * t1);
+                    glm::vec3 faceTangent = {(t2 * x1 - t1 * x2) * r, (t2 * y1 - t1 * y2) * r, (t2 * z1 - t1 * z2) * r};
+                    glm::vec3 faceBitangent = {(s1 * x2 - s2 * x1) * r, (s1 * y2 - s2 * y1) * r, (s1 * z2 - s2 * z1) * r};
+
+                    calculateTangentAndBitangent(&mesh.data[i1 + normalOffset], faceTangent, faceBitangent,
+                                                 &mesh.data[i1 + tangentOffset], &mesh.data[i1 + bitangentOffset]);
+                    calculateTangentAndBitangent(&mesh.data[i2 + normalOffset], faceTangent, faceBitangent,
+                                                 &mesh.data[i2 + tangentOffset], &mesh.data[i2 + bitangentOffset]);
+                    calculateTangentAndBitangent(&mesh.data[i3 + normalOffset], faceTangent, faceBitangent,
+                                                 &mesh.data[i3 + tangentOffset], &mesh.data[i3 + bitangentOffset]);
+                }
+            }
+        }
+    }
+}
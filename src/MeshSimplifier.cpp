@@ -0,0 +1,533 @@
+#include "MeshSimplifier.h"
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+namespace Raven
+{
+    namespace MeshSimplifier
+    {
+        //Weight of the planes that keep open edges in place, relative to the surface planes.
+        static const double BORDER_WEIGHT = 2.0;
+        //A level of detail is only kept if it removes at least this fraction of the triangles.
+        static const float LOD_MIN_REDUCTION = 0.05f;
+
+        //How a vertex may be collapsed.
+        enum class VertexKind : uint8_t
+        {
+            //Surrounded by triangles, may collapse along any edge.
+            Manifold,
+            //On an open edge, may only slide along the edge so the outline is kept.
+            Border,
+            //Shares its position with other vertices (a normal or texture seam) or has a
+            //complex neighbourhood. Never moves but other vertices may collapse into it.
+            Locked
+        };
+
+        //Symmetric 4x4 matrix that sums the squared distances to a set of weighted planes.
+        struct Quadric
+        {
+            double a00 = 0.0, a11 = 0.0, a22 = 0.0, a10 = 0.0, a20 = 0.0, a21 = 0.0;
+            double b0 = 0.0, b1 = 0.0, b2 = 0.0;
+            double c = 0.0;
+            double weight = 0.0;
+        };
+
+        //Moving the source vertex onto the target vertex.
+        struct Collapse
+        {
+            uint32_t source;
+            uint32_t target;
+            double error;
+        };
+
+        static void addPlane(Quadric &quadric, const glm::vec3 &normal, float distance, double weight)
+        {
+            double x = normal.x, y = normal.y, z = normal.z, d = distance;
+            quadric.a00 += weight * x * x;
+            quadric.a11 += weight * y * y;
+            quadric.a22 += weight * z * z;
+            quadric.a10 += weight * y * x;
+            quadric.a20 += weight * z * x;
+            quadric.a21 += weight * z * y;
+            quadric.b0 += weight * x * d;
+            quadric.b1 += weight * y * d;
+            quadric.b2 += weight * z * d;
+            quadric.c += weight * d * d;
+            quadric.weight += weight;
+        }
+
+        static void addQuadric(Quadric &quadric, const Quadric &other)
+        {
+            quadric.a00 += other.a00;
+            quadric.a11 += other.a11;
+            quadric.a22 += other.a22;
+            quadric.a10 += other.a10;
+            quadric.a20 += other.a20;
+            quadric.a21 += other.a21;
+            quadric.b0 += other.b0;
+            quadric.b1 += other.b1;
+            quadric.b2 += other.b2;
+            quadric.c += other.c;
+            quadric.weight += other.weight;
+        }
+
+        //Returns the weighted mean squared distance from the position to the planes.
+        static double evaluateQuadric(const Quadric &quadric, const glm::vec3 &position)
+        {
+            if(quadric.weight <= 0.0)
+                return 0.0;
+            double x = position.x, y = position.y, z = position.z;
+            double result = quadric.a00 * x * x + quadric.a11 * y * y + quadric.a22 * z * z +
+                            2.0 * (quadric.a10 * x * y + quadric.a20 * x * z + quadric.a21 * y * z) +
+                            2.0 * (quadric.b0 * x + quadric.b1 * y + quadric.b2 * z) +
+                            quadric.c;
+            return std::fabs(result) / quadric.weight;
+        }
+
+        static uint64_t hashPosition(const glm::vec3 &position)
+        {
+            const float values[3] = {position.x, position.y, position.z};
+            const unsigned char *bytes = reinterpret_cast<const unsigned char*>(values);
+            uint64_t hash = 14695981039346656037ull;
+            for(size_t i = 0; i < sizeof(values); ++i)
+            {
+                hash ^= bytes[i];
+                hash *= 1099511628211ull;
+            }
+            return hash;
+        }
+
+        /**
+         * @brief Maps every vertex to the first vertex with the same position so that
+         *        vertices split by normals or texture coordinates share their topology.
+         * @param positions
+         * @param referenced Vertices that are used by the triangles.
+         * @param canonical Output, the first vertex with the same position.
+         * @param shared Output, true for vertices whose position is used by several vertices.
+         */
+        static void findSharedPositions(const std::vector<glm::vec3> &positions,
+                                        const std::vector<bool> &referenced,
+                                        std::vector<uint32_t> &canonical,
+                                        std::vector<bool> &shared)
+        {
+            size_t tableSize = 1;
+            while(tableSize < positions.size() * 2)
+                tableSize <<= 1;
+            std::vector<uint32_t> table(tableSize, UINT32_MAX);
+
+            canonical.resize(positions.size());
+            shared.assign(positions.size(), false);
+            for(uint32_t i = 0; i < positions.size(); ++i)
+            {
+                canonical[i] = i;
+                if(!referenced[i])
+                    continue;
+
+                size_t slot = hashPosition(positions[i]) & (tableSize - 1);
+                while(table[slot] != UINT32_MAX &&
+                      std::memcmp(&positions[table[slot]], &positions[i], sizeof(glm::vec3)) != 0)
+                {
+                    slot = (slot + 1) & (tableSize - 1);
+                }
+
+                if(table[slot] == UINT32_MAX)
+                {
+                    table[slot] = i;
+                }
+                else
+                {
+                    canonical[i] = table[slot];
+                    shared[i] = true;
+                    shared[table[slot]] = true;
+                }
+            }
+        }
+
+        //Returns the unnormalized normal of a triangle.
+        static glm::vec3 triangleNormal(const glm::vec3 &p0, const glm::vec3 &p1, const glm::vec3 &p2)
+        {
+            return glm::cross(p1 - p0, p2 - p0);
+        }
+
+        /**
+         * @brief Simplifies a triangle list with quadric error metric edge collapses
+         *        (Garland and Heckbert, "Surface Simplification Using Quadric Error Metrics").
+         *        Vertices are collapsed onto one of their neighbours so the vertex data stays
+         *        untouched and the result can share the vertex buffer of the full mesh.
+         *        Vertices on seams stay in place and vertices on open edges only slide along
+         *        the edge, which keeps the outline and the attribute boundaries intact.
+         *        Collapses are done in passes of independent edges, cheapest first, and a
+         *        collapse is rejected if it would flip one of the surrounding triangles.
+         * @param mesh The mesh that holds the vertices.
+         * @param vertexStride Size of a single vertex in bytes, the position has to come first.
+         * @param indices The triangle list to simplify.
+         * @param indexCount
+         * @param targetIndexCount Simplification stops once the result is this small.
+         * @param maxError Simplification stops before a collapse moves the surface further than this.
+         * @param result Output, the simplified triangle list.
+         * @param resultError Output, the largest distance to the original surface.
+         * @return False if the triangle list is invalid.
+         */
+        bool simplify(const Mesh &mesh, uint32_t vertexStride,
+                      const uint32_t *indices, size_t indexCount,
+                      size_t targetIndexCount, float maxError,
+                      std::vector<uint32_t> &result, float &resultError)
+        {
+            result.clear();
+            resultError = 0.0f;
+            size_t strideFloats = vertexStride / sizeof(float);
+            if(strideFloats < 3 || indexCount % 3 != 0 || (indices == nullptr && indexCount != 0))
+            {
+                std::cerr << "Failed to simplify mesh since the triangle list is invalid!" << std::endl;
+                return false;
+            }
+            if(indexCount == 0)
+                return true;
+
+            //Work on the vertex range the triangles use.
+            uint32_t firstVertex = *std::min_element(indices, indices + indexCount);
+            uint32_t lastVertex = *std::max_element(indices, indices + indexCount);
+            if(lastVertex >= mesh.data.size() / strideFloats)
+            {
+                std::cerr << "Failed to simplify mesh since an index is out of range!" << std::endl;
+                return false;
+            }
+            uint32_t vertexCount = lastVertex - firstVertex + 1;
+
+            std::vector<glm::vec3> positions(vertexCount);
+            std::vector<bool> referenced(vertexCount, false);
+            for(uint32_t i = 0; i < vertexCount; ++i)
+            {
+                const float *position = &mesh.data[(size_t(firstVertex) + i) * strideFloats];
+                positions[i] = glm::vec3(position[0], position[1], position[2]);
+            }
+            for(size_t i = 0; i < indexCount; ++i)
+                referenced[indices[i] - firstVertex] = true;
+
+            std::vector<uint32_t> canonical;
+            std::vector<bool> shared;
+            findSharedPositions(positions, referenced, canonical, shared);
+
+            //Triangles refer to the real vertices, topology is decided on the canonical ones.
+            std::vector<uint32_t> triangles;
+            triangles.reserve(indexCount);
+            for(size_t i = 0; i < indexCount; i += 3)
+            {
+                uint32_t v0 = indices[i] - firstVertex;
+                uint32_t v1 = indices[i + 1] - firstVertex;
+                uint32_t v2 = indices[i + 2] - firstVertex;
+                if(canonical[v0] == canonical[v1] || canonical[v1] == canonical[v2] ||
+                   canonical[v0] == canonical[v2])
+                {
+                    continue;
+                }
+                triangles.insert(triangles.end(), {v0, v1, v2});
+            }
+
+            std::vector<uint32_t> adjacencyOffsets(vertexCount + 1);
+            std::vector<uint32_t> adjacency;
+            //Fills the triangles around every canonical vertex.
+            auto buildAdjacency = [&]()
+            {
+                std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+                for(uint32_t vertex : triangles)
+                    ++adjacencyOffsets[canonical[vertex] + 1];
+                for(uint32_t i = 0; i < vertexCount; ++i)
+                    adjacencyOffsets[i + 1] += adjacencyOffsets[i];
+                adjacency.resize(triangles.size());
+                std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+                for(uint32_t i = 0; i < triangles.size(); ++i)
+                    adjacency[fill[canonical[triangles[i]]]++] = i / 3;
+            };
+            //Returns true if no triangle has the edge from b to a, meaning a to b is an open edge.
+            auto isBorderEdge = [&](uint32_t a, uint32_t b)
+            {
+                for(uint32_t i = adjacencyOffsets[b]; i < adjacencyOffsets[b + 1]; ++i)
+                {
+                    const uint32_t *triangle = &triangles[adjacency[i] * 3];
+                    for(uint32_t e = 0; e < 3; ++e)
+                    {
+                        if(canonical[triangle[e]] == b && canonical[triangle[(e + 1) % 3]] == a)
+                            return false;
+                    }
+                }
+                return true;
+            };
+
+            //Every vertex starts with the planes of its triangles and of its open edges.
+            std::vector<Quadric> quadrics(vertexCount);
+            buildAdjacency();
+            for(size_t i = 0; i < triangles.size(); i += 3)
+            {
+                uint32_t c[3] = {canonical[triangles[i]], canonical[triangles[i + 1]], canonical[triangles[i + 2]]};
+                glm::vec3 normal = triangleNormal(positions[c[0]], positions[c[1]], positions[c[2]]);
+                float doubleArea = glm::length(normal);
+                if(doubleArea <= 0.0f)
+                    continue;
+                normal /= doubleArea;
+
+                for(uint32_t e = 0; e < 3; ++e)
+                    addPlane(quadrics[c[e]], normal, -glm::dot(normal, positions[c[e]]), doubleArea * 0.5);
+
+                for(uint32_t e = 0; e < 3; ++e)
+                {
+                    uint32_t a = c[e];
+                    uint32_t b = c[(e + 1) % 3];
+                    if(!isBorderEdge(a, b))
+                        continue;
+                    glm::vec3 edge = positions[b] - positions[a];
+                    float edgeLength = glm::length(edge);
+                    if(edgeLength <= 0.0f)
+                        continue;
+                    glm::vec3 edgeNormal = glm::normalize(glm::cross(edge, normal));
+                    float distance = -glm::dot(edgeNormal, positions[a]);
+                    addPlane(quadrics[a], edgeNormal, distance, edgeLength * edgeLength * BORDER_WEIGHT);
+                    addPlane(quadrics[b], edgeNormal, distance, edgeLength * edgeLength * BORDER_WEIGHT);
+                }
+            }
+
+            size_t targetTriangleCount = targetIndexCount / 3;
+            double maxSquaredError = double(maxError) * maxError;
+            double largestError = 0.0;
+
+            std::vector<VertexKind> kinds(vertexCount);
+            std::vector<uint32_t> borderEdgeCounts(vertexCount);
+            std::vector<Collapse> collapses;
+            std::vector<uint32_t> remap(vertexCount);
+            std::vector<bool> lockedThisPass(vertexCount);
+
+            while(triangles.size() / 3 > targetTriangleCount)
+            {
+                //Classify the vertices for the current triangles.
+                buildAdjacency();
+                std::fill(borderEdgeCounts.begin(), borderEdgeCounts.end(), 0);
+                for(size_t i = 0; i < triangles.size(); i += 3)
+                {
+                    for(uint32_t e = 0; e < 3; ++e)
+                    {
+                        uint32_t a = canonical[triangles[i + e]];
+                        uint32_t b = canonical[triangles[i + (e + 1) % 3]];
+                        if(isBorderEdge(a, b))
+                            ++borderEdgeCounts[a];
+                    }
+                }
+                for(uint32_t i = 0; i < vertexCount; ++i)
+                {
+                    if(shared[i] || borderEdgeCounts[i] > 1)
+                        kinds[i] = VertexKind::Locked;
+                    else
+                        kinds[i] = borderEdgeCounts[i] == 1 ? VertexKind::Border : VertexKind::Manifold;
+                }
+
+                //Gather every allowed collapse with its cost.
+                collapses.clear();
+                auto addCollapse = [&](uint32_t source, uint32_t target, bool borderEdge)
+                {
+                    bool allowed = (kinds[source] == VertexKind::Manifold && !borderEdge) ||
+                                   (kinds[source] == VertexKind::Border && borderEdge);
+                    //A seam has no single vertex to collapse into, the triangles of the
+                    //source would take the attributes of an arbitrary side.
+                    if(!allowed || shared[target])
+                        return;
+
+                    Quadric quadric = quadrics[source];
+                    addQuadric(quadric, quadrics[target]);
+                    collapses.push_back({source, target, evaluateQuadric(quadric, positions[target])});
+                };
+                for(size_t i = 0; i < triangles.size(); i += 3)
+                {
+                    for(uint32_t e = 0; e < 3; ++e)
+                    {
+                        uint32_t a = canonical[triangles[i + e]];
+                        uint32_t b = canonical[triangles[i + (e + 1) % 3]];
+                        bool borderEdge = isBorderEdge(a, b);
+                        addCollapse(a, b, borderEdge);
+                        //Open edges are only seen from one side.
+                        if(borderEdge)
+                            addCollapse(b, a, true);
+                    }
+                }
+                std::sort(collapses.begin(), collapses.end(), [](const Collapse &a, const Collapse &b)
+                {
+                    return a.error < b.error;
+                });
+
+                //Apply the cheapest collapses whose neighbourhoods do not overlap.
+                for(uint32_t i = 0; i < vertexCount; ++i)
+                    remap[i] = i;
+                std::fill(lockedThisPass.begin(), lockedThisPass.end(), false);
+                size_t triangleCount = triangles.size() / 3;
+                size_t appliedCount = 0;
+                for(const Collapse &collapse : collapses)
+                {
+                    if(triangleCount <= targetTriangleCount || collapse.error > maxSquaredError)
+                        break;
+                    if(lockedThisPass[collapse.source] || lockedThisPass[collapse.target])
+                        continue;
+
+                    //Reject collapses that flip a remaining triangle.
+                    bool flips = false;
+                    uint32_t removedTriangles = 0;
+                    for(uint32_t j = adjacencyOffsets[collapse.source]; j < adjacencyOffsets[collapse.source + 1]; ++j)
+                    {
+                        const uint32_t *triangle = &triangles[adjacency[j] * 3];
+                        uint32_t c[3] = {canonical[triangle[0]], canonical[triangle[1]], canonical[triangle[2]]};
+                        if(c[0] == collapse.target || c[1] == collapse.target || c[2] == collapse.target)
+                        {
+                            ++removedTriangles;
+                            continue;
+                        }
+
+                        glm::vec3 before = triangleNormal(positions[c[0]], positions[c[1]], positions[c[2]]);
+                        glm::vec3 moved[3] = {positions[c[0]], positions[c[1]], positions[c[2]]};
+                        for(uint32_t e = 0; e < 3; ++e)
+                        {
+                            if(c[e] == collapse.source)
+                                moved[e] = positions[collapse.target];
+                        }
+                        glm::vec3 after = triangleNormal(moved[0], moved[1], moved[2]);
+                        if(glm::dot(before, after) <= 0.0f)
+                        {
+                            flips = true;
+                            break;
+                        }
+                    }
+                    if(flips)
+                        continue;
+
+                    remap[collapse.source] = collapse.target;
+                    addQuadric(quadrics[collapse.target], quadrics[collapse.source]);
+                    largestError = std::max(largestError, collapse.error);
+                    triangleCount -= std::min<size_t>(removedTriangles, triangleCount);
+                    ++appliedCount;
+
+                    //The triangles around the source changed, so every vertex on them has to
+                    //wait for the next pass where its cost and flip checks are up to date.
+                    lockedThisPass[collapse.target] = true;
+                    for(uint32_t j = adjacencyOffsets[collapse.source]; j < adjacencyOffsets[collapse.source + 1]; ++j)
+                    {
+                        const uint32_t *triangle = &triangles[adjacency[j] * 3];
+                        for(uint32_t e = 0; e < 3; ++e)
+                            lockedThisPass[canonical[triangle[e]]] = true;
+                    }
+                }
+                if(appliedCount == 0)
+                    break;
+
+                //Move the collapsed vertices and drop the triangles that became degenerate.
+                //Collapsed vertices are never shared so their canonical vertex is themselves.
+                size_t writeIndex = 0;
+                for(size_t i = 0; i < triangles.size(); i += 3)
+                {
+                    uint32_t v[3];
+                    for(uint32_t e = 0; e < 3; ++e)
+                        v[e] = remap[canonical[triangles[i + e]]] != canonical[triangles[i + e]] ?
+                               remap[canonical[triangles[i + e]]] : triangles[i + e];
+                    if(canonical[v[0]] == canonical[v[1]] || canonical[v[1]] == canonical[v[2]] ||
+                       canonical[v[0]] == canonical[v[2]])
+                    {
+                        continue;
+                    }
+                    triangles[writeIndex++] = v[0];
+                    triangles[writeIndex++] = v[1];
+                    triangles[writeIndex++] = v[2];
+                }
+                triangles.resize(writeIndex);
+            }
+
+            result.resize(triangles.size());
+            for(size_t i = 0; i < triangles.size(); ++i)
+                result[i] = triangles[i] + firstVertex;
+            resultError = static_cast<float>(std::sqrt(largestError));
+            return true;
+        }
+
+        /**
+         * @brief Gives every part a chain of levels of detail. The first level is the part
+         *        itself, every following one is simplified from the full part down to about
+         *        reduction times the triangles of the previous level. The new triangle lists
+         *        are appended to the index buffer and share the vertices of the full part.
+         *        The chain ends early once the simplifier cannot remove enough triangles.
+         * @param mesh An indexed mesh, see MeshLoader::generateIndices.
+         * @param vertexStride Size of a single vertex in bytes, the position has to come first.
+         * @param lodCount Maximum number of levels per part including the full part.
+         * @param reduction Triangle count ratio between neighbouring levels, between 0 and 1.
+         * @param maxError Largest model space error allowed for any level.
+         * @return False if the mesh is not indexed or the parameters are invalid.
+         */
+        bool generateLods(Mesh &mesh, uint32_t vertexStride, uint32_t lodCount,
+                          float reduction, float maxError)
+        {
+            if(mesh.indices.empty())
+            {
+                std::cerr << "Failed to generate levels of detail since the mesh is not indexed!" << std::endl;
+                return false;
+            }
+            if(lodCount == 0 || reduction <= 0.0f || reduction >= 1.0f)
+            {
+                std::cerr << "Failed to generate levels of detail since the parameters are invalid!" << std::endl;
+                return false;
+            }
+
+            mesh.lods.clear();
+            std::vector<uint32_t> lodIndices;
+            for(Mesh::Part &part : mesh.parts)
+            {
+                part.lodOffset = static_cast<uint32_t>(mesh.lods.size());
+                mesh.lods.push_back({part.indexOffset, part.indexCount, 0.0f});
+
+                size_t previousIndexCount = part.indexCount;
+                for(uint32_t level = 1; level < lodCount; ++level)
+                {
+                    size_t targetIndexCount = static_cast<size_t>(previousIndexCount / 3 * reduction) * 3;
+                    if(targetIndexCount == 0)
+                        break;
+
+                    float error;
+                    if(!simplify(mesh, vertexStride, &mesh.indices[part.indexOffset], part.indexCount,
+                                 targetIndexCount, maxError, lodIndices, error))
+                    {
+                        return false;
+                    }
+                    if(lodIndices.empty() || lodIndices.size() > previousIndexCount * (1.0f - LOD_MIN_REDUCTION))
+                        break;
+
+                    //Coarser levels never claim to be more accurate than finer ones.
+                    error = std::max(error, mesh.lods.back().error);
+                    mesh.lods.push_back({static_cast<uint32_t>(mesh.indices.size()),
+                                         static_cast<uint32_t>(lodIndices.size()), error});
+                    mesh.indices.insert(mesh.indices.end(), lodIndices.begin(), lodIndices.end());
+                    previousIndexCount = lodIndices.size();
+                }
+                part.lodCount = static_cast<uint32_t>(mesh.lods.size()) - part.lodOffset;
+            }
+            return true;
+        }
+
+        /**
+         * @brief Picks the level of detail of a part from its projected error. The error of a
+         *        level times the pixels a model space unit covers is how far, in pixels, its
+         *        silhouette may be from the full part.
+         * @param mesh
+         * @param part
+         * @param pixelsPerUnit Pixels covered by one model space unit at the object's distance.
+         * @param maxScreenSpaceError Largest error in pixels that is accepted.
+         * @return Index of the level relative to Mesh::Part::lodOffset, 0 being the full part.
+         */
+        uint32_t selectLod(const Mesh &mesh, const Mesh::Part &part,
+                           float pixelsPerUnit, float maxScreenSpaceError)
+        {
+            uint32_t selected = 0;
+            for(uint32_t i = 1; i < part.lodCount; ++i)
+            {
+                if(mesh.lods[part.lodOffset + i].error * pixelsPerUnit > maxScreenSpaceError)
+                    break;
+                selected = i;
+            }
+            return selected;
+        }
+    }
+}
@@ -0,0 +1,261 @@
+#include "MeshletBuilder.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+namespace Raven
+{
+    namespace MeshletBuilder
+    {
+        //Returns the position of a vertex.
+        static inline glm::vec3 getPosition(const Mesh &mesh, uint32_t vertex, size_t strideFloats)
+        {
+            const float *position = &mesh.data[vertex * strideFloats];
+            return glm::vec3(position[0], position[1], position[2]);
+        }
+
+        /**
+         * @brief Splits the indexed parts of a mesh into meshlets of at most MESHLET_MAX_VERTICES
+         *        vertices and MESHLET_MAX_TRIANGLES triangles. Triangles are added in index order,
+         *        which keeps neighbouring triangles together for meshes with a vertex cache
+         *        friendly order. A meshlet is closed when the next triangle does not fit.
+         * @param mesh An indexed mesh, see MeshLoader::generateIndices.
+         * @param vertexStride Size of a single vertex in bytes, the position has to come first.
+         * @return False if the mesh has no indices.
+         */
+        bool buildMeshlets(Mesh &mesh, uint32_t vertexStride)
+        {
+            if(mesh.indices.empty() || vertexStride < 3 * sizeof(float))
+            {
+                std::cerr << "Failed to build meshlets since the mesh is not indexed!" << std::endl;
+                return false;
+            }
+
+            mesh.meshlets.clear();
+            mesh.meshletBounds.clear();
+            mesh.meshletVertices.clear();
+            mesh.meshletTriangles.clear();
+
+            //Maps a mesh vertex to its local index in the current meshlet. Entries are only
+            //valid when their stamp matches the current meshlet, so nothing has to be cleared.
+            std::vector<uint8_t> localIndices(mesh.data.size() / (vertexStride / sizeof(float)));
+            std::vector<uint32_t> stamps(localIndices.size(), UINT32_MAX);
+
+            for(Mesh::Part &part : mesh.parts)
+            {
+                part.meshletOffset = static_cast<uint32_t>(mesh.meshlets.size());
+
+                Meshlet meshlet = {static_cast<uint32_t>(mesh.meshletVertices.size()),
+                                   static_cast<uint32_t>(mesh.meshletTriangles.size()), 0, 0};
+                uint32_t stamp = static_cast<uint32_t>(mesh.meshlets.size());
+
+                for(uint32_t i = 0; i + 2 < part.indexCount; i += 3)
+                {
+                    const uint32_t *triangle = &mesh.indices[part.indexOffset + i];
+
+                    uint32_t newVertexCount = 0;
+                    for(uint32_t j = 0; j < 3; ++j)
+                    {
+                        bool duplicate = (j > 0 && triangle[j] == triangle[0]) || (j > 1 && triangle[j] == triangle[1]);
+                        if(stamps[triangle[j]] != stamp && !duplicate)
+                            ++newVertexCount;
+                    }
+
+                    //Close the meshlet if the triangle does not fit.
+                    if(meshlet.vertexCount + newVertexCount > MESHLET_MAX_VERTICES ||
+                       meshlet.triangleCount + 1 > MESHLET_MAX_TRIANGLES)
+                    {
+                        mesh.meshlets.push_back(meshlet);
+                        meshlet = {static_cast<uint32_t>(mesh.meshletVertices.size()),
+                                   static_cast<uint32_t>(mesh.meshletTriangles.size()), 0, 0};
+                        stamp = static_cast<uint32_t>(mesh.meshlets.size());
+                    }
+
+                    for(uint32_t j = 0; j < 3; ++j)
+                    {
+                        uint32_t vertex = triangle[j];
+                        if(stamps[vertex] != stamp)
+                        {
+                            stamps[vertex] = stamp;
+                            localIndices[vertex] = static_cast<uint8_t>(meshlet.vertexCount++);
+                            mesh.meshletVertices.push_back(vertex);
+                        }
+                        mesh.meshletTriangles.push_back(localIndices[vertex]);
+                    }
+                    ++meshlet.triangleCount;
+                }
+
+                if(meshlet.triangleCount > 0)
+                    mesh.meshlets.push_back(meshlet);
+                part.meshletCount = static_cast<uint32_t>(mesh.meshlets.size()) - part.meshletOffset;
+            }
+
+            mesh.meshletBounds.reserve(mesh.meshlets.size());
+            for(const Meshlet &meshlet : mesh.meshlets)
+                mesh.meshletBounds.push_back(computeMeshletBounds(mesh, meshlet, vertexStride));
+            return true;
+        }
+
+        /**
+         * @brief Computes the bounding sphere and the normal cone of a meshlet. The sphere
+         *        is Ritter's approximation. The cone axis is the average triangle normal and
+         *        the cutoff is the sine of the widest angle between the axis and a triangle
+         *        normal, so the back-face test only needs the direction to the cone apex.
+         * @param mesh
+         * @param meshlet
+         * @param vertexStride Size of a single vertex in bytes.
+         * @return The bounds. Meshlets whose normals spread too much get a cutoff of 1,
+         *         which never culls them.
+         */
+        MeshletBounds computeMeshletBounds(const Mesh &mesh, const Meshlet &meshlet, uint32_t vertexStride)
+        {
+            size_t strideFloats = vertexStride / sizeof(float);
+            MeshletBounds bounds = {};
+
+            //Start from the two vertices that are furthest apart along an axis.
+            const uint32_t *vertices = &mesh.meshletVertices[meshlet.vertexOffset];
+            uint32_t minimum[3] = {vertices[0], vertices[0], vertices[0]};
+            uint32_t maximum[3] = {vertices[0], vertices[0], vertices[0]};
+            for(uint32_t i = 0; i < meshlet.vertexCount; ++i)
+            {
+                glm::vec3 position = getPosition(mesh, vertices[i], strideFloats);
+                for(int axis = 0; axis < 3; ++axis)
+                {
+                    if(position[axis] < getPosition(mesh, minimum[axis], strideFloats)[axis])
+                        minimum[axis] = vertices[i];
+                    if(position[axis] > getPosition(mesh, maximum[axis], strideFloats)[axis])
+                        maximum[axis] = vertices[i];
+                }
+            }
+
+            int widestAxis = 0;
+            float widestDistance = 0.0f;
+            for(int axis = 0; axis < 3; ++axis)
+            {
+                glm::vec3 difference = getPosition(mesh, maximum[axis], strideFloats) -
+                                       getPosition(mesh, minimum[axis], strideFloats);
+                if(glm::dot(difference, difference) > widestDistance)
+                {
+                    widestDistance = glm::dot(difference, difference);
+                    widestAxis = axis;
+                }
+            }
+
+            glm::vec3 center = 0.5f * (getPosition(mesh, minimum[widestAxis], strideFloats) +
+                                       getPosition(mesh, maximum[widestAxis], strideFloats));
+            float radius = 0.5f * std::sqrt(widestDistance);
+
+            //Grow the sphere to cover every vertex.
+            for(uint32_t i = 0; i < meshlet.vertexCount; ++i)
+            {
+                glm::vec3 position = getPosition(mesh, vertices[i], strideFloats);
+                float distance = glm::length(position - center);
+                if(distance > radius)
+                {
+                    float shift = 0.5f * (distance - radius);
+                    radius = 0.5f * (distance + radius);
+                    center += (position - center) * (shift / distance);
+                }
+            }
+
+            bounds.center[0] = center.x;
+            bounds.center[1] = center.y;
+            bounds.center[2] = center.z;
+            bounds.radius = radius;
+
+            //Normal cone.
+            std::vector<glm::vec3> normals;
+            normals.reserve(meshlet.triangleCount);
+            glm::vec3 axis(0.0f);
+            const uint8_t *triangles = &mesh.meshletTriangles[meshlet.triangleOffset];
+            for(uint32_t i = 0; i < meshlet.triangleCount; ++i)
+            {
+                glm::vec3 p0 = getPosition(mesh, vertices[triangles[i * 3 + 0]], strideFloats);
+                glm::vec3 p1 = getPosition(mesh, vertices[triangles[i * 3 + 1]], strideFloats);
+                glm::vec3 p2 = getPosition(mesh, vertices[triangles[i * 3 + 2]], strideFloats);
+                glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+                float area = glm::length(normal);
+                //Degenerate triangles do not face anywhere.
+                if(area <= 0.0f)
+                    continue;
+                normal = normal / area;
+                normals.push_back(normal);
+                axis += normal;
+            }
+
+            float axisLength = glm::length(axis);
+            float minimumDot = 1.0f;
+            if(axisLength > 0.0f)
+            {
+                axis = axis / axisLength;
+                for(const glm::vec3 &normal : normals)
+                    minimumDot = std::min(minimumDot, glm::dot(axis, normal));
+            }
+
+            //Normals spread over more than ~84 degrees from the axis would give a cone
+            //that never culls anything anyway.
+            if(axisLength <= 0.0f || minimumDot <= 0.1f)
+            {
+                bounds.coneApex[0] = center.x;
+                bounds.coneApex[1] = center.y;
+                bounds.coneApex[2] = center.z;
+                bounds.coneCutoff = 1.0f;
+                return bounds;
+            }
+
+            //Move the apex back along the axis until every triangle plane lies in front of it,
+            //which makes the test conservative for any camera position.
+            float apexDistance = 0.0f;
+            for(uint32_t i = 0, n = 0; i < meshlet.triangleCount; ++i)
+            {
+                glm::vec3 p0 = getPosition(mesh, vertices[triangles[i * 3 + 0]], strideFloats);
+                glm::vec3 p1 = getPosition(mesh, vertices[triangles[i * 3 + 1]], strideFloats);
+                glm::vec3 p2 = getPosition(mesh, vertices[triangles[i * 3 + 2]], strideFloats);
+                if(glm::length(glm::cross(p1 - p0, p2 - p0)) <= 0.0f)
+                    continue;
+                const glm::vec3 &normal = normals[n++];
+                float distance = glm::dot(center - p0, normal) / glm::dot(axis, normal);
+                apexDistance = std::max(apexDistance, distance);
+            }
+
+            glm::vec3 apex = center - axis * apexDistance;
+            bounds.coneApex[0] = apex.x;
+            bounds.coneApex[1] = apex.y;
+            bounds.coneApex[2] = apex.z;
+            bounds.coneAxis[0] = axis.x;
+            bounds.coneAxis[1] = axis.y;
+            bounds.coneAxis[2] = axis.z;
+            bounds.coneCutoff = std::sqrt(1.0f - minimumDot * minimumDot);
+            return bounds;
+        }
+
+        /**
+         * @brief Tests a meshlet against the camera. Both tests are conservative, a meshlet
+         *        that is not culled may still be invisible.
+         * @param bounds
+         * @param cameraPosition Camera position in the model space of the mesh.
+         * @param frustumPlanes Planes as (normal, distance) with normals pointing inside, or nullptr.
+         * @param frustumPlaneCount
+         * @return True if the meshlet can be skipped.
+         */
+        bool isMeshletCulled(const MeshletBounds &bounds, const glm::vec3 &cameraPosition,
+                             const glm::vec4 *frustumPlanes, uint32_t frustumPlaneCount)
+        {
+            glm::vec3 center(bounds.center[0], bounds.center[1], bounds.center[2]);
+            for(uint32_t i = 0; i < frustumPlaneCount; ++i)
+            {
+                glm::vec3 normal(frustumPlanes[i].x, frustumPlanes[i].y, frustumPlanes[i].z);
+                if(glm::dot(normal, center) + frustumPlanes[i].w < -bounds.radius)
+                    return true;
+            }
+
+            glm::vec3 apex(bounds.coneApex[0], bounds.coneApex[1], bounds.coneApex[2]);
+            glm::vec3 axis(bounds.coneAxis[0], bounds.coneAxis[1], bounds.coneAxis[2]);
+            glm::vec3 viewDirection = apex - cameraPosition;
+            float viewDistance = glm::length(viewDirection);
+            if(viewDistance <= 0.0f)
+                return false;
+            return glm::dot(viewDirection, axis) >= bounds.coneCutoff * viewDistance;
+        }
+    }
+}
@@ -0,0 +1,498 @@
+#include "PostProcessChain.h"
+#include "VulkanUtility.h"
+#include "VulkanStructures.h"
+#include "VulkanDescriptorManager.h"
+#include <algorithm>
+
+namespace Raven
+{
+    namespace
+    {
+        void destroyPostProcessImage(VkDevice logicalDevice, VulkanImage &image, VkDeviceMemory &memory)
+        {
+            destroyImageView(logicalDevice, image.imageView);
+            destroyImage(logicalDevice, image.image);
+            freeMemory(logicalDevice, memory);
+            image = {};
+        }
+
+        uint32_t postProcessGroupCount(uint32_t size)
+        {
+            return (size + POST_PROCESS_WORKGROUP_SIZE - 1) / POST_PROCESS_WORKGROUP_SIZE;
+        }
+    }
+
+    PostProcessChain::PostProcessChain()
+    {
+
+    }
+
+    PostProcessChain::~PostProcessChain()
+    {
+        destroy();
+    }
+
+    /**
+     * @brief Creates the scene color and output images as storage images of the device, the
+     *        sampler, the descriptor sets and the pipelines of the passes. The bloom and tonemap
+     *        images are created by the render graph when the first chain is recorded.
+     * @param device
+     * @param sceneWidth Size of the scene color the geometry pass renders.
+     * @param sceneHeight
+     * @param shaderDirectory Directory with the compiled shaders of Shaders/postprocess.
+     * @return False if anything could not be created.
+     */
+    bool PostProcessChain::initialize(VulkanDevice *device, uint32_t sceneWidth, uint32_t sceneHeight,
+                                      const std::string &shaderDirectory)
+    {
+        destroy();
+        if(sceneWidth == 0 || sceneHeight == 0)
+        {
+            std::cerr << "Failed to initialize post processing for an empty scene!" << std::endl;
+            return false;
+        }
+        this->device = device;
+        logicalDevice = device->getLogicalDevice();
+        width = sceneWidth;
+        height = sceneHeight;
+        bloomLevelCount = computeBloomLevelCount(width, height, SETTINGS_POST_PROCESS_MAX_BLOOM_LEVELS);
+
+        //The scene color is rendered to and sampled, the output is sampled or copied by
+        //whatever presents it.
+        for(FrameResources &frame : frames)
+        {
+            if(!device->createStorageImage(VK_IMAGE_TYPE_2D, POST_PROCESS_HDR_FORMAT, {width, height, 1}, 1, 1,
+                                           VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+                                           VK_IMAGE_VIEW_TYPE_2D, VK_IMAGE_ASPECT_COLOR_BIT, VK_FALSE,
+                                           frame.sceneColor, frame.sceneColorMemory) ||
+               !device->createStorageImage(VK_IMAGE_TYPE_2D, POST_PROCESS_LDR_FORMAT, {width, height, 1}, 1, 1,
+                                           VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+                                           VK_IMAGE_VIEW_TYPE_2D, VK_IMAGE_ASPECT_COLOR_BIT, VK_FALSE,
+                                           frame.output, frame.outputMemory))
+            {
+                std::cerr << "Failed to create post processing frame images!" << std::endl;
+                destroy();
+                return false;
+            }
+        }
+        //Only compute passes are declared, so the graph needs no renderer.
+        renderGraph.initialize(logicalDevice, device->getMemoryProperties(), nullptr);
+
+        //The bloom filters rely on bilinear taps between texels.
+        VkSamplerCreateInfo samplerInfo = VulkanStructures::samplerCreateInfo(VK_FILTER_LINEAR, VK_FILTER_LINEAR,
+                                                                              VK_SAMPLER_MIPMAP_MODE_NEAREST,
+                                                                              VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+                                                                              VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+                                                                              VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+                                                                              0.0f, VK_FALSE, 1.0f, VK_FALSE,
+                                                                              VK_COMPARE_OP_ALWAYS, 0.0f, 0.0f,
+                                                                              VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE, VK_FALSE);
+        if(!createSampler(logicalDevice, samplerInfo, sampler))
+        {
+            destroy();
+            return false;
+        }
+
+        //Sets per frame: first downsample, tonemap and FXAA. Shared: a downsample and an
+        //upsample for every level after the first.
+        uint32_t frameCount = SETTINGS_POST_PROCESS_FRAME_COUNT;
+        uint32_t chainSetCount = bloomLevelCount - 1;
+        uint32_t setCount = 3 * frameCount + 2 * chainSetCount;
+        std::vector<VkDescriptorSetLayoutBinding> passBindings =
+        {
+            {0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr},
+            {1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr}
+        };
+        std::vector<VkDescriptorSetLayoutBinding> tonemapBindings =
+        {
+            {0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr},
+            {1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr},
+            {2, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr}
+        };
+        std::vector<VkDescriptorPoolSize> poolSizes =
+        {
+            {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4 * frameCount + 2 * chainSetCount},
+            {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, setCount}
+        };
+        if(!VulkanDescriptorManager::createDescriptorSetLayout(logicalDevice, passBindings, passSetLayout) ||
+           !VulkanDescriptorManager::createDescriptorSetLayout(logicalDevice, tonemapBindings, tonemapSetLayout) ||
+           !VulkanDescriptorManager::createDescriptorPool(logicalDevice, VK_FALSE, setCount, poolSizes, descriptorPool))
+        {
+            destroy();
+            return false;
+        }
+        //The tonemap sets come last.
+        std::vector<VkDescriptorSetLayout> setLayouts(setCount, passSetLayout);
+        std::fill(setLayouts.end() - frameCount, setLayouts.end(), tonemapSetLayout);
+        std::vector<VkDescriptorSet> sets;
+        if(!VulkanDescriptorManager::allocateDescriptorSets(logicalDevice, descriptorPool, setLayouts, sets))
+        {
+            destroy();
+            return false;
+        }
+        std::vector<VkDescriptorSet>::const_iterator nextSet = sets.begin();
+        downsampleSets.assign(nextSet, nextSet + chainSetCount);
+        nextSet += chainSetCount;
+        upsampleSets.assign(nextSet, nextSet + chainSetCount);
+        nextSet += chainSetCount;
+        for(FrameResources &frame : frames)
+        {
+            frame.downsampleSet = *nextSet++;
+            frame.fxaaSet = *nextSet++;
+        }
+        for(FrameResources &frame : frames)
+            frame.tonemapSet = *nextSet++;
+
+        if(!createPipelines(shaderDirectory))
+        {
+            destroy();
+            return false;
+        }
+        return true;
+    }
+
+    void PostProcessChain::destroy()
+    {
+        if(logicalDevice == VK_NULL_HANDLE)
+            return;
+
+        destroyPipeline(logicalDevice, downsamplePipeline);
+        destroyPipeline(logicalDevice, upsamplePipeline);
+        destroyPipeline(logicalDevice, tonemapPipeline);
+        destroyPipeline(logicalDevice, fxaaPipeline);
+        destroyPipelineLayout(logicalDevice, passPipelineLayout);
+        destroyPipelineLayout(logicalDevice, tonemapPipelineLayout);
+        VulkanDescriptorManager::destroyDescriptorPool(logicalDevice, descriptorPool);
+        VulkanDescriptorManager::destroyDescriptorSetLayout(logicalDevice, passSetLayout);
+        VulkanDescriptorManager::destroyDescriptorSetLayout(logicalDevice, tonemapSetLayout);
+        downsampleSets.clear();
+        upsampleSets.clear();
+
+        destroySampler(logicalDevice, sampler);
+        renderGraph.destroy();
+        boundViews.clear();
+        for(FrameResources &frame : frames)
+        {
+            destroyPostProcessImage(logicalDevice, frame.sceneColor, frame.sceneColorMemory);
+            destroyPostProcessImage(logicalDevice, frame.output, frame.outputMemory);
+            frame = {};
+        }
+
+        outputConsumingStages = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+        width = 0;
+        height = 0;
+        bloomLevelCount = 0;
+        device = nullptr;
+        logicalDevice = VK_NULL_HANDLE;
+    }
+
+    /**
+     * @brief Creates the downsample, upsample, tonemap and FXAA pipelines.
+     * @param shaderDirectory
+     * @return False if a shader could not be loaded or a pipeline could not be created.
+     */
+    bool PostProcessChain::createPipelines(const std::string &shaderDirectory)
+    {
+        VkPushConstantRange pushConstantRange = {VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(PostProcessPushConstants)};
+        if(!createPipelineLayout(logicalDevice, {passSetLayout}, {pushConstantRange}, passPipelineLayout) ||
+           !createPipelineLayout(logicalDevice, {tonemapSetLayout}, {pushConstantRange}, tonemapPipelineLayout))
+        {
+            return false;
+        }
+
+        const char *shaderNames[] = {"bloomdownsample-comp.spv", "bloomupsample-comp.spv",
+                                     "tonemap-comp.spv", "fxaa-comp.spv"};
+        VkPipelineLayout layouts[] = {passPipelineLayout, passPipelineLayout, tonemapPipelineLayout, passPipelineLayout};
+        std::vector<VkShaderModule> shaderModules;
+        std::vector<VkComputePipelineCreateInfo> pipelineInfos;
+        bool shadersLoaded = true;
+        for(size_t i = 0; i < 4; ++i)
+        {
+            VkShaderModule shaderModule = VK_NULL_HANDLE;
+            if(!loadShaderModule(logicalDevice, shaderDirectory + shaderNames[i], shaderModule))
+            {
+                std::cerr << "Failed to load post processing shader " << shaderNames[i] << "!" << std::endl;
+                shadersLoaded = false;
+                break;
+            }
+            shaderModules.push_back(shaderModule);
+
+            VkComputePipelineCreateInfo pipelineInfo = {};
+            pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+            pipelineInfo.stage = VulkanStructures::pipelineShaderStageCreateInfo(VK_SHADER_STAGE_COMPUTE_BIT,
+                                                                                 shaderModule, "main", nullptr);
+            pipelineInfo.layout = layouts[i];
+            pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+            pipelineInfo.basePipelineIndex = -1;
+            pipelineInfos.push_back(pipelineInfo);
+        }
+
+        std::vector<VkPipeline> pipelines;
+        bool pipelinesCreated = shadersLoaded && createComputePipelines(logicalDevice, VK_NULL_HANDLE, pipelineInfos, pipelines);
+        for(VkShaderModule &shaderModule : shaderModules)
+            destroyShaderModule(logicalDevice, shaderModule);
+        if(!pipelinesCreated)
+            return false;
+        downsamplePipeline = pipelines[0];
+        upsamplePipeline = pipelines[1];
+        tonemapPipeline = pipelines[2];
+        fxaaPipeline = pipelines[3];
+        return true;
+    }
+
+    /**
+     * @brief Writes the descriptor sets of every pass. The graph samples images in
+     *        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL and writes storage images in VK_IMAGE_LAYOUT_GENERAL.
+     * @param transientViews Views of the bloom levels, followed by the view of the tonemapped image.
+     */
+    void PostProcessChain::writeDescriptorSets(const std::vector<VkImageView> &transientViews)
+    {
+        const std::vector<VkImageView> bloomLevelViews(transientViews.begin(), transientViews.begin() + bloomLevelCount);
+        VkImageView tonemappedView = transientViews[bloomLevelCount];
+
+        std::vector<ImageDescriptorInfo> imageDescriptors;
+        for(uint32_t level = 1; level < bloomLevelCount; ++level)
+        {
+            imageDescriptors.push_back({downsampleSets[level - 1], 0, 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                                        {{sampler, bloomLevelViews[level - 1], VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL}}});
+            imageDescriptors.push_back({downsampleSets[level - 1], 1, 0, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                                        {{VK_NULL_HANDLE, bloomLevelViews[level], VK_IMAGE_LAYOUT_GENERAL}}});
+            imageDescriptors.push_back({upsampleSets[level - 1], 0, 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                                        {{sampler, bloomLevelViews[level], VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL}}});
+            imageDescriptors.push_back({upsampleSets[level - 1], 1, 0, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                                        {{VK_NULL_HANDLE, bloomLevelViews[level - 1], VK_IMAGE_LAYOUT_GENERAL}}});
+        }
+        for(FrameResources &frame : frames)
+        {
+            imageDescriptors.push_back({frame.downsampleSet, 0, 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                                        {{sampler, frame.sceneColor.imageView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL}}});
+            imageDescriptors.push_back({frame.downsampleSet, 1, 0, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                                        {{VK_NULL_HANDLE, bloomLevelViews[0], VK_IMAGE_LAYOUT_GENERAL}}});
+            imageDescriptors.push_back({frame.tonemapSet, 0, 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                                        {{sampler, frame.sceneColor.imageView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL}}});
+            imageDescriptors.push_back({frame.tonemapSet, 1, 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                                        {{sampler, bloomLevelViews[0], VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL}}});
+            imageDescriptors.push_back({frame.tonemapSet, 2, 0, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                                        {{VK_NULL_HANDLE, tonemappedView, VK_IMAGE_LAYOUT_GENERAL}}});
+            imageDescriptors.push_back({frame.fxaaSet, 0, 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                                        {{sampler, tonemappedView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL}}});
+            imageDescriptors.push_back({frame.fxaaSet, 1, 0, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                                        {{VK_NULL_HANDLE, frame.output.imageView, VK_IMAGE_LAYOUT_GENERAL}}});
+        }
+        VulkanDescriptorManager::updateDescriptorSets(logicalDevice, imageDescriptors, {}, {}, {});
+    }
+
+    /**
+     * @brief Hands the frame's scene color to the compute queue. Without an async compute
+     *        family nothing is recorded and the acquire in recordChain does the transition.
+     * @param cmdBuffer A command buffer of the graphics queue.
+     * @param frame
+     */
+    void PostProcessChain::recordSceneRelease(VkCommandBuffer cmdBuffer, uint64_t frame)
+    {
+        BarrierBatch barriers(cmdBuffer);
+        device->getScheduler().releaseImage(barriers, QUEUE_TYPE_GRAPHICS, QUEUE_TYPE_COMPUTE,
+                                            VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                                            getSceneColor(frame).image, VK_IMAGE_ASPECT_COLOR_BIT,
+                                            VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+                                            VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+                                            VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    }
+
+    /**
+     * @brief Records the bloom chain, tonemapping and FXAA of a frame. The passes are declared
+     *        into the render graph, which orders them, puts the barriers between them and places
+     *        the bloom levels and the tonemapped image in shared memory. The output is released
+     *        to the graphics queue at the end.
+     * @param cmdBuffer A command buffer of the compute queue.
+     * @param frame
+     * @return False if the render graph could not be compiled.
+     */
+    bool PostProcessChain::recordChain(VkCommandBuffer cmdBuffer, uint64_t frame)
+    {
+        const FrameResources &resources = frames[frame % SETTINGS_POST_PROCESS_FRAME_COUNT];
+        const QueueScheduler &scheduler = device->getScheduler();
+        uint32_t bloomWidth = std::max(width / 2, 1u);
+        uint32_t bloomHeight = std::max(height / 2, 1u);
+
+        //The scene color is acquired for sampling before the graph. The output was last read on
+        //the graphics queue, before the scene color this submission waits for was rendered.
+        //Sharing the graphics queue there is no wait, and the first write has to wait for those reads.
+        VkPipelineStageFlags outputReadStages = scheduler.isAsync(QUEUE_TYPE_COMPUTE) ?
+                                                static_cast<VkPipelineStageFlags>(VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT) :
+                                                outputConsumingStages;
+        renderGraph.reset();
+        RenderGraphResource sceneColor =
+                renderGraph.importImage("scene color", {resources.sceneColor.image, resources.sceneColor.imageView,
+                                                        POST_PROCESS_HDR_FORMAT, {width, height}, VK_IMAGE_ASPECT_COLOR_BIT},
+                                        {VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT,
+                                         VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL});
+        RenderGraphResource output =
+                renderGraph.importImage("post process output", {resources.output.image, resources.output.imageView,
+                                                                POST_PROCESS_LDR_FORMAT, {width, height}, VK_IMAGE_ASPECT_COLOR_BIT},
+                                        {outputReadStages, 0, VK_IMAGE_LAYOUT_UNDEFINED});
+        //The release below takes the output over from the FXAA writes.
+        renderGraph.setFinalState(output, {VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, VK_IMAGE_LAYOUT_GENERAL});
+
+        //The bloom levels followed by the tonemapped image.
+        std::vector<RenderGraphResource> transients;
+        for(uint32_t level = 0; level < bloomLevelCount; ++level)
+        {
+            transients.push_back(renderGraph.createImage("bloom level " + std::to_string(level), POST_PROCESS_HDR_FORMAT,
+                                                         {std::max(bloomWidth >> level, 1u), std::max(bloomHeight >> level, 1u)},
+                                                         VK_IMAGE_ASPECT_COLOR_BIT));
+        }
+        RenderGraphResource tonemapped = renderGraph.createImage("tonemapped scene", POST_PROCESS_LDR_FORMAT,
+                                                                 {width, height}, VK_IMAGE_ASPECT_COLOR_BIT);
+        transients.push_back(tonemapped);
+
+        //Every dispatch samples its source and writes its destination as a storage image.
+        bool declared = true;
+        auto addDispatch = [&](const std::string &name, VkPipeline pipeline, VkPipelineLayout layout,
+                               VkDescriptorSet descriptorSet, uint32_t sourceWidth, uint32_t sourceHeight,
+                               uint32_t destinationWidth, uint32_t destinationHeight, uint32_t prefilter,
+                               const std::vector<RenderGraphResource> &sources, RenderGraphResource destination,
+                               bool readsDestination)
+        {
+            RenderGraphPass pass = renderGraph.addPass(name, RENDER_GRAPH_PASS_COMPUTE,
+                                                       [=](VkCommandBuffer cmdBuffer)
+            {
+                recordPass(cmdBuffer, pipeline, layout, descriptorSet, sourceWidth, sourceHeight,
+                           destinationWidth, destinationHeight, prefilter);
+            });
+            for(RenderGraphResource source : sources)
+                declared = renderGraph.read(pass, source, RENDER_GRAPH_USAGE_SAMPLED) && declared;
+            if(readsDestination)
+                declared = renderGraph.read(pass, destination, RENDER_GRAPH_USAGE_STORAGE) && declared;
+            declared = renderGraph.write(pass, destination, RENDER_GRAPH_USAGE_STORAGE) && declared;
+        };
+
+        addDispatch("bloom downsample 0", downsamplePipeline, passPipelineLayout, resources.downsampleSet,
+                    width, height, bloomWidth, bloomHeight, 1, {sceneColor}, transients[0], false);
+        for(uint32_t level = 1; level < bloomLevelCount; ++level)
+        {
+            addDispatch("bloom downsample " + std::to_string(level), downsamplePipeline, passPipelineLayout,
+                        downsampleSets[level - 1],
+                        std::max(bloomWidth >> (level - 1), 1u), std::max(bloomHeight >> (level - 1), 1u),
+                        std::max(bloomWidth >> level, 1u), std::max(bloomHeight >> level, 1u), 0,
+                        {transients[level - 1]}, transients[level], false);
+        }
+        //From the smallest level up, every level adds the blurred level below it.
+        for(uint32_t level = bloomLevelCount - 1; level > 0; --level)
+        {
+            addDispatch("bloom upsample " + std::to_string(level), upsamplePipeline, passPipelineLayout,
+                        upsampleSets[level - 1],
+                        std::max(bloomWidth >> level, 1u), std::max(bloomHeight >> level, 1u),
+                        std::max(bloomWidth >> (level - 1), 1u), std::max(bloomHeight >> (level - 1), 1u), 0,
+                        {transients[level]}, transients[level - 1], true);
+        }
+        addDispatch("tonemap", tonemapPipeline, tonemapPipelineLayout, resources.tonemapSet,
+                    bloomWidth, bloomHeight, width, height, 0, {sceneColor, transients[0]}, tonemapped, false);
+        addDispatch("fxaa", fxaaPipeline, passPipelineLayout, resources.fxaaSet,
+                    width, height, width, height, 0, {tonemapped}, output, false);
+
+        if(!declared || !renderGraph.compile())
+        {
+            std::cerr << "Failed to compile the post processing graph!" << std::endl;
+            return false;
+        }
+
+        //The chain declares the same graph every frame, so the views only change when the first
+        //graph is compiled and the descriptor sets are not in use yet.
+        std::vector<VkImageView> transientViews(transients.size(), VK_NULL_HANDLE);
+        for(const RenderGraphTransientImage &image : renderGraph.getTransientImages())
+        {
+            size_t index = std::find(transients.begin(), transients.end(), image.resource) - transients.begin();
+            if(index < transientViews.size())
+                transientViews[index] = image.view;
+        }
+        if(transientViews != boundViews)
+        {
+            writeDescriptorSets(transientViews);
+            boundViews = transientViews;
+        }
+
+        {
+            BarrierBatch barriers(cmdBuffer);
+            scheduler.acquireImage(barriers, QUEUE_TYPE_GRAPHICS, QUEUE_TYPE_COMPUTE,
+                                   VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                                   resources.sceneColor.image, VK_IMAGE_ASPECT_COLOR_BIT,
+                                   VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
+                                   VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+        }
+        renderGraph.execute(cmdBuffer);
+
+        BarrierBatch barriers(cmdBuffer);
+        scheduler.releaseImage(barriers, QUEUE_TYPE_COMPUTE, QUEUE_TYPE_GRAPHICS, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                               resources.output.image, VK_IMAGE_ASPECT_COLOR_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+                               VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+        return true;
+    }
+
+    /**
+     * @brief Takes the frame's output over on the graphics queue.
+     * @param cmdBuffer A command buffer of the graphics queue, submitted behind the chain.
+     * @param frame
+     * @param consumingStages Stages that read the output, e.g. the fragment shader of a composite.
+     * @param newAccess
+     */
+    void PostProcessChain::recordOutputAcquire(VkCommandBuffer cmdBuffer, uint64_t frame,
+                                               VkPipelineStageFlags consumingStages, VkAccessFlags newAccess)
+    {
+        BarrierBatch barriers(cmdBuffer);
+        device->getScheduler().acquireImage(barriers, QUEUE_TYPE_COMPUTE, QUEUE_TYPE_GRAPHICS,
+                                            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, consumingStages,
+                                            getOutput(frame).image, VK_IMAGE_ASPECT_COLOR_BIT,
+                                            VK_ACCESS_SHADER_WRITE_BIT, newAccess, VK_IMAGE_LAYOUT_GENERAL,
+                                            VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+        outputConsumingStages = consumingStages;
+    }
+
+    /**
+     * @brief Submits the chain to the compute queue. The graphics queue runs its submissions
+     *        in order, so waiting for the scene color also covers the reads of older outputs.
+     * @param cmdBuffer
+     * @param sceneRendered Graphics point of the submission with recordSceneRelease.
+     * @param processed The point the graphics queue waits for before recordOutputAcquire.
+     * @return False if the submission failed.
+     */
+    bool PostProcessChain::submit(VkCommandBuffer cmdBuffer, const GpuSyncPoint &sceneRendered, GpuSyncPoint &processed)
+    {
+        return device->getScheduler().submit(QUEUE_TYPE_COMPUTE, {cmdBuffer}, {sceneRendered},
+                                             {VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT}, processed);
+    }
+
+    void PostProcessChain::recordPass(VkCommandBuffer cmdBuffer, VkPipeline pipeline, VkPipelineLayout layout,
+                                      VkDescriptorSet descriptorSet, uint32_t sourceWidth, uint32_t sourceHeight,
+                                      uint32_t destinationWidth, uint32_t destinationHeight, uint32_t prefilter)
+    {
+        PostProcessPushConstants pushConstants = {};
+        pushConstants.sourceTexelSize = glm::vec2(1.0f / static_cast<float>(sourceWidth),
+                                                  1.0f / static_cast<float>(sourceHeight));
+        pushConstants.exposure = exposure;
+        pushConstants.bloomThreshold = bloomThreshold;
+        pushConstants.bloomIntensity = bloomIntensity;
+        pushConstants.prefilter = prefilter;
+
+        vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+        VulkanDescriptorManager::bindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, layout,
+                                                    0, {descriptorSet}, {});
+        vkCmdPushConstants(cmdBuffer, layout, VK_SHADER_STAGE_COMPUTE_BIT, 0,
+                           sizeof(PostProcessPushConstants), &pushConstants);
+        vkCmdDispatch(cmdBuffer, postProcessGroupCount(destinationWidth), postProcessGroupCount(destinationHeight), 1);
+    }
+
+    uint32_t PostProcessChain::computeBloomLevelCount(uint32_t width, uint32_t height, uint32_t maxLevels)
+    {
+        width = std::max(width / 2, 1u);
+        height = std::max(height / 2, 1u);
+        uint32_t levels = 1;
+        while(levels < maxLevels && std::min(width, height) >= 4)
+        {
+            width /= 2;
+            height /= 2;
+            ++levels;
+        }
+        return levels;
+    }
+}
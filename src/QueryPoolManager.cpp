@@ -0,0 +1,269 @@
+#include "QueryPoolManager.h"
+
+namespace Raven
+{
+    namespace
+    {
+        //Counters in the order they are written, the order of the flag bits.
+        const VkQueryPipelineStatisticFlags STATISTIC_FLAGS = VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_VERTICES_BIT |
+                                                              VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_PRIMITIVES_BIT |
+                                                              VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT |
+                                                              VK_QUERY_PIPELINE_STATISTIC_CLIPPING_INVOCATIONS_BIT |
+                                                              VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT |
+                                                              VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT |
+                                                              VK_QUERY_PIPELINE_STATISTIC_COMPUTE_SHADER_INVOCATIONS_BIT;
+        const uint32_t STATISTIC_COUNT = 7;
+    }
+
+    QueryPoolManager::QueryPoolManager()
+    {
+
+    }
+
+    QueryPoolManager::~QueryPoolManager()
+    {
+        destroy();
+    }
+
+    /**
+     * @brief Creates the pools of every frame in the ring.
+     * @param logicalDevice
+     * @param enabledFeatures Features of the logical device.
+     * @param frameCount Has to be larger than the number of frames in flight.
+     * @param maxOcclusionQueries
+     * @param maxStatisticsQueries Ignored without pipelineStatisticsQuery.
+     * @return False if a pool could not be created.
+     */
+    bool QueryPoolManager::initialize(VkDevice logicalDevice, const VkPhysicalDeviceFeatures &enabledFeatures,
+                                      uint32_t frameCount, uint32_t maxOcclusionQueries, uint32_t maxStatisticsQueries)
+    {
+        destroy();
+        if(frameCount < 2 || maxOcclusionQueries == 0)
+        {
+            std::cerr << "Failed to initialize query pools, they need at least two frames and one query!" << std::endl;
+            return false;
+        }
+        this->logicalDevice = logicalDevice;
+        this->maxOcclusionQueries = maxOcclusionQueries;
+        statisticsSupported = enabledFeatures.pipelineStatisticsQuery == VK_TRUE && maxStatisticsQueries > 0;
+        preciseSupported = enabledFeatures.occlusionQueryPrecise == VK_TRUE;
+        this->maxStatisticsQueries = statisticsSupported ? maxStatisticsQueries : 0;
+
+        frames.resize(frameCount);
+        for(FrameQueries &frame : frames)
+        {
+            if(!createQueryPool(VK_QUERY_TYPE_OCCLUSION, maxOcclusionQueries, 0, frame.occlusionPool) ||
+               (statisticsSupported &&
+                !createQueryPool(VK_QUERY_TYPE_PIPELINE_STATISTICS, maxStatisticsQueries, STATISTIC_FLAGS,
+                                 frame.statisticsPool)))
+            {
+                destroy();
+                return false;
+            }
+            frame.occlusionObjects.reserve(maxOcclusionQueries);
+        }
+        currentFrame = frameCount;
+        return true;
+    }
+
+    void QueryPoolManager::destroy()
+    {
+        if(logicalDevice == VK_NULL_HANDLE)
+            return;
+
+        for(FrameQueries &frame : frames)
+        {
+            if(frame.occlusionPool != VK_NULL_HANDLE)
+                vkDestroyQueryPool(logicalDevice, frame.occlusionPool, nullptr);
+            if(frame.statisticsPool != VK_NULL_HANDLE)
+                vkDestroyQueryPool(logicalDevice, frame.statisticsPool, nullptr);
+        }
+        frames.clear();
+        currentFrame = 0;
+        visibilityHistory.clear();
+        visibilityKnown.clear();
+        statistics.clear();
+        unavailableResults = 0;
+        logicalDevice = VK_NULL_HANDLE;
+    }
+
+    /**
+     * @brief Moves to the next frame in the ring. The results that frame recorded the last
+     *        time around are read first, then its pools are reset for the new queries.
+     * @param cmdBuffer
+     */
+    void QueryPoolManager::beginFrame(VkCommandBuffer cmdBuffer)
+    {
+        if(frames.empty())
+            return;
+
+        currentFrame = currentFrame + 1 < frames.size() ? currentFrame + 1 : 0;
+        FrameQueries &frame = frames[currentFrame];
+        if(frame.pending)
+            readResults(frame);
+
+        vkCmdResetQueryPool(cmdBuffer, frame.occlusionPool, 0, maxOcclusionQueries);
+        if(frame.statisticsPool != VK_NULL_HANDLE)
+            vkCmdResetQueryPool(cmdBuffer, frame.statisticsPool, 0, maxStatisticsQueries);
+        frame.occlusionObjects.clear();
+        frame.statisticsCount = 0;
+        frame.pending = true;
+    }
+
+    /**
+     * @brief Begins an occlusion query for an object in the current frame.
+     * @param cmdBuffer
+     * @param objectId Index of the object, e.g. its scene node.
+     * @param precise
+     * @return The query to end, QUERY_POOL_INVALID_QUERY if the frame has run out of queries.
+     */
+    uint32_t QueryPoolManager::beginOcclusionQuery(VkCommandBuffer cmdBuffer, uint32_t objectId, bool precise)
+    {
+        if(currentFrame >= frames.size() || frames[currentFrame].occlusionObjects.size() >= maxOcclusionQueries)
+            return QUERY_POOL_INVALID_QUERY;
+
+        FrameQueries &frame = frames[currentFrame];
+        uint32_t query = static_cast<uint32_t>(frame.occlusionObjects.size());
+        frame.occlusionObjects.push_back(objectId);
+        vkCmdBeginQuery(cmdBuffer, frame.occlusionPool, query,
+                        precise && preciseSupported ? VK_QUERY_CONTROL_PRECISE_BIT : 0);
+        return query;
+    }
+
+    void QueryPoolManager::endOcclusionQuery(VkCommandBuffer cmdBuffer, uint32_t query)
+    {
+        if(query != QUERY_POOL_INVALID_QUERY)
+            vkCmdEndQuery(cmdBuffer, frames[currentFrame].occlusionPool, query);
+    }
+
+    /**
+     * @brief Begins a pipeline statistics query in the current frame.
+     * @param cmdBuffer
+     * @return The query to end, QUERY_POOL_INVALID_QUERY if statistics are not supported or
+     *         the frame has run out of queries.
+     */
+    uint32_t QueryPoolManager::beginStatisticsQuery(VkCommandBuffer cmdBuffer)
+    {
+        if(currentFrame >= frames.size() || frames[currentFrame].statisticsCount >= maxStatisticsQueries)
+            return QUERY_POOL_INVALID_QUERY;
+
+        FrameQueries &frame = frames[currentFrame];
+        uint32_t query = frame.statisticsCount++;
+        vkCmdBeginQuery(cmdBuffer, frame.statisticsPool, query, 0);
+        return query;
+    }
+
+    void QueryPoolManager::endStatisticsQuery(VkCommandBuffer cmdBuffer, uint32_t query)
+    {
+        if(query != QUERY_POOL_INVALID_QUERY)
+            vkCmdEndQuery(cmdBuffer, frames[currentFrame].statisticsPool, query);
+    }
+
+    void QueryPoolManager::recordVisibility(uint32_t objectId, bool visible)
+    {
+        if(objectId >= visibilityHistory.size())
+        {
+            visibilityHistory.resize(objectId + 1, 0);
+            visibilityKnown.resize(objectId + 1, false);
+        }
+        visibilityHistory[objectId] = (visibilityHistory[objectId] << 1) | (visible ? 1u : 0u);
+        visibilityKnown[objectId] = true;
+    }
+
+    bool QueryPoolManager::wasVisible(uint32_t objectId) const
+    {
+        return (getVisibilityHistory(objectId) & 1u) != 0;
+    }
+
+    uint32_t QueryPoolManager::getVisibilityHistory(uint32_t objectId) const
+    {
+        if(objectId >= visibilityKnown.size() || !visibilityKnown[objectId])
+            return ~0u;
+        return visibilityHistory[objectId];
+    }
+
+    bool QueryPoolManager::createQueryPool(VkQueryType type, uint32_t queryCount,
+                                           VkQueryPipelineStatisticFlags statisticFlags, VkQueryPool &queryPool)
+    {
+        VkQueryPoolCreateInfo createInfo = {};
+        createInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        createInfo.pNext = nullptr;
+        createInfo.flags = 0;
+        createInfo.queryType = type;
+        createInfo.queryCount = queryCount;
+        createInfo.pipelineStatistics = statisticFlags;
+        if(vkCreateQueryPool(logicalDevice, &createInfo, nullptr, &queryPool) != VK_SUCCESS)
+        {
+            std::cerr << "Failed to create a query pool!" << std::endl;
+            queryPool = VK_NULL_HANDLE;
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Reads a frame's results with their availability instead of waiting for them.
+     *        With enough frames in the ring everything is available, results that are not
+     *        count as visible so that the object is drawn and queried again.
+     * @param frame
+     */
+    void QueryPoolManager::readResults(FrameQueries &frame)
+    {
+        frame.pending = false;
+        const VkQueryResultFlags flags = VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT;
+
+        uint32_t occlusionCount = static_cast<uint32_t>(frame.occlusionObjects.size());
+        if(occlusionCount > 0)
+        {
+            //A sample count and the availability per query.
+            std::vector<uint64_t> results(2 * occlusionCount, 0);
+            VkResult result = vkGetQueryPoolResults(logicalDevice, frame.occlusionPool, 0, occlusionCount,
+                                                    results.size() * sizeof(uint64_t), results.data(),
+                                                    2 * sizeof(uint64_t), flags);
+            if(result != VK_SUCCESS && result != VK_NOT_READY)
+            {
+                std::cerr << "Failed to read occlusion query results!" << std::endl;
+                return;
+            }
+            for(uint32_t i = 0; i < occlusionCount; ++i)
+            {
+                bool available = results[2 * i + 1] != 0;
+                if(!available)
+                    ++unavailableResults;
+                recordVisibility(frame.occlusionObjects[i], !available || results[2 * i] != 0);
+            }
+        }
+
+        if(frame.statisticsCount > 0)
+        {
+            std::vector<uint64_t> results((STATISTIC_COUNT + 1) * frame.statisticsCount, 0);
+            VkResult result = vkGetQueryPoolResults(logicalDevice, frame.statisticsPool, 0, frame.statisticsCount,
+                                                    results.size() * sizeof(uint64_t), results.data(),
+                                                    (STATISTIC_COUNT + 1) * sizeof(uint64_t), flags);
+            if(result != VK_SUCCESS && result != VK_NOT_READY)
+            {
+                std::cerr << "Failed to read pipeline statistics query results!" << std::endl;
+                return;
+            }
+            statistics.clear();
+            for(uint32_t i = 0; i < frame.statisticsCount; ++i)
+            {
+                const uint64_t *counters = &results[(STATISTIC_COUNT + 1) * i];
+                if(counters[STATISTIC_COUNT] == 0)
+                {
+                    ++unavailableResults;
+                    continue;
+                }
+                PipelineStatistics queryStatistics;
+                queryStatistics.inputAssemblyVertices = counters[0];
+                queryStatistics.inputAssemblyPrimitives = counters[1];
+                queryStatistics.vertexShaderInvocations = counters[2];
+                queryStatistics.clippingInvocations = counters[3];
+                queryStatistics.clippingPrimitives = counters[4];
+                queryStatistics.fragmentShaderInvocations = counters[5];
+                queryStatistics.computeShaderInvocations = counters[6];
+                statistics.push_back(queryStatistics);
+            }
+        }
+    }
+}
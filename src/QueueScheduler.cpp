@@ -0,0 +1,155 @@
+#include "QueueScheduler.h"
+
+namespace Raven
+{
+    namespace
+    {
+        //Index of the first family with every flag of required and none of excluded.
+        bool findQueueFamily(const std::vector<VkQueueFamilyProperties> &families, VkQueueFlags required,
+                             VkQueueFlags excluded, uint32_t &familyIndex)
+        {
+            for(uint32_t i = 0; i < static_cast<uint32_t>(families.size()); ++i)
+            {
+                if(families[i].queueCount > 0 && (families[i].queueFlags & required) == required &&
+                   (families[i].queueFlags & excluded) == 0)
+                {
+                    familyIndex = i;
+                    return true;
+                }
+            }
+            return false;
+        }
+    }
+
+    /**
+     * @brief Picks the queue family every type of work is submitted to.
+     * @param families The queue families of the physical device.
+     * @param familyIndices Family of every QueueType.
+     * @return False if there is no family with both graphics and compute.
+     */
+    bool QueueScheduler::selectQueueFamilies(const std::vector<VkQueueFamilyProperties> &families,
+                                             std::array<uint32_t, QUEUE_TYPE_COUNT> &familyIndices)
+    {
+        uint32_t &graphics = familyIndices[QUEUE_TYPE_GRAPHICS];
+        uint32_t &compute = familyIndices[QUEUE_TYPE_COMPUTE];
+        uint32_t &transfer = familyIndices[QUEUE_TYPE_TRANSFER];
+        if(!findQueueFamily(families, VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT, 0, graphics))
+        {
+            std::cerr << "Failed to find a queue family with graphics and compute!" << std::endl;
+            return false;
+        }
+        if(!findQueueFamily(families, VK_QUEUE_COMPUTE_BIT, VK_QUEUE_GRAPHICS_BIT, compute))
+            compute = graphics;
+        //Transfers only families may limit the granularity of image copies, so they are best
+        //used for buffers and whole images.
+        if(!findQueueFamily(families, VK_QUEUE_TRANSFER_BIT, VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT, transfer))
+            transfer = compute;
+        return true;
+    }
+
+    void QueueScheduler::initialize(GpuTimeline *timeline, const std::array<QueueRoute, QUEUE_TYPE_COUNT> &routes)
+    {
+        this->timeline = timeline;
+        this->routes = routes;
+    }
+
+    /**
+     * @brief Submits command buffers to the queue of a type of work.
+     * @param type
+     * @param cmdBuffers
+     * @param waits Points on the timeline, usually from submissions to the queues of other types.
+     * @param waitStages Stages that wait for each point.
+     * @param signaled The point the submission reaches.
+     * @return False if the submission failed.
+     */
+    bool QueueScheduler::submit(QueueType type, const std::vector<VkCommandBuffer> &cmdBuffers,
+                                const std::vector<GpuSyncPoint> &waits,
+                                const std::vector<VkPipelineStageFlags> &waitStages, GpuSyncPoint &signaled)
+    {
+        const QueueRoute &route = routes[type];
+        return timeline->submit(route.queue, *route.submitter, cmdBuffers, waits, waitStages, signaled);
+    }
+
+    /**
+     * @brief Releases a buffer from the family of from to the one of to.
+     * @param barriers A batch on a command buffer of from's queue.
+     * @param from
+     * @param to
+     * @param generatingStages Stages of the last use on from's queue.
+     * @param buffer
+     * @param currentAccess Access of the last use on from's queue.
+     */
+    void QueueScheduler::releaseBuffer(BarrierBatch &barriers, QueueType from, QueueType to,
+                                       VkPipelineStageFlags generatingStages, VkBuffer buffer,
+                                       VkAccessFlags currentAccess) const
+    {
+        if(!needsOwnershipTransfer(from, to))
+            return;
+        barriers.addBuffer(generatingStages, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                           {buffer, currentAccess, 0, routes[from].family, routes[to].family});
+    }
+
+    void QueueScheduler::releaseImage(BarrierBatch &barriers, QueueType from, QueueType to,
+                                      VkPipelineStageFlags generatingStages, VkImage image,
+                                      VkImageAspectFlags aspect, VkAccessFlags currentAccess,
+                                      VkImageLayout currentLayout, VkImageLayout newLayout) const
+    {
+        if(!needsOwnershipTransfer(from, to))
+            return;
+        barriers.addImage(generatingStages, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                          {image, currentAccess, 0, currentLayout, newLayout,
+                           routes[from].family, routes[to].family, aspect});
+    }
+
+    /**
+     * @brief Acquires a buffer released by releaseBuffer. Within a family a plain barrier behind
+     *        the stages of the last use is recorded instead, the timeline skips waits between
+     *        submissions to the same queue.
+     * @param barriers A batch on a command buffer of to's queue.
+     * @param from
+     * @param to
+     * @param generatingStages Stages of the last use on from's queue.
+     * @param consumingStages Stages of the first use on to's queue.
+     * @param buffer
+     * @param currentAccess Access of the last use on from's queue.
+     * @param newAccess Access of the first use on to's queue.
+     */
+    void QueueScheduler::acquireBuffer(BarrierBatch &barriers, QueueType from, QueueType to,
+                                       VkPipelineStageFlags generatingStages, VkPipelineStageFlags consumingStages,
+                                       VkBuffer buffer, VkAccessFlags currentAccess, VkAccessFlags newAccess) const
+    {
+        if(needsOwnershipTransfer(from, to))
+        {
+            barriers.addBuffer(VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, consumingStages,
+                               {buffer, 0, newAccess, routes[from].family, routes[to].family});
+        }
+        else
+        {
+            barriers.addBuffer(generatingStages, consumingStages,
+                               {buffer, currentAccess, newAccess, VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED});
+        }
+    }
+
+    /**
+     * @brief Acquires an image released by releaseImage. Within a family the layout transition
+     *        is recorded here, behind the stages of the last use.
+     */
+    void QueueScheduler::acquireImage(BarrierBatch &barriers, QueueType from, QueueType to,
+                                      VkPipelineStageFlags generatingStages, VkPipelineStageFlags consumingStages,
+                                      VkImage image, VkImageAspectFlags aspect, VkAccessFlags currentAccess,
+                                      VkAccessFlags newAccess, VkImageLayout currentLayout, VkImageLayout newLayout) const
+    {
+        if(needsOwnershipTransfer(from, to))
+        {
+            barriers.addImage(VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, consumingStages,
+                              {image, 0, newAccess, currentLayout, newLayout,
+                               routes[from].family, routes[to].family, aspect});
+        }
+        else
+        {
+            barriers.addImage(generatingStages, consumingStages,
+                              {image, currentAccess, newAccess, currentLayout, newLayout,
+                               VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, aspect});
+        }
+    }
+}
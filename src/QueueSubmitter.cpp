@@ -0,0 +1,108 @@
+#include "QueueSubmitter.h"
+
+namespace Raven
+{
+    QueueSubmitter::QueueSubmitter()
+    {
+
+    }
+
+    QueueSubmitter::~QueueSubmitter()
+    {
+
+    }
+
+    void QueueSubmitter::initialize(VkQueue queue)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        this->queue = queue;
+        pendingCount = 0;
+    }
+
+    /**
+     * @brief Queues a submission for the next flush.
+     * @param cmdBuffers
+     * @param waits Semaphores the command buffers wait on and the stages that wait.
+     * @param signals Semaphores signaled once the command buffers have finished.
+     */
+    void QueueSubmitter::enqueue(const std::vector<VkCommandBuffer> &cmdBuffers,
+                                 const std::vector<WaitSemaphoreInfo> &waits,
+                                 const std::vector<VkSemaphore> &signals)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if(pendingCount == pending.size())
+            pending.emplace_back();
+        PendingSubmit &submit = pending[pendingCount++];
+        submit.cmdBuffers.assign(cmdBuffers.begin(), cmdBuffers.end());
+        submit.waitSemaphores.clear();
+        submit.waitStages.clear();
+        for(const WaitSemaphoreInfo &wait : waits)
+        {
+            submit.waitSemaphores.push_back(wait.semaphore);
+            submit.waitStages.push_back(wait.waitingStage);
+        }
+        submit.signalSemaphores.assign(signals.begin(), signals.end());
+    }
+
+    /**
+     * @brief Submits the queued work with a single vkQueueSubmit.
+     * @param fence Signaled once the work has finished, can be VK_NULL_HANDLE.
+     * @return False if the submission failed. The queued work is dropped either way.
+     */
+    bool QueueSubmitter::flush(VkFence fence)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if(pendingCount == 0 && fence == VK_NULL_HANDLE)
+            return true;
+        return submitPending(nullptr, fence);
+    }
+
+    /**
+     * @brief Submits the queued work followed by the submit info with a single vkQueueSubmit.
+     * @param submitInfo
+     * @param fence Signaled once all of the work has finished, can be VK_NULL_HANDLE.
+     * @return False if the submission failed.
+     */
+    bool QueueSubmitter::submit(const VkSubmitInfo &submitInfo, VkFence fence)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return submitPending(&submitInfo, fence);
+    }
+
+    size_t QueueSubmitter::getPendingSubmitCount()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return pendingCount;
+    }
+
+    bool QueueSubmitter::submitPending(const VkSubmitInfo *submitInfo, VkFence fence)
+    {
+        submitInfos.clear();
+        for(size_t i = 0; i < pendingCount; ++i)
+        {
+            const PendingSubmit &submit = pending[i];
+            VkSubmitInfo info = {};
+            info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+            info.pNext = nullptr;
+            info.commandBufferCount = static_cast<uint32_t>(submit.cmdBuffers.size());
+            info.pCommandBuffers = submit.cmdBuffers.data();
+            info.waitSemaphoreCount = static_cast<uint32_t>(submit.waitSemaphores.size());
+            info.pWaitSemaphores = submit.waitSemaphores.data();
+            info.pWaitDstStageMask = submit.waitStages.data();
+            info.signalSemaphoreCount = static_cast<uint32_t>(submit.signalSemaphores.size());
+            info.pSignalSemaphores = submit.signalSemaphores.data();
+            submitInfos.push_back(info);
+        }
+        if(submitInfo != nullptr)
+            submitInfos.push_back(*submitInfo);
+        pendingCount = 0;
+
+        VkResult result = vkQueueSubmit(queue, static_cast<uint32_t>(submitInfos.size()), submitInfos.data(), fence);
+        if(result != VK_SUCCESS)
+        {
+            std::cerr << "Failed to submit command buffers to a queue!" << std::endl;
+            return false;
+        }
+        return true;
+    }
+}
@@ -4,6 +4,7 @@
 #include "Settings.h"
 #include "CommandBufferManager.h"
 #include "VulkanDescriptorManager.h"
+#include "FileIO.h"
 
 namespace Raven
 {
@@ -22,6 +23,31 @@ namespace Raven
         VK_KHR_SWAPCHAIN_EXTENSION_NAME
     };
 
+    //Extensions that are enabled only when the implementation supports them.
+    //Features built on top of these check for them at runtime.
+    struct OptionalExtension
+    {
+        const char *name;
+        //Instance extension the device extension depends on, nullptr if none.
+        const char *requiredInstanceExtension;
+    };
+
+    std::vector<const char*> optionalInstanceExtensions =
+    {
+        //Extended physical device queries, needed by several device extensions.
+        VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME
+    };
+
+    std::vector<OptionalExtension> optionalDeviceExtensions =
+    {
+        //Memory heap budgets for texture streaming.
+        {VK_EXT_MEMORY_BUDGET_EXTENSION_NAME, VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME},
+        //Draw counts written by the gpu culling pass.
+        {VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME, nullptr},
+        //Per queue timelines the cpu and other queues wait on.
+        {VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME, VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME}
+    };
+
     RavenEngine::RavenEngine()
     {
         selectedInstance = VK_NULL_HANDLE;
@@ -48,6 +74,16 @@ namespace Raven
         {
             //Wait until the device/devices are idle before proceeding to deletion.
             waitUntilDeviceIdle(vulkanDevice->getLogicalDevice());
+            //Streamed textures, the instance buffers and the culling buffers are owned by the device.
+            textureStreamer.destroy();
+            gpuCuller.destroy();
+            depthPyramid.destroy();
+            postProcessChain.destroy();
+            uniformRing.destroy();
+            queryPoolManager.destroy();
+            resourceRegistry.destroy();
+            instanceBatcher.destroy();
+            scene.destroy();
             //vulkanDevice.reset();
             delete vulkanDevice;
         }
@@ -62,6 +98,9 @@ namespace Raven
         //Lastly free the dynamically loaded vulkan library
         if(libraryInitialized)
             freeVulkanLibrary(vulkanLibrary);
+
+        //Stop FileIO from reading the pack before it gets unmapped.
+        FileIO::mountArchive(nullptr);
     }
 
     /**
@@ -77,17 +116,37 @@ namespace Raven
             return false;
         }
 
+        //Mount the asset pack if one has been built. Without it assets are read as loose files.
+        if(assetArchive.open(SETTINGS_ASSET_ARCHIVE_PATH))
+            FileIO::mountArchive(&assetArchive);
+
+        assetDirectory = FileIO::getAssetDirectory();
+        if(assetDirectory != SETTINGS_COOKED_ASSET_DIRECTORY)
+            std::cout << "No cooked assets found, loading the source resources." << std::endl;
+
         //First initialize vulkan if it has not been initialized yet.
         if(!initializeVulkan())
             return false;
 
+        //Enable the optional instance extensions that are available.
+        enabledInstanceExtensions = desiredInstanceExtensions;
+        std::vector<VkExtensionProperties> availableInstanceExtensions;
+        if(checkAvailableInstanceExtensions(availableInstanceExtensions))
+        {
+            for(auto &extension : optionalInstanceExtensions)
+            {
+                if(isExtensionSupported(availableInstanceExtensions, extension))
+                    enabledInstanceExtensions.push_back(extension);
+            }
+        }
+
         //After vulkan dynamic library, exported- and global-level functions have been loaded,
         //create a new vulkan instance.
-        if(!createVulkanInstance(desiredInstanceExtensions, appName, selectedInstance))
+        if(!createVulkanInstance(enabledInstanceExtensions, appName, selectedInstance))
             return false;
 
         //After instance has been created, load instance level funcions
-        if(!loadInstanceLevelVulkanFunctions(selectedInstance, desiredInstanceExtensions))
+        if(!loadInstanceLevelVulkanFunctions(selectedInstance, enabledInstanceExtensions))
             return false;
 
         //Next it is time to choose which Vulkan device (usually a gpu) we are going to use.
@@ -109,6 +168,89 @@ namespace Raven
         if(!createVulkanDevice(selectedPhysicalDevice, desiredDeviceExtensions))
             return false;
 
+        //Texture streaming uploads go through the primary queue.
+        if(!textureStreamer.initialize(selectedPhysicalDevice, vulkanDevice->getLogicalDevice(),
+                                       vulkanDevice->getPrimaryQueueFamilyIndex(),
+                                       &vulkanDevice->getQueueSubmitter(0), &vulkanDevice->getSyncObjectPool(),
+                                       &vulkanDevice->getTimeline(),
+                                       vulkanDevice->getScheduler().getRoute(QUEUE_TYPE_GRAPHICS).queue, 0,
+                                       vulkanDevice->isExtensionEnabled(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME)))
+        {
+            return false;
+        }
+
+        //Scene nodes write their world matrices straight into a host visible instance buffer,
+        //instanced draws get them copied into contiguous ranges per mesh and material.
+        VkPhysicalDeviceMemoryProperties memoryProperties;
+        vkGetPhysicalDeviceMemoryProperties(selectedPhysicalDevice, &memoryProperties);
+        if(!threadPool.initialize() ||
+           !scene.createInstanceBuffer(vulkanDevice->getLogicalDevice(), memoryProperties,
+                                       SETTINGS_SCENE_MAX_NODES) ||
+           !instanceBatcher.createInstanceBuffer(vulkanDevice->getLogicalDevice(), memoryProperties,
+                                                 SETTINGS_INSTANCE_BATCH_MAX_INSTANCES))
+        {
+            return false;
+        }
+
+        //Draws are culled on the gpu against the world matrices in the instance buffer. Devices
+        //without drawIndirectFirstInstance, or a missing shader, leave gpu culling disabled.
+        if(gpuCuller.initialize(vulkanDevice->getLogicalDevice(), memoryProperties,
+                                vulkanDevice->getEnabledFeatures(),
+                                vulkanDevice->isExtensionEnabled(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME),
+                                assetDirectory + "Shaders/culling/culling-comp.spv",
+                                SETTINGS_GPU_CULL_MAX_DRAWS))
+        {
+            gpuCuller.setInstanceBuffer(scene.getInstanceBuffer().buffer);
+        }
+        else
+        {
+            std::cout << "Gpu culling is not available, continuing without it." << std::endl;
+        }
+
+        //Occlusion culling tests the draws against a depth pyramid of the window sized depth image.
+        //Without it the culler keeps testing the frustum only.
+        if(gpuCuller.isInitialized() &&
+           (!depthPyramid.initialize(vulkanDevice->getLogicalDevice(), memoryProperties, windowWidth, windowHeight,
+                                     assetDirectory + "Shaders/depthpyramid/depthpyramid-comp.spv") ||
+            !gpuCuller.enableOcclusion(memoryProperties, depthPyramid,
+                                       assetDirectory + "Shaders/occlusionculling/occlusionculling-comp.spv")))
+        {
+            std::cout << "Occlusion culling is not available, continuing without it." << std::endl;
+            depthPyramid.destroy();
+        }
+
+        //The scene is rendered into the chain's color images and post processed on the
+        //compute queue while the next frame renders. Frames are not routed through the
+        //chain yet, so a device or build without it still starts.
+        if(!postProcessChain.initialize(vulkanDevice, windowWidth, windowHeight,
+                                        assetDirectory + "Shaders/postprocess/"))
+        {
+            std::cout << "Post processing is not available, continuing without it." << std::endl;
+        }
+
+        //Occlusion and pipeline statistics queries, read back a few frames later.
+        if(!queryPoolManager.initialize(vulkanDevice->getLogicalDevice(), vulkanDevice->getEnabledFeatures(),
+                                        SETTINGS_QUERY_POOL_FRAME_COUNT, SETTINGS_QUERY_POOL_MAX_OCCLUSION_QUERIES,
+                                        SETTINGS_QUERY_POOL_MAX_STATISTICS_QUERIES))
+        {
+            return false;
+        }
+
+        //Resources referred to by handles, destroyed once the frames using them are done.
+        resourceRegistry.initialize(vulkanDevice->getLogicalDevice());
+
+        //Per-draw uniforms are written straight into mapped memory. The ring also holds the
+        //draw parameters on devices whose push constants are too small for them.
+        const VkPhysicalDeviceLimits &limits = vulkanDevice->getPhysicalDeviceProperties().limits;
+        if(!uniformRing.initialize(vulkanDevice->getLogicalDevice(), memoryProperties, limits,
+                                   SETTINGS_UNIFORM_RING_FRAME_SIZE, SETTINGS_UNIFORM_RING_FRAME_COUNT,
+                                   std::max(sizeof(DiffuseUniforms), sizeof(DrawParameters))) ||
+           !drawParameterBinding.initialize(limits, VK_SHADER_STAGE_VERTEX_BIT, sizeof(DrawParameters),
+                                            &uniformRing))
+        {
+            return false;
+        }
+
         //After the vulkan device has been created we need to create a window
         //for the application. This window will display our rendering content.
         //A new window will also initialize a new swapchain for the window.
@@ -125,6 +267,7 @@ namespace Raven
 		VkRenderPass renderPass;
 		if (!vulkanRenderer->buildGeometryAndPostProcessingRenderPass(vulkanDevice->getLogicalDevice(), renderPass))
 			return false;
+
         //Start rendering. At this point the window is empty.
         vulkanRenderer->render(appWindow);
 
@@ -137,33 +280,35 @@ namespace Raven
      */
     bool RavenEngine::render()
     {
+        //Swap in finished texture uploads and stream the mips requested for this frame.
+        if(!textureStreamer.update())
+            return false;
 
-        //This is just a test case for submitting commands to device queues.
-        //This function does nothing of value other than works as an example for now.
-        VkFence submitFence;
-        createFence(vulkanDevice->getLogicalDevice(), VK_FALSE, submitFence);
-        VkSemaphore signaledSemaphore;
-        createSemaphore(vulkanDevice->getLogicalDevice(), signaledSemaphore);
-
-        VkSubmitInfo submitInfo = VulkanStructures::submitInfo(drawBuffers, {},{},{signaledSemaphore});
+        //Recompute the world matrices of the nodes that moved.
+        scene.update(&threadPool);
 
-        //Submit commands to the vulkan device for execution:
-        if(!vulkanDevice->executeCommands(submitInfo, submitFence))
-            return false;
+        //Draws of this frame write their uniforms into the frame's region of the ring.
+        uniformRing.beginFrame(resourceRegistry.getCurrentFrame());
 
-        //Wait for the fence to be signaled and delete the synchronization objects.
-        //Note that in a normal case the application shouldn't stop to wait for the fence
-        //to be signaled but should instead do other tasks and check the fence status
-        //every now and then and when the fence is signaled, then continue with the task.
-        if(!waitForFences(vulkanDevice->getLogicalDevice(), 100000000, VK_TRUE, {submitFence}))
+        //This is just a test case for submitting commands to device queues.
+        //This function does nothing of value other than works as an example for now.
+        //The submission signals the next value of the queue's timeline, so no synchronization
+        //objects are created per frame.
+        GpuTimeline &timeline = vulkanDevice->getTimeline();
+        GpuSyncPoint frameDone;
+        if(!uniformRing.flush() ||
+           !vulkanDevice->getScheduler().submit(QUEUE_TYPE_GRAPHICS, drawBuffers, {}, {}, frameDone))
             return false;
 
-        //Check the fence status:
-        if(!isFenceSignaled(vulkanDevice->getLogicalDevice(), submitFence))
+        //Note that in a normal case the application shouldn't stop to wait for the frame
+        //but should instead do other tasks and check isComplete every now and then.
+        if(!timeline.wait(frameDone, 100000000))
             return false;
 
-        destroyFence(vulkanDevice->getLogicalDevice(), submitFence);
-        destroySemaphore(vulkanDevice->getLogicalDevice(), signaledSemaphore);
+        //The frame is done on the gpu, so what it released can be destroyed or reused.
+        uint64_t completedFrame = resourceRegistry.endFrame();
+        resourceRegistry.collect(completedFrame);
+        vulkanDevice->getSyncObjectPool().collect(completedFrame);
 
         //Destroying the command pool will destroy all the command buffers allocated from it.
         CommandBufferManager::destroyCommandPool(vulkanDevice->getLogicalDevice(), cmdPool);
@@ -233,7 +378,27 @@ namespace Raven
     bool RavenEngine::createVulkanDevice(VkPhysicalDevice &physicalDevice,
                                          std::vector<const char*>  &desiredExtensions)
     {
-        if(!vulkanDevice->initializeDevice(physicalDevice, desiredExtensions))
+        //Add the optional extensions the device and the instance support.
+        std::vector<const char*> enabledDeviceExtensions = desiredExtensions;
+        std::vector<VkExtensionProperties> availableDeviceExtensions;
+        if(checkAvailableDeviceExtensions(physicalDevice, availableDeviceExtensions))
+        {
+            for(auto &extension : optionalDeviceExtensions)
+            {
+                bool instanceRequirementMet = extension.requiredInstanceExtension == nullptr;
+                for(auto &instanceExtension : enabledInstanceExtensions)
+                {
+                    if(!instanceRequirementMet &&
+                       std::strcmp(instanceExtension, extension.requiredInstanceExtension) == 0)
+                        instanceRequirementMet = true;
+                }
+
+                if(instanceRequirementMet && isExtensionSupported(availableDeviceExtensions, extension.name))
+                    enabledDeviceExtensions.push_back(extension.name);
+            }
+        }
+
+        if(!vulkanDevice->initializeDevice(physicalDevice, enabledDeviceExtensions))
             return false;
         return true;
     }
@@ -279,11 +444,19 @@ namespace Raven
 
     /**
      * @brief Creates objects required by shaders to draw geometry.
-     * @return False if vertex buffers could not be created.
+     * @param graphicsObject
+     * @param vertexBufferObject
+     * @param vertexMemory
+     * @param indexBufferObject Receives the mesh's 32-bit indices. Left untouched if the mesh has none.
+     * @param indexMemory
+     * @param cmdBuffer
+     * @return False if vertex or index buffers could not be created.
      */
     bool RavenEngine::buildVertexDataForShaders(GraphicsObject &graphicsObject,
                                            VulkanBuffer &vertexBufferObject,
                                            VkDeviceMemory &vertexMemory,
+                                           VulkanBuffer &indexBufferObject,
+                                           VkDeviceMemory &indexMemory,
                                            VkCommandBuffer &cmdBuffer)
     {
         /** This function describes parts of the process of creating a vertex buffer.
@@ -328,8 +501,41 @@ namespace Raven
         if(!updateDeviceLocalMemoryBuffer(vulkanDevice->getLogicalDevice(), &graphicsObject.getMesh()->data[0],
                                           vertexBufferObject.size, memoryProperties, vertexBufferObject.buffer,
                                           0, 0, VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
-                                          VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, vulkanDevice->getQueueHandles()[0],
-                                          cmdBuffer, {}))
+                                          VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, vulkanDevice->getQueueSubmitter(0),
+                                          cmdBuffer, vulkanDevice->getSyncObjectPool(), {}))
+        {
+            return false;
+        }
+
+        //Indexed meshes get their index buffer the same way.
+        std::vector<uint32_t> &indices = graphicsObject.getMesh()->indices;
+        if(indices.empty())
+            return true;
+
+        indexBufferObject.size = sizeof(indices[0]) * indices.size();
+        VkBufferCreateInfo indexBufferInfo =
+            VulkanStructures::bufferCreateInfo(indexBufferObject.size,
+                                               VK_BUFFER_USAGE_TRANSFER_DST_BIT |
+                                               VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+                                               VK_SHARING_MODE_EXCLUSIVE);
+        if(!createBuffer(vulkanDevice->getLogicalDevice(), indexBufferInfo, indexBufferObject.buffer))
+            return false;
+
+        vkGetBufferMemoryRequirements(vulkanDevice->getLogicalDevice(), indexBufferObject.buffer, &memReq);
+        if(!allocateMemory(vulkanDevice->getLogicalDevice(), memoryProperties, memReq,
+                           VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, indexMemory))
+        {
+            return false;
+        }
+
+        if(!indexBufferObject.bindMemoryObject(vulkanDevice->getLogicalDevice(), indexMemory))
+            return false;
+
+        if(!updateDeviceLocalMemoryBuffer(vulkanDevice->getLogicalDevice(), &indices[0],
+                                          indexBufferObject.size, memoryProperties, indexBufferObject.buffer,
+                                          0, 0, VK_ACCESS_INDEX_READ_BIT, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                                          VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, vulkanDevice->getQueueSubmitter(0),
+                                          cmdBuffer, vulkanDevice->getSyncObjectPool(), {}))
         {
             return false;
         }
@@ -377,27 +583,35 @@ namespace Raven
      * @brief Describes the data that is sent to the shaders.
      * @param descriptorSetLayout
      * @param descriptorPool
+     * @param uniforms The ring the draws write their uniform blocks into.
+     * @param drawParameters Adds a second dynamic binding when the draw parameters are not pushed.
      * @param descriptorSets
      * @return
      */
     bool RavenEngine::buildDescriptors(VkDescriptorSetLayout &descriptorSetLayout,
                                        VkDescriptorPool &descriptorPool,
-                                       VkBuffer &uniformBuffer,
+                                       const UniformRing &uniforms,
+                                       const DrawParameterBinding &drawParameters,
                                        std::vector<VkDescriptorSet> &descriptorSets)
     {
         //Create descriptor info so that the uniform buffer can be accessed inside the vertex shader.
+        //The set is bound with the draw's offset into the ring as its dynamic offset.
         VkDescriptorSetLayoutBinding descriptorSetLayoutBinding =
         {
             0,
-            VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+            VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
             1,
             VK_SHADER_STAGE_VERTEX_BIT,
             nullptr
         };
+        std::vector<VkDescriptorSetLayoutBinding> descriptorSetLayoutBindings = {descriptorSetLayoutBinding};
+        std::vector<VkDescriptorSetLayoutBinding> drawParameterBindings = drawParameters.getDescriptorSetLayoutBindings(1);
+        descriptorSetLayoutBindings.insert(descriptorSetLayoutBindings.end(), drawParameterBindings.begin(),
+                                           drawParameterBindings.end());
 
         //Create the descriptor set layout.
         if(!VulkanDescriptorManager::createDescriptorSetLayout(vulkanDevice->getLogicalDevice(),
-                                                               {descriptorSetLayoutBinding},
+                                                               descriptorSetLayoutBindings,
                                                                descriptorSetLayout))
         {
             return false;
@@ -406,8 +620,8 @@ namespace Raven
         //Next create the descriptor pool
         VkDescriptorPoolSize descriptorPoolSize =
         {
-            VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-            1
+            VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+            static_cast<uint32_t>(descriptorSetLayoutBindings.size())
         };
 
         if(!VulkanDescriptorManager::createDescriptorPool(vulkanDevice->getLogicalDevice(), VK_FALSE, 1,
@@ -423,23 +637,11 @@ namespace Raven
             return false;
         }
 
-        BufferDescriptorInfo bufferDescriptorUpdate =
-        {
-            descriptorSets[0],
-            0,
-            0,
-            VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-            {
-                {
-                    uniformBuffer,
-                    0,
-                    VK_WHOLE_SIZE
-                }
-            }
-        };
+        std::vector<BufferDescriptorInfo> bufferDescriptorUpdates = drawParameters.getDescriptorInfos(descriptorSets[0], 1);
+        bufferDescriptorUpdates.insert(bufferDescriptorUpdates.begin(), uniforms.getDescriptorInfo(descriptorSets[0], 0));
 
         VulkanDescriptorManager::updateDescriptorSets(vulkanDevice->getLogicalDevice(),{},
-                                                      {bufferDescriptorUpdate},{},{});
+                                                      bufferDescriptorUpdates,{},{});
 
         return true;
     }
@@ -504,26 +706,32 @@ namespace Raven
           }
         };
 
-        //Then the subpass dependencies.
+        //Then the subpass dependencies. The attachments are only written once the previous frame
+        //has finished with them, and presentation waits on a semaphore after the render pass,
+        //so nothing has to wait at the top of the pipe.
         std::vector<VkSubpassDependency> subpassDependencies =
         {
             {
-                VK_SUBPASS_EXTERNAL,                            //Source subpass.
-                0,                                              //Destination subpass.
-                VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,              //Source stage mask.
-                VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,  //Destination stage mask.
-                VK_ACCESS_MEMORY_READ_BIT,                      //Source access mask.
-                VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,           //Destination access mask.
-                VK_DEPENDENCY_BY_REGION_BIT                     //Dependency flags.
+                VK_SUBPASS_EXTERNAL,                                //Source subpass.
+                0,                                                  //Destination subpass.
+                VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT |
+                VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,          //Source stage mask.
+                VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT |
+                VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT,         //Destination stage mask.
+                VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,       //Source access mask.
+                VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+                VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT |
+                VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,       //Destination access mask.
+                0                                                   //Dependency flags.
             },
             {
                 0,
                 VK_SUBPASS_EXTERNAL,
                 VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-                VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
                 VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
-                VK_ACCESS_MEMORY_READ_BIT,
-                VK_DEPENDENCY_BY_REGION_BIT
+                0,
+                0
             }
         };
 
@@ -543,12 +751,13 @@ namespace Raven
 
     bool RavenEngine::buildGraphicsPipeline(VulkanPipeline &basicGraphicsPipeline,
                                             VkDescriptorSetLayout &descriptorSetLayout,
+                                            const DrawParameterBinding &drawParameters,
                                             VkRenderPass &renderPass,
                                             VkPipeline& graphicsPipeline)
     {
         VkPipelineLayout pipelineLayout;
         if(!createPipelineLayout(vulkanDevice->getLogicalDevice(),
-                                 {descriptorSetLayout}, {}, pipelineLayout))
+                                 {descriptorSetLayout}, drawParameters.getPushConstantRanges(), pipelineLayout))
         {
             return false;
         }
@@ -559,6 +768,12 @@ namespace Raven
                 0,                              //Binding.
                 6 * sizeof(float),              //Stride.
                 VK_VERTEX_INPUT_RATE_VERTEX     //Input rate.
+            },
+            {
+                //World matrix of every instance, from the InstanceBatcher or the scene.
+                1,
+                sizeof(glm::mat4),
+                VK_VERTEX_INPUT_RATE_INSTANCE
             }
         };
 
@@ -575,7 +790,12 @@ namespace Raven
                 0,
                 VK_FORMAT_R32G32B32_SFLOAT,
                 3 * sizeof(float)
-            }
+            },
+            //A matrix attribute takes a location per column.
+            {2, 1, VK_FORMAT_R32G32B32A32_SFLOAT, 0},
+            {3, 1, VK_FORMAT_R32G32B32A32_SFLOAT, 4 * sizeof(float)},
+            {4, 1, VK_FORMAT_R32G32B32A32_SFLOAT, 8 * sizeof(float)},
+            {5, 1, VK_FORMAT_R32G32B32A32_SFLOAT, 12 * sizeof(float)}
         };
 
         std::vector<VkPipelineColorBlendAttachmentState> attachmentBlendStates =
@@ -601,10 +821,14 @@ namespace Raven
         if(!createPipelineCache(vulkanDevice->getLogicalDevice(), {}, pipelineCache))
             return false;
 
+        //The fallback shader reads the draw parameters from the ring instead of push constants.
+        std::string vertexShader = assetDirectory + (drawParameters.usesPushConstants() ?
+                                                     "Shaders/diffuse/diffuse-vert.spv" :
+                                                     "Shaders/diffuse/diffusefallback-vert.spv");
         std::vector<VkPipeline> pipelines = {graphicsPipeline};
         if(!basicGraphicsPipeline.initialize(vulkanDevice->getLogicalDevice(),
-                                             0, "../Resources/Shaders/diffuse/diffuse-vert.spv",
-                                             "../Resources/Shaders/diffuse/diffuse-frag.spv",
+                                             0, vertexShader,
+                                             assetDirectory + "Shaders/diffuse/diffuse-frag.spv",
                                              vertexInputBindingDescriptions,
                                              vertexAttributeDescriptions,
                                              VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, VK_FALSE,
@@ -0,0 +1,1357 @@
+#include "RenderGraph.h"
+#include "VulkanUtility.h"
+#include "VulkanStructures.h"
+#include <algorithm>
+#include <numeric>
+
+namespace Raven
+{
+    namespace
+    {
+        const VkAccessFlags WRITE_ACCESS = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+                                           VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT |
+                                           VK_ACCESS_HOST_WRITE_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+
+        struct UsageInfo
+        {
+            VkPipelineStageFlags stages;
+            VkAccessFlags access;
+            //VK_IMAGE_LAYOUT_UNDEFINED for uses that only apply to buffers.
+            VkImageLayout layout;
+        };
+
+        bool isAttachmentUsage(RenderGraphUsage usage)
+        {
+            return usage == RENDER_GRAPH_USAGE_COLOR_ATTACHMENT || usage == RENDER_GRAPH_USAGE_DEPTH_ATTACHMENT ||
+                   usage == RENDER_GRAPH_USAGE_INPUT_ATTACHMENT;
+        }
+
+        bool isWritableUsage(RenderGraphUsage usage)
+        {
+            return usage == RENDER_GRAPH_USAGE_COLOR_ATTACHMENT || usage == RENDER_GRAPH_USAGE_DEPTH_ATTACHMENT ||
+                   usage == RENDER_GRAPH_USAGE_STORAGE || usage == RENDER_GRAPH_USAGE_TRANSFER_DST;
+        }
+
+        bool isBufferOnlyUsage(RenderGraphUsage usage)
+        {
+            return usage == RENDER_GRAPH_USAGE_UNIFORM || usage == RENDER_GRAPH_USAGE_VERTEX ||
+                   usage == RENDER_GRAPH_USAGE_INDIRECT;
+        }
+
+        VkImageUsageFlags getImageUsage(RenderGraphUsage usage)
+        {
+            switch(usage)
+            {
+                case RENDER_GRAPH_USAGE_COLOR_ATTACHMENT:
+                    return VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+                case RENDER_GRAPH_USAGE_DEPTH_ATTACHMENT:
+                    return VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+                case RENDER_GRAPH_USAGE_INPUT_ATTACHMENT:
+                    return VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT;
+                case RENDER_GRAPH_USAGE_SAMPLED:
+                    return VK_IMAGE_USAGE_SAMPLED_BIT;
+                case RENDER_GRAPH_USAGE_STORAGE:
+                    return VK_IMAGE_USAGE_STORAGE_BIT;
+                case RENDER_GRAPH_USAGE_TRANSFER_SRC:
+                    return VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+                case RENDER_GRAPH_USAGE_TRANSFER_DST:
+                    return VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+                default:
+                    return 0;
+            }
+        }
+
+        //Like getMemoryType, but a missing type is not an error since there is a fallback.
+        bool findTransientMemoryType(const VkPhysicalDeviceMemoryProperties &memoryProperties, uint32_t typeBits,
+                                     VkMemoryPropertyFlags requiredProperties, uint32_t &memoryTypeIndex)
+        {
+            for(uint32_t type = 0; type < memoryProperties.memoryTypeCount; ++type)
+            {
+                if((typeBits & (1u << type)) &&
+                   (memoryProperties.memoryTypes[type].propertyFlags & requiredProperties) == requiredProperties)
+                {
+                    memoryTypeIndex = type;
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        RenderGraphTransientImage *findTransientImage(std::vector<RenderGraphTransientImage> &images,
+                                                      RenderGraphResource resource)
+        {
+            for(RenderGraphTransientImage &image : images)
+            {
+                if(image.resource == resource)
+                    return &image;
+            }
+            return nullptr;
+        }
+
+        UsageInfo getUsageInfo(RenderGraphUsage usage, bool read, bool write, RenderGraphPassType passType,
+                               bool depthImage)
+        {
+            VkPipelineStageFlags shaderStages = passType == RENDER_GRAPH_PASS_COMPUTE ?
+                                                VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT :
+                                                VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+            VkImageLayout readOnlyLayout = depthImage ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL :
+                                                        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+            switch(usage)
+            {
+                case RENDER_GRAPH_USAGE_COLOR_ATTACHMENT:
+                    return {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                            (read ? static_cast<VkAccessFlags>(VK_ACCESS_COLOR_ATTACHMENT_READ_BIT) : 0u) |
+                            (write ? static_cast<VkAccessFlags>(VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT) : 0u),
+                            VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
+                case RENDER_GRAPH_USAGE_DEPTH_ATTACHMENT:
+                    //Depth tests read the attachment even when the pass only declares a write.
+                    return {VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+                            VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT |
+                            (write ? static_cast<VkAccessFlags>(VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT) : 0u),
+                            write ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL :
+                                    VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL};
+                case RENDER_GRAPH_USAGE_INPUT_ATTACHMENT:
+                    return {VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_INPUT_ATTACHMENT_READ_BIT, readOnlyLayout};
+                case RENDER_GRAPH_USAGE_SAMPLED:
+                    return {shaderStages, VK_ACCESS_SHADER_READ_BIT, readOnlyLayout};
+                case RENDER_GRAPH_USAGE_STORAGE:
+                    return {shaderStages,
+                            (read ? static_cast<VkAccessFlags>(VK_ACCESS_SHADER_READ_BIT) : 0u) |
+                            (write ? static_cast<VkAccessFlags>(VK_ACCESS_SHADER_WRITE_BIT) : 0u),
+                            VK_IMAGE_LAYOUT_GENERAL};
+                case RENDER_GRAPH_USAGE_UNIFORM:
+                    return {shaderStages, VK_ACCESS_UNIFORM_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED};
+                case RENDER_GRAPH_USAGE_VERTEX:
+                    return {VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+                            VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED};
+                case RENDER_GRAPH_USAGE_INDIRECT:
+                    return {VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT,
+                            VK_IMAGE_LAYOUT_UNDEFINED};
+                case RENDER_GRAPH_USAGE_TRANSFER_SRC:
+                    return {VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT,
+                            VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL};
+                case RENDER_GRAPH_USAGE_TRANSFER_DST:
+                default:
+                    return {VK_PIPELINE_STAGE_TRANSFER_BIT,
+                            (read ? static_cast<VkAccessFlags>(VK_ACCESS_TRANSFER_READ_BIT) : 0u) |
+                            (write ? static_cast<VkAccessFlags>(VK_ACCESS_TRANSFER_WRITE_BIT) : 0u),
+                            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL};
+            }
+        }
+
+        //Stage masks of a pipeline barrier may not be empty.
+        void finishBarrier(RenderGraphBarrier &barrier)
+        {
+            if(barrier.isEmpty())
+                return;
+            if(barrier.srcStages == 0)
+                barrier.srcStages = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+            if(barrier.dstStages == 0)
+                barrier.dstStages = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+        }
+
+        void addImageBarrier(RenderGraphBarrier &barrier, RenderGraphResource resource, const RenderGraphImage &image,
+                             VkAccessFlags srcAccess, VkAccessFlags dstAccess, VkImageLayout oldLayout,
+                             VkImageLayout newLayout)
+        {
+            VkImageMemoryBarrier imageBarrier = {};
+            imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+            imageBarrier.pNext = nullptr;
+            imageBarrier.srcAccessMask = srcAccess;
+            imageBarrier.dstAccessMask = dstAccess;
+            imageBarrier.oldLayout = oldLayout;
+            imageBarrier.newLayout = newLayout;
+            imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            imageBarrier.image = image.image;
+            imageBarrier.subresourceRange = {image.aspect, 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS};
+            barrier.imageBarriers.push_back(imageBarrier);
+            barrier.imageResources.push_back(resource);
+        }
+
+        void recordBarrier(VkCommandBuffer cmdBuffer, const RenderGraphBarrier &barrier)
+        {
+            if(barrier.isEmpty())
+                return;
+
+            VkMemoryBarrier memoryBarrier = {};
+            memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+            memoryBarrier.pNext = nullptr;
+            memoryBarrier.srcAccessMask = barrier.srcAccess;
+            memoryBarrier.dstAccessMask = barrier.dstAccess;
+            bool hasMemoryBarrier = barrier.srcAccess != 0 || barrier.dstAccess != 0;
+            vkCmdPipelineBarrier(cmdBuffer, barrier.srcStages, barrier.dstStages, 0,
+                                 hasMemoryBarrier ? 1 : 0, hasMemoryBarrier ? &memoryBarrier : nullptr,
+                                 0, nullptr,
+                                 static_cast<uint32_t>(barrier.imageBarriers.size()), barrier.imageBarriers.data());
+        }
+    }
+
+    RenderGraph::RenderGraph()
+    {
+
+    }
+
+    RenderGraph::~RenderGraph()
+    {
+        destroy();
+    }
+
+    void RenderGraph::initialize(VkDevice logicalDevice, VkPhysicalDeviceMemoryProperties memoryProperties,
+                                 VulkanRenderer *renderer)
+    {
+        destroy();
+        this->logicalDevice = logicalDevice;
+        this->memoryProperties = memoryProperties;
+        this->renderer = renderer;
+    }
+
+    void RenderGraph::destroy()
+    {
+        for(CompiledGraph &graph : cache)
+            destroyCompiledGraph(graph);
+        cache.clear();
+        current = RENDER_GRAPH_INVALID;
+        logicalDevice = VK_NULL_HANDLE;
+        renderer = nullptr;
+    }
+
+    void RenderGraph::reset()
+    {
+        resources.clear();
+        passes.clear();
+        current = RENDER_GRAPH_INVALID;
+    }
+
+    RenderGraphResource RenderGraph::importImage(const std::string &name, const RenderGraphImage &image,
+                                                 const RenderGraphResourceState &initialState)
+    {
+        ResourceData resource = {};
+        resource.name = name;
+        resource.isImage = true;
+        resource.image = image;
+        resource.initialState = initialState;
+        resources.push_back(resource);
+        return static_cast<RenderGraphResource>(resources.size() - 1);
+    }
+
+    RenderGraphResource RenderGraph::importBuffer(const std::string &name, VkBuffer buffer,
+                                                  const RenderGraphResourceState &initialState)
+    {
+        ResourceData resource = {};
+        resource.name = name;
+        resource.isImage = false;
+        resource.buffer = buffer;
+        resource.initialState = initialState;
+        resources.push_back(resource);
+        return static_cast<RenderGraphResource>(resources.size() - 1);
+    }
+
+    RenderGraphResource RenderGraph::createImage(const std::string &name, VkFormat format, VkExtent2D extent,
+                                                 VkImageAspectFlags aspect)
+    {
+        ResourceData resource = {};
+        resource.name = name;
+        resource.isImage = true;
+        resource.isTransient = true;
+        resource.image = {VK_NULL_HANDLE, VK_NULL_HANDLE, format, extent, aspect};
+        resource.initialState = {0, 0, VK_IMAGE_LAYOUT_UNDEFINED};
+        resources.push_back(resource);
+        return static_cast<RenderGraphResource>(resources.size() - 1);
+    }
+
+    void RenderGraph::setFinalState(RenderGraphResource resource, const RenderGraphResourceState &finalState)
+    {
+        if(resource >= resources.size())
+            return;
+        if(resources[resource].isTransient)
+        {
+            std::cerr << "Failed to make " << resources[resource].name
+                      << " an output, transient images do not outlive the graph!" << std::endl;
+            return;
+        }
+        resources[resource].finalState = finalState;
+        resources[resource].isOutput = true;
+    }
+
+    RenderGraphPass RenderGraph::addPass(const std::string &name, RenderGraphPassType type,
+                                         std::function<void(VkCommandBuffer)> record)
+    {
+        PassData pass = {};
+        pass.name = name;
+        pass.type = type;
+        pass.sideEffects = false;
+        pass.record = record;
+        passes.push_back(pass);
+        return static_cast<RenderGraphPass>(passes.size() - 1);
+    }
+
+    bool RenderGraph::read(RenderGraphPass pass, RenderGraphResource resource, RenderGraphUsage usage)
+    {
+        return addAccess(pass, resource, usage, false);
+    }
+
+    bool RenderGraph::write(RenderGraphPass pass, RenderGraphResource resource, RenderGraphUsage usage)
+    {
+        return addAccess(pass, resource, usage, true);
+    }
+
+    void RenderGraph::setClearValue(RenderGraphPass pass, RenderGraphResource resource, VkClearValue clearValue)
+    {
+        if(pass >= passes.size())
+            return;
+        for(Access &access : passes[pass].accesses)
+        {
+            if(access.resource == resource && access.write && isAttachmentUsage(access.usage))
+            {
+                access.clear = true;
+                access.clearValue = clearValue;
+                return;
+            }
+        }
+        std::cerr << "Failed to set a clear value, the pass does not write the attachment!" << std::endl;
+    }
+
+    void RenderGraph::setSideEffects(RenderGraphPass pass)
+    {
+        if(pass < passes.size())
+            passes[pass].sideEffects = true;
+    }
+
+    /**
+     * @brief Schedules the declared graph, or reuses the schedule of an earlier graph with the
+     *        same structure. Creates the render passes and framebuffers of a new schedule.
+     * @return False if the graph is invalid or its Vulkan objects could not be created.
+     */
+    bool RenderGraph::compile()
+    {
+        ++compileCount;
+        std::vector<uint64_t> signature;
+        computeSignature(signature);
+
+        for(uint32_t i = 0; i < cache.size(); ++i)
+        {
+            if(cache[i].signature == signature)
+            {
+                //Clear values and record functions are not part of the structure.
+                for(RenderGraphStep &step : cache[i].steps)
+                {
+                    for(RenderGraphPass pass : step.passes)
+                    {
+                        for(const Access &access : passes[pass].accesses)
+                        {
+                            if(!access.clear)
+                                continue;
+                            for(size_t a = 0; a < step.attachments.size(); ++a)
+                            {
+                                if(step.attachments[a] == access.resource)
+                                    step.clearValues[a] = access.clearValue;
+                            }
+                        }
+                    }
+                }
+                cache[i].lastUsed = compileCount;
+                current = i;
+                return true;
+            }
+        }
+
+        current = RENDER_GRAPH_INVALID;
+        CompiledGraph graph;
+        graph.signature = std::move(signature);
+        if(!schedule(graph))
+            return false;
+
+        std::shared_ptr<TransientAllocation> transients = std::make_shared<TransientAllocation>();
+        planTransientImages(graph, *transients);
+        bool shared = false;
+        for(const CompiledGraph &cached : cache)
+        {
+            if(cached.transients->signature == transients->signature)
+            {
+                transients = cached.transients;
+                shared = true;
+                break;
+            }
+        }
+        graph.transients = transients;
+        if(logicalDevice != VK_NULL_HANDLE && !shared && !allocateTransientImages(*transients))
+        {
+            destroyCompiledGraph(graph);
+            return false;
+        }
+        bindTransientImages(graph);
+        if(logicalDevice != VK_NULL_HANDLE && renderer != nullptr && !createRenderPasses(graph))
+        {
+            destroyCompiledGraph(graph);
+            return false;
+        }
+
+        //The least recently used graph has not been used for at least as many frames as
+        //the cache holds graphs, so the gpu is done with it.
+        if(cache.size() >= SETTINGS_RENDER_GRAPH_CACHE_SIZE)
+        {
+            auto oldest = std::min_element(cache.begin(), cache.end(),
+                                           [](const CompiledGraph &a, const CompiledGraph &b)
+            {
+                return a.lastUsed < b.lastUsed;
+            });
+            destroyCompiledGraph(*oldest);
+            cache.erase(oldest);
+        }
+        graph.lastUsed = compileCount;
+        cache.push_back(std::move(graph));
+        current = static_cast<uint32_t>(cache.size() - 1);
+        return true;
+    }
+
+    /**
+     * @brief Records the compiled steps. Graphics steps are recorded in their render pass,
+     *        with every merged pass in its own subpass.
+     * @param cmdBuffer
+     */
+    void RenderGraph::execute(VkCommandBuffer cmdBuffer)
+    {
+        if(current == RENDER_GRAPH_INVALID)
+        {
+            std::cerr << "Failed to execute the render graph, it has not been compiled!" << std::endl;
+            return;
+        }
+
+        const CompiledGraph &graph = cache[current];
+        for(const RenderGraphStep &step : graph.steps)
+        {
+            recordBarrier(cmdBuffer, step.barrier);
+            if(step.type == RENDER_GRAPH_PASS_GRAPHICS)
+            {
+                if(renderer == nullptr || step.renderPass == VK_NULL_HANDLE)
+                {
+                    std::cerr << "Failed to execute a graphics step, the render graph has no device!" << std::endl;
+                    return;
+                }
+                renderer->beginRenderPass(cmdBuffer, step.renderPass, step.framebuffer, {{0, 0}, step.extent},
+                                          step.clearValues, VK_SUBPASS_CONTENTS_INLINE);
+            }
+            for(size_t i = 0; i < step.passes.size(); ++i)
+            {
+                if(i > 0)
+                    renderer->startNextSubpass(cmdBuffer, VK_SUBPASS_CONTENTS_INLINE);
+                if(passes[step.passes[i]].record)
+                    passes[step.passes[i]].record(cmdBuffer);
+            }
+            if(step.type == RENDER_GRAPH_PASS_GRAPHICS)
+                renderer->endRenderPass(cmdBuffer);
+        }
+        recordBarrier(cmdBuffer, graph.finalBarrier);
+    }
+
+    bool RenderGraph::getSubpass(RenderGraphPass pass, VkRenderPass &renderPass, uint32_t &subpass) const
+    {
+        if(current == RENDER_GRAPH_INVALID || isPassCulled(pass))
+            return false;
+
+        const CompiledGraph &graph = cache[current];
+        const RenderGraphStep &step = graph.steps[graph.passSteps[pass]];
+        if(step.type != RENDER_GRAPH_PASS_GRAPHICS)
+            return false;
+        renderPass = step.renderPass;
+        subpass = graph.passSubpasses[pass];
+        return true;
+    }
+
+    const std::vector<RenderGraphStep> &RenderGraph::getSteps() const
+    {
+        static const std::vector<RenderGraphStep> noSteps;
+        return current == RENDER_GRAPH_INVALID ? noSteps : cache[current].steps;
+    }
+
+    const RenderGraphBarrier &RenderGraph::getFinalBarrier() const
+    {
+        static const RenderGraphBarrier noBarrier;
+        return current == RENDER_GRAPH_INVALID ? noBarrier : cache[current].finalBarrier;
+    }
+
+    bool RenderGraph::isPassCulled(RenderGraphPass pass) const
+    {
+        return current == RENDER_GRAPH_INVALID || pass >= cache[current].culledPasses.size() ||
+               cache[current].culledPasses[pass];
+    }
+
+    const std::vector<RenderGraphTransientImage> &RenderGraph::getTransientImages() const
+    {
+        static const std::vector<RenderGraphTransientImage> noImages;
+        return current == RENDER_GRAPH_INVALID ? noImages : cache[current].transients->images;
+    }
+
+    VkDeviceSize RenderGraph::getTransientMemorySize() const
+    {
+        return current == RENDER_GRAPH_INVALID ? 0 : cache[current].transients->memorySize;
+    }
+
+    /**
+     * @brief Greedy placement of the largest images first. An image goes to the lowest offset,
+     *        the start of the block or the end of an image in use at the same time, where it
+     *        does not overlap any image whose lifetime overlaps its own.
+     * @param requests
+     * @param offsets Offset of every request in the block.
+     * @return Size of the block.
+     */
+    VkDeviceSize RenderGraph::placeAliasedImages(const std::vector<RenderGraphAliasingRequest> &requests,
+                                                 std::vector<VkDeviceSize> &offsets)
+    {
+        std::vector<size_t> order(requests.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [&requests](size_t a, size_t b)
+        {
+            return requests[a].size > requests[b].size;
+        });
+
+        offsets.assign(requests.size(), 0);
+        std::vector<size_t> placed;
+        VkDeviceSize blockSize = 0;
+        for(size_t i : order)
+        {
+            const RenderGraphAliasingRequest &request = requests[i];
+            VkDeviceSize alignment = std::max<VkDeviceSize>(request.alignment, 1);
+            std::vector<size_t> concurrent;
+            std::vector<VkDeviceSize> candidates = {0};
+            for(size_t j : placed)
+            {
+                if(requests[j].lastStep < request.firstStep || request.lastStep < requests[j].firstStep)
+                    continue;
+                concurrent.push_back(j);
+                VkDeviceSize end = offsets[j] + requests[j].size;
+                candidates.push_back((end + alignment - 1) / alignment * alignment);
+            }
+            std::sort(candidates.begin(), candidates.end());
+
+            //The end of the highest concurrent image always fits.
+            for(VkDeviceSize candidate : candidates)
+            {
+                bool fits = std::none_of(concurrent.begin(), concurrent.end(),
+                                         [&](size_t j)
+                {
+                    return candidate < offsets[j] + requests[j].size && offsets[j] < candidate + request.size;
+                });
+                if(fits)
+                {
+                    offsets[i] = candidate;
+                    break;
+                }
+            }
+            placed.push_back(i);
+            blockSize = std::max(blockSize, offsets[i] + request.size);
+        }
+        return blockSize;
+    }
+
+    /**
+     * @brief Adds a use of a resource to a pass, or merges it with the pass's earlier use.
+     * @param pass
+     * @param resource
+     * @param usage
+     * @param write
+     * @return False if the pass, resource or usage do not fit together.
+     */
+    bool RenderGraph::addAccess(RenderGraphPass pass, RenderGraphResource resource, RenderGraphUsage usage, bool write)
+    {
+        if(pass >= passes.size() || resource >= resources.size())
+        {
+            std::cerr << "Failed to add a resource use, the pass or the resource does not exist!" << std::endl;
+            return false;
+        }
+        if((write && !isWritableUsage(usage)) ||
+           (isAttachmentUsage(usage) && (passes[pass].type != RENDER_GRAPH_PASS_GRAPHICS || !resources[resource].isImage)) ||
+           (isBufferOnlyUsage(usage) && resources[resource].isImage))
+        {
+            std::cerr << "Failed to add the use of " << resources[resource].name << " to " << passes[pass].name
+                      << ", the usage does not fit!" << std::endl;
+            return false;
+        }
+
+        for(Access &access : passes[pass].accesses)
+        {
+            if(access.resource != resource)
+                continue;
+            if(access.usage != usage)
+            {
+                std::cerr << "Failed to add the use of " << resources[resource].name << " to " << passes[pass].name
+                          << ", a pass uses a resource in a single way!" << std::endl;
+                return false;
+            }
+            access.read = access.read || !write;
+            access.write = access.write || write;
+            return true;
+        }
+
+        Access access = {};
+        access.resource = resource;
+        access.usage = usage;
+        access.read = !write;
+        access.write = write;
+        passes[pass].accesses.push_back(access);
+        return true;
+    }
+
+    void RenderGraph::computeSignature(std::vector<uint64_t> &signature) const
+    {
+        signature.clear();
+        signature.push_back(resources.size());
+        for(const ResourceData &resource : resources)
+        {
+            signature.push_back((resource.isTransient ? 2u : 0u) | (resource.isImage ? 1u : 0u));
+            if(resource.isImage)
+            {
+                signature.push_back(handleValue(resource.image.image));
+                signature.push_back(handleValue(resource.image.view));
+                signature.push_back(resource.image.format);
+                signature.push_back((uint64_t(resource.image.extent.width) << 32) | resource.image.extent.height);
+                signature.push_back(resource.image.aspect);
+            }
+            else
+            {
+                signature.push_back(handleValue(resource.buffer));
+            }
+            signature.push_back((uint64_t(resource.initialState.stages) << 32) | resource.initialState.access);
+            signature.push_back(resource.initialState.layout);
+            signature.push_back(resource.isOutput);
+            if(resource.isOutput)
+            {
+                signature.push_back((uint64_t(resource.finalState.stages) << 32) | resource.finalState.access);
+                signature.push_back(resource.finalState.layout);
+            }
+        }
+
+        signature.push_back(passes.size());
+        for(const PassData &pass : passes)
+        {
+            signature.push_back((uint64_t(pass.type) << 32) | (pass.sideEffects ? 1u : 0u));
+            signature.push_back(pass.accesses.size());
+            for(const Access &access : pass.accesses)
+            {
+                signature.push_back((uint64_t(access.resource) << 32) | (uint64_t(access.usage) << 8) |
+                                    (access.read ? 1u : 0u) | (access.write ? 2u : 0u) | (access.clear ? 4u : 0u));
+            }
+        }
+    }
+
+    /**
+     * @brief Orders the passes, culls the ones whose results are not used, and computes the
+     *        barriers. Consecutive graphics passes are merged into one render pass when the
+     *        only dependencies between them are on attachments, which subpass dependencies
+     *        can express by region.
+     * @param graph
+     * @return False if a graphics pass has no attachments or attachments of different sizes.
+     */
+    bool RenderGraph::schedule(CompiledGraph &graph) const
+    {
+        const uint32_t passCount = static_cast<uint32_t>(passes.size());
+        const uint32_t resourceCount = static_cast<uint32_t>(resources.size());
+
+        //Size of the attachments of every graphics pass.
+        std::vector<VkExtent2D> passExtents(passCount, VkExtent2D{0, 0});
+        for(uint32_t p = 0; p < passCount; ++p)
+        {
+            if(passes[p].type != RENDER_GRAPH_PASS_GRAPHICS)
+                continue;
+            for(const Access &access : passes[p].accesses)
+            {
+                if(!isAttachmentUsage(access.usage))
+                    continue;
+                VkExtent2D extent = resources[access.resource].image.extent;
+                if(passExtents[p].width != 0 &&
+                   (passExtents[p].width != extent.width || passExtents[p].height != extent.height))
+                {
+                    std::cerr << "Failed to compile the render graph, the attachments of " << passes[p].name
+                              << " differ in size!" << std::endl;
+                    return false;
+                }
+                passExtents[p] = extent;
+            }
+            if(passExtents[p].width == 0)
+            {
+                std::cerr << "Failed to compile the render graph, " << passes[p].name
+                          << " has no attachments!" << std::endl;
+                return false;
+            }
+        }
+
+        //Dependencies in the order the passes were declared. Reads depend on the last write,
+        //writes also have to wait for the earlier reads and writes.
+        std::vector<std::vector<uint32_t>> producers(passCount);
+        std::vector<std::vector<uint32_t>> successors(passCount);
+        std::vector<uint32_t> lastWriters(resourceCount, RENDER_GRAPH_INVALID);
+        std::vector<std::vector<uint32_t>> readers(resourceCount);
+        auto addEdge = [&successors](uint32_t from, uint32_t to)
+        {
+            if(from != to && std::find(successors[from].begin(), successors[from].end(), to) == successors[from].end())
+                successors[from].push_back(to);
+        };
+        for(uint32_t p = 0; p < passCount; ++p)
+        {
+            for(const Access &access : passes[p].accesses)
+            {
+                uint32_t lastWriter = lastWriters[access.resource];
+                if(access.read && lastWriter != RENDER_GRAPH_INVALID)
+                    producers[p].push_back(lastWriter);
+                if(lastWriter != RENDER_GRAPH_INVALID)
+                    addEdge(lastWriter, p);
+                if(access.write)
+                {
+                    for(uint32_t reader : readers[access.resource])
+                        addEdge(reader, p);
+                }
+            }
+            for(const Access &access : passes[p].accesses)
+            {
+                if(access.write)
+                {
+                    lastWriters[access.resource] = p;
+                    readers[access.resource].clear();
+                }
+                else
+                {
+                    readers[access.resource].push_back(p);
+                }
+            }
+        }
+
+        //Keep the passes the outputs depend on.
+        std::vector<bool> live(passCount, false);
+        std::vector<uint32_t> stack;
+        for(uint32_t r = 0; r < resourceCount; ++r)
+        {
+            if(resources[r].isOutput && lastWriters[r] != RENDER_GRAPH_INVALID)
+                stack.push_back(lastWriters[r]);
+        }
+        for(uint32_t p = 0; p < passCount; ++p)
+        {
+            if(passes[p].sideEffects)
+                stack.push_back(p);
+        }
+        while(!stack.empty())
+        {
+            uint32_t p = stack.back();
+            stack.pop_back();
+            if(live[p])
+                continue;
+            live[p] = true;
+            stack.insert(stack.end(), producers[p].begin(), producers[p].end());
+        }
+        graph.culledPasses.resize(passCount);
+        for(uint32_t p = 0; p < passCount; ++p)
+            graph.culledPasses[p] = !live[p];
+
+        //Topological sort of the live passes. Of the passes that are ready, one that can share
+        //the render pass of the previous pass goes first, otherwise the earliest declared.
+        std::vector<uint32_t> pendingCounts(passCount, 0);
+        for(uint32_t p = 0; p < passCount; ++p)
+        {
+            if(!live[p])
+                continue;
+            for(uint32_t successor : successors[p])
+            {
+                if(live[successor])
+                    ++pendingCounts[successor];
+            }
+        }
+        std::vector<uint32_t> ready;
+        for(uint32_t p = 0; p < passCount; ++p)
+        {
+            if(live[p] && pendingCounts[p] == 0)
+                ready.push_back(p);
+        }
+        std::vector<uint32_t> order;
+        while(!ready.empty())
+        {
+            size_t pick = 0;
+            if(!order.empty() && passes[order.back()].type == RENDER_GRAPH_PASS_GRAPHICS)
+            {
+                VkExtent2D extent = passExtents[order.back()];
+                for(size_t i = 0; i < ready.size(); ++i)
+                {
+                    if(passes[ready[i]].type == RENDER_GRAPH_PASS_GRAPHICS &&
+                       passExtents[ready[i]].width == extent.width && passExtents[ready[i]].height == extent.height)
+                    {
+                        pick = i;
+                        break;
+                    }
+                }
+            }
+            uint32_t p = ready[pick];
+            ready.erase(ready.begin() + pick);
+            order.push_back(p);
+            for(uint32_t successor : successors[p])
+            {
+                if(live[successor] && --pendingCounts[successor] == 0)
+                    ready.insert(std::upper_bound(ready.begin(), ready.end(), successor), successor);
+            }
+        }
+
+        //Walk the schedule and track every resource to find the barriers.
+        std::vector<ResourceState> states(resourceCount);
+        for(uint32_t r = 0; r < resourceCount; ++r)
+        {
+            const RenderGraphResourceState &initial = resources[r].initialState;
+            ResourceState &state = states[r];
+            state = {};
+            state.layout = resources[r].isImage ? initial.layout : VK_IMAGE_LAYOUT_UNDEFINED;
+            state.writeAccess = initial.access & WRITE_ACCESS;
+            if(state.writeAccess != 0)
+                state.writeStages = initial.stages;
+            else
+                state.readStages = initial.stages;
+        }
+
+        graph.passSteps.assign(passCount, RENDER_GRAPH_INVALID);
+        graph.passSubpasses.assign(passCount, 0);
+        //Resources used by the current step, and the subpass that used them last.
+        std::vector<bool> stepResources(resourceCount, false);
+        std::vector<uint32_t> stepSubpasses(resourceCount, 0);
+
+        struct Dependency
+        {
+            VkPipelineStageFlags srcStages;
+            VkAccessFlags srcAccess;
+            VkPipelineStageFlags dstStages;
+            VkAccessFlags dstAccess;
+            VkImageLayout oldLayout;
+            VkImageLayout newLayout;
+            bool needed;
+        };
+
+        for(uint32_t p : order)
+        {
+            const PassData &pass = passes[p];
+            std::vector<Dependency> dependencies(pass.accesses.size());
+            std::vector<UsageInfo> usages(pass.accesses.size());
+            for(size_t a = 0; a < pass.accesses.size(); ++a)
+            {
+                const Access &access = pass.accesses[a];
+                const ResourceData &resource = resources[access.resource];
+                ResourceState &state = states[access.resource];
+                UsageInfo usage = getUsageInfo(access.usage, access.read, access.write, pass.type,
+                                               resource.isImage && (resource.image.aspect & VK_IMAGE_ASPECT_DEPTH_BIT));
+                usages[a] = usage;
+                Dependency &dependency = dependencies[a];
+                dependency = {0, 0, usage.stages, usage.access, state.layout, state.layout, false};
+
+                if(resource.isImage && usage.layout != VK_IMAGE_LAYOUT_UNDEFINED && usage.layout != state.layout)
+                {
+                    //The layout transition waits for every earlier use.
+                    dependency.srcStages = state.writeStages | state.readStages;
+                    dependency.srcAccess = state.writeAccess;
+                    dependency.newLayout = usage.layout;
+                    dependency.needed = true;
+                    state.layout = usage.layout;
+                    state.writeStages = usage.stages;
+                    state.writeAccess = access.write ? usage.access & WRITE_ACCESS : 0;
+                    state.readStages = access.write ? 0 : usage.stages;
+                    state.visibleStages = access.write ? 0 : usage.stages;
+                    state.visibleAccess = access.write ? 0 : usage.access;
+                }
+                else if(access.write)
+                {
+                    if((state.writeStages | state.readStages) != 0)
+                    {
+                        dependency.srcStages = state.writeStages | state.readStages;
+                        dependency.srcAccess = state.writeAccess;
+                        dependency.needed = true;
+                    }
+                    state.writeStages = usage.stages;
+                    state.writeAccess = usage.access & WRITE_ACCESS;
+                    state.readStages = 0;
+                    state.visibleStages = 0;
+                    state.visibleAccess = 0;
+                }
+                else
+                {
+                    //Readers after the same write only wait for it once per stage and access.
+                    if(state.writeStages != 0 &&
+                       ((usage.stages & ~state.visibleStages) != 0 || (usage.access & ~state.visibleAccess) != 0))
+                    {
+                        dependency.srcStages = state.writeStages;
+                        dependency.srcAccess = state.writeAccess;
+                        dependency.needed = true;
+                        state.visibleStages |= usage.stages;
+                        state.visibleAccess |= usage.access;
+                    }
+                    state.readStages |= usage.stages;
+                }
+            }
+
+            //Merge into the render pass of the previous step if every dependency on a resource
+            //the step already uses is between attachments.
+            bool merge = !graph.steps.empty() && pass.type == RENDER_GRAPH_PASS_GRAPHICS &&
+                         graph.steps.back().type == RENDER_GRAPH_PASS_GRAPHICS &&
+                         graph.steps.back().extent.width == passExtents[p].width &&
+                         graph.steps.back().extent.height == passExtents[p].height;
+            for(size_t a = 0; a < pass.accesses.size() && merge; ++a)
+            {
+                RenderGraphResource resource = pass.accesses[a].resource;
+                if(!stepResources[resource])
+                    continue;
+                const std::vector<RenderGraphResource> &attachments = graph.steps.back().attachments;
+                bool stepAttachment = std::find(attachments.begin(), attachments.end(), resource) != attachments.end();
+                bool attachmentUse = isAttachmentUsage(pass.accesses[a].usage);
+                if(stepAttachment != attachmentUse || (dependencies[a].needed && !attachmentUse))
+                    merge = false;
+            }
+
+            if(!merge)
+            {
+                RenderGraphStep step;
+                step.type = pass.type;
+                step.extent = passExtents[p];
+                graph.steps.push_back(step);
+                std::fill(stepResources.begin(), stepResources.end(), false);
+            }
+            RenderGraphStep &step = graph.steps.back();
+            uint32_t subpass = static_cast<uint32_t>(step.passes.size());
+            step.passes.push_back(p);
+            graph.passSteps[p] = static_cast<uint32_t>(graph.steps.size() - 1);
+            graph.passSubpasses[p] = subpass;
+            if(pass.type == RENDER_GRAPH_PASS_GRAPHICS)
+            {
+                RenderGraphSubpass subpassData;
+                subpassData.depthAttachment = {VK_ATTACHMENT_UNUSED, VK_IMAGE_LAYOUT_UNDEFINED};
+                step.subpasses.push_back(subpassData);
+            }
+
+            for(size_t a = 0; a < pass.accesses.size(); ++a)
+            {
+                const Access &access = pass.accesses[a];
+                const Dependency &dependency = dependencies[a];
+                const ResourceData &resource = resources[access.resource];
+
+                if(dependency.needed && stepResources[access.resource])
+                {
+                    //Between subpasses, the attachment references do the layout transition.
+                    uint32_t srcSubpass = stepSubpasses[access.resource];
+                    auto existing = std::find_if(step.dependencies.begin(), step.dependencies.end(),
+                                                 [srcSubpass, subpass](const VkSubpassDependency &d)
+                    {
+                        return d.srcSubpass == srcSubpass && d.dstSubpass == subpass;
+                    });
+                    if(existing == step.dependencies.end())
+                    {
+                        step.dependencies.push_back({srcSubpass, subpass, 0, 0, 0, 0, VK_DEPENDENCY_BY_REGION_BIT});
+                        existing = step.dependencies.end() - 1;
+                    }
+                    existing->srcStageMask |= dependency.srcStages;
+                    existing->dstStageMask |= dependency.dstStages;
+                    existing->srcAccessMask |= dependency.srcAccess;
+                    existing->dstAccessMask |= dependency.dstAccess;
+                }
+                else if(dependency.needed)
+                {
+                    step.barrier.srcStages |= dependency.srcStages;
+                    step.barrier.dstStages |= dependency.dstStages;
+                    if(dependency.oldLayout != dependency.newLayout)
+                    {
+                        addImageBarrier(step.barrier, access.resource, resource.image, dependency.srcAccess, dependency.dstAccess,
+                                        dependency.oldLayout, dependency.newLayout);
+                    }
+                    else
+                    {
+                        step.barrier.srcAccess |= dependency.srcAccess;
+                        step.barrier.dstAccess |= dependency.dstAccess;
+                    }
+                }
+                stepResources[access.resource] = true;
+                stepSubpasses[access.resource] = subpass;
+
+                if(!isAttachmentUsage(access.usage))
+                    continue;
+                auto found = std::find(step.attachments.begin(), step.attachments.end(), access.resource);
+                uint32_t attachment = static_cast<uint32_t>(found - step.attachments.begin());
+                if(found == step.attachments.end())
+                {
+                    //Load and store operations are filled in once all steps are known.
+                    step.attachments.push_back(access.resource);
+                    VkAttachmentDescription description = {};
+                    description.format = resource.image.format;
+                    description.samples = VK_SAMPLE_COUNT_1_BIT;
+                    description.loadOp = access.clear ? VK_ATTACHMENT_LOAD_OP_CLEAR :
+                                         access.read ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+                    description.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+                    description.initialLayout = usages[a].layout;
+                    step.attachmentDescriptions.push_back(description);
+                    VkClearValue clearValue = {};
+                    step.clearValues.push_back(access.clear ? access.clearValue : clearValue);
+                }
+                step.attachmentDescriptions[attachment].finalLayout = usages[a].layout;
+
+                VkAttachmentReference reference = {attachment, usages[a].layout};
+                RenderGraphSubpass &subpassData = step.subpasses.back();
+                if(access.usage == RENDER_GRAPH_USAGE_COLOR_ATTACHMENT)
+                    subpassData.colorAttachments.push_back(reference);
+                else if(access.usage == RENDER_GRAPH_USAGE_DEPTH_ATTACHMENT)
+                    subpassData.depthAttachment = reference;
+                else
+                    subpassData.inputAttachments.push_back(reference);
+            }
+        }
+
+        //Attachments are only stored if a later step or the world outside the graph uses them,
+        //and preserved through subpasses that do not use them.
+        std::vector<bool> usedLater(resourceCount, false);
+        for(uint32_t r = 0; r < resourceCount; ++r)
+            usedLater[r] = resources[r].isOutput;
+        for(size_t s = graph.steps.size(); s-- > 0;)
+        {
+            RenderGraphStep &step = graph.steps[s];
+            for(size_t a = 0; a < step.attachments.size(); ++a)
+            {
+                VkAttachmentDescription &description = step.attachmentDescriptions[a];
+                description.storeOp = usedLater[step.attachments[a]] ? VK_ATTACHMENT_STORE_OP_STORE :
+                                                                       VK_ATTACHMENT_STORE_OP_DONT_CARE;
+                bool hasStencil = (resources[step.attachments[a]].image.aspect & VK_IMAGE_ASPECT_STENCIL_BIT) != 0;
+                description.stencilLoadOp = hasStencil ? description.loadOp : VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+                description.stencilStoreOp = hasStencil ? description.storeOp : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+
+                uint32_t first = UINT32_MAX, last = 0;
+                std::vector<bool> usedIn(step.subpasses.size(), false);
+                for(uint32_t i = 0; i < step.subpasses.size(); ++i)
+                {
+                    const RenderGraphSubpass &subpass = step.subpasses[i];
+                    auto references = [a](const std::vector<VkAttachmentReference> &list)
+                    {
+                        return std::any_of(list.begin(), list.end(), [a](const VkAttachmentReference &reference)
+                        {
+                            return reference.attachment == a;
+                        });
+                    };
+                    usedIn[i] = references(subpass.colorAttachments) || references(subpass.inputAttachments) ||
+                                subpass.depthAttachment.attachment == a;
+                    if(usedIn[i])
+                    {
+                        first = std::min(first, i);
+                        last = i;
+                    }
+                }
+                for(uint32_t i = first + 1; i < last; ++i)
+                {
+                    if(!usedIn[i])
+                        step.subpasses[i].preserveAttachments.push_back(static_cast<uint32_t>(a));
+                }
+            }
+            for(RenderGraphPass pass : step.passes)
+            {
+                for(const Access &access : passes[pass].accesses)
+                    usedLater[access.resource] = true;
+            }
+            finishBarrier(step.barrier);
+        }
+
+        //Hand the outputs over in the state the work after the graph expects.
+        for(uint32_t r = 0; r < resourceCount; ++r)
+        {
+            if(!resources[r].isOutput)
+                continue;
+            const RenderGraphResourceState &finalState = resources[r].finalState;
+            const ResourceState &state = states[r];
+            if(resources[r].isImage && finalState.layout != VK_IMAGE_LAYOUT_UNDEFINED && finalState.layout != state.layout)
+            {
+                graph.finalBarrier.srcStages |= state.writeStages | state.readStages;
+                graph.finalBarrier.dstStages |= finalState.stages;
+                addImageBarrier(graph.finalBarrier, r, resources[r].image, state.writeAccess, finalState.access,
+                                state.layout, finalState.layout);
+            }
+            else if(state.writeAccess != 0 || ((finalState.access & WRITE_ACCESS) != 0 && state.readStages != 0))
+            {
+                graph.finalBarrier.srcStages |= state.writeStages | state.readStages;
+                graph.finalBarrier.dstStages |= finalState.stages;
+                graph.finalBarrier.srcAccess |= state.writeAccess;
+                graph.finalBarrier.dstAccess |= finalState.access;
+            }
+        }
+        finishBarrier(graph.finalBarrier);
+
+        graph.lastStages.resize(resourceCount);
+        graph.lastWriteAccess.resize(resourceCount);
+        for(uint32_t r = 0; r < resourceCount; ++r)
+        {
+            graph.lastStages[r] = states[r].writeStages | states[r].readStages;
+            graph.lastWriteAccess[r] = states[r].writeAccess;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Finds the lifetime and usage of every transient image in the schedule. Images that
+     *        are only attachments of a single render pass, and are not loaded, never leave the
+     *        tile memory and are made transient attachments.
+     * @param graph
+     * @param transients Gets the images and the signature to share them by.
+     */
+    void RenderGraph::planTransientImages(const CompiledGraph &graph, TransientAllocation &transients) const
+    {
+        for(uint32_t r = 0; r < resources.size(); ++r)
+        {
+            if(!resources[r].isTransient)
+                continue;
+
+            RenderGraphTransientImage image = {};
+            image.resource = r;
+            image.firstStep = RENDER_GRAPH_INVALID;
+            image.memoryBlock = RENDER_GRAPH_INVALID;
+            bool onlyAttachment = true;
+            for(uint32_t s = 0; s < graph.steps.size(); ++s)
+            {
+                for(RenderGraphPass pass : graph.steps[s].passes)
+                {
+                    for(const Access &access : passes[pass].accesses)
+                    {
+                        if(access.resource != r)
+                            continue;
+                        image.usage |= getImageUsage(access.usage);
+                        image.firstStep = std::min(image.firstStep, s);
+                        image.lastStep = s;
+                        onlyAttachment = onlyAttachment && isAttachmentUsage(access.usage);
+                    }
+                }
+            }
+            //Only used by culled passes.
+            if(image.firstStep == RENDER_GRAPH_INVALID)
+                continue;
+
+            if(onlyAttachment && image.firstStep == image.lastStep)
+            {
+                const RenderGraphStep &step = graph.steps[image.firstStep];
+                size_t attachment = std::find(step.attachments.begin(), step.attachments.end(), r) -
+                                    step.attachments.begin();
+                image.lazilyAllocated = step.attachmentDescriptions[attachment].loadOp != VK_ATTACHMENT_LOAD_OP_LOAD &&
+                                        step.attachmentDescriptions[attachment].storeOp == VK_ATTACHMENT_STORE_OP_DONT_CARE;
+                if(image.lazilyAllocated)
+                    image.usage |= VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+            }
+            transients.images.push_back(image);
+
+            const RenderGraphImage &description = resources[r].image;
+            transients.signature.push_back(r);
+            transients.signature.push_back(description.format);
+            transients.signature.push_back((uint64_t(description.extent.width) << 32) | description.extent.height);
+            transients.signature.push_back((uint64_t(description.aspect) << 32) | image.usage);
+            transients.signature.push_back((uint64_t(image.firstStep) << 32) | image.lastStep);
+        }
+    }
+
+    /**
+     * @brief Creates the transient images. Transient attachments get lazily allocated memory
+     *        of their own if the device has it, the other images share device local blocks,
+     *        one per memory type, in which images with disjoint lifetimes alias.
+     * @param transients
+     * @return False if an image or memory could not be created.
+     */
+    bool RenderGraph::allocateTransientImages(TransientAllocation &transients)
+    {
+        std::vector<VkMemoryRequirements> requirements(transients.images.size());
+        for(size_t i = 0; i < transients.images.size(); ++i)
+        {
+            RenderGraphTransientImage &image = transients.images[i];
+            const RenderGraphImage &description = resources[image.resource].image;
+            VkImageCreateInfo createInfo =
+                    VulkanStructures::imageCreateInfo(image.usage, VK_IMAGE_TYPE_2D, description.format,
+                                                      {description.extent.width, description.extent.height, 1}, 1,
+                                                      VK_SAMPLE_COUNT_1_BIT, VK_IMAGE_LAYOUT_UNDEFINED,
+                                                      VK_SHARING_MODE_EXCLUSIVE, 1, false);
+            if(!Raven::createImage(logicalDevice, createInfo, image.image))
+                return false;
+            vkGetImageMemoryRequirements(logicalDevice, image.image, &requirements[i]);
+        }
+
+        //Memory type of every image in a shared block.
+        std::vector<uint32_t> memoryTypes(transients.images.size(), RENDER_GRAPH_INVALID);
+        for(size_t i = 0; i < transients.images.size(); ++i)
+        {
+            RenderGraphTransientImage &image = transients.images[i];
+            uint32_t memoryType;
+            if(image.lazilyAllocated &&
+               findTransientMemoryType(memoryProperties, requirements[i].memoryTypeBits,
+                                       VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT,
+                                       memoryType))
+            {
+                VkDeviceMemory memory = VK_NULL_HANDLE;
+                VkMemoryAllocateInfo allocateInfo = VulkanStructures::memoryAllocateInfo(requirements[i].size, memoryType);
+                if(vkAllocateMemory(logicalDevice, &allocateInfo, nullptr, &memory) != VK_SUCCESS)
+                {
+                    std::cerr << "Failed to allocate lazily allocated memory!" << std::endl;
+                    return false;
+                }
+                image.memoryBlock = static_cast<uint32_t>(transients.memoryBlocks.size());
+                image.offset = 0;
+                transients.memoryBlocks.push_back(memory);
+                transients.memorySize += requirements[i].size;
+                continue;
+            }
+
+            //Without lazily allocated memory the transient attachment shares a block like the rest.
+            image.lazilyAllocated = false;
+            if(!findTransientMemoryType(memoryProperties, requirements[i].memoryTypeBits,
+                                        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, memoryTypes[i]))
+            {
+                std::cerr << "Failed to find a memory type for " << resources[image.resource].name << "!" << std::endl;
+                return false;
+            }
+        }
+
+        for(uint32_t memoryType = 0; memoryType < memoryProperties.memoryTypeCount; ++memoryType)
+        {
+            std::vector<size_t> blockImages;
+            std::vector<RenderGraphAliasingRequest> requests;
+            for(size_t i = 0; i < transients.images.size(); ++i)
+            {
+                if(memoryTypes[i] != memoryType)
+                    continue;
+                blockImages.push_back(i);
+                requests.push_back({transients.images[i].firstStep, transients.images[i].lastStep,
+                                    requirements[i].size, requirements[i].alignment});
+            }
+            if(blockImages.empty())
+                continue;
+
+            std::vector<VkDeviceSize> offsets;
+            VkDeviceSize blockSize = placeAliasedImages(requests, offsets);
+            VkDeviceMemory memory = VK_NULL_HANDLE;
+            VkMemoryAllocateInfo allocateInfo = VulkanStructures::memoryAllocateInfo(blockSize, memoryType);
+            if(vkAllocateMemory(logicalDevice, &allocateInfo, nullptr, &memory) != VK_SUCCESS)
+            {
+                std::cerr << "Failed to allocate memory for the transient images!" << std::endl;
+                return false;
+            }
+            for(size_t i = 0; i < blockImages.size(); ++i)
+            {
+                transients.images[blockImages[i]].memoryBlock = static_cast<uint32_t>(transients.memoryBlocks.size());
+                transients.images[blockImages[i]].offset = offsets[i];
+            }
+            transients.memoryBlocks.push_back(memory);
+            transients.memorySize += blockSize;
+        }
+
+        for(RenderGraphTransientImage &image : transients.images)
+        {
+            if(vkBindImageMemory(logicalDevice, image.image, transients.memoryBlocks[image.memoryBlock],
+                                 image.offset) != VK_SUCCESS)
+            {
+                std::cerr << "Failed to bind memory to " << resources[image.resource].name << "!" << std::endl;
+                return false;
+            }
+            const RenderGraphImage &description = resources[image.resource].image;
+            if(!createImageView(logicalDevice,
+                                VulkanStructures::imageViewCreateInfo(image.image, description.format,
+                                                                      description.aspect, VK_IMAGE_VIEW_TYPE_2D),
+                                image.view))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * @brief Puts the transient images into the barriers. The first use of an image also waits
+     *        for the last use of every image in the same memory, which includes the image itself
+     *        in the previous frame.
+     * @param graph
+     */
+    void RenderGraph::bindTransientImages(CompiledGraph &graph) const
+    {
+        std::vector<RenderGraphTransientImage> &images = graph.transients->images;
+        auto bindBarrier = [&images](RenderGraphBarrier &barrier)
+        {
+            for(size_t i = 0; i < barrier.imageBarriers.size(); ++i)
+            {
+                RenderGraphTransientImage *image = findTransientImage(images, barrier.imageResources[i]);
+                if(image != nullptr)
+                    barrier.imageBarriers[i].image = image->image;
+            }
+        };
+        for(RenderGraphStep &step : graph.steps)
+            bindBarrier(step.barrier);
+        bindBarrier(graph.finalBarrier);
+
+        for(const RenderGraphTransientImage &image : images)
+        {
+            RenderGraphBarrier &barrier = graph.steps[image.firstStep].barrier;
+            for(const RenderGraphTransientImage &other : images)
+            {
+                if(other.resource != image.resource &&
+                   (image.memoryBlock == RENDER_GRAPH_INVALID || other.memoryBlock != image.memoryBlock))
+                {
+                    continue;
+                }
+                barrier.srcStages |= graph.lastStages[other.resource];
+                barrier.srcAccess |= graph.lastWriteAccess[other.resource];
+            }
+        }
+    }
+
+    bool RenderGraph::createRenderPasses(CompiledGraph &graph)
+    {
+        for(RenderGraphStep &step : graph.steps)
+        {
+            if(step.type != RENDER_GRAPH_PASS_GRAPHICS)
+                continue;
+
+            std::vector<SubpassParameters> subpassParameters;
+            for(const RenderGraphSubpass &subpass : step.subpasses)
+            {
+                subpassParameters.push_back(
+                {
+                    VK_PIPELINE_BIND_POINT_GRAPHICS,
+                    subpass.inputAttachments,
+                    subpass.colorAttachments,
+                    {},
+                    subpass.depthAttachment.attachment != VK_ATTACHMENT_UNUSED ? &subpass.depthAttachment : nullptr,
+                    subpass.preserveAttachments
+                });
+            }
+            if(!renderer->createRenderPass(logicalDevice, step.attachmentDescriptions, subpassParameters,
+                                           step.dependencies, step.renderPass))
+            {
+                return false;
+            }
+
+            std::vector<VkImageView> views;
+            for(RenderGraphResource attachment : step.attachments)
+            {
+                RenderGraphTransientImage *transient = findTransientImage(graph.transients->images, attachment);
+                views.push_back(transient != nullptr ? transient->view : resources[attachment].image.view);
+            }
+            if(!renderer->createFramebuffer(logicalDevice, step.renderPass, views, step.extent.width,
+                                            step.extent.height, 1, step.framebuffer))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void RenderGraph::destroyCompiledGraph(CompiledGraph &graph)
+    {
+        if(logicalDevice == VK_NULL_HANDLE)
+            return;
+
+        for(RenderGraphStep &step : graph.steps)
+        {
+            if(renderer != nullptr && step.framebuffer != VK_NULL_HANDLE)
+                renderer->destroyFramebuffer(logicalDevice, step.framebuffer);
+            if(renderer != nullptr && step.renderPass != VK_NULL_HANDLE)
+                renderer->destroyRenderPass(logicalDevice, step.renderPass);
+        }
+
+        //The last schedule using the transient images destroys them.
+        if(graph.transients && graph.transients.use_count() == 1)
+        {
+            for(RenderGraphTransientImage &image : graph.transients->images)
+            {
+                destroyImageView(logicalDevice, image.view);
+                destroyImage(logicalDevice, image.image);
+            }
+            for(VkDeviceMemory &memory : graph.transients->memoryBlocks)
+                freeMemory(logicalDevice, memory);
+        }
+        graph.transients.reset();
+    }
+}
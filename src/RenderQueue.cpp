@@ -0,0 +1,270 @@
+#include "RenderQueue.h"
+#include "VulkanUtility.h"
+#include "VulkanDescriptorManager.h"
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+
+static_assert(RENDER_QUEUE_PASS_BITS + RENDER_QUEUE_PIPELINE_BITS + RENDER_QUEUE_DESCRIPTOR_SET_BITS +
+              RENDER_QUEUE_VERTEX_BUFFER_BITS + RENDER_QUEUE_DEPTH_BITS == 64,
+              "Render queue key fields have to fill 64 bits.");
+
+namespace Raven
+{
+    namespace
+    {
+        const uint32_t DEPTH_SHIFT = 0;
+        const uint32_t VERTEX_BUFFER_SHIFT = DEPTH_SHIFT + RENDER_QUEUE_DEPTH_BITS;
+        const uint32_t DESCRIPTOR_SET_SHIFT = VERTEX_BUFFER_SHIFT + RENDER_QUEUE_VERTEX_BUFFER_BITS;
+        const uint32_t PIPELINE_SHIFT = DESCRIPTOR_SET_SHIFT + RENDER_QUEUE_DESCRIPTOR_SET_BITS;
+        const uint32_t PASS_SHIFT = PIPELINE_SHIFT + RENDER_QUEUE_PIPELINE_BITS;
+    }
+
+    RenderQueue::RenderQueue()
+    {
+
+    }
+
+    RenderQueue::~RenderQueue()
+    {
+
+    }
+
+    void RenderQueue::reset()
+    {
+        items.clear();
+        keys.clear();
+        sortedKeys.clear();
+        sortedIndices.clear();
+        pipelineIds.clear();
+        descriptorSetIds.clear();
+        vertexBufferIds.clear();
+        statistics = RenderQueueStatistics();
+        sorted = true;
+    }
+
+    void RenderQueue::setBackToFront(uint32_t pass, bool backToFront)
+    {
+        if(pass >= (1u << RENDER_QUEUE_PASS_BITS))
+            return;
+        if(backToFront)
+            backToFrontPasses |= 1u << pass;
+        else
+            backToFrontPasses &= ~(1u << pass);
+    }
+
+    /**
+     * @brief Adds a draw to the queue. Handles are replaced by small ids in the order they
+     *        are first seen this frame, so draws sharing state end up next to each other.
+     * @param pass Render pass the draw belongs to, passes are recorded separately.
+     * @param item Draws with more than RENDER_QUEUE_MAX_DYNAMIC_OFFSETS dynamic offsets are rejected.
+     * @param depth View space distance, used to draw front to back within the same state.
+     */
+    void RenderQueue::submit(uint32_t pass, const RenderItem &item, float depth)
+    {
+        if(item.dynamicOffsetCount > RENDER_QUEUE_MAX_DYNAMIC_OFFSETS)
+        {
+            std::cerr << "Failed to submit a draw with more than " << RENDER_QUEUE_MAX_DYNAMIC_OFFSETS
+                      << " dynamic offsets!" << std::endl;
+            return;
+        }
+
+        pass = std::min(pass, (1u << RENDER_QUEUE_PASS_BITS) - 1);
+        uint32_t pipelineId = compactId(pipelineIds, handleValue(item.pipeline), RENDER_QUEUE_PIPELINE_BITS);
+        uint32_t descriptorSetId = compactId(descriptorSetIds, handleValue(item.descriptorSet),
+                                             RENDER_QUEUE_DESCRIPTOR_SET_BITS);
+        uint32_t vertexBufferId = compactId(vertexBufferIds, handleValue(item.vertexBuffer),
+                                            RENDER_QUEUE_VERTEX_BUFFER_BITS);
+
+        items.push_back(item);
+        keys.push_back(makeKey(pass, pipelineId, descriptorSetId, vertexBufferId, depth,
+                               (backToFrontPasses & (1u << pass)) != 0));
+        sorted = false;
+    }
+
+    /**
+     * @brief Sorts the keys with a least significant digit radix sort, one byte per pass.
+     *        Bytes that are the same in every key are skipped, which is common for the pass
+     *        and pipeline fields.
+     */
+    void RenderQueue::sort()
+    {
+        if(sorted)
+            return;
+
+        size_t count = keys.size();
+        sortedKeys = keys;
+        sortedIndices.resize(count);
+        std::iota(sortedIndices.begin(), sortedIndices.end(), 0);
+        scratchKeys.resize(count);
+        scratchIndices.resize(count);
+
+        for(uint32_t shift = 0; shift < 64 && count > 1; shift += 8)
+        {
+            size_t offsets[256] = {};
+            for(uint64_t key : sortedKeys)
+                ++offsets[(key >> shift) & 0xFF];
+            if(offsets[(sortedKeys[0] >> shift) & 0xFF] == count)
+                continue;
+
+            size_t offset = 0;
+            for(size_t &bucket : offsets)
+            {
+                size_t bucketSize = bucket;
+                bucket = offset;
+                offset += bucketSize;
+            }
+            for(size_t i = 0; i < count; ++i)
+            {
+                size_t destination = offsets[(sortedKeys[i] >> shift) & 0xFF]++;
+                scratchKeys[destination] = sortedKeys[i];
+                scratchIndices[destination] = sortedIndices[i];
+            }
+            sortedKeys.swap(scratchKeys);
+            sortedIndices.swap(scratchIndices);
+        }
+        sorted = true;
+    }
+
+    /**
+     * @brief Records the sorted draws of a pass. Pipelines, descriptor sets, vertex buffers
+     *        and index buffers are only bound when they differ from the previous draw. A set
+     *        is bound again when its dynamic offsets change.
+     * @param cmdBuffer
+     * @param pass
+     * @param vertexBinding Binding of the vertex buffers.
+     */
+    void RenderQueue::record(VkCommandBuffer cmdBuffer, uint32_t pass, uint32_t vertexBinding)
+    {
+        sort();
+
+        //The pass is the top field, so its draws are a contiguous range.
+        uint64_t passKey = uint64_t(pass) << PASS_SHIFT;
+        auto begin = std::lower_bound(sortedKeys.begin(), sortedKeys.end(), passKey);
+        auto end = pass + 1 < (1u << RENDER_QUEUE_PASS_BITS) ?
+                   std::lower_bound(begin, sortedKeys.end(), uint64_t(pass + 1) << PASS_SHIFT) :
+                   sortedKeys.end();
+
+        VkPipeline boundPipeline = VK_NULL_HANDLE;
+        VkPipelineLayout boundLayout = VK_NULL_HANDLE;
+        VkDescriptorSet boundDescriptorSet = VK_NULL_HANDLE;
+        const RenderItem *boundOffsetsItem = nullptr;
+        VkBuffer boundVertexBuffer = VK_NULL_HANDLE;
+        VkBuffer boundIndexBuffer = VK_NULL_HANDLE;
+        for(auto key = begin; key != end; ++key)
+        {
+            const RenderItem &item = items[sortedIndices[key - sortedKeys.begin()]];
+
+            if(item.pipeline != boundPipeline)
+            {
+                vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, item.pipeline);
+                boundPipeline = item.pipeline;
+                ++statistics.pipelineBinds;
+            }
+            else
+            {
+                ++statistics.redundantBindsSkipped;
+            }
+
+            //A set stays bound across pipelines only if they share the layout.
+            if(item.descriptorSet != VK_NULL_HANDLE)
+            {
+                bool offsetsChanged = boundOffsetsItem == nullptr ||
+                                      item.dynamicOffsetCount != boundOffsetsItem->dynamicOffsetCount ||
+                                      !std::equal(item.dynamicOffsets, item.dynamicOffsets + item.dynamicOffsetCount,
+                                                  boundOffsetsItem->dynamicOffsets);
+                if(item.descriptorSet != boundDescriptorSet || item.pipelineLayout != boundLayout || offsetsChanged)
+                {
+                    VulkanDescriptorManager::bindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                                                                item.pipelineLayout, 0, {item.descriptorSet},
+                                                                std::vector<uint32_t>(item.dynamicOffsets,
+                                                                                      item.dynamicOffsets +
+                                                                                      item.dynamicOffsetCount));
+                    boundDescriptorSet = item.descriptorSet;
+                    boundLayout = item.pipelineLayout;
+                    boundOffsetsItem = &item;
+                    ++statistics.descriptorSetBinds;
+                }
+                else
+                {
+                    ++statistics.redundantBindsSkipped;
+                }
+            }
+
+            if(item.vertexBuffer != boundVertexBuffer)
+            {
+                bindVertexBuffers(cmdBuffer, vertexBinding, {{item.vertexBuffer, 0}});
+                boundVertexBuffer = item.vertexBuffer;
+                ++statistics.vertexBufferBinds;
+            }
+            else
+            {
+                ++statistics.redundantBindsSkipped;
+            }
+
+            if(item.indexBuffer != VK_NULL_HANDLE)
+            {
+                if(item.indexBuffer != boundIndexBuffer)
+                {
+                    vkCmdBindIndexBuffer(cmdBuffer, item.indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+                    boundIndexBuffer = item.indexBuffer;
+                    ++statistics.indexBufferBinds;
+                }
+                else
+                {
+                    ++statistics.redundantBindsSkipped;
+                }
+            }
+
+            item.drawable->recordDraws(cmdBuffer, item.instanceCount, item.firstInstance);
+            ++statistics.drawCount;
+        }
+    }
+
+    /**
+     * @brief Packs the fields into a key, the pass being the most significant one. Positive
+     *        floats keep their order when compared as integers, so the depth uses the top
+     *        bits of its float representation.
+     * @param pass
+     * @param pipelineId
+     * @param descriptorSetId
+     * @param vertexBufferId
+     * @param depth Negative depths count as zero.
+     * @param backToFront Inverts the depth so that far draws come first.
+     * @return The sort key.
+     */
+    uint64_t RenderQueue::makeKey(uint32_t pass, uint32_t pipelineId, uint32_t descriptorSetId,
+                                  uint32_t vertexBufferId, float depth, bool backToFront)
+    {
+        uint32_t depthBits = 0;
+        if(depth > 0.0f)
+        {
+            std::memcpy(&depthBits, &depth, sizeof(depthBits));
+            depthBits >>= 32 - RENDER_QUEUE_DEPTH_BITS;
+        }
+        uint32_t depthMask = (1u << RENDER_QUEUE_DEPTH_BITS) - 1;
+        if(backToFront)
+            depthBits = depthMask - depthBits;
+
+        return uint64_t(pass & ((1u << RENDER_QUEUE_PASS_BITS) - 1)) << PASS_SHIFT |
+               uint64_t(pipelineId & ((1u << RENDER_QUEUE_PIPELINE_BITS) - 1)) << PIPELINE_SHIFT |
+               uint64_t(descriptorSetId & ((1u << RENDER_QUEUE_DESCRIPTOR_SET_BITS) - 1)) << DESCRIPTOR_SET_SHIFT |
+               uint64_t(vertexBufferId & ((1u << RENDER_QUEUE_VERTEX_BUFFER_BITS) - 1)) << VERTEX_BUFFER_SHIFT |
+               uint64_t(depthBits & depthMask) << DEPTH_SHIFT;
+    }
+
+    /**
+     * @brief Returns the id of a handle. Once every id of the field is taken new handles share
+     *        the last one, which only makes the ordering worse, the recorded state stays right.
+     * @param ids
+     * @param handle
+     * @param bits Size of the key field.
+     * @return The id.
+     */
+    uint32_t RenderQueue::compactId(std::unordered_map<uint64_t, uint32_t> &ids, uint64_t handle, uint32_t bits)
+    {
+        uint32_t maxId = (1u << bits) - 1;
+        auto result = ids.emplace(handle, std::min(static_cast<uint32_t>(ids.size()), maxId));
+        return result.first->second;
+    }
+}
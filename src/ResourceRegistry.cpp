@@ -0,0 +1,80 @@
+#include "ResourceRegistry.h"
+#include "VulkanUtility.h"
+
+namespace Raven
+{
+    namespace
+    {
+        void destroyPipelineResource(VkDevice logicalDevice, PipelineResource &pipeline)
+        {
+            destroyPipeline(logicalDevice, pipeline.pipeline);
+            destroyPipelineLayout(logicalDevice, pipeline.layout);
+        }
+
+        void destroyTextureResource(VkDevice logicalDevice, TextureResource &texture)
+        {
+            destroySampler(logicalDevice, texture.sampler);
+            destroyImageView(logicalDevice, texture.image.imageView);
+            destroyImage(logicalDevice, texture.image.image);
+            freeMemory(logicalDevice, texture.image.imageMemory);
+        }
+
+        void destroyBufferResource(VkDevice logicalDevice, BufferResource &buffer)
+        {
+            destroyBufferView(logicalDevice, buffer.buffer.bufferView);
+            destroyBuffer(logicalDevice, buffer.buffer.buffer);
+            freeMemory(logicalDevice, buffer.memory);
+        }
+    }
+
+    ResourceRegistry::ResourceRegistry()
+    {
+
+    }
+
+    ResourceRegistry::~ResourceRegistry()
+    {
+        destroy();
+    }
+
+    void ResourceRegistry::initialize(VkDevice logicalDevice)
+    {
+        destroy();
+        this->logicalDevice = logicalDevice;
+        currentFrame = 0;
+    }
+
+    void ResourceRegistry::destroy()
+    {
+        if(logicalDevice == VK_NULL_HANDLE)
+            return;
+
+        //Meshes first, they refer to the buffers.
+        collect(UINT64_MAX);
+        VkDevice device = logicalDevice;
+        meshes.clear([](MeshResource&){});
+        pipelines.clear([device](PipelineResource &pipeline){destroyPipelineResource(device, pipeline);});
+        textures.clear([device](TextureResource &texture){destroyTextureResource(device, texture);});
+        buffers.clear([device](BufferResource &buffer){destroyBufferResource(device, buffer);});
+        logicalDevice = VK_NULL_HANDLE;
+    }
+
+    /**
+     * @brief Destroys the resources released during frames that the gpu has finished.
+     * @param completedFrame The latest frame whose fence has been signaled.
+     */
+    void ResourceRegistry::collect(uint64_t completedFrame)
+    {
+        VkDevice device = logicalDevice;
+        meshes.collect(completedFrame, [](MeshResource&){});
+        pipelines.collect(completedFrame, [device](PipelineResource &pipeline){destroyPipelineResource(device, pipeline);});
+        textures.collect(completedFrame, [device](TextureResource &texture){destroyTextureResource(device, texture);});
+        buffers.collect(completedFrame, [device](BufferResource &buffer){destroyBufferResource(device, buffer);});
+    }
+
+    size_t ResourceRegistry::getPendingReleaseCount() const
+    {
+        return buffers.getPendingReleaseCount() + textures.getPendingReleaseCount() +
+               meshes.getPendingReleaseCount() + pipelines.getPendingReleaseCount();
+    }
+}
@@ -0,0 +1,409 @@
+#include "Scene.h"
+#include "VulkanStructures.h"
+#include "VulkanUtility.h"
+
+namespace Raven
+{
+    //Builds the matrix translate * rotate * scale without multiplying matrices.
+    static inline glm::mat4 composeTransform(const glm::vec3 &position, const glm::quat &rotation,
+                                             const glm::vec3 &scale)
+    {
+        float xx = rotation.x * rotation.x, yy = rotation.y * rotation.y, zz = rotation.z * rotation.z;
+        float xy = rotation.x * rotation.y, xz = rotation.x * rotation.z, yz = rotation.y * rotation.z;
+        float wx = rotation.w * rotation.x, wy = rotation.w * rotation.y, wz = rotation.w * rotation.z;
+
+        glm::mat4 matrix;
+        matrix[0] = glm::vec4((1.0f - 2.0f * (yy + zz)) * scale.x, 2.0f * (xy + wz) * scale.x,
+                              2.0f * (xz - wy) * scale.x, 0.0f);
+        matrix[1] = glm::vec4(2.0f * (xy - wz) * scale.y, (1.0f - 2.0f * (xx + zz)) * scale.y,
+                              2.0f * (yz + wx) * scale.y, 0.0f);
+        matrix[2] = glm::vec4(2.0f * (xz + wy) * scale.z, 2.0f * (yz - wx) * scale.z,
+                              (1.0f - 2.0f * (xx + yy)) * scale.z, 0.0f);
+        matrix[3] = glm::vec4(position, 1.0f);
+        return matrix;
+    }
+
+    //Multiplies two affine matrices, skipping the constant bottom row.
+    static inline glm::mat4 multiplyAffine(const glm::mat4 &parent, const glm::mat4 &local)
+    {
+        glm::mat4 matrix;
+        for(int column = 0; column < 3; ++column)
+            matrix[column] = parent[0] * local[column].x + parent[1] * local[column].y + parent[2] * local[column].z;
+        matrix[3] = parent[0] * local[3].x + parent[1] * local[3].y + parent[2] * local[3].z + parent[3];
+        return matrix;
+    }
+
+    //Reorders the values so that values[i] becomes the old values[order[i]]. Values that
+    //are not in the order are dropped.
+    template<typename T>
+    static void applyOrder(std::vector<T> &values, const std::vector<uint32_t> &order)
+    {
+        std::vector<T> sorted(order.size());
+        for(size_t i = 0; i < order.size(); ++i)
+            sorted[i] = values[order[i]];
+        values.swap(sorted);
+    }
+
+    Scene::Scene()
+    {
+
+    }
+
+    Scene::~Scene()
+    {
+        destroy();
+    }
+
+    /**
+     * @brief Creates a persistently mapped, host coherent buffer that holds one world matrix
+     *        per node handle. It can be bound as a per-instance vertex buffer or read as a
+     *        storage buffer, so the gpu reads the matrices without any copies.
+     * @param logicalDevice
+     * @param memoryProperties
+     * @param capacity Largest number of nodes the scene may have.
+     * @return False if the buffer could not be created or mapped.
+     */
+    bool Scene::createInstanceBuffer(VkDevice logicalDevice,
+                                     const VkPhysicalDeviceMemoryProperties &memoryProperties,
+                                     uint32_t capacity)
+    {
+        destroy();
+        if(capacity == 0 || capacity < handleToIndex.size())
+        {
+            std::cerr << "Failed to create instance buffer since it can not hold every scene node!" << std::endl;
+            return false;
+        }
+        this->logicalDevice = logicalDevice;
+
+        instanceBuffer.size = sizeof(glm::mat4) * capacity;
+        instanceBuffer.usageFlags = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+        VkBufferCreateInfo bufferInfo = VulkanStructures::bufferCreateInfo(instanceBuffer.size,
+                                                                           instanceBuffer.usageFlags,
+                                                                           VK_SHARING_MODE_EXCLUSIVE);
+        if(!createBuffer(logicalDevice, bufferInfo, instanceBuffer.buffer))
+            return false;
+
+        VkMemoryRequirements memReq;
+        vkGetBufferMemoryRequirements(logicalDevice, instanceBuffer.buffer, &memReq);
+        if(!allocateMemory(logicalDevice, memoryProperties, memReq,
+                           VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                           instanceMemory) ||
+           !instanceBuffer.bindMemoryObject(logicalDevice, instanceMemory))
+        {
+            destroy();
+            return false;
+        }
+
+        void *data;
+        if(vkMapMemory(logicalDevice, instanceMemory, 0, instanceBuffer.size, 0, &data) != VK_SUCCESS)
+        {
+            std::cerr << "Failed to map scene instance buffer memory!" << std::endl;
+            destroy();
+            return false;
+        }
+        instanceBuffer.data = data;
+        instanceData = static_cast<glm::mat4*>(data);
+        instanceCapacity = capacity;
+
+        //Every node has to be written into the new buffer.
+        std::fill(localDirty.begin(), localDirty.end(), 1);
+        anyDirty = !handles.empty();
+        return true;
+    }
+
+    /**
+     * @brief Destroys the instance buffer. The gpu must not be using it anymore.
+     */
+    void Scene::destroy()
+    {
+        if(logicalDevice == VK_NULL_HANDLE)
+            return;
+        if(instanceData != nullptr)
+            vkUnmapMemory(logicalDevice, instanceMemory);
+        destroyBuffer(logicalDevice, instanceBuffer.buffer);
+        freeMemory(logicalDevice, instanceMemory);
+        instanceBuffer = VulkanBuffer();
+        instanceData = nullptr;
+        instanceCapacity = 0;
+        logicalDevice = VK_NULL_HANDLE;
+    }
+
+    /**
+     * @brief Creates a node. It is placed into its depth level on the next update.
+     * @param parent Parent node or SCENE_INVALID_NODE for a root node.
+     * @return The handle of the node, SCENE_INVALID_NODE if it could not be created.
+     */
+    SceneNode Scene::createNode(SceneNode parent)
+    {
+        if(parent != SCENE_INVALID_NODE && !isValid(parent))
+        {
+            std::cerr << "Failed to create scene node since the parent does not exist!" << std::endl;
+            return SCENE_INVALID_NODE;
+        }
+        if(freeHandles.empty() && instanceData != nullptr && handleToIndex.size() >= instanceCapacity)
+        {
+            std::cerr << "Failed to create scene node since the instance buffer is full!" << std::endl;
+            return SCENE_INVALID_NODE;
+        }
+
+        SceneNode node;
+        if(!freeHandles.empty())
+        {
+            node = freeHandles.back();
+            freeHandles.pop_back();
+        }
+        else
+        {
+            node = static_cast<SceneNode>(handleToIndex.size());
+            handleToIndex.push_back(SCENE_INVALID_NODE);
+        }
+
+        handleToIndex[node] = static_cast<uint32_t>(handles.size());
+        positions.push_back(glm::vec3(0.0f));
+        rotations.push_back(glm::quat(1.0f, 0.0f, 0.0f, 0.0f));
+        scales.push_back(glm::vec3(1.0f));
+        parentHandles.push_back(parent);
+        parentIndices.push_back(SCENE_INVALID_NODE);
+        handles.push_back(node);
+        worldMatrices.push_back(glm::mat4(1.0f));
+        localDirty.push_back(1);
+        worldChanged.push_back(0);
+
+        hierarchyChanged = true;
+        anyDirty = true;
+        return node;
+    }
+
+    /**
+     * @brief Destroys a node and every node below it. Their handles may be reused.
+     * @param node
+     */
+    void Scene::destroyNode(SceneNode node)
+    {
+        if(!isValid(node))
+            return;
+        //Parents have to come before their children for the descendants to be found in one pass.
+        if(hierarchyChanged)
+            sortByDepth();
+
+        size_t nodeCount = handles.size();
+        std::vector<uint8_t> removed(nodeCount, 0);
+        removed[handleToIndex[node]] = 1;
+        for(size_t i = handleToIndex[node] + 1; i < nodeCount; ++i)
+        {
+            if(parentIndices[i] != SCENE_INVALID_NODE && removed[parentIndices[i]])
+                removed[i] = 1;
+        }
+
+        std::vector<uint32_t> order;
+        order.reserve(nodeCount);
+        for(uint32_t i = 0; i < nodeCount; ++i)
+        {
+            if(!removed[i])
+            {
+                order.push_back(i);
+                continue;
+            }
+            handleToIndex[handles[i]] = SCENE_INVALID_NODE;
+            freeHandles.push_back(handles[i]);
+        }
+
+        applyOrder(positions, order);
+        applyOrder(rotations, order);
+        applyOrder(scales, order);
+        applyOrder(parentHandles, order);
+        applyOrder(parentIndices, order);
+        applyOrder(handles, order);
+        applyOrder(worldMatrices, order);
+        applyOrder(localDirty, order);
+        applyOrder(worldChanged, order);
+        for(uint32_t i = 0; i < handles.size(); ++i)
+            handleToIndex[handles[i]] = i;
+        hierarchyChanged = true;
+    }
+
+    /**
+     * @brief Moves a node under another parent. The local transform is kept, so the
+     *        node moves with its new parent from now on.
+     * @param node
+     * @param parent New parent or SCENE_INVALID_NODE to make the node a root.
+     * @return False if the nodes do not exist or the parent is inside the node's subtree.
+     */
+    bool Scene::setParent(SceneNode node, SceneNode parent)
+    {
+        if(!isValid(node) || (parent != SCENE_INVALID_NODE && !isValid(parent)))
+        {
+            std::cerr << "Failed to set scene node parent since the node does not exist!" << std::endl;
+            return false;
+        }
+        for(SceneNode ancestor = parent; ancestor != SCENE_INVALID_NODE;
+            ancestor = parentHandles[handleToIndex[ancestor]])
+        {
+            if(ancestor == node)
+            {
+                std::cerr << "Failed to set scene node parent since it would create a cycle!" << std::endl;
+                return false;
+            }
+        }
+
+        parentHandles[handleToIndex[node]] = parent;
+        hierarchyChanged = true;
+        markDirty(node);
+        return true;
+    }
+
+    void Scene::setPosition(SceneNode node, const glm::vec3 &position)
+    {
+        positions[handleToIndex[node]] = position;
+        markDirty(node);
+    }
+
+    void Scene::setRotation(SceneNode node, const glm::quat &rotation)
+    {
+        rotations[handleToIndex[node]] = rotation;
+        markDirty(node);
+    }
+
+    void Scene::setScale(SceneNode node, const glm::vec3 &scale)
+    {
+        scales[handleToIndex[node]] = scale;
+        markDirty(node);
+    }
+
+    void Scene::setTransform(SceneNode node, const glm::vec3 &position,
+                             const glm::quat &rotation, const glm::vec3 &scale)
+    {
+        uint32_t index = handleToIndex[node];
+        positions[index] = position;
+        rotations[index] = rotation;
+        scales[index] = scale;
+        markDirty(node);
+    }
+
+    void Scene::markDirty(SceneNode node)
+    {
+        localDirty[handleToIndex[node]] = 1;
+        anyDirty = true;
+    }
+
+    /**
+     * @brief Updates the world matrices. Depth levels are processed one after another and
+     *        the nodes of a level are split into chunks that the thread pool runs in parallel.
+     *        A node is recomputed if its local transform changed or its parent's world matrix
+     *        changed during this update, everything else is skipped.
+     * @param threadPool Optional pool for the parallel update.
+     */
+    void Scene::update(ThreadPool *threadPool)
+    {
+        if(hierarchyChanged)
+            sortByDepth();
+        if(!anyDirty)
+            return;
+
+        for(size_t level = 0; level + 1 < levelOffsets.size(); ++level)
+        {
+            size_t levelBegin = levelOffsets[level];
+            size_t levelEnd = levelOffsets[level + 1];
+            if(threadPool == nullptr)
+            {
+                updateRange(levelBegin, levelEnd);
+                continue;
+            }
+            threadPool->parallelFor(levelEnd - levelBegin, SCENE_UPDATE_CHUNK_SIZE,
+                                    [this, levelBegin](size_t begin, size_t end)
+            {
+                updateRange(levelBegin + begin, levelBegin + end);
+            });
+        }
+        anyDirty = false;
+    }
+
+    void Scene::updateRange(size_t begin, size_t end)
+    {
+        for(size_t i = begin; i < end; ++i)
+        {
+            uint32_t parent = parentIndices[i];
+            bool changed = localDirty[i] || (parent != SCENE_INVALID_NODE && worldChanged[parent]);
+            worldChanged[i] = changed;
+            if(!changed)
+                continue;
+
+            localDirty[i] = 0;
+            glm::mat4 local = composeTransform(positions[i], rotations[i], scales[i]);
+            worldMatrices[i] = parent == SCENE_INVALID_NODE ? local : multiplyAffine(worldMatrices[parent], local);
+            if(instanceData != nullptr)
+                instanceData[handles[i]] = worldMatrices[i];
+        }
+    }
+
+    /**
+     * @brief Reorders every array in breadth-first order. Depth levels become contiguous
+     *        ranges and the children of a node sit next to each other in the order of
+     *        their parents, so an update walks the parent matrices almost sequentially.
+     */
+    void Scene::sortByDepth()
+    {
+        size_t nodeCount = handles.size();
+        for(size_t i = 0; i < nodeCount; ++i)
+        {
+            parentIndices[i] = parentHandles[i] == SCENE_INVALID_NODE ?
+                               SCENE_INVALID_NODE : handleToIndex[parentHandles[i]];
+        }
+
+        //Children of every node, in their current order.
+        std::vector<uint32_t> childOffsets(nodeCount + 1, 0);
+        for(uint32_t parent : parentIndices)
+        {
+            if(parent != SCENE_INVALID_NODE)
+                ++childOffsets[parent + 1];
+        }
+        for(size_t i = 0; i < nodeCount; ++i)
+            childOffsets[i + 1] += childOffsets[i];
+        std::vector<uint32_t> children(childOffsets[nodeCount]);
+        std::vector<uint32_t> fill(childOffsets.begin(), childOffsets.end() - 1);
+        for(uint32_t i = 0; i < nodeCount; ++i)
+        {
+            if(parentIndices[i] != SCENE_INVALID_NODE)
+                children[fill[parentIndices[i]]++] = i;
+        }
+
+        //Roots first, then the children of every node in the order the nodes were visited.
+        std::vector<uint32_t> order;
+        order.reserve(nodeCount);
+        for(uint32_t i = 0; i < nodeCount; ++i)
+        {
+            if(parentIndices[i] == SCENE_INVALID_NODE)
+                order.push_back(i);
+        }
+        levelOffsets.assign(1, 0);
+        size_t levelEnd = order.size();
+        for(size_t i = 0; i < order.size(); ++i)
+        {
+            if(i == levelEnd)
+            {
+                levelOffsets.push_back(levelEnd);
+                levelEnd = order.size();
+            }
+            order.insert(order.end(), children.begin() + childOffsets[order[i]],
+                         children.begin() + childOffsets[order[i] + 1]);
+        }
+        levelOffsets.push_back(order.size());
+
+        applyOrder(positions, order);
+        applyOrder(rotations, order);
+        applyOrder(scales, order);
+        applyOrder(parentHandles, order);
+        applyOrder(handles, order);
+        applyOrder(worldMatrices, order);
+        applyOrder(localDirty, order);
+        applyOrder(worldChanged, order);
+        for(uint32_t i = 0; i < nodeCount; ++i)
+            handleToIndex[handles[i]] = i;
+        for(size_t i = 0; i < nodeCount; ++i)
+        {
+            parentIndices[i] = parentHandles[i] == SCENE_INVALID_NODE ?
+                               SCENE_INVALID_NODE : handleToIndex[parentHandles[i]];
+        }
+        hierarchyChanged = false;
+    }
+}
@@ -0,0 +1,153 @@
+#include "SyncObjectPool.h"
+#include "VulkanUtility.h"
+
+namespace Raven
+{
+    SyncObjectPool::SyncObjectPool()
+    {
+
+    }
+
+    SyncObjectPool::~SyncObjectPool()
+    {
+        destroy();
+    }
+
+    void SyncObjectPool::initialize(VkDevice logicalDevice)
+    {
+        destroy();
+        this->logicalDevice = logicalDevice;
+    }
+
+    void SyncObjectPool::destroy()
+    {
+        if(logicalDevice == VK_NULL_HANDLE)
+            return;
+
+        for(VkFence &fence : freeFences)
+            destroyFence(logicalDevice, fence);
+        for(VkFence &fence : usedFences)
+            destroyFence(logicalDevice, fence);
+        for(PendingRelease<VkFence> &pending : pendingFences)
+            destroyFence(logicalDevice, pending.object);
+        for(VkSemaphore &semaphore : freeSemaphores)
+            destroySemaphore(logicalDevice, semaphore);
+        for(PendingRelease<VkSemaphore> &pending : pendingSemaphores)
+            destroySemaphore(logicalDevice, pending.object);
+        freeFences.clear();
+        usedFences.clear();
+        pendingFences.clear();
+        freeSemaphores.clear();
+        pendingSemaphores.clear();
+        fenceCount = 0;
+        semaphoreCount = 0;
+        logicalDevice = VK_NULL_HANDLE;
+    }
+
+    /**
+     * @brief Takes a reset fence from the pool. When none are left the returned fences are reset
+     *        with a single call, and only if there are none of those either a new one is created.
+     * @param fence
+     * @return False if a fence could not be created.
+     */
+    bool SyncObjectPool::acquireFence(VkFence &fence)
+    {
+        if(freeFences.empty() && !usedFences.empty())
+        {
+            if(resetFences(logicalDevice, usedFences))
+            {
+                freeFences.swap(usedFences);
+            }
+            else
+            {
+                for(VkFence &usedFence : usedFences)
+                    destroyFence(logicalDevice, usedFence);
+                fenceCount -= usedFences.size();
+            }
+            usedFences.clear();
+        }
+
+        if(!freeFences.empty())
+        {
+            fence = freeFences.back();
+            freeFences.pop_back();
+            return true;
+        }
+        if(!createFence(logicalDevice, VK_FALSE, fence))
+            return false;
+        ++fenceCount;
+        return true;
+    }
+
+    /**
+     * @brief Takes an unsignaled binary semaphore from the pool, or creates one if none are left.
+     * @param semaphore
+     * @return False if a semaphore could not be created.
+     */
+    bool SyncObjectPool::acquireSemaphore(VkSemaphore &semaphore)
+    {
+        if(!freeSemaphores.empty())
+        {
+            semaphore = freeSemaphores.back();
+            freeSemaphores.pop_back();
+            return true;
+        }
+        if(!createSemaphore(logicalDevice, semaphore))
+            return false;
+        ++semaphoreCount;
+        return true;
+    }
+
+    void SyncObjectPool::releaseFence(VkFence &fence)
+    {
+        if(fence == VK_NULL_HANDLE)
+            return;
+        usedFences.push_back(fence);
+        fence = VK_NULL_HANDLE;
+    }
+
+    void SyncObjectPool::releaseFences(const std::vector<VkFence> &fences)
+    {
+        usedFences.insert(usedFences.end(), fences.begin(), fences.end());
+    }
+
+    void SyncObjectPool::releaseFence(VkFence &fence, uint64_t frame)
+    {
+        if(fence == VK_NULL_HANDLE)
+            return;
+        pendingFences.push_back({frame, fence});
+        fence = VK_NULL_HANDLE;
+    }
+
+    /**
+     * @brief Gives a semaphore back once the frame has finished. By then the wait on it must have
+     *        been executed, which leaves it unsignaled.
+     * @param semaphore
+     * @param frame
+     */
+    void SyncObjectPool::releaseSemaphore(VkSemaphore &semaphore, uint64_t frame)
+    {
+        if(semaphore == VK_NULL_HANDLE)
+            return;
+        pendingSemaphores.push_back({frame, semaphore});
+        semaphore = VK_NULL_HANDLE;
+    }
+
+    /**
+     * @brief Makes the fences and semaphores released during finished frames available again.
+     * @param completedFrame The latest frame the gpu has finished.
+     */
+    void SyncObjectPool::collect(uint64_t completedFrame)
+    {
+        while(!pendingFences.empty() && pendingFences.front().frame <= completedFrame)
+        {
+            usedFences.push_back(pendingFences.front().object);
+            pendingFences.pop_front();
+        }
+        while(!pendingSemaphores.empty() && pendingSemaphores.front().frame <= completedFrame)
+        {
+            freeSemaphores.push_back(pendingSemaphores.front().object);
+            pendingSemaphores.pop_front();
+        }
+    }
+}
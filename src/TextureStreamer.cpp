@@ -0,0 +1,638 @@
+#include "TextureStreamer.h"
+#include "VulkanStructures.h"
+#include "VulkanUtility.h"
+#include "CommandBufferManager.h"
+#include "FileIO.h"
+#include "FrustumCuller.h"
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace Raven
+{
+    TextureStreamer::TextureStreamer()
+    {
+
+    }
+
+    TextureStreamer::~TextureStreamer()
+    {
+        destroy();
+    }
+
+    /**
+     * @brief Prepares the streamer for use.
+     * @param physicalDevice
+     * @param logicalDevice
+     * @param queueFamilyIndex The family uploads are recorded for.
+     * @param submitter Submitter of the queue uploads are submitted to.
+     * @param syncObjects The pool the fences of the uploads are taken from.
+     * @param timeline Timeline of the device's queues.
+     * @param timelineQueue Index of the queue whose submissions sample the textures.
+     * @param memoryBudget Maximum device memory for streamed textures, 0 for the default.
+     * @param memoryBudgetExtensionEnabled True if VK_EXT_memory_budget was enabled on the device.
+     * @return False if the command pool could not be created.
+     */
+    bool TextureStreamer::initialize(VkPhysicalDevice physicalDevice, VkDevice logicalDevice,
+                                     uint32_t queueFamilyIndex, QueueSubmitter *submitter, SyncObjectPool *syncObjects,
+                                     GpuTimeline *timeline, uint32_t timelineQueue,
+                                     VkDeviceSize memoryBudget, bool memoryBudgetExtensionEnabled)
+    {
+        this->physicalDevice = physicalDevice;
+        this->logicalDevice = logicalDevice;
+        this->submitter = submitter;
+        this->syncObjects = syncObjects;
+        this->timeline = timeline;
+        this->timelineQueue = timelineQueue;
+        this->memoryBudget = memoryBudget > 0 ? memoryBudget : SETTINGS_TEXTURE_STREAMING_BUDGET;
+        //The budget query also needs vkGetPhysicalDeviceMemoryProperties2KHR from the instance.
+        this->memoryBudgetExtensionEnabled = memoryBudgetExtensionEnabled &&
+                                             vkGetPhysicalDeviceMemoryProperties2KHR != nullptr;
+        currentBudget = this->memoryBudget;
+        vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+
+        VkCommandPoolCreateInfo poolInfo = VulkanStructures::commandPoolCreateInfo(queueFamilyIndex);
+        poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+        if(!CommandBufferManager::createCommandPool(logicalDevice, poolInfo, cmdPool))
+            return false;
+        return true;
+    }
+
+    /**
+     * @brief Waits for all uploads to finish and destroys every streamed texture.
+     */
+    void TextureStreamer::destroy()
+    {
+        if(logicalDevice == VK_NULL_HANDLE)
+            return;
+
+        for(PendingUpload &upload : pendingUploads)
+        {
+            vkWaitForFences(logicalDevice, 1, &upload.fence, VK_TRUE, UINT64_MAX);
+            syncObjects->releaseFence(upload.fence);
+            destroyImageView(logicalDevice, upload.image.imageView);
+            destroyImage(logicalDevice, upload.image.image);
+            freeMemory(logicalDevice, upload.image.imageMemory);
+            destroyBuffer(logicalDevice, upload.stagingBuffer.buffer);
+            freeMemory(logicalDevice, upload.stagingMemory);
+        }
+        pendingUploads.clear();
+
+        releaseRetiredResources(true);
+
+        for(StreamedTexture &texture : textures)
+        {
+            destroyImageView(logicalDevice, texture.image.imageView);
+            destroyImage(logicalDevice, texture.image.image);
+            freeMemory(logicalDevice, texture.image.imageMemory);
+        }
+        textures.clear();
+        residentMemory = 0;
+
+        //Destroying the pool frees the command buffers of the uploads as well.
+        CommandBufferManager::destroyCommandPool(logicalDevice, cmdPool);
+        logicalDevice = VK_NULL_HANDLE;
+    }
+
+    /**
+     * @brief Loads a texture file and starts uploading the smallest mips. Cooked textures
+     *        already hold their mip chain, other image files are decoded and mipmapped here.
+     * @param filename
+     * @param format Format of the gpu image, VK_FORMAT_R8G8B8A8_UNORM or VK_FORMAT_R8G8B8A8_SRGB.
+     * @param textureId
+     * @return False if the file could not be read or the upload could not be started.
+     */
+    bool TextureStreamer::addTexture(const std::string &filename, VkFormat format, uint32_t &textureId)
+    {
+        if(CookedAssets::hasExtension(filename, COOKED_TEXTURE_EXTENSION))
+        {
+            std::vector<TextureMipLevel> mipLevels;
+            try
+            {
+                if(!CookedAssets::readTexture(FileIO::readBinaryFile(filename), mipLevels))
+                    return false;
+            }
+            catch(const std::runtime_error&)
+            {
+                std::cerr << "Failed to open cooked texture " << filename << "!" << std::endl;
+                return false;
+            }
+            return addTexture(std::move(mipLevels), format, textureId);
+        }
+
+        std::vector<unsigned char> pixels;
+        int imageWidth, imageHeight;
+        if(!FileIO::readImageFile(filename, pixels, &imageWidth, &imageHeight, nullptr, 4, nullptr))
+            return false;
+
+        std::vector<TextureMipLevel> mipLevels;
+        generateMipChain(pixels.data(), static_cast<uint32_t>(imageWidth),
+                         static_cast<uint32_t>(imageHeight), mipLevels);
+        return addTexture(std::move(mipLevels), format, textureId);
+    }
+
+    /**
+     * @brief Adds a texture from already built mip levels and starts uploading its smallest mips.
+     *        The image of the texture stays VK_NULL_HANDLE until the first upload has finished.
+     * @param mipLevels RGBA8 pixels of every mip level.
+     * @param format VK_FORMAT_R8G8B8A8_UNORM or VK_FORMAT_R8G8B8A8_SRGB.
+     * @param textureId
+     * @return False if there were no mip levels, the format or pixel sizes did not match
+     *         or the upload could not be started.
+     */
+    bool TextureStreamer::addTexture(std::vector<TextureMipLevel> &&mipLevels, VkFormat format, uint32_t &textureId)
+    {
+        if(mipLevels.empty())
+        {
+            std::cerr << "Failed to add a streamed texture without mip levels!" << std::endl;
+            return false;
+        }
+
+        //The mips are copied to the image as they are, so the format has to match their RGBA8 pixels.
+        if(format != VK_FORMAT_R8G8B8A8_UNORM && format != VK_FORMAT_R8G8B8A8_SRGB)
+        {
+            std::cerr << "Failed to add a streamed texture, only 4-byte RGBA formats are supported!" << std::endl;
+            return false;
+        }
+        for(const TextureMipLevel &level : mipLevels)
+        {
+            if(level.pixels.size() != static_cast<size_t>(level.width) * level.height * 4)
+            {
+                std::cerr << "Failed to add a streamed texture, a mip level is not RGBA8!" << std::endl;
+                return false;
+            }
+        }
+
+        StreamedTexture texture;
+        texture.mipLevels = std::move(mipLevels);
+        texture.format = format;
+        texture.residentMip = static_cast<uint32_t>(texture.mipLevels.size());
+
+        //The tail is the first mip that is small enough to stay resident for good.
+        texture.tailMip = static_cast<uint32_t>(texture.mipLevels.size()) - 1;
+        for(uint32_t i = 0; i < texture.mipLevels.size(); ++i)
+        {
+            const TextureMipLevel &level = texture.mipLevels[i];
+            if(std::max(level.width, level.height) <= SETTINGS_TEXTURE_STREAMING_TAIL_SIZE)
+            {
+                texture.tailMip = i;
+                break;
+            }
+        }
+        texture.requestedMip = texture.tailMip;
+        if(!queryMemorySizes(texture))
+            return false;
+
+        textureId = static_cast<uint32_t>(textures.size());
+        textures.push_back(std::move(texture));
+        return uploadTexture(textureId, textures[textureId].tailMip);
+    }
+
+    /**
+     * @brief Requests a texture to be sharp enough for the given on-screen size. Multiple
+     *        requests during the same frame keep the largest one.
+     * @param textureId
+     * @param screenSpaceSize Size of the textured object on the screen in pixels.
+     */
+    void TextureStreamer::requestResolution(uint32_t textureId, float screenSpaceSize)
+    {
+        if(textureId >= textures.size())
+            return;
+
+        StreamedTexture &texture = textures[textureId];
+        uint32_t mip = selectMipLevel(texture.mipLevels[0].width, texture.mipLevels[0].height,
+                                      screenSpaceSize, static_cast<uint32_t>(texture.mipLevels.size()));
+        texture.requestedMip = std::min(texture.requestedMip, std::min(mip, texture.tailMip));
+        texture.requestedScreenSize = std::max(texture.requestedScreenSize, screenSpaceSize);
+        texture.lastRequestFrame = frameIndex;
+    }
+
+    /**
+     * @brief Runs one streaming step: swaps in finished uploads, picks the mip level of every
+     *        texture so that the total fits the budget and starts the uploads for the changes.
+     *        Textures are served in order of their on-screen size, so when the budget runs out
+     *        the smallest objects lose their finest mips first.
+     * @return False if an upload could not be started.
+     */
+    bool TextureStreamer::update()
+    {
+        completeUploads();
+        releaseRetiredResources(false);
+        currentBudget = queryBudget();
+
+        //Decide which mip each texture would like to have and how important it is.
+        std::vector<uint32_t> desiredMips(textures.size());
+        std::vector<float> priorities(textures.size());
+        VkDeviceSize requiredMemory = 0;
+        for(size_t i = 0; i < textures.size(); ++i)
+        {
+            const StreamedTexture &texture = textures[i];
+            bool requestedThisFrame = texture.lastRequestFrame == frameIndex && texture.requestedScreenSize > 0.0f;
+            bool recentlyUsed = frameIndex - texture.lastRequestFrame <= SETTINGS_TEXTURE_STREAMING_RETAIN_FRAMES;
+
+            if(requestedThisFrame)
+                desiredMips[i] = texture.requestedMip;
+            else if(recentlyUsed)
+                desiredMips[i] = std::min(texture.residentMip, texture.tailMip);
+            else
+                desiredMips[i] = texture.tailMip;
+
+            priorities[i] = requestedThisFrame ? texture.requestedScreenSize : 0.0f;
+            //The tails are always resident.
+            requiredMemory += texture.mipMemorySizes[texture.tailMip];
+        }
+
+        std::vector<uint32_t> order(textures.size());
+        std::iota(order.begin(), order.end(), 0u);
+        std::stable_sort(order.begin(), order.end(),
+                         [&priorities](uint32_t a, uint32_t b){return priorities[a] > priorities[b];});
+
+        //Fit the desired mips into the budget, coarsening them when there is no room.
+        std::vector<uint32_t> targetMips(textures.size());
+        for(uint32_t textureId : order)
+        {
+            const StreamedTexture &texture = textures[textureId];
+            VkDeviceSize tailSize = texture.mipMemorySizes[texture.tailMip];
+            uint32_t mip = desiredMips[textureId];
+            while(mip < texture.tailMip &&
+                  requiredMemory - tailSize + texture.mipMemorySizes[mip] > currentBudget)
+            {
+                ++mip;
+            }
+            targetMips[textureId] = mip;
+            requiredMemory += texture.mipMemorySizes[mip] - tailSize;
+        }
+
+        //Evictions first so their memory is released before new mips arrive.
+        for(uint32_t textureId : order)
+        {
+            const StreamedTexture &texture = textures[textureId];
+            if(!texture.uploadPending && targetMips[textureId] > texture.residentMip)
+            {
+                if(!uploadTexture(textureId, targetMips[textureId]))
+                    return false;
+            }
+        }
+
+        //Then load finer mips for the most important textures within the upload limit.
+        VkDeviceSize uploadedBytes = 0;
+        for(uint32_t textureId : order)
+        {
+            const StreamedTexture &texture = textures[textureId];
+            if(texture.uploadPending || targetMips[textureId] >= texture.residentMip)
+                continue;
+
+            VkDeviceSize uploadSize = calculateUploadSize(texture, targetMips[textureId]);
+            if(uploadedBytes > 0 && uploadedBytes + uploadSize > SETTINGS_TEXTURE_STREAMING_UPLOAD_LIMIT)
+                break;
+            if(!uploadTexture(textureId, targetMips[textureId]))
+                return false;
+            uploadedBytes += uploadSize;
+        }
+
+        //Clear the requests for the next frame.
+        for(StreamedTexture &texture : textures)
+        {
+            texture.requestedMip = texture.tailMip;
+            texture.requestedScreenSize = 0.0f;
+        }
+        ++frameIndex;
+        return true;
+    }
+
+    /**
+     * @brief Creates a new image holding the mips [residentMip, end), copies the pixels into a
+     *        staging buffer and submits the copy. The image is swapped into the texture when the
+     *        upload has finished, until then the old image stays in use.
+     * @param textureId
+     * @param residentMip
+     * @return False if any of the vulkan objects could not be created.
+     */
+    bool TextureStreamer::uploadTexture(uint32_t textureId, uint32_t residentMip)
+    {
+        StreamedTexture &texture = textures[textureId];
+        const TextureMipLevel &topLevel = texture.mipLevels[residentMip];
+        uint32_t levelCount = static_cast<uint32_t>(texture.mipLevels.size()) - residentMip;
+
+        PendingUpload upload = {};
+        upload.textureId = textureId;
+        upload.residentMip = residentMip;
+
+        //Releases everything created so far when a step fails.
+        auto releaseUpload = [this, &upload]()
+        {
+            if(upload.cmdBuffer != VK_NULL_HANDLE)
+            {
+                std::vector<VkCommandBuffer> cmdBuffers = {upload.cmdBuffer};
+                CommandBufferManager::freeCommandBuffers(logicalDevice, cmdPool, cmdBuffers);
+            }
+            syncObjects->releaseFence(upload.fence);
+            destroyImageView(logicalDevice, upload.image.imageView);
+            destroyImage(logicalDevice, upload.image.image);
+            freeMemory(logicalDevice, upload.image.imageMemory);
+            destroyBuffer(logicalDevice, upload.stagingBuffer.buffer);
+            freeMemory(logicalDevice, upload.stagingMemory);
+        };
+
+        VkExtent3D extent = {topLevel.width, topLevel.height, 1};
+        if(!createImageWithImageView(logicalDevice, memoryProperties,
+                                     VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+                                     VK_IMAGE_TYPE_2D, VK_IMAGE_VIEW_TYPE_2D, texture.format, extent, 1,
+                                     VK_SAMPLE_COUNT_1_BIT, VK_IMAGE_LAYOUT_UNDEFINED, VK_SHARING_MODE_EXCLUSIVE,
+                                     levelCount, false, VK_IMAGE_ASPECT_COLOR_BIT, upload.image,
+                                     upload.image.imageMemory))
+        {
+            releaseUpload();
+            return false;
+        }
+
+        VkMemoryRequirements memReq;
+        vkGetImageMemoryRequirements(logicalDevice, upload.image.image, &memReq);
+        upload.memorySize = memReq.size;
+
+        //Copy every resident mip into one staging buffer.
+        VkDeviceSize stagingSize = calculateUploadSize(texture, residentMip);
+
+        if(!prepareStagingBuffer(logicalDevice, memoryProperties, stagingSize,
+                                 upload.stagingBuffer, upload.stagingMemory))
+        {
+            releaseUpload();
+            return false;
+        }
+
+        void *stagingPointer;
+        if(vkMapMemory(logicalDevice, upload.stagingMemory, 0, stagingSize, 0, &stagingPointer) != VK_SUCCESS)
+        {
+            std::cerr << "Failed to map texture staging memory!" << std::endl;
+            releaseUpload();
+            return false;
+        }
+
+        std::vector<VkBufferImageCopy> copyRegions;
+        VkDeviceSize offset = 0;
+        for(uint32_t level = residentMip; level < texture.mipLevels.size(); ++level)
+        {
+            const TextureMipLevel &mip = texture.mipLevels[level];
+            std::memcpy(static_cast<char*>(stagingPointer) + offset, mip.pixels.data(), mip.pixels.size());
+
+            VkBufferImageCopy region = {};
+            region.bufferOffset = offset;
+            region.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level - residentMip, 0, 1};
+            region.imageOffset = {0, 0, 0};
+            region.imageExtent = {mip.width, mip.height, 1};
+            copyRegions.push_back(region);
+            offset += mip.pixels.size();
+        }
+
+        std::vector<VkMappedMemoryRange> memoryRanges =
+                VulkanStructures::mappedMemoryRanges(upload.stagingMemory, 0, VK_WHOLE_SIZE);
+        vkFlushMappedMemoryRanges(logicalDevice, static_cast<uint32_t>(memoryRanges.size()), memoryRanges.data());
+        vkUnmapMemory(logicalDevice, upload.stagingMemory);
+
+        //Record the copy.
+        std::vector<VkCommandBuffer> cmdBuffers;
+        VkCommandBufferAllocateInfo allocInfo =
+                VulkanStructures::commandBufferAllocateInfo(VK_COMMAND_BUFFER_LEVEL_PRIMARY, cmdPool, 1);
+        if(!CommandBufferManager::allocateCommandBuffer(logicalDevice, allocInfo, cmdBuffers))
+        {
+            releaseUpload();
+            return false;
+        }
+        upload.cmdBuffer = cmdBuffers[0];
+
+        if(!CommandBufferManager::beginCommandBuffer(upload.cmdBuffer, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT))
+        {
+            releaseUpload();
+            return false;
+        }
+
+        setImageMemoryBarriers(upload.cmdBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                               {{upload.image.image, 0, VK_ACCESS_TRANSFER_WRITE_BIT,
+                                 VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                 VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, VK_IMAGE_ASPECT_COLOR_BIT}});
+
+        copyDataFromBufferToImage(upload.cmdBuffer, upload.stagingBuffer.buffer, upload.image.image,
+                                  VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, copyRegions);
+
+        setImageMemoryBarriers(upload.cmdBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                               {{upload.image.image, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
+                                 VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                                 VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, VK_IMAGE_ASPECT_COLOR_BIT}});
+
+        if(!CommandBufferManager::endCommandBuffer(upload.cmdBuffer) ||
+           !syncObjects->acquireFence(upload.fence))
+        {
+            releaseUpload();
+            return false;
+        }
+
+        VkSubmitInfo submitInfo = {};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &upload.cmdBuffer;
+        if(!submitter->submit(submitInfo, upload.fence))
+        {
+            releaseUpload();
+            return false;
+        }
+
+        texture.uploadPending = true;
+        pendingUploads.push_back(upload);
+        return true;
+    }
+
+    /**
+     * @brief Swaps in the images of finished uploads. The replaced images are kept alive until
+     *        every submission made so far, the ones that might still sample them, has finished.
+     */
+    void TextureStreamer::completeUploads()
+    {
+        for(size_t i = 0; i < pendingUploads.size();)
+        {
+            PendingUpload &upload = pendingUploads[i];
+            if(vkGetFenceStatus(logicalDevice, upload.fence) != VK_SUCCESS)
+            {
+                ++i;
+                continue;
+            }
+
+            StreamedTexture &texture = textures[upload.textureId];
+            if(texture.image.image != VK_NULL_HANDLE)
+            {
+                RetiredResources retired = {};
+                retired.lastUse = {timelineQueue, timeline->getSubmittedValue(timelineQueue)};
+                retired.image = texture.image;
+                retiredResources.push_back(retired);
+            }
+
+            residentMemory -= texture.memorySize;
+            residentMemory += upload.memorySize;
+            texture.image = upload.image;
+            texture.memorySize = upload.memorySize;
+            texture.residentMip = upload.residentMip;
+            texture.uploadPending = false;
+            ++texture.version;
+
+            //The copy is done so the staging resources can go right away.
+            std::vector<VkCommandBuffer> cmdBuffers = {upload.cmdBuffer};
+            CommandBufferManager::freeCommandBuffers(logicalDevice, cmdPool, cmdBuffers);
+            syncObjects->releaseFence(upload.fence);
+            destroyBuffer(logicalDevice, upload.stagingBuffer.buffer);
+            freeMemory(logicalDevice, upload.stagingMemory);
+
+            pendingUploads[i] = pendingUploads.back();
+            pendingUploads.pop_back();
+        }
+    }
+
+    /**
+     * @brief Destroys replaced images once the timeline has reached their last use.
+     * @param force Destroy everything regardless of the timeline, the device must be idle.
+     */
+    void TextureStreamer::releaseRetiredResources(bool force)
+    {
+        for(size_t i = 0; i < retiredResources.size();)
+        {
+            RetiredResources &retired = retiredResources[i];
+            if(!force && !timeline->isComplete(retired.lastUse))
+            {
+                ++i;
+                continue;
+            }
+
+            destroyImageView(logicalDevice, retired.image.imageView);
+            destroyImage(logicalDevice, retired.image.image);
+            freeMemory(logicalDevice, retired.image.imageMemory);
+
+            retiredResources[i] = retiredResources.back();
+            retiredResources.pop_back();
+        }
+    }
+
+    /**
+     * @brief Queries the device memory of an image for every resident mip range of a texture.
+     *        The budget is charged with these sizes, the same ones residentMemory is counted in,
+     *        instead of the pixel bytes that ignore alignment and tiling padding.
+     * @param texture
+     * @return False if an image could not be created.
+     */
+    bool TextureStreamer::queryMemorySizes(StreamedTexture &texture) const
+    {
+        texture.mipMemorySizes.assign(texture.mipLevels.size(), 0);
+        for(uint32_t residentMip = 0; residentMip < texture.mipLevels.size(); ++residentMip)
+        {
+            const TextureMipLevel &topLevel = texture.mipLevels[residentMip];
+            uint32_t levelCount = static_cast<uint32_t>(texture.mipLevels.size()) - residentMip;
+            VkImageCreateInfo imageInfo =
+                    VulkanStructures::imageCreateInfo(VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+                                                      VK_IMAGE_TYPE_2D, texture.format,
+                                                      {topLevel.width, topLevel.height, 1}, 1, VK_SAMPLE_COUNT_1_BIT,
+                                                      VK_IMAGE_LAYOUT_UNDEFINED, VK_SHARING_MODE_EXCLUSIVE,
+                                                      levelCount, false);
+            VkImage image = VK_NULL_HANDLE;
+            if(!createImage(logicalDevice, imageInfo, image))
+                return false;
+
+            VkMemoryRequirements memReq;
+            vkGetImageMemoryRequirements(logicalDevice, image, &memReq);
+            texture.mipMemorySizes[residentMip] = memReq.size;
+            destroyImage(logicalDevice, image);
+        }
+        return true;
+    }
+
+    /**
+     * @brief Returns the bytes of pixels in the mips [residentMip, end).
+     * @param texture
+     * @param residentMip
+     * @return Size in bytes.
+     */
+    VkDeviceSize TextureStreamer::calculateUploadSize(const StreamedTexture &texture, uint32_t residentMip) const
+    {
+        VkDeviceSize size = 0;
+        for(uint32_t level = residentMip; level < texture.mipLevels.size(); ++level)
+            size += texture.mipLevels[level].pixels.size();
+        return size;
+    }
+
+    /**
+     * @brief Returns the memory budget for this frame. With VK_EXT_memory_budget the configured
+     *        budget is lowered to what the device local heaps can still give to this process,
+     *        counting the memory the streamer already holds as available to itself.
+     * @return Budget in bytes.
+     */
+    VkDeviceSize TextureStreamer::queryBudget() const
+    {
+        if(!memoryBudgetExtensionEnabled)
+            return memoryBudget;
+
+        VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties = {};
+        budgetProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+        budgetProperties.pNext = nullptr;
+
+        VkPhysicalDeviceMemoryProperties2KHR properties = {};
+        properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2_KHR;
+        properties.pNext = &budgetProperties;
+        vkGetPhysicalDeviceMemoryProperties2KHR(physicalDevice, &properties);
+
+        VkDeviceSize available = residentMemory;
+        for(uint32_t i = 0; i < properties.memoryProperties.memoryHeapCount; ++i)
+        {
+            if(!(properties.memoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT))
+                continue;
+            if(budgetProperties.heapBudget[i] > budgetProperties.heapUsage[i])
+                available += budgetProperties.heapBudget[i] - budgetProperties.heapUsage[i];
+        }
+        return std::min(memoryBudget, available);
+    }
+
+    /**
+     * @brief Returns the height in pixels a bounding sphere covers on the screen.
+     * @param center World space center of the sphere.
+     * @param radius
+     * @param viewMatrix
+     * @param projectionMatrix
+     * @param viewportHeight
+     * @return The projected diameter, or the viewport height if the camera is inside the sphere.
+     */
+    float TextureStreamer::calculateScreenSpaceSize(const glm::vec3 &center, float radius,
+                                                    const glm::mat4 &viewMatrix,
+                                                    const glm::mat4 &projectionMatrix,
+                                                    float viewportHeight)
+    {
+        glm::vec4 viewPosition = viewMatrix * glm::vec4(center, 1.0f);
+        //The camera looks down the negative z-axis.
+        float depth = -viewPosition.z;
+        if(depth <= radius)
+            return viewportHeight;
+
+        //Same projection as the level of detail selection of GraphicsObject.
+        float size = 2.0f * radius * FrustumCuller::calculatePixelsPerUnit(projectionMatrix, viewportHeight, depth);
+        return std::min(size, viewportHeight);
+    }
+
+    /**
+     * @brief Returns the finest mip level worth sampling when the texture covers
+     *        screenSpaceSize pixels. Finer levels would only be minified away.
+     * @param width
+     * @param height
+     * @param screenSpaceSize
+     * @param mipLevelCount
+     * @return The mip level.
+     */
+    uint32_t TextureStreamer::selectMipLevel(uint32_t width, uint32_t height,
+                                             float screenSpaceSize, uint32_t mipLevelCount)
+    {
+        if(mipLevelCount == 0)
+            return 0;
+        if(screenSpaceSize < 1.0f)
+            return mipLevelCount - 1;
+
+        float ratio = static_cast<float>(std::max(width, height)) / screenSpaceSize;
+        if(ratio <= 1.0f)
+            return 0;
+
+        uint32_t level = static_cast<uint32_t>(std::floor(std::log2(ratio)));
+        return std::min(level, mipLevelCount - 1);
+    }
+}
@@ -0,0 +1,144 @@
+#include "ThreadPool.h"
+#include <algorithm>
+#include <iostream>
+#include <system_error>
+
+namespace Raven
+{
+    ThreadPool::ThreadPool()
+    {
+
+    }
+
+    ThreadPool::~ThreadPool()
+    {
+        destroy();
+    }
+
+    /**
+     * @brief Starts the worker threads.
+     * @param workerCount Number of workers, 0 uses the hardware concurrency minus the calling thread.
+     * @return False if the threads could not be started.
+     */
+    bool ThreadPool::initialize(uint32_t workerCount)
+    {
+        destroy();
+        if(workerCount == 0)
+        {
+            uint32_t hardwareThreads = std::thread::hardware_concurrency();
+            workerCount = hardwareThreads > 1 ? hardwareThreads - 1 : 0;
+        }
+
+        stopping = false;
+        try
+        {
+            for(uint32_t i = 0; i < workerCount; ++i)
+                workers.emplace_back(&ThreadPool::workerLoop, this);
+        }
+        catch(const std::system_error&)
+        {
+            std::cerr << "Failed to start thread pool workers!" << std::endl;
+            destroy();
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Wakes every worker up and waits for them to exit.
+     */
+    void ThreadPool::destroy()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wakeCondition.notify_all();
+        for(std::thread &worker : workers)
+            worker.join();
+        workers.clear();
+    }
+
+    /**
+     * @brief Splits [0, count) into chunks and runs them in parallel. The calling thread
+     *        works on the chunks too, so small jobs that fit into a single chunk never
+     *        wake the workers up.
+     * @param count
+     * @param chunkSize Number of items per call of the function.
+     * @param function Called with the half-open range [begin, end) of a chunk.
+     */
+    void ThreadPool::parallelFor(size_t count, size_t chunkSize,
+                                 const std::function<void(size_t, size_t)> &function)
+    {
+        if(count == 0)
+            return;
+        chunkSize = std::max<size_t>(chunkSize, 1);
+        size_t chunkCount = (count + chunkSize - 1) / chunkSize;
+        if(workers.empty() || chunkCount == 1)
+        {
+            for(size_t begin = 0; begin < count; begin += chunkSize)
+                function(begin, std::min(begin + chunkSize, count));
+            return;
+        }
+
+        std::lock_guard<std::mutex> jobLock(jobMutex);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            jobFunction = &function;
+            jobCount = count;
+            jobChunkSize = chunkSize;
+            jobChunkCount = chunkCount;
+            nextChunk = 0;
+            finishedChunks = 0;
+            ++jobGeneration;
+        }
+        wakeCondition.notify_all();
+
+        runChunks();
+
+        //Workers that joined the job have to leave it before the function goes out of scope.
+        std::unique_lock<std::mutex> lock(mutex);
+        doneCondition.wait(lock, [this]()
+        {
+            return finishedChunks == jobChunkCount && activeWorkers == 0;
+        });
+        jobFunction = nullptr;
+    }
+
+    void ThreadPool::workerLoop()
+    {
+        uint64_t seenGeneration = 0;
+        std::unique_lock<std::mutex> lock(mutex);
+        while(true)
+        {
+            wakeCondition.wait(lock, [this, &seenGeneration]()
+            {
+                return stopping || jobGeneration != seenGeneration;
+            });
+            if(stopping)
+                return;
+            seenGeneration = jobGeneration;
+            if(jobFunction == nullptr)
+                continue;
+
+            ++activeWorkers;
+            lock.unlock();
+            runChunks();
+            lock.lock();
+            --activeWorkers;
+            if(activeWorkers == 0)
+                doneCondition.notify_all();
+        }
+    }
+
+    void ThreadPool::runChunks()
+    {
+        size_t chunk;
+        while((chunk = nextChunk.fetch_add(1)) < jobChunkCount)
+        {
+            size_t begin = chunk * jobChunkSize;
+            (*jobFunction)(begin, std::min(begin + jobChunkSize, jobCount));
+            finishedChunks.fetch_add(1);
+        }
+    }
+}
@@ -0,0 +1,185 @@
+#include "UniformRing.h"
+#include "VulkanUtility.h"
+#include "VulkanStructures.h"
+#include <algorithm>
+#include <cstring>
+
+namespace Raven
+{
+    UniformRing::UniformRing()
+    {
+
+    }
+
+    UniformRing::~UniformRing()
+    {
+        destroy();
+    }
+
+    /**
+     * @brief Creates and maps the ring buffer. Coherent memory is preferred, any host visible
+     *        memory is used otherwise and flushed explicitly.
+     * @param logicalDevice
+     * @param memoryProperties
+     * @param limits Limits of the physical device, for the offset alignment and atom size.
+     * @param frameSize Bytes of uniform data a frame can write.
+     * @param frameCount Has to be larger than the number of frames in flight.
+     * @param blockRange Size of the largest block a draw reads, e.g. the shader's uniform block.
+     * @return False if the buffer could not be created or mapped.
+     */
+    bool UniformRing::initialize(VkDevice logicalDevice, const VkPhysicalDeviceMemoryProperties &memoryProperties,
+                                 const VkPhysicalDeviceLimits &limits, VkDeviceSize frameSize, uint32_t frameCount,
+                                 VkDeviceSize blockRange)
+    {
+        destroy();
+        if(frameCount == 0 || blockRange == 0 || blockRange > frameSize ||
+           blockRange > limits.maxUniformBufferRange)
+        {
+            std::cerr << "Failed to create uniform ring with a block larger than a frame or a uniform buffer!" << std::endl;
+            return false;
+        }
+        this->logicalDevice = logicalDevice;
+        this->frameCount = frameCount;
+        this->blockRange = blockRange;
+
+        //Offsets are aligned to whole atoms even with coherent memory, so that the choice
+        //of memory does not change the layout of the buffer.
+        alignment = std::max<VkDeviceSize>(std::max<VkDeviceSize>(limits.minUniformBufferOffsetAlignment,
+                                                                  limits.nonCoherentAtomSize), 1);
+        atomSize = std::max<VkDeviceSize>(limits.nonCoherentAtomSize, 1);
+        frameStride = alignUp(frameSize, alignment);
+        //Dynamic offsets are 32 bit.
+        if(frameStride * frameCount > UINT32_MAX)
+        {
+            std::cerr << "Failed to create uniform ring larger than dynamic offsets can address!" << std::endl;
+            destroy();
+            return false;
+        }
+
+        buffer.size = frameStride * frameCount;
+        buffer.usageFlags = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
+        VkBufferCreateInfo bufferInfo = VulkanStructures::bufferCreateInfo(buffer.size, buffer.usageFlags,
+                                                                           VK_SHARING_MODE_EXCLUSIVE);
+        if(!createBuffer(logicalDevice, bufferInfo, buffer.buffer))
+        {
+            destroy();
+            return false;
+        }
+
+        VkMemoryRequirements memReq;
+        vkGetBufferMemoryRequirements(logicalDevice, buffer.buffer, &memReq);
+        VkMemoryPropertyFlags coherentFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+        coherent = false;
+        for(uint32_t type = 0; type < memoryProperties.memoryTypeCount && !coherent; ++type)
+        {
+            coherent = (memReq.memoryTypeBits & (1u << type)) &&
+                       (memoryProperties.memoryTypes[type].propertyFlags & coherentFlags) == coherentFlags;
+        }
+        if(!allocateMemory(logicalDevice, memoryProperties, memReq,
+                           coherent ? coherentFlags : static_cast<VkMemoryPropertyFlags>(VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT),
+                           memory) ||
+           !buffer.bindMemoryObject(logicalDevice, memory))
+        {
+            destroy();
+            return false;
+        }
+
+        void *data;
+        if(vkMapMemory(logicalDevice, memory, 0, VK_WHOLE_SIZE, 0, &data) != VK_SUCCESS)
+        {
+            std::cerr << "Failed to map uniform ring memory!" << std::endl;
+            destroy();
+            return false;
+        }
+        buffer.data = data;
+        mapped = static_cast<uint8_t*>(data);
+        beginFrame(0);
+        return true;
+    }
+
+    void UniformRing::destroy()
+    {
+        if(logicalDevice == VK_NULL_HANDLE)
+            return;
+        if(mapped != nullptr)
+            vkUnmapMemory(logicalDevice, memory);
+        destroyBuffer(logicalDevice, buffer.buffer);
+        freeMemory(logicalDevice, memory);
+        buffer = VulkanBuffer();
+        mapped = nullptr;
+        frameCount = 0;
+        frameStride = 0;
+        frameStart = 0;
+        head = 0;
+        flushed = 0;
+        logicalDevice = VK_NULL_HANDLE;
+    }
+
+    /**
+     * @brief Moves to the region of the frame. The frame that wrote it frameCount frames ago
+     *        must have finished on the gpu.
+     * @param frame
+     */
+    void UniformRing::beginFrame(uint64_t frame)
+    {
+        frameStart = (frame % frameCount) * frameStride;
+        head = 0;
+        flushed = 0;
+    }
+
+    /**
+     * @brief Copies a block into the frame's region at the next aligned offset.
+     * @param data
+     * @param size At most the block range.
+     * @param dynamicOffset Offset of the block in the buffer, for bindDescriptorSets.
+     * @return False if the block is too large or the region is full.
+     */
+    bool UniformRing::write(const void *data, VkDeviceSize size, uint32_t &dynamicOffset)
+    {
+        if(size > blockRange)
+        {
+            std::cerr << "Failed to write uniform block larger than the block range of the uniform ring!" << std::endl;
+            return false;
+        }
+        VkDeviceSize offset = alignUp(head, alignment);
+        //The descriptor always covers blockRange bytes, which have to stay inside the region.
+        if(offset + blockRange > frameStride)
+        {
+            std::cerr << "Failed to write uniform block, the frame's region of the uniform ring is full!" << std::endl;
+            return false;
+        }
+        std::memcpy(mapped + frameStart + offset, data, static_cast<size_t>(size));
+        head = offset + size;
+        dynamicOffset = static_cast<uint32_t>(frameStart + offset);
+        return true;
+    }
+
+    /**
+     * @brief Flushes the blocks written since the last flush, rounded out to whole atoms.
+     * @return False if the memory could not be flushed.
+     */
+    bool UniformRing::flush()
+    {
+        if(coherent || head == flushed)
+            return true;
+
+        VkMappedMemoryRange range = {};
+        range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+        range.pNext = nullptr;
+        range.memory = memory;
+        range.offset = frameStart + flushed / atomSize * atomSize;
+        range.size = frameStart + alignUp(head, atomSize) - range.offset;
+        if(vkFlushMappedMemoryRanges(logicalDevice, 1, &range) != VK_SUCCESS)
+        {
+            std::cerr << "Failed to flush uniform ring memory!" << std::endl;
+            return false;
+        }
+        flushed = head;
+        return true;
+    }
+
+    BufferDescriptorInfo UniformRing::getDescriptorInfo(VkDescriptorSet descriptorSet, uint32_t binding) const
+    {
+        return {descriptorSet, binding, 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, {{buffer.buffer, 0, blockRange}}};
+    }
+}
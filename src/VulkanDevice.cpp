@@ -5,6 +5,7 @@
 #include "CommandBufferManager.h"
 #include "VulkanDescriptorManager.h"
 #include "FileIO.h"
+#include <cstring>
 
 namespace Raven
 {
@@ -26,6 +27,8 @@ namespace Raven
         //logical device was created.
         if(logicalDevice != VK_NULL_HANDLE)
         {
+            timeline.destroy();
+            syncObjects.destroy();
             vkDestroyDevice(logicalDevice, nullptr);
             logicalDevice = VK_NULL_HANDLE;
         }
@@ -54,22 +57,25 @@ namespace Raven
         if(!initializeQueues(queueFamilyInfo))
             return false;
 
-        //Create a new queue create info -structure for each queue in the chosen family.
-        VulkanQueueInfo chosenQueueFamily = queueFamilyInfo[primaryQueueFamilyIndex];
-        VkDeviceQueueCreateInfo queueInfo = {};
-        queueInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
-        queueInfo.flags = 0;
-        queueInfo.pNext = nullptr;
-        queueInfo.pQueuePriorities = chosenQueueFamily.priorities.data();
-        queueInfo.queueFamilyIndex = chosenQueueFamily.queueFamilyIndex;
-        queueInfo.queueCount = static_cast<uint32_t>(chosenQueueFamily.priorities.size());
+        //Create a new queue create info -structure for each chosen family.
+        std::vector<VkDeviceQueueCreateInfo> queueInfos;
+        for(const VulkanQueueInfo &family : queueFamilyInfo)
+        {
+            VkDeviceQueueCreateInfo queueInfo = {};
+            queueInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+            queueInfo.flags = 0;
+            queueInfo.pNext = nullptr;
+            queueInfo.pQueuePriorities = family.priorities.data();
+            queueInfo.queueFamilyIndex = family.queueFamilyIndex;
+            queueInfo.queueCount = static_cast<uint32_t>(family.priorities.size());
+            queueInfos.push_back(queueInfo);
+        }
 
         //Get the device features and properties. Note that features must be implicitly enabled,
         //while creating the logical device, they are not enabled by default.
         VkPhysicalDeviceFeatures features;
-        //Physical device properties variable won't be used at this point.
-        VkPhysicalDeviceProperties properties;
-        getPhysicalDeviceFeaturesAndProperties(physicalDevice, features, properties);
+        //The properties are kept for their limits, e.g. uniform buffer offset alignment.
+        getPhysicalDeviceFeaturesAndProperties(physicalDevice, features, physicalDeviceProperties);
 
         //Build the device create info
         VkDeviceCreateInfo createInfo = VulkanStructures::deviceCreateInfo();
@@ -81,11 +87,30 @@ namespace Raven
         //Enable all features the graphics card supports for now. This is not ideal for optimization.
         createInfo.pEnabledFeatures = &features;
         //Device queues are created when the logical device is created.
-        createInfo.queueCreateInfoCount = 1;
-        createInfo.pQueueCreateInfos = &queueInfo;
+        createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueInfos.size());
+        createInfo.pQueueCreateInfos = queueInfos.data();
+
+        //Timeline semaphores are a feature on top of the extension, enabled when both are there.
+        VkPhysicalDeviceTimelineSemaphoreFeaturesKHR timelineFeatures = {};
+        timelineFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES_KHR;
+        timelineFeatures.pNext = nullptr;
+        bool timelineExtension = false;
+        for(const char *extension : desiredDeviceExtensions)
+            timelineExtension = timelineExtension || std::strcmp(extension, VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME) == 0;
+        if(timelineExtension && vkGetPhysicalDeviceFeatures2KHR != nullptr)
+        {
+            VkPhysicalDeviceFeatures2KHR features2 = {};
+            features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2_KHR;
+            features2.pNext = &timelineFeatures;
+            vkGetPhysicalDeviceFeatures2KHR(physicalDevice, &features2);
+        }
+        if(timelineFeatures.timelineSemaphore == VK_TRUE)
+            createInfo.pNext = &timelineFeatures;
 
         if(!createLogicalDevice(physicalDevice, createInfo, logicalDevice))
             return false;
+        enabledExtensions.assign(desiredDeviceExtensions.begin(), desiredDeviceExtensions.end());
+        enabledFeatures = features;
 
         //Now that we have a logical device, we should load the device level functions.
         //The logical device will be responsible for performing most of the vulkan application's
@@ -95,25 +120,68 @@ namespace Raven
 
         //After device level functions have been loaded, save the logical device queue handles so
         //that the vulkan device can actually be used to submit commands into the graphics card.
-        getQueueFamilyQueues(logicalDevice, chosenQueueFamily.queueFamilyIndex,
-                             static_cast<uint32_t>(chosenQueueFamily.priorities.size()),
-                             deviceQueueHandles);
-        if(deviceQueueHandles.size() < chosenQueueFamily.priorities.size())
+        //Every type of work goes to the first queue of its family.
+        deviceQueueHandles.clear();
+        std::array<QueueRoute, QUEUE_TYPE_COUNT> routes = {};
+        for(const VulkanQueueInfo &family : queueFamilyInfo)
+        {
+            uint32_t firstQueue = static_cast<uint32_t>(deviceQueueHandles.size());
+            getQueueFamilyQueues(logicalDevice, family.queueFamilyIndex,
+                                 static_cast<uint32_t>(family.priorities.size()), deviceQueueHandles);
+            if(deviceQueueHandles.size() < firstQueue + family.priorities.size())
+            {
+                std::cerr << "Failed to store logical device queue handles!" << std::endl;
+                return false;
+            }
+            for(uint32_t type = 0; type < QUEUE_TYPE_COUNT; ++type)
+            {
+                if(queueTypeFamilies[type] == family.queueFamilyIndex)
+                    routes[type] = {firstQueue, family.queueFamilyIndex, nullptr};
+            }
+        }
+
+        queueSubmitters.clear();
+        for(VkQueue queue : deviceQueueHandles)
+        {
+            queueSubmitters.emplace_back();
+            queueSubmitters.back().initialize(queue);
+        }
+        for(QueueRoute &route : routes)
+            route.submitter = &queueSubmitters[route.queue];
+        scheduler.initialize(&timeline, routes);
+
+        syncObjects.initialize(logicalDevice);
+        if(!timeline.initialize(logicalDevice, static_cast<uint32_t>(deviceQueueHandles.size()),
+                                timelineFeatures.timelineSemaphore == VK_TRUE, &syncObjects))
         {
-            std::cerr << "Failed to store logical device queue handles!" << std::endl;
             return false;
         }
 
         return true;
     }
 
+    /**
+     * @brief Checks if an extension was enabled when the logical device was created.
+     * @param extension
+     * @return True if the extension is enabled.
+     */
+    bool VulkanDevice::isExtensionEnabled(const char *extension) const
+    {
+        for(auto &enabledExtension : enabledExtensions)
+        {
+            if(enabledExtension == extension)
+                return true;
+        }
+        return false;
+    }
+
     //Sends commands to the gpu for computing. This function also chooses the
     //queue which the commands will be submitted to.
     bool VulkanDevice::executeCommands(VkSubmitInfo &submitInfo, VkFence &submitFence)
     {
         //Submit:
-        VkQueue selectedQueue = deviceQueueHandles[0];
-        if(!CommandBufferManager::submitCommandBuffers(selectedQueue, 1, submitInfo, submitFence))
+        QueueSubmitter &selectedQueue = queueSubmitters[0];
+        if(!selectedQueue.submit(submitInfo, submitFence))
         {
             return false;
         }
@@ -825,32 +893,43 @@ namespace Raven
      * @param graphicsPipeline
      * @param firstVertexBufferBinding
      * @param bufferParams
+     * @param indexBuffer 32-bit indices of the drawable's mesh, VK_NULL_HANDLE if the mesh has none.
      * @param pipelineLayout
      * @param descriptorSets
      * @param firstDescritorSetIndex
+     * @param dynamicOffsets Offsets of the dynamic buffers in the sets, e.g. the draw's block in a UniformRing.
+     * @param drawParameterBinding Decides whether the draw parameters are pushed or read from the ring.
+     * @param drawParameters
      * @param drawable
      * @param instances
-     * @param firstInstance
+     * @param firstInstance First instance index, e.g. the drawable's scene node handle
+     *        when the scene instance buffer is bound as a per-instance vertex buffer.
+     * @param visibleParts Optional indices of the parts that passed culling, all parts are drawn without it.
      * @return False if any of the operations fails.
      */
-    bool recordCommandBufferForDrawingGeometry(VkCommandBuffer cmdBuffer,
-                                               VkImage swapchainImage,
-                                               uint32_t presentQueueFamilyIndex,
-                                               uint32_t graphicsQueueFamilyIndex,
-                                               VulkanRenderer vulkanRenderer,
-                                               VkRenderPass renderPass,
-                                               VkFramebuffer framebuffer,
-                                               VkExtent2D framebufferSize,
-                                               const std::vector<VkClearValue> &clearValues,
-                                               VkPipeline graphicsPipeline,
-                                               uint32_t firstVertexBufferBinding,
-                                               const std::vector<VertexBufferParameters> &bufferParams,
-                                               VkPipelineLayout pipelineLayout,
-                                               const std::vector<VkDescriptorSet> &descriptorSets,
-                                               uint32_t firstDescritorSetIndex,
-                                               GraphicsObject drawable,
-                                               uint32_t instances,
-                                               uint32_t firstInstance)
+    bool VulkanDevice::recordCommandBufferForDrawingGeometry(VkCommandBuffer cmdBuffer,
+                                                             VkImage swapchainImage,
+                                                             uint32_t presentQueueFamilyIndex,
+                                                             uint32_t graphicsQueueFamilyIndex,
+                                                             VulkanRenderer &vulkanRenderer,
+                                                             VkRenderPass renderPass,
+                                                             VkFramebuffer framebuffer,
+                                                             VkExtent2D framebufferSize,
+                                                             const std::vector<VkClearValue> &clearValues,
+                                                             VkPipeline graphicsPipeline,
+                                                             uint32_t firstVertexBufferBinding,
+                                                             const std::vector<VertexBufferParameters> &bufferParams,
+                                                             VkBuffer indexBuffer,
+                                                             VkPipelineLayout pipelineLayout,
+                                                             const std::vector<VkDescriptorSet> &descriptorSets,
+                                                             uint32_t firstDescritorSetIndex,
+                                                             const std::vector<uint32_t> &dynamicOffsets,
+                                                             const DrawParameterBinding &drawParameterBinding,
+                                                             const DrawParameters &drawParameters,
+                                                             const GraphicsObject &drawable,
+                                                             uint32_t instances,
+                                                             uint32_t firstInstance,
+                                                             const std::vector<uint32_t> *visibleParts)
     {
 
         //First begin the command buffer.
@@ -923,20 +1002,33 @@ namespace Raven
         //Bind the vertex buffer.
         bindVertexBuffers(cmdBuffer, firstVertexBufferBinding, bufferParams);
 
+        //Indexed meshes draw through their index buffer.
+        bool indexed = !drawable.getMesh()->indices.empty();
+        if(indexed)
+        {
+            if(indexBuffer == VK_NULL_HANDLE)
+            {
+                std::cerr << "Failed to record drawing an indexed mesh without an index buffer!" << std::endl;
+                return false;
+            }
+            vkCmdBindIndexBuffer(cmdBuffer, indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+        }
+
+        //Small per-draw parameters are pushed, larger ones add a dynamic offset into the ring.
+        std::vector<uint32_t> drawDynamicOffsets = dynamicOffsets;
+        if(!drawParameterBinding.record(cmdBuffer, pipelineLayout, drawParameters, drawDynamicOffsets))
+            return false;
+
         //Bind descriptor sets so that the data can be used in the shaders.
         if(descriptorSets.size() > 0)
         {
             VulkanDescriptorManager::bindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
                                                         pipelineLayout, firstDescritorSetIndex,
-                                                        descriptorSets, {});
+                                                        descriptorSets, drawDynamicOffsets);
         }
 
         //Draw.
-        for(size_t i = 0; i < drawable.getMesh()->parts.size(); ++i)
-        {
-            vkCmdDraw(cmdBuffer, drawable.getMesh()->parts[i].vertexCount, instances,
-                      drawable.getMesh()->parts[i].vertexOffset, firstInstance);
-        }
+        drawable.recordDraws(cmdBuffer, instances, firstInstance, visibleParts);
 
         //End the render pass.
         vulkanRenderer.endRenderPass(cmdBuffer);
@@ -977,25 +1069,32 @@ namespace Raven
         if(!getPhysicalDeviceQueuesWithProperties(physicalDevice, queueFamilies))
             return false;
 
-        //Find a queue family that suits our needs.
-        if(!getQueueFamilyIndex(queueFamilies,
-                                VK_QUEUE_GRAPHICS_BIT |
-                                VK_QUEUE_COMPUTE_BIT  |
-                                VK_QUEUE_TRANSFER_BIT |
-                                VK_QUEUE_SPARSE_BINDING_BIT,
-                                primaryQueueFamilyIndex))
+        //Find the queue families for graphics, async compute and transfers.
+        if(!QueueScheduler::selectQueueFamilies(queueFamilies, queueTypeFamilies))
             return false;
+        primaryQueueFamilyIndex = queueTypeFamilies[QUEUE_TYPE_GRAPHICS];
 
-        //Store the chosen queue family information into a vector.
-        VulkanQueueInfo  newFamily;
-        newFamily.queueFamilyIndex = primaryQueueFamilyIndex;
-        //Track all queues in the family.
-        for(int i = 0; i < queueFamilies[primaryQueueFamilyIndex].queueCount; i++)
+        //Store the chosen queue family information into a vector, every family once.
+        for(uint32_t type = 0; type < QUEUE_TYPE_COUNT; ++type)
         {
-            //Every queue is as valuable.
-            newFamily.priorities.push_back(1.0f);
+            uint32_t familyIndex = queueTypeFamilies[type];
+            bool stored = false;
+            for(const VulkanQueueInfo &family : familyInfo)
+                stored = stored || family.queueFamilyIndex == familyIndex;
+            if(stored)
+                continue;
+
+            VulkanQueueInfo newFamily;
+            newFamily.queueFamilyIndex = familyIndex;
+            //Track all queues in the primary family, the others only need the queue of their type.
+            uint32_t queueCount = type == QUEUE_TYPE_GRAPHICS ? queueFamilies[familyIndex].queueCount : 1;
+            for(uint32_t i = 0; i < queueCount; i++)
+            {
+                //Every queue is as valuable.
+                newFamily.priorities.push_back(1.0f);
+            }
+            familyInfo.push_back(newFamily);
         }
-        familyInfo.push_back(newFamily);
 
         return true;
     }
@@ -1,6 +1,5 @@
 #include "VulkanPipeline.h"
 #include "VulkanStructures.h"
-#include "FileIO.h"
 #include "VulkanUtility.h"
 
 namespace Raven
@@ -63,28 +62,17 @@ namespace Raven
 									VkPipelineCache pipelineCache,
 									std::vector<VkPipeline> &graphicsPipelines) noexcept
     {
-        //Read the vertex shader info.
-        std::vector<char> vertexShaderSourceCode =
-                FileIO::readBinaryFile(vertexShaderFilename);
-
-        if(vertexShaderSourceCode.empty())
-            return false;
-
-        //Create a vertex shader module.
+        //Create the vertex and fragment shader modules.
         VkShaderModule vertexShaderModule;
-        if(!createShaderModule(logicalDevice, vertexShaderSourceCode, vertexShaderModule))
-            return false;
-
-        //Read the fragment shader information and create a shader module as well.
-        std::vector<char> fragmentShaderSourceCode =
-                FileIO::readBinaryFile(fragmentShaderFilename);
-
-        if(fragmentShaderSourceCode.empty())
+        if(!loadShaderModule(logicalDevice, vertexShaderFilename, vertexShaderModule))
             return false;
 
         VkShaderModule fragmentShaderModule;
-        if(!createShaderModule(logicalDevice, fragmentShaderSourceCode, fragmentShaderModule))
+        if(!loadShaderModule(logicalDevice, fragmentShaderFilename, fragmentShaderModule))
+        {
+            destroyShaderModule(logicalDevice, vertexShaderModule);
             return false;
+        }
 
 
 
@@ -512,8 +512,10 @@ namespace Raven
             waitSemaphoreStages.emplace_back(waitSemaphoreInfo.waitingStage);
         }
 
-        VkSubmitInfo submitInfo = VulkanStructures::submitInfo({cmdBuffer}, waitSemaphores, waitSemaphoreStages,
-                                                               {readyToPresentSemaphore});
+        std::vector<VkCommandBuffer> cmdBuffers = {cmdBuffer};
+        std::vector<VkSemaphore> signalSemaphores = {readyToPresentSemaphore};
+        VkSubmitInfo submitInfo = VulkanStructures::submitInfo(cmdBuffers, waitSemaphores, waitSemaphoreStages,
+                                                               signalSemaphores);
 
         //Submit the task for the graphics device.
         if(!CommandBufferManager::submitCommandBuffers(graphicsQueue, 1, submitInfo, finishedDrawingFence))
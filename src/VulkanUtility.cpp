@@ -1,6 +1,8 @@
 #include "VulkanUtility.h"
 #include "VulkanStructures.h"
 #include "CommandBufferManager.h"
+#include "BarrierBatch.h"
+#include "FileIO.h"
 
 //All vulkan utility functions will be implemented here.
 namespace Raven
@@ -36,6 +38,37 @@ namespace Raven
         return true;
     }
 
+    /**
+     * @brief Checks all extensions a physical device supports and adds them into a vector.
+     * @param physicalDevice
+     * @param availableExtensions
+     * @return False if the extensions could not be enumerated.
+     */
+    bool checkAvailableDeviceExtensions(VkPhysicalDevice &physicalDevice,
+                                        std::vector<VkExtensionProperties> &availableExtensions)
+    {
+        uint32_t extensionCount = 0;
+        VkResult result = vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr);
+        if(result != VK_SUCCESS)
+        {
+            std::cerr << "Failed to load device extensions!" << std::endl;
+            return false;
+        }
+
+        availableExtensions.resize(extensionCount);
+        if(extensionCount == 0)
+            return true;
+
+        result = vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount,
+                                                      availableExtensions.data());
+        if(result != VK_SUCCESS)
+        {
+            std::cerr << "Failed to enumerate device extensions!" << std::endl;
+            return false;
+        }
+        return true;
+    }
+
     /**
      * @brief Creates a new vulkan instance.
      * @param desiredExtensions
@@ -760,29 +793,12 @@ namespace Raven
     void setBufferMemoryBarriers(VkCommandBuffer commandBuffer,
                                  const VkPipelineStageFlags generatingStages,
                                  const VkPipelineStageFlags consumingStages,
-                                 std::vector<BufferTransition> bufferTransitions) noexcept
+                                 const std::vector<BufferTransition> &bufferTransitions) noexcept
     {
-        //Create a vector for the buffer memory barriers.
-        std::vector<VkBufferMemoryBarrier> barriers;
-        for(auto& bufferTransition : bufferTransitions)
-        {
-            //Set a barrier for each buffer.
-            barriers.push_back(VulkanStructures::bufferMemoryBarrier(bufferTransition.currentAccess,
-                                                                     bufferTransition.newAccess,
-                                                                     bufferTransition.currentQueueFamily,
-                                                                     bufferTransition.newQueueFamily,
-                                                                     bufferTransition.buffer,
-                                                                     0,
-                                                                     VK_WHOLE_SIZE));
-        }
-
-        //Set the barriers.
-        if(barriers.size() > 0)
-        {
-            vkCmdPipelineBarrier(commandBuffer, generatingStages, consumingStages, 0, 0,
-                                 nullptr, static_cast<uint32_t>(barriers.size()),
-                                 barriers.data(),0, nullptr);
-        }
+        //The batch records all of them in a single barrier when it goes out of scope.
+        BarrierBatch barriers(commandBuffer);
+        for(const BufferTransition &bufferTransition : bufferTransitions)
+            barriers.addBuffer(generatingStages, consumingStages, bufferTransition);
     }
 
     /**
@@ -799,35 +815,11 @@ namespace Raven
     void setImageMemoryBarriers(VkCommandBuffer commandBuffer,
                                 const VkPipelineStageFlags generatingStages,
                                 const VkPipelineStageFlags consumingStages,
-                                std::vector<ImageTransition> imageTransitions) noexcept
+                                const std::vector<ImageTransition> &imageTransitions) noexcept
     {
-        //Create a vector for the image memory barriers.
-        std::vector<VkImageMemoryBarrier> barriers;
-        for(auto& imageTransition : imageTransitions)
-        {
-            barriers.push_back(VulkanStructures::imageMemoryBarrier(imageTransition.image,
-                                                                    imageTransition.currentAccess,
-                                                                    imageTransition.newAccess,
-                                                                    imageTransition.currentQueueFamily,
-                                                                    imageTransition.newQueueFamily,
-                                                                    imageTransition.currentLayout,
-                                                                    imageTransition.newLayout,
-                                                                    {
-                                                                        imageTransition.aspect,
-                                                                        0,
-                                                                        VK_REMAINING_MIP_LEVELS,
-                                                                        0,
-                                                                        VK_REMAINING_ARRAY_LAYERS
-                                                                    }));
-        }
-
-        //Set the barriers.
-        if(barriers.size() > 0)
-        {
-            vkCmdPipelineBarrier(commandBuffer, generatingStages, consumingStages, 0, 0,
-                                 nullptr, 0, nullptr, static_cast<uint32_t>(barriers.size()),
-                                 barriers.data());
-        }
+        BarrierBatch barriers(commandBuffer);
+        for(const ImageTransition &imageTransition : imageTransitions)
+            barriers.addImage(generatingStages, consumingStages, imageTransition);
     }
 
     /**
@@ -1293,8 +1285,9 @@ namespace Raven
      * @param destinationBufferNewAccess
      * @param destinationBufferGeneratingStages
      * @param destinationBufferConsumingStages
-     * @param queue
+     * @param submitter Submitter of the queue the copy is done on.
      * @param cmdBuffer
+     * @param syncObjects The pool the fence of the submit is taken from.
      * @param signalSemaphores
      * @return
      */
@@ -1308,8 +1301,9 @@ namespace Raven
                                        VkAccessFlags destinationBufferNewAccess,
                                        VkPipelineStageFlags destinationBufferGeneratingStages,
                                        VkPipelineStageFlags destinationBufferConsumingStages,
-                                       VkQueue queue,
+                                       QueueSubmitter &submitter,
                                        VkCommandBuffer cmdBuffer,
+                                       SyncObjectPool &syncObjects,
                                        std::vector<VkSemaphore> signalSemaphores)
     {
         //Create staging buffer resources.
@@ -1331,13 +1325,13 @@ namespace Raven
         if(!CommandBufferManager::beginCommandBuffer(cmdBuffer, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT))
             return false;
 
-        //Set buffer memory barrier so that the transfer can begin.
-        BufferTransition firstTransition = { destinationBuffer, destinationBufferCurrentAccess,
-                                             VK_ACCESS_TRANSFER_WRITE_BIT, VK_QUEUE_FAMILY_IGNORED,
-                                             VK_QUEUE_FAMILY_IGNORED};
-
-        setBufferMemoryBarriers(cmdBuffer, destinationBufferGeneratingStages, VK_PIPELINE_STAGE_TRANSFER_BIT,
-                                {firstTransition});
+        //Only the written range needs a barrier so that the transfer can begin.
+        BarrierBatch barriers(cmdBuffer);
+        barriers.addBuffer(destinationBufferGeneratingStages, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                           {destinationBuffer, destinationBufferCurrentAccess, VK_ACCESS_TRANSFER_WRITE_BIT,
+                            VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED},
+                           destinationOffset, dataSize);
+        barriers.flush();
 
         //After the destination buffer has been set to the correct usage, start the data transfer from the
         //staging buffer.
@@ -1346,33 +1340,37 @@ namespace Raven
             return false;
 
         //After the transfer is complete, change the destination buffer usage again so that it can be read from.
-        BufferTransition secondTransition = {destinationBuffer, VK_ACCESS_TRANSFER_WRITE_BIT,
-                                             destinationBufferNewAccess, VK_QUEUE_FAMILY_IGNORED,
-                                             VK_QUEUE_FAMILY_IGNORED};
-        setBufferMemoryBarriers(cmdBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, destinationBufferConsumingStages,
-                                {secondTransition});
+        barriers.addBuffer(VK_PIPELINE_STAGE_TRANSFER_BIT, destinationBufferConsumingStages,
+                           {destinationBuffer, VK_ACCESS_TRANSFER_WRITE_BIT, destinationBufferNewAccess,
+                            VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED},
+                           destinationOffset, dataSize);
+        barriers.flush();
 
         if(!CommandBufferManager::endCommandBuffer(cmdBuffer))
             return false;
 
-        //Create a fence for the submit.
+        //Take a fence for the submit from the pool.
         VkFence fence;
-        if(!createFence(logicalDevice, VK_FALSE, fence))
+        if(!syncObjects.acquireFence(fence))
             return false;
 
-        //Submit the task to a queue.
-        VkSubmitInfo submitInfo = VulkanStructures::submitInfo({cmdBuffer}, {}, {}, signalSemaphores);
-        if(!CommandBufferManager::submitCommandBuffers(queue, 1, submitInfo, fence))
+        //Submit the task to a queue, together with whatever else has been queued for it.
+        std::vector<VkCommandBuffer> cmdBuffers = {cmdBuffer};
+        VkSubmitInfo submitInfo = VulkanStructures::submitInfo(cmdBuffers, {}, {}, signalSemaphores);
+        if(!submitter.submit(submitInfo, fence))
+        {
+            syncObjects.releaseFence(fence);
             return false;
+        }
 
         //Wait for the fence to make sure the task was complete.
         if(!waitForFences(logicalDevice, 500000000, VK_FALSE, {fence}))
                 return false;
 
-        //Remember to clean afterwards by destroying the staging buffer and the fence.
+        //Remember to clean afterwards by destroying the staging buffer and returning the fence.
         destroyBuffer(logicalDevice, stagingBufferObject.buffer);
         freeMemory(logicalDevice, stagingMemory);
-        destroyFence(logicalDevice, fence);
+        syncObjects.releaseFence(fence);
 
         return true;
     }
@@ -1510,6 +1508,36 @@ namespace Raven
         return true;
     }
 
+    /**
+     * @brief Reads a SPIR-V file and creates a shader module from it. A file that is
+     *        missing or empty fails the same way as a module that can not be created.
+     * @param logicalDevice
+     * @param filename
+     * @param module
+     * @return False if the file could not be read or the module could not be created.
+     */
+    bool loadShaderModule(const VkDevice logicalDevice,
+                          const std::string &filename,
+                          VkShaderModule &module) noexcept
+    {
+        std::vector<char> sourceCode;
+        try
+        {
+            sourceCode = FileIO::readBinaryFile(filename);
+        }
+        catch(const std::exception&)
+        {
+            sourceCode.clear();
+        }
+
+        if(sourceCode.empty())
+        {
+            std::cerr << "Failed to read shader file " << filename << "!" << std::endl;
+            return false;
+        }
+        return createShaderModule(logicalDevice, sourceCode, module);
+    }
+
     /**
      * @brief Destroys a shader module. Shader modules can be destroyed after a pipeline has been
      *        created. They are not required during pipeline execution.